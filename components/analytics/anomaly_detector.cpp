@@ -0,0 +1,176 @@
+#include "anomaly_detector.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <esp_log.h>
+
+static const char* TAG = "anomaly";
+
+namespace analytics {
+
+static uint32_t isqrt64(uint64_t v) {
+    uint64_t result = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= result + bit) {
+            v -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)result;
+}
+
+AnomalyDetector& AnomalyDetector::getInstance() {
+    static AnomalyDetector instance;
+    return instance;
+}
+
+const char* AnomalyDetector::levelToString(Level level) {
+    switch (level) {
+        case NORMAL: return "normal";
+        case WATCH: return "watch";
+        case WARN: return "warn";
+        case ALARM: return "alarm";
+        default: return "unknown";
+    }
+}
+
+void AnomalyDetector::reset() {
+    cell_count_ = 0;
+    samples_ = 0;
+    memset(mean_q8_, 0, sizeof(mean_q8_));
+    memset(var_q16_, 0, sizeof(var_q16_));
+    level_ = NORMAL;
+    candidate_ = NORMAL;
+    candidate_count_ = 0;
+    event_pending_ = false;
+}
+
+AnomalyDetector::Level AnomalyDetector::grade(uint32_t abs_z_q8) const {
+    if (abs_z_q8 >= config_.alarm_z_q8) return ALARM;
+    if (abs_z_q8 >= config_.warn_z_q8) return WARN;
+    if (abs_z_q8 >= config_.watch_z_q8) return WATCH;
+    return NORMAL;
+}
+
+void AnomalyDetector::update(output::BMSSnapshot& data) {
+    data.anomaly_level = NORMAL;
+    data.anomaly_cell = 0;
+    data.anomaly_z = 0.0f;
+
+    int cells = data.cell_count;
+    if (cells > MAX_CELLS) cells = MAX_CELLS;
+    if (cells < 3) {
+        return;  // a median of fewer than three cells says nothing about peers
+    }
+    if (cells != cell_count_) {
+        reset();
+        cell_count_ = cells;
+    }
+
+    int32_t mv[MAX_CELLS];
+    for (int i = 0; i < cells; ++i) {
+        mv[i] = (int32_t)(data.cell_v[static_cast<size_t>(i)] * 1000.0f + 0.5f);
+    }
+
+    // Pack median (mean of the two middle values for an even count)
+    int32_t sorted[MAX_CELLS];
+    memcpy(sorted, mv, sizeof(int32_t) * cells);
+    const int mid = cells / 2;
+    std::nth_element(sorted, sorted + mid, sorted + cells);
+    int32_t median = sorted[mid];
+    if ((cells & 1) == 0) {
+        median = (median + *std::max_element(sorted, sorted + mid)) / 2;
+    }
+
+    const bool first = samples_ == 0;
+    const bool warmed = samples_ >= config_.warmup_samples;
+    const int64_t min_sigma_q8 = (int64_t)config_.min_sigma_mv << 8;
+
+    uint32_t worst_abs_z = 0;
+    int32_t worst_z = 0;
+    int worst_cell = 0;
+    for (int i = 0; i < cells; ++i) {
+        const int32_t dev_q8 = (mv[i] - median) * 256;
+        if (first) {
+            mean_q8_[i] = dev_q8;
+            var_q16_[i] = (min_sigma_q8 * 2) * (min_sigma_q8 * 2);
+            continue;
+        }
+
+        const int64_t resid_q8 = (int64_t)dev_q8 - mean_q8_[i];
+        int64_t sigma_q8 = isqrt64((uint64_t)var_q16_[i]);
+        if (sigma_q8 < min_sigma_q8) sigma_q8 = min_sigma_q8;
+        const int32_t z_q8 = (int32_t)(resid_q8 * 256 / sigma_q8);
+        const uint32_t abs_z = (uint32_t)(z_q8 < 0 ? -z_q8 : z_q8);
+
+        if (warmed && abs_z > worst_abs_z) {
+            worst_abs_z = abs_z;
+            worst_z = z_q8;
+            worst_cell = i;
+        }
+
+        // Anomalous samples barely move the mean and leave the noise estimate alone,
+        // so a drifting cell is neither absorbed nor allowed to inflate its own sigma
+        const bool anomalous = warmed && abs_z >= config_.watch_z_q8;
+        const int extra = anomalous ? config_.anomalous_extra_shift : 0;
+        mean_q8_[i] += (int32_t)(resid_q8 / (1LL << (config_.mean_shift + extra)));
+        if (!anomalous) {
+            var_q16_[i] += (resid_q8 * resid_q8 - var_q16_[i]) / (1LL << config_.var_shift);
+        }
+    }
+    if (samples_ < UINT32_MAX) samples_++;
+    if (!warmed) {
+        return;
+    }
+
+    // Debounced grading
+    const Level g = grade(worst_abs_z);
+    if (g != level_) {
+        if (g == candidate_) {
+            candidate_count_++;
+        } else {
+            candidate_ = g;
+            candidate_count_ = 1;
+        }
+        if (candidate_count_ >= config_.persist_samples) {
+            ESP_LOGW(TAG, "Cell anomaly %s -> %s (cell %d, z=%.1f)", levelToString(level_),
+                     levelToString(g), worst_cell + 1, worst_z / 256.0f);
+            level_ = g;
+            candidate_count_ = 0;
+            event_pending_ = true;
+            event_level_ = g;
+            event_cell_ = worst_cell + 1;
+            event_z_q8_ = worst_z;
+            event_dev_mv_ = mv[worst_cell] - median;
+        }
+    } else {
+        candidate_count_ = 0;
+    }
+
+    data.anomaly_level = level_;
+    data.anomaly_cell = level_ != NORMAL ? worst_cell + 1 : 0;
+    data.anomaly_z = worst_z / 256.0f;
+}
+
+bool AnomalyDetector::takeEvent(std::string& json) {
+    if (!event_pending_) {
+        return false;
+    }
+    event_pending_ = false;
+    char buf[160];
+    snprintf(buf, sizeof(buf),
+             "{\"level\":\"%s\",\"severity\":%d,\"cell\":%d,\"z\":%.2f,\"deviation_mv\":%ld}",
+             levelToString(event_level_), (int)event_level_, event_cell_,
+             event_z_q8_ / 256.0f, (long)event_dev_mv_);
+    json = buf;
+    return true;
+}
+
+} // namespace analytics
@@ -0,0 +1,220 @@
+#include "cell_stats.h"
+#include <string.h>
+#include <math.h>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+
+static const char* TAG = "cell_stats";
+
+namespace analytics {
+
+// Window lengths; each is split into BUCKETS_PER_WINDOW buckets
+static constexpr uint64_t WINDOW_LENGTH_US[output::CELL_STATS_WINDOWS] = {
+    60ULL * 1000000ULL,
+    3600ULL * 1000000ULL,
+    86400ULL * 1000000ULL
+};
+
+static constexpr uint32_t EMPTY_EPOCH = UINT32_MAX;
+
+CellStats& CellStats::getInstance() {
+    static CellStats instance;
+    return instance;
+}
+
+CellStats::CellStats() {
+    // The long windows are touched once per sample: PSRAM is fast enough
+    const bool psram = heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0;
+    for (int w = 0; w < output::CELL_STATS_WINDOWS; ++w) {
+        Window& window = windows_[w];
+        window.bucket_span_us = WINDOW_LENGTH_US[w] / BUCKETS_PER_WINDOW;
+        if (w == static_cast<int>(StatsWindow::ONE_MINUTE)) {
+            window.buckets = minute_buckets_;
+            continue;
+        }
+        window.buckets = static_cast<Bucket*>(heap_caps_calloc(BUCKETS_PER_WINDOW, sizeof(Bucket),
+                                                               psram ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT));
+        if (!window.buckets) {
+            ESP_LOGW(TAG, "No memory for window %d (%u bytes)", w,
+                     (unsigned)(BUCKETS_PER_WINDOW * sizeof(Bucket)));
+        }
+    }
+    reset();
+}
+
+void CellStats::reset() {
+    for (auto& window : windows_) {
+        if (!window.buckets) {
+            continue;
+        }
+        for (int i = 0; i < BUCKETS_PER_WINDOW; ++i) {
+            clearBucket(window.buckets[i], EMPTY_EPOCH);
+        }
+    }
+    cell_count_ = 0;
+}
+
+void CellStats::clearBucket(Bucket& b, uint32_t epoch) {
+    memset(&b, 0, sizeof(b));
+    b.epoch = epoch;
+    for (int i = 0; i < MAX_CELLS; ++i) {
+        b.min[i] = UINT16_MAX;
+    }
+}
+
+void CellStats::accumulate(Bucket& b, const uint16_t* mv, int cells, uint32_t t_ms) {
+    const int64_t t = t_ms;
+    b.count++;
+    b.sum_t += (uint64_t)t;
+    b.sum_tt += (uint64_t)(t * t);
+
+    // Plain loops over contiguous arrays; no per-cell branches
+    for (int i = 0; i < cells; ++i) {
+        const int64_t v = mv[i];
+        b.sum[i] += v;
+        b.sum_sq[i] += v * v;
+        b.sum_tv[i] += t * v;
+    }
+    for (int i = 0; i < cells; ++i) {
+        b.min[i] = mv[i] < b.min[i] ? mv[i] : b.min[i];
+        b.max[i] = mv[i] > b.max[i] ? mv[i] : b.max[i];
+    }
+}
+
+void CellStats::update(const output::BMSSnapshot& data) {
+    int cells = data.cell_count;
+    if (cells <= 0) {
+        return;
+    }
+    if (cells > MAX_CELLS) {
+        cells = MAX_CELLS;
+    }
+    if (cells != cell_count_) {
+        // Different pack layout: old sums are meaningless
+        reset();
+        cell_count_ = cells;
+    }
+
+    uint16_t mv[MAX_CELLS];
+    for (int i = 0; i < cells; ++i) {
+        float v = data.cell_v[static_cast<size_t>(i)] * 1000.0f + 0.5f;
+        mv[i] = v <= 0.0f ? 0 : (v >= 65535.0f ? UINT16_MAX : static_cast<uint16_t>(v));
+    }
+
+    const uint64_t now_us = data.now_time_us;
+    for (auto& window : windows_) {
+        if (!window.buckets) {
+            continue;
+        }
+        const uint32_t epoch = static_cast<uint32_t>(now_us / window.bucket_span_us);
+        Bucket& bucket = window.buckets[epoch % BUCKETS_PER_WINDOW];
+        if (bucket.epoch != epoch) {
+            clearBucket(bucket, epoch);
+        }
+        const uint32_t t_ms = static_cast<uint32_t>((now_us - (uint64_t)epoch * window.bucket_span_us) / 1000ULL);
+        accumulate(bucket, mv, cells, t_ms);
+    }
+}
+
+bool CellStats::getWindow(StatsWindow which, uint64_t now_us, CellWindowStats& out) const {
+    out = CellWindowStats{};
+    const int w = static_cast<int>(which);
+    if (w < 0 || w >= output::CELL_STATS_WINDOWS || cell_count_ == 0 || !windows_[w].buckets) {
+        return false;
+    }
+    const Window& window = windows_[w];
+    const int cells = cell_count_;
+
+    // The window ends at the query time, so after a gap in sampling the
+    // buckets it has outlived drop out instead of standing in for the window
+    const uint32_t newest = static_cast<uint32_t>(now_us / window.bucket_span_us);
+    const uint32_t oldest = newest >= (uint32_t)(BUCKETS_PER_WINDOW - 1) ? newest - (BUCKETS_PER_WINDOW - 1) : 0;
+    const double span_ms = (double)(window.bucket_span_us / 1000ULL);
+
+    // Combine bucket sums on a common time origin (start of the oldest bucket)
+    double n = 0, st = 0, stt = 0;
+    double sv[MAX_CELLS] = {}, svv[MAX_CELLS] = {}, stv[MAX_CELLS] = {};
+    uint16_t vmin[MAX_CELLS], vmax[MAX_CELLS];
+    for (int i = 0; i < cells; ++i) {
+        vmin[i] = UINT16_MAX;
+        vmax[i] = 0;
+    }
+    uint32_t first_epoch = newest;
+    uint32_t last_epoch = oldest;
+    for (int k = 0; k < BUCKETS_PER_WINDOW; ++k) {
+        const Bucket& b = window.buckets[k];
+        if (b.epoch == EMPTY_EPOCH || b.count == 0 || b.epoch < oldest || b.epoch > newest) {
+            continue;
+        }
+        first_epoch = b.epoch < first_epoch ? b.epoch : first_epoch;
+        last_epoch = b.epoch > last_epoch ? b.epoch : last_epoch;
+        const double off = (double)(b.epoch - oldest) * span_ms;
+        const double c = (double)b.count;
+        n += c;
+        st += (double)b.sum_t + c * off;
+        stt += (double)b.sum_tt + 2.0 * off * (double)b.sum_t + c * off * off;
+        for (int i = 0; i < cells; ++i) {
+            sv[i] += (double)b.sum[i];
+            svv[i] += (double)b.sum_sq[i];
+            stv[i] += (double)b.sum_tv[i] + off * (double)b.sum[i];
+            vmin[i] = b.min[i] < vmin[i] ? b.min[i] : vmin[i];
+            vmax[i] = b.max[i] > vmax[i] ? b.max[i] : vmax[i];
+        }
+    }
+
+    if (n == 0) {
+        return false;
+    }
+
+    out.samples = (uint32_t)n;
+    out.cell_count = cells;
+    out.span_s = (uint32_t)(((double)(last_epoch - first_epoch) + 1.0) * span_ms / 1000.0);
+
+    const double denom = n * stt - st * st;
+    for (int i = 0; i < cells; ++i) {
+        const double mean = sv[i] / n;
+        double var = svv[i] / n - mean * mean;
+        if (var < 0) var = 0;
+        out.mean_v[i] = (float)(mean / 1000.0);
+        out.stddev_v[i] = (float)(sqrt(var) / 1000.0);
+        out.min_v[i] = vmin[i] / 1000.0f;
+        out.max_v[i] = vmax[i] / 1000.0f;
+        // Least-squares slope in mV/ms, reported as mV/h
+        out.slope_mv_per_h[i] = (n >= 2 && denom > 0) ? (float)((n * stv[i] - st * sv[i]) / denom * 3600000.0) : 0.0f;
+    }
+    return true;
+}
+
+void CellStats::fillSummary(output::BMSSnapshot& data) const {
+    CellWindowStats stats;
+    for (int w = 0; w < output::CELL_STATS_WINDOWS; ++w) {
+        output::CellWindowSummary& summary = data.cell_stats[static_cast<size_t>(w)];
+        summary = output::CellWindowSummary{};
+        if (!getWindow(static_cast<StatsWindow>(w), data.now_time_us, stats)) {
+            continue;
+        }
+
+        float mean_min = stats.mean_v[0], mean_max = stats.mean_v[0];
+        float slope_avg = 0.0f;
+        for (int i = 0; i < stats.cell_count; ++i) {
+            mean_min = stats.mean_v[i] < mean_min ? stats.mean_v[i] : mean_min;
+            mean_max = stats.mean_v[i] > mean_max ? stats.mean_v[i] : mean_max;
+            summary.max_stddev_v = stats.stddev_v[i] > summary.max_stddev_v ? stats.stddev_v[i] : summary.max_stddev_v;
+            slope_avg += stats.slope_mv_per_h[i];
+        }
+        slope_avg /= (float)stats.cell_count;
+
+        // Drift relative to the pack: a cell tracking the others has ~0 here
+        for (int i = 0; i < stats.cell_count; ++i) {
+            float rel = stats.slope_mv_per_h[i] - slope_avg;
+            if (fabsf(rel) > fabsf(summary.drift_mv_per_h)) {
+                summary.drift_mv_per_h = rel;
+                summary.drift_cell = i + 1;
+            }
+        }
+        summary.samples = stats.samples;
+        summary.spread_v = mean_max - mean_min;
+    }
+}
+
+} // namespace analytics
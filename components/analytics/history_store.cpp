@@ -0,0 +1,253 @@
+#include "history_store.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+
+static const char* TAG = "history";
+
+namespace analytics {
+
+namespace {
+
+struct TierSpec {
+    uint32_t interval_s;
+    uint32_t capacity_psram;
+    uint32_t capacity_internal;
+};
+
+// PSRAM: 1 s x 1 h, 10 s x 24 h, 1 min x 7 d (~350 KB)
+// Internal RAM: 1 s x 5 min, 10 s x 1 h, 1 min x 12 h (~22 KB)
+constexpr TierSpec TIER_SPECS[HistoryStore::TIERS] = {
+    { 1, 3600, 300 },
+    { 10, 8640, 360 },
+    { 60, 10080, 720 },
+};
+
+template <typename T>
+T clampTo(float v, float lo, float hi) {
+    v = roundf(v);
+    return static_cast<T>(v < lo ? lo : (v > hi ? hi : v));
+}
+
+} // namespace
+
+HistoryStore& HistoryStore::getInstance() {
+    static HistoryStore instance;
+    return instance;
+}
+
+bool HistoryStore::init() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (initialized_) {
+        return true;
+    }
+
+    psram_ = heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0;
+    const uint32_t caps = psram_ ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT;
+    size_t total = 0;
+
+    for (int i = 0; i < TIERS; ++i) {
+        Tier& tier = tiers_[i];
+        tier = Tier{};
+        tier.interval_s = TIER_SPECS[i].interval_s;
+        tier.capacity = psram_ ? TIER_SPECS[i].capacity_psram : TIER_SPECS[i].capacity_internal;
+        tier.ring = static_cast<HistoryRecord*>(heap_caps_calloc(tier.capacity, sizeof(HistoryRecord), caps));
+        if (!tier.ring) {
+            ESP_LOGW(TAG, "No memory for tier %d (%lu records)", i, (unsigned long)tier.capacity);
+            tier.capacity = 0;
+            continue;
+        }
+        total += tier.capacity * sizeof(HistoryRecord);
+    }
+
+    initialized_ = total > 0;
+    ESP_LOGI(TAG, "History store: %u bytes in %s", (unsigned)total, psram_ ? "PSRAM" : "internal RAM");
+    return initialized_;
+}
+
+HistoryRecord HistoryStore::encode(const output::BMSSnapshot& data) {
+    HistoryRecord r = {};
+    r.t = data.real_timestamp > 0 ? (uint32_t)data.real_timestamp : (uint32_t)(data.now_time_us / 1000000ULL);
+    r.pack_cv = clampTo<uint16_t>(data.pack_voltage_v * 100.0f, 0, UINT16_MAX);
+    r.current_ca = clampTo<int16_t>(data.pack_current_a * 100.0f, INT16_MIN, INT16_MAX);
+    r.soc_half_pct = clampTo<uint8_t>(data.soc_pct * 2.0f, 0, 200);
+    r.max_temp_c = clampTo<int8_t>(data.max_temp_c, INT8_MIN, INT8_MAX);
+    r.min_cell_mv = clampTo<uint16_t>(data.min_cell_voltage_v * 1000.0f, 0, UINT16_MAX);
+    r.max_cell_mv = clampTo<uint16_t>(data.max_cell_voltage_v * 1000.0f, 0, UINT16_MAX);
+    r.flags = (data.charging_enabled ? FLAG_CHARGING_ENABLED : 0) |
+              (data.discharging_enabled ? FLAG_DISCHARGING_ENABLED : 0);
+    r.samples = 1;
+    return r;
+}
+
+void HistoryStore::fold(Accumulator& acc, const HistoryRecord& r) {
+    if (acc.count == 0) {
+        acc.min_cell_mv = r.min_cell_mv;
+        acc.max_cell_mv = r.max_cell_mv;
+        acc.max_temp_c = r.max_temp_c;
+    }
+    acc.count++;
+    acc.pack_cv += r.pack_cv;
+    acc.current_ca += r.current_ca;
+    acc.soc_half_pct += r.soc_half_pct;
+    acc.max_temp_c = r.max_temp_c > acc.max_temp_c ? r.max_temp_c : acc.max_temp_c;
+    acc.min_cell_mv = r.min_cell_mv < acc.min_cell_mv ? r.min_cell_mv : acc.min_cell_mv;
+    acc.max_cell_mv = r.max_cell_mv > acc.max_cell_mv ? r.max_cell_mv : acc.max_cell_mv;
+    acc.flags = r.flags;  // latest state wins
+}
+
+HistoryRecord HistoryStore::flush(const Tier& tier) {
+    const Accumulator& acc = tier.acc;
+    const int64_t n = acc.count;
+    HistoryRecord r = {};
+    r.t = acc.bucket * tier.interval_s;
+    r.pack_cv = (uint16_t)((acc.pack_cv + n / 2) / n);
+    r.current_ca = (int16_t)(acc.current_ca / n);
+    r.soc_half_pct = (uint8_t)((acc.soc_half_pct + n / 2) / n);
+    r.max_temp_c = (int8_t)acc.max_temp_c;
+    r.min_cell_mv = acc.min_cell_mv;
+    r.max_cell_mv = acc.max_cell_mv;
+    r.flags = acc.flags;
+    r.samples = n > 255 ? 255 : (uint8_t)n;
+    return r;
+}
+
+void HistoryStore::push(Tier& tier, const HistoryRecord& r) {
+    tier.ring[tier.head] = r;
+    tier.head = (tier.head + 1) % tier.capacity;
+    if (tier.count < tier.capacity) {
+        tier.count++;
+    }
+    tier.written++;
+}
+
+void HistoryStore::append(const output::BMSSnapshot& data) {
+    const HistoryRecord r = encode(data);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!initialized_) {
+        return;
+    }
+    for (auto& tier : tiers_) {
+        if (tier.capacity == 0) {
+            continue;
+        }
+        const uint32_t bucket = r.t / tier.interval_s;
+        if (tier.acc.count > 0 && bucket != tier.acc.bucket) {
+            push(tier, flush(tier));
+            tier.acc = Accumulator{};
+        }
+        tier.acc.bucket = bucket;
+        fold(tier.acc, r);
+    }
+}
+
+HistoryStore::Cursor HistoryStore::openCursor(int tier, uint32_t from, uint32_t to) {
+    Cursor cursor;
+    cursor.tier = tier;
+    cursor.from = from;
+    cursor.to = to;
+    return cursor;
+}
+
+size_t HistoryStore::read(Cursor& cursor, HistoryRecord* out, size_t max, bool* done) const {
+    if (done) *done = true;
+    if (cursor.tier < 0 || cursor.tier >= TIERS || !out || max == 0) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Tier& tier = tiers_[cursor.tier];
+    if (tier.count == 0) {
+        return 0;
+    }
+    // Ring slot of the record with write count p (written - count <= p < written)
+    auto at = [&tier](uint32_t p) -> const HistoryRecord& {
+        return tier.ring[(tier.head + tier.capacity - (tier.written - p)) % tier.capacity];
+    };
+
+    const uint32_t oldest = tier.written - tier.count;
+    if (!cursor.positioned) {
+        // Once per request: the first record at or after from
+        cursor.pos = tier.written;
+        for (uint32_t p = oldest; p != tier.written; ++p) {
+            if (at(p).t >= cursor.from) {
+                cursor.pos = p;
+                break;
+            }
+        }
+        cursor.positioned = true;
+    } else if ((int32_t)(cursor.pos - oldest) < 0) {
+        // Overwritten since the last read
+        cursor.pos = oldest;
+    }
+
+    size_t copied = 0;
+    while (cursor.pos != tier.written) {
+        const HistoryRecord& r = at(cursor.pos);
+        if (r.t > cursor.to) {
+            break;
+        }
+        if (copied == max) {
+            // More to come; resume at this record
+            if (done) *done = false;
+            break;
+        }
+        cursor.pos++;
+        if (r.t >= cursor.from) {
+            out[copied++] = r;
+        }
+    }
+    return copied;
+}
+
+int HistoryStore::selectTier(uint32_t resolution_s, uint32_t from_t) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int fallback = TIERS - 1;
+    for (int i = 0; i < TIERS; ++i) {
+        const Tier& tier = tiers_[i];
+        if (tier.interval_s < resolution_s || tier.count == 0) {
+            continue;
+        }
+        const uint32_t start = (tier.head + tier.capacity - tier.count) % tier.capacity;
+        if (tier.ring[start].t <= from_t) {
+            return i;
+        }
+        fallback = i;
+    }
+    return fallback;
+}
+
+bool HistoryStore::getTierInfo(int tier_index, TierInfo& info) const {
+    if (tier_index < 0 || tier_index >= TIERS) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Tier& tier = tiers_[tier_index];
+    info.interval_s = tier.interval_s;
+    info.capacity = tier.capacity;
+    info.count = tier.count;
+    info.oldest_t = 0;
+    info.newest_t = 0;
+    if (tier.count > 0) {
+        const uint32_t start = (tier.head + tier.capacity - tier.count) % tier.capacity;
+        info.oldest_t = tier.ring[start].t;
+        info.newest_t = tier.ring[(tier.head + tier.capacity - 1) % tier.capacity].t;
+    }
+    return true;
+}
+
+void HistoryStore::appendJsonRows(std::string& json, const HistoryRecord* records, size_t count) {
+    char buf[96];
+    for (size_t i = 0; i < count; ++i) {
+        const HistoryRecord& r = records[i];
+        snprintf(buf, sizeof(buf), "%s[%lu,%u,%d,%u,%d,%u,%u,%u,%u]", i ? "," : "",
+                 (unsigned long)r.t, r.pack_cv, r.current_ca, r.soc_half_pct, r.max_temp_c,
+                 r.min_cell_mv, r.max_cell_mv, r.flags, r.samples);
+        json += buf;
+    }
+}
+
+} // namespace analytics
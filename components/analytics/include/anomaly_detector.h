@@ -0,0 +1,93 @@
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+#include <stdint.h>
+#include <string>
+#include "bms_snapshot.h"
+
+namespace analytics {
+
+/**
+ * Streaming cell anomaly detector
+ *
+ * Each sample, every cell's deviation from the pack median (integer mV) is
+ * compared against that cell's own EWMA baseline of mean and variance, giving
+ * a z-score per cell. All arithmetic is fixed point (Q8 mean, Q16 variance,
+ * shift-based EWMA), so the cost is a median plus O(cells) integer ops.
+ *
+ * The worst cell's |z| is graded into NORMAL / WATCH / WARN / ALARM; a grade
+ * must hold for a few consecutive samples before it is raised, and a change
+ * of grade produces an event for the diagnostics channel.
+ */
+class AnomalyDetector {
+public:
+    static constexpr int MAX_CELLS = output::DEFAULT_MAX_CSV_CELLS;
+
+    enum Level : uint8_t {
+        NORMAL = 0,
+        WATCH = 1,
+        WARN = 2,
+        ALARM = 3
+    };
+
+    struct Config {
+        uint16_t watch_z_q8 = 3 * 256;     // |z| thresholds in Q8
+        uint16_t warn_z_q8 = 4 * 256 + 128;
+        uint16_t alarm_z_q8 = 6 * 256;
+        uint8_t mean_shift = 12;           // slow baseline (alpha 1/4096) so gradual drift stands out
+        uint8_t var_shift = 8;             // noise estimate adapts faster (alpha 1/256)
+        uint8_t anomalous_extra_shift = 3; // 8x slower mean while a cell looks anomalous (sigma frozen)
+        uint16_t min_sigma_mv = 2;         // floor; readings are quantized to 1 mV
+        uint16_t warmup_samples = 60;
+        uint8_t persist_samples = 3;       // consecutive samples before raising a grade
+    };
+
+    static AnomalyDetector& getInstance();
+
+    void setConfig(const Config& config) { config_ = config; }
+
+    /**
+     * Score one snapshot and fill anomaly_level / anomaly_cell / anomaly_z
+     */
+    void update(output::BMSSnapshot& data);
+
+    /**
+     * Take the pending grade-change event, if any
+     * @param json event payload (level, cell, z, deviation)
+     * @return true if an event was pending
+     */
+    bool takeEvent(std::string& json);
+
+    Level getLevel() const { return level_; }
+
+    void reset();
+
+    static const char* levelToString(Level level);
+
+private:
+    AnomalyDetector() = default;
+    AnomalyDetector(const AnomalyDetector&) = delete;
+    AnomalyDetector& operator=(const AnomalyDetector&) = delete;
+
+    Level grade(uint32_t abs_z_q8) const;
+
+    Config config_;
+    int cell_count_ = 0;
+    uint32_t samples_ = 0;
+    int32_t mean_q8_[MAX_CELLS] = {};     // EWMA of deviation from median, mV << 8
+    int64_t var_q16_[MAX_CELLS] = {};     // EWMA of squared residual, mV^2 << 16
+
+    Level level_ = NORMAL;
+    Level candidate_ = NORMAL;
+    uint8_t candidate_count_ = 0;
+
+    bool event_pending_ = false;
+    Level event_level_ = NORMAL;
+    int event_cell_ = 0;
+    int32_t event_z_q8_ = 0;
+    int32_t event_dev_mv_ = 0;
+};
+
+} // namespace analytics
+
+#endif // ANOMALY_DETECTOR_H
@@ -0,0 +1,105 @@
+#ifndef CELL_STATS_H
+#define CELL_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "bms_snapshot.h"
+
+namespace analytics {
+
+enum class StatsWindow : uint8_t {
+    ONE_MINUTE = 0,
+    ONE_HOUR = 1,
+    ONE_DAY = 2
+};
+
+/**
+ * Per-cell results for one rolling window
+ */
+struct CellWindowStats {
+    uint32_t samples = 0;
+    uint32_t span_s = 0;                                  // time covered by the contributing buckets
+    int cell_count = 0;
+    float mean_v[output::DEFAULT_MAX_CSV_CELLS] = {};
+    float stddev_v[output::DEFAULT_MAX_CSV_CELLS] = {};
+    float min_v[output::DEFAULT_MAX_CSV_CELLS] = {};
+    float max_v[output::DEFAULT_MAX_CSV_CELLS] = {};
+    float slope_mv_per_h[output::DEFAULT_MAX_CSV_CELLS] = {};
+};
+
+/**
+ * Incremental per-cell statistics over 1 min, 1 h and 24 h windows
+ *
+ * Each window is a ring of fixed time buckets. A bucket holds running sums
+ * per cell in structure-of-arrays layout with cell voltages in integer mV,
+ * so the per-sample update is one branch-free pass over each array.
+ * Memory is fixed and the update cost is O(cells) per window; expired
+ * buckets are cleared lazily when the ring advances, and queries only
+ * combine the buckets still inside the window at the query time.
+ * The 1 min ring is embedded; the 1 h and 24 h rings are allocated once,
+ * in PSRAM when the board has it.
+ */
+class CellStats {
+public:
+    static constexpr int MAX_CELLS = output::DEFAULT_MAX_CSV_CELLS;
+    static constexpr int BUCKETS_PER_WINDOW = 12;
+
+    static CellStats& getInstance();
+
+    /**
+     * Feed one snapshot (uses now_time_us, cell_count and cell_v)
+     */
+    void update(const output::BMSSnapshot& data);
+
+    /**
+     * Compute full per-cell results for a window
+     * @param now_us query time (esp_timer clock, as in now_time_us); buckets
+     *               that have aged out of the window by then are skipped
+     * @return false if the window holds no samples in that span
+     */
+    bool getWindow(StatsWindow window, uint64_t now_us, CellWindowStats& out) const;
+
+    /**
+     * Fill the compact per-window summary carried in the snapshot, as of
+     * its now_time_us
+     */
+    void fillSummary(output::BMSSnapshot& data) const;
+
+    /**
+     * Drop all history (e.g. after a cell count change)
+     */
+    void reset();
+
+private:
+    CellStats();
+    CellStats(const CellStats&) = delete;
+    CellStats& operator=(const CellStats&) = delete;
+
+    struct Bucket {
+        uint32_t epoch;          // bucket index since boot; UINT32_MAX = empty
+        uint32_t count;
+        uint64_t sum_t;          // ms since bucket start
+        uint64_t sum_tt;
+        int64_t sum[MAX_CELLS];  // mV
+        int64_t sum_sq[MAX_CELLS];
+        int64_t sum_tv[MAX_CELLS];
+        uint16_t min[MAX_CELLS];
+        uint16_t max[MAX_CELLS];
+    };
+
+    struct Window {
+        uint64_t bucket_span_us;
+        Bucket* buckets;         // BUCKETS_PER_WINDOW, or nullptr if allocation failed
+    };
+
+    static void clearBucket(Bucket& b, uint32_t epoch);
+    static void accumulate(Bucket& b, const uint16_t* mv, int cells, uint32_t t_ms);
+
+    Window windows_[output::CELL_STATS_WINDOWS];
+    Bucket minute_buckets_[BUCKETS_PER_WINDOW];
+    int cell_count_ = 0;
+};
+
+} // namespace analytics
+
+#endif // CELL_STATS_H
@@ -0,0 +1,150 @@
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <mutex>
+#include "bms_snapshot.h"
+
+namespace analytics {
+
+/**
+ * Compact fixed-point history record (16 bytes)
+ */
+struct HistoryRecord {
+    uint32_t t;              // unix seconds (start of the bucket for downsampled tiers)
+    uint16_t pack_cv;        // pack voltage, 10 mV
+    int16_t current_ca;      // pack current, 10 mA, charge positive
+    uint8_t soc_half_pct;    // SoC, 0.5 %
+    int8_t max_temp_c;
+    uint16_t min_cell_mv;
+    uint16_t max_cell_mv;
+    uint8_t flags;           // FLAG_* below
+    uint8_t samples;         // raw samples folded in (saturates at 255)
+};
+static_assert(sizeof(HistoryRecord) == 16, "HistoryRecord must stay 16 bytes");
+
+/**
+ * Multi-tier in-memory history for dashboard backfill
+ *
+ * Every tier is a ring of HistoryRecord at a fixed interval. Samples are
+ * folded into a per-tier accumulator and written out as one averaged record
+ * (min/max for cell extremes) when the sample crosses into the next interval,
+ * so downsampling happens on the fly without re-reading finer tiers.
+ *
+ * Ring storage comes from PSRAM when present (1 s x 1 h, 10 s x 24 h,
+ * 1 min x 7 d); otherwise reduced internal-RAM tiers are used.
+ */
+class HistoryStore {
+public:
+    static constexpr int TIERS = 3;
+    static constexpr uint8_t FLAG_CHARGING_ENABLED = 0x01;
+    static constexpr uint8_t FLAG_DISCHARGING_ENABLED = 0x02;
+
+    /**
+     * Read position of one backfill request, so each chunk resumes where the
+     * previous one stopped instead of rescanning the ring
+     */
+    struct Cursor {
+        int tier = -1;
+        uint32_t from = 0;
+        uint32_t to = 0;
+        uint32_t pos = 0;          // tier write count of the next record to read
+        bool positioned = false;   // pos found (first read scans for from)
+    };
+
+    struct TierInfo {
+        uint32_t interval_s;
+        uint32_t capacity;
+        uint32_t count;
+        uint32_t oldest_t;
+        uint32_t newest_t;
+    };
+
+    static HistoryStore& getInstance();
+
+    /**
+     * Allocate the tier rings
+     * @return false if no memory could be allocated (appends become no-ops)
+     */
+    bool init();
+
+    /**
+     * Fold one snapshot into every tier (uses real_timestamp)
+     */
+    void append(const output::BMSSnapshot& data);
+
+    /**
+     * Start reading the records of a tier with from <= t <= to
+     */
+    static Cursor openCursor(int tier, uint32_t from, uint32_t to);
+
+    /**
+     * Copy up to max records from the cursor on, oldest first, and advance it
+     * Records overwritten since the previous read are skipped.
+     * @param done set to true when the range is exhausted
+     * @return number of records copied
+     */
+    size_t read(Cursor& cursor, HistoryRecord* out, size_t max, bool* done) const;
+
+    /**
+     * Finest tier with interval >= resolution_s that still reaches back to from_t
+     * (falls back to the coarsest tier)
+     */
+    int selectTier(uint32_t resolution_s, uint32_t from_t) const;
+
+    bool getTierInfo(int tier, TierInfo& info) const;
+
+    /**
+     * Append records as compact JSON rows: [t,pack_cv,current_ca,soc_half_pct,
+     * max_temp_c,min_cell_mv,max_cell_mv,flags,samples],...
+     */
+    static void appendJsonRows(std::string& json, const HistoryRecord* records, size_t count);
+
+    static constexpr const char* JSON_FIELDS =
+        "[\"t\",\"pack_cv\",\"current_ca\",\"soc_half_pct\",\"max_temp_c\",\"min_cell_mv\",\"max_cell_mv\",\"flags\",\"samples\"]";
+
+    bool isPsram() const { return psram_; }
+
+private:
+    HistoryStore() = default;
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    struct Accumulator {
+        uint32_t bucket;
+        uint32_t count;
+        int64_t pack_cv;
+        int64_t current_ca;
+        uint32_t soc_half_pct;
+        int32_t max_temp_c;
+        uint16_t min_cell_mv;
+        uint16_t max_cell_mv;
+        uint8_t flags;
+    };
+
+    struct Tier {
+        uint32_t interval_s;
+        uint32_t capacity;
+        HistoryRecord* ring;
+        uint32_t head;     // next write slot
+        uint32_t count;
+        uint32_t written;  // records pushed since init
+        Accumulator acc;
+    };
+
+    static HistoryRecord encode(const output::BMSSnapshot& data);
+    static void fold(Accumulator& acc, const HistoryRecord& r);
+    static void push(Tier& tier, const HistoryRecord& r);
+    static HistoryRecord flush(const Tier& tier);
+
+    mutable std::mutex mutex_;
+    Tier tiers_[TIERS] = {};
+    bool initialized_ = false;
+    bool psram_ = false;
+};
+
+} // namespace analytics
+
+#endif // HISTORY_STORE_H
@@ -0,0 +1,98 @@
+#ifndef IR_ESTIMATOR_H
+#define IR_ESTIMATOR_H
+
+#include <stdint.h>
+#include <string>
+#include "bms_snapshot.h"
+
+namespace analytics {
+
+/**
+ * Online per-cell DC internal resistance estimator
+ *
+ * Detects pack current steps between consecutive samples and fits
+ * dV = R * dI per cell with recursive least squares (exponential forgetting).
+ * Because the regressor (dI) is shared by every cell, the RLS gain is a
+ * single scalar and the per-cell update is one multiply-add per cell.
+ *
+ * An hourly average per cell is kept in a 24-entry ring so the trend over
+ * the last day can be reported alongside the current estimate.
+ */
+class IREstimator {
+public:
+    static constexpr int MAX_CELLS = output::DEFAULT_MAX_CSV_CELLS;
+    static constexpr int TREND_HOURS = 24;
+
+    struct Config {
+        float min_step_a = 2.0f;           // smallest |dI| treated as a load step
+        uint32_t max_step_gap_ms = 3000;   // samples further apart mix in OCV drift
+        float forgetting = 0.98f;          // RLS forgetting factor per step
+        float max_ir_mohm = 200.0f;        // reject physically implausible fits
+    };
+
+    static IREstimator& getInstance();
+
+    void setConfig(const Config& config) { config_ = config; }
+
+    /**
+     * Feed one snapshot; runs an RLS step when a current step is detected
+     */
+    void update(const output::BMSSnapshot& data);
+
+    /**
+     * Copy current estimates into the snapshot (cell_ir_mohm, ir_steps)
+     */
+    void fillSnapshot(output::BMSSnapshot& data) const;
+
+    /**
+     * Build the hourly report once per hour
+     * @param now_us esp_timer time
+     * @param json output payload (estimate and 24 h trend per cell)
+     * @return true when a report was produced
+     */
+    bool takeHourlyReport(uint64_t now_us, std::string& json);
+
+    float getResistanceMohm(int cell) const;
+
+    /**
+     * Change in resistance over the trend ring (newest - oldest hour)
+     */
+    float getTrendMohm(int cell) const;
+
+    uint32_t getStepCount() const { return steps_; }
+
+    void reset();
+
+private:
+    IREstimator();
+    IREstimator(const IREstimator&) = delete;
+    IREstimator& operator=(const IREstimator&) = delete;
+
+    void closeHour();
+
+    Config config_;
+
+    // Previous sample
+    bool have_prev_ = false;
+    uint64_t prev_time_us_ = 0;
+    float prev_current_a_ = 0.0f;
+    int cell_count_ = 0;
+    float prev_cell_v_[MAX_CELLS] = {};
+
+    // RLS state: shared covariance, per-cell estimate in ohms
+    float p_ = 1.0f;
+    float r_ohm_[MAX_CELLS] = {};
+    uint32_t steps_ = 0;
+
+    // Hourly trend ring
+    uint64_t hour_start_us_ = 0;
+    float hour_sum_[MAX_CELLS] = {};
+    uint32_t hour_samples_ = 0;
+    float hourly_mohm_[TREND_HOURS][MAX_CELLS] = {};
+    int hourly_head_ = 0;
+    int hourly_filled_ = 0;
+};
+
+} // namespace analytics
+
+#endif // IR_ESTIMATOR_H
@@ -0,0 +1,106 @@
+#ifndef LOOP_TIMING_H
+#define LOOP_TIMING_H
+
+#include <stdint.h>
+#include <string>
+#include <mutex>
+
+namespace analytics {
+
+/**
+ * Timing of the poll loop: esp_timer tick -> task wake -> UART read ->
+ * snapshot build -> sink fan-out
+ *
+ * Every phase lands in a fixed-bucket histogram, so a cycle costs a handful
+ * of compares and no allocation. A cycle that ends after the next tick was
+ * due is a deadline miss; the ticks that fell inside it were collapsed into
+ * one task notification and are counted as missed ticks.
+ *
+ * Histograms cover the current publish window and are cleared when the window
+ * is taken for the diagnostics record; the miss counters also keep boot totals.
+ */
+class LoopTiming {
+public:
+    enum Phase {
+        PHASE_WAKE,     // tick to task running
+        PHASE_UART,     // readMeasurements()
+        PHASE_BUILD,    // getters, snapshot and analytics
+        PHASE_FANOUT,   // LogManager::send and dashboard publish
+        PHASE_CYCLE,    // tick to end of the cycle
+        PHASE_COUNT
+    };
+
+    static constexpr int BUCKETS = 14;   // 100 us .. 1 s, then everything above
+
+    struct Config {
+        uint32_t publish_interval_s = 300;   // diagnostics record cadence
+    };
+
+    /**
+     * One loop cycle, in microseconds; phases that did not run are 0
+     * (a failed read has no build or fan-out)
+     */
+    struct Cycle {
+        uint32_t wake_us = 0;
+        uint32_t uart_us = 0;
+        uint32_t build_us = 0;
+        uint32_t fanout_us = 0;
+        uint32_t cycle_us = 0;
+        uint32_t interval_us = 0;   // poll interval the cycle was scheduled with
+        bool read_ok = false;
+    };
+
+    static LoopTiming& getInstance();
+
+    void setConfig(const Config& config) { config_ = config; }
+
+    void record(const Cycle& cycle);
+
+    /**
+     * Current window as JSON: miss counters, bucket edges and per phase
+     * count, avg_us, max_us and bucket counts
+     */
+    void toJson(uint64_t now_us, std::string& json) const;
+
+    /**
+     * When the publish interval has elapsed, fill json with the window and
+     * start a new one
+     * @return true if json holds a record to publish
+     */
+    bool takeWindow(uint64_t now_us, std::string& json);
+
+    static int bucketOf(uint32_t us);
+    static const char* phaseName(Phase phase);
+
+private:
+    LoopTiming() = default;
+    LoopTiming(const LoopTiming&) = delete;
+    LoopTiming& operator=(const LoopTiming&) = delete;
+
+    struct PhaseStats {
+        uint32_t count;
+        uint32_t max_us;
+        uint64_t total_us;
+        uint32_t buckets[BUCKETS];
+    };
+
+    void add(Phase phase, uint32_t us);
+    void toJsonLocked(uint64_t now_us, std::string& json) const;
+
+    Config config_;
+    mutable std::mutex mutex_;
+    PhaseStats phases_[PHASE_COUNT] = {};
+    uint32_t cycles_ = 0;
+    uint32_t read_failures_ = 0;
+    uint32_t deadline_misses_ = 0;
+    uint32_t missed_ticks_ = 0;
+    uint32_t total_cycles_ = 0;
+    uint32_t total_deadline_misses_ = 0;
+    uint32_t total_missed_ticks_ = 0;
+    uint32_t last_interval_us_ = 0;
+    uint64_t window_start_us_ = 0;
+};
+
+} // namespace analytics
+
+#endif // LOOP_TIMING_H
@@ -0,0 +1,37 @@
+#ifndef NVS_BLOB_H
+#define NVS_BLOB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+namespace analytics {
+
+/**
+ * Versioned, CRC-checked NVS blob storage for small persistent state
+ *
+ * Each blob is stored as an 8-byte header (version, payload size, CRC32 of the
+ * payload) followed by the payload. A load only succeeds when all three match,
+ * so a layout change just bumps the version and starts from defaults.
+ */
+
+/**
+ * Load a blob
+ * @return ESP_OK, ESP_ERR_NVS_NOT_FOUND if absent, ESP_ERR_INVALID_VERSION /
+ *         ESP_ERR_INVALID_SIZE / ESP_ERR_INVALID_CRC if stale or corrupt
+ */
+esp_err_t nvsBlobLoad(const char* ns, const char* key, uint16_t version, void* data, size_t size);
+
+/**
+ * Store a blob (commits immediately)
+ */
+esp_err_t nvsBlobSave(const char* ns, const char* key, uint16_t version, const void* data, size_t size);
+
+/**
+ * Remove a blob; missing keys are not an error
+ */
+esp_err_t nvsBlobErase(const char* ns, const char* key);
+
+} // namespace analytics
+
+#endif // NVS_BLOB_H
@@ -0,0 +1,108 @@
+#ifndef RAINFLOW_H
+#define RAINFLOW_H
+
+#include <stdint.h>
+#include <string>
+#include <mutex>
+#include "bms_snapshot.h"
+
+namespace analytics {
+
+/**
+ * Streaming rainflow cycle counter over pack SoC
+ *
+ * SoC samples are reduced to turning points with a small hysteresis, and the
+ * turning points go through the four-point rainflow rule on a bounded residue
+ * stack. Every closed cycle lands in a depth-of-discharge x mean-SoC histogram
+ * counted in half cycles. Raw history is never kept; only the residue stack
+ * (at most RESIDUE_MAX points) and the histogram. Both are persisted in one
+ * record, with the open leg, so a cycle that spans a restart still closes.
+ *
+ * update() runs on the sampling task, toJson() may be called from a command
+ * handler on another task; both take the internal lock.
+ */
+class RainflowCounter {
+public:
+    static constexpr int DOD_BINS = 10;       // 10% DoD per bin
+    static constexpr int MEAN_BINS = 10;      // 10% mean SoC per bin
+    static constexpr int RESIDUE_MAX = 32;
+
+    struct Config {
+        float hysteresis_pct = 1.0f;           // SoC moves smaller than this are noise
+        uint32_t persist_interval_s = 6 * 3600;
+    };
+
+    static RainflowCounter& getInstance();
+
+    void setConfig(const Config& config) { config_ = config; }
+
+    /**
+     * Feed one snapshot (uses soc_pct and now_time_us); persists the
+     * histogram when it changed and the persist interval elapsed
+     */
+    void update(const output::BMSSnapshot& data);
+
+    /**
+     * Histogram as JSON: bin edges, counts[dod][mean] in cycles and totals
+     */
+    void toJson(std::string& json) const;
+
+    /**
+     * Sum of DoD over all counted cycles, in full-cycle equivalents
+     */
+    float getEquivalentFullCycles() const;
+
+    /**
+     * Write the histogram and residue to NVS now (e.g. before a planned restart)
+     */
+    void persist();
+
+    void reset();
+
+private:
+    RainflowCounter() = default;
+    RainflowCounter(const RainflowCounter&) = delete;
+    RainflowCounter& operator=(const RainflowCounter&) = delete;
+
+    void load();
+    void pushTurningPoint(float soc);
+    void countCycle(float range, float mean, uint32_t half_cycles);
+    void persistLocked();
+
+    struct Histogram {
+        uint32_t half_cycles[DOD_BINS][MEAN_BINS];
+        float equivalent_full_cycles;
+        uint32_t residue_overflows;
+    };
+
+    // Persisted state (NVS blob "rainflow"/"hist"); version 1 held only the histogram
+    struct Stored {
+        Histogram hist;
+        float residue[RESIDUE_MAX];
+        int32_t residue_len;
+        float extreme;
+        int8_t direction;
+        uint8_t have_sample;
+        uint8_t reserved[2];
+    };
+
+    Config config_;
+    mutable std::mutex mutex_;
+    Histogram hist_ = {};
+    bool loaded_ = false;
+    bool dirty_ = false;
+    uint64_t last_persist_us_ = 0;
+
+    // Turning point detection
+    bool have_sample_ = false;
+    float extreme_ = 0.0f;        // running extreme of the current leg
+    int direction_ = 0;           // +1 rising, -1 falling, 0 unknown
+
+    // Residue stack of unmatched reversals
+    float residue_[RESIDUE_MAX] = {};
+    int residue_len_ = 0;
+};
+
+} // namespace analytics
+
+#endif // RAINFLOW_H
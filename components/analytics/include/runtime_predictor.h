@@ -0,0 +1,53 @@
+#ifndef RUNTIME_PREDICTOR_H
+#define RUNTIME_PREDICTOR_H
+
+#include <stdint.h>
+#include "bms_snapshot.h"
+
+namespace analytics {
+
+/**
+ * Time-to-empty / time-to-full prediction
+ *
+ * Keeps separate EWMA-smoothed charge and discharge power (time-constant
+ * based, so irregular poll intervals weigh correctly) and divides the
+ * remaining energy to empty or to full by the smoothed power of the current
+ * direction. Constant time per sample.
+ */
+class RuntimePredictor {
+public:
+    struct Config {
+        float tau_s = 120.0f;          // EWMA time constant
+        float idle_power_w = 5.0f;     // |P| below this is neither charging nor discharging
+        uint32_t max_gap_s = 120;      // restart smoothing after longer gaps
+    };
+
+    static RuntimePredictor& getInstance();
+
+    void setConfig(const Config& config) { config_ = config; }
+
+    /**
+     * Feed one snapshot and fill time_to_empty_s / time_to_full_s
+     * Uses est_capacity_ah when available, otherwise full_capacity_ah.
+     */
+    void update(output::BMSSnapshot& data);
+
+    void reset();
+
+private:
+    RuntimePredictor() = default;
+    RuntimePredictor(const RuntimePredictor&) = delete;
+    RuntimePredictor& operator=(const RuntimePredictor&) = delete;
+
+    Config config_;
+    bool have_prev_ = false;
+    uint64_t prev_time_us_ = 0;
+    float charge_w_ = 0.0f;        // smoothed, positive
+    float discharge_w_ = 0.0f;     // smoothed, positive
+    bool charge_valid_ = false;
+    bool discharge_valid_ = false;
+};
+
+} // namespace analytics
+
+#endif // RUNTIME_PREDICTOR_H
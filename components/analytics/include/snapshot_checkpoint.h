@@ -0,0 +1,115 @@
+#ifndef SNAPSHOT_CHECKPOINT_H
+#define SNAPSHOT_CHECKPOINT_H
+
+#include <stdint.h>
+#include <string>
+#include <mutex>
+#include "bms_snapshot.h"
+
+namespace analytics {
+
+/**
+ * Last-known snapshot and lifetime peaks, kept across reboots
+ *
+ * The snapshot is packed into a fixed 128-byte record (cell voltages in mV,
+ * temperatures in 0.1 C) and written to NVS at most once per checkpoint
+ * interval, or after the shorter peak interval when a peak has risen. NVS
+ * spreads the writes over its pages, so at the default rate a 24 KB partition
+ * sees about one page erase a day.
+ *
+ * On boot restore() hands back the record as a snapshot flagged stale, so the
+ * dashboard and sinks have something to show before the first BMS read, and
+ * the peaks are seeded back into the driver so they survive a restart.
+ */
+class SnapshotCheckpoint {
+public:
+    struct Config {
+        uint32_t min_interval_s = 600;    // regular checkpoint cadence
+        uint32_t peak_interval_s = 60;    // earliest save after a new peak
+        float peak_margin = 0.05f;        // relative rise that counts as a new peak
+    };
+
+    static SnapshotCheckpoint& getInstance();
+
+    void setConfig(const Config& config) { config_ = config; }
+
+    /**
+     * Fill the measurement fields of out from the stored record and mark it
+     * stale; identity and uptime fields are left to the caller
+     * @return false if nothing valid is stored
+     */
+    bool restore(output::BMSSnapshot& out);
+
+    /**
+     * Feed one live snapshot (uses now_time_us); writes the record when a
+     * checkpoint is due. The first live snapshot after boot is always saved.
+     */
+    void update(const output::BMSSnapshot& data);
+
+    /**
+     * Write the latest snapshot now (e.g. before a planned restart)
+     */
+    void persist();
+
+    /**
+     * Writes since boot and age of the stored record, as JSON
+     */
+    void toJson(uint64_t now_us, std::string& json) const;
+
+    void reset();
+
+private:
+    SnapshotCheckpoint() = default;
+    SnapshotCheckpoint(const SnapshotCheckpoint&) = delete;
+    SnapshotCheckpoint& operator=(const SnapshotCheckpoint&) = delete;
+
+    // Persisted record (NVS blob "checkpoint"/"snap")
+    struct Record {
+        int64_t real_timestamp;
+        uint32_t boot_id;
+        uint32_t seq;
+        float total_energy_wh;
+        float pack_voltage_v;
+        float pack_current_a;
+        float soc_pct;
+        float power_w;
+        float full_capacity_ah;
+        float est_capacity_ah;
+        float soh_pct;
+        float peak_current_a;
+        float peak_power_w;
+        float min_temp_c;
+        float max_temp_c;
+        int32_t time_to_empty_s;
+        int32_t time_to_full_s;
+        uint16_t cell_mv[output::DEFAULT_MAX_CSV_CELLS];
+        int16_t temp_dc[output::DEFAULT_MAX_CSV_TEMPS];
+        uint8_t cell_count;
+        uint8_t temp_count;
+        uint8_t min_cell_num;
+        uint8_t max_cell_num;
+        uint8_t flags;
+        uint8_t anomaly_level;
+        uint8_t anomaly_cell;
+        uint8_t reserved;
+    };
+    static_assert(sizeof(Record) == 128, "checkpoint record layout changed, bump its version");
+
+    static void pack(const output::BMSSnapshot& data, Record& rec);
+    void saveLocked(uint64_t now_us);
+
+    Config config_;
+    mutable std::mutex mutex_;
+    Record latest_ = {};
+    bool have_latest_ = false;
+    bool saved_this_boot_ = false;
+    uint64_t last_save_us_ = 0;
+    float saved_peak_current_a_ = 0.0f;
+    float saved_peak_power_w_ = 0.0f;
+    uint32_t writes_ = 0;
+    uint32_t write_failures_ = 0;
+};
+
+} // namespace analytics
+
+#endif // SNAPSHOT_CHECKPOINT_H
@@ -0,0 +1,98 @@
+#ifndef SOH_ESTIMATOR_H
+#define SOH_ESTIMATOR_H
+
+#include <stdint.h>
+#include "bms_snapshot.h"
+
+namespace analytics {
+
+/**
+ * Incremental capacity / state-of-health estimator
+ *
+ * Integrates pack current between SoC anchor points (charge taper at full,
+ * empty, or a rested pack) and, when two anchors are far enough apart in SoC,
+ * turns the counted Ah into a capacity sample. Samples are blended into the
+ * estimate with an EWMA weighted by the SoC span they cover. Per-sample cost
+ * is O(1); the estimate is persisted to NVS only when it changes.
+ */
+class SohEstimator {
+public:
+    struct Config {
+        float rated_capacity_ah = 0.0f;   // 0 = adopt the first BMS full capacity seen
+        float min_span_pct = 40.0f;       // smallest SoC span that yields a capacity sample
+        float ewma_alpha = 0.2f;          // blend for a 100% span; scaled down for shorter ones
+        float full_soc_pct = 99.5f;
+        float empty_soc_pct = 2.0f;
+        float taper_current_a = 2.0f;     // charge current below this at full SoC = full anchor
+        float rest_current_a = 0.5f;
+        uint32_t rest_time_s = 1800;      // rest this long before trusting the BMS SoC
+        float rest_weight = 0.5f;         // rest anchors are less trustworthy than full/empty
+        uint32_t max_gap_s = 120;         // larger sample gaps invalidate the Ah count
+    };
+
+    static SohEstimator& getInstance();
+
+    void setConfig(const Config& config) { config_ = config; }
+
+    /**
+     * Feed one snapshot (current, SoC, time, BMS full capacity)
+     */
+    void update(const output::BMSSnapshot& data);
+
+    /**
+     * Copy est_capacity_ah and soh_pct into the snapshot
+     */
+    void fillSnapshot(output::BMSSnapshot& data) const;
+
+    float getCapacityAh() const { return state_.est_capacity_ah; }
+    float getSohPct() const;
+    uint32_t getUpdateCount() const { return state_.updates; }
+
+    /**
+     * Forget the learned capacity (NVS copy included)
+     */
+    void reset();
+
+private:
+    enum class Anchor : uint8_t { NONE, FULL, EMPTY, REST };
+
+    SohEstimator() = default;
+    SohEstimator(const SohEstimator&) = delete;
+    SohEstimator& operator=(const SohEstimator&) = delete;
+
+    void load();
+    void save();
+    Anchor detectAnchor(const output::BMSSnapshot& data, float dt_s);
+    void onAnchor(Anchor type, float soc_pct);
+
+    // Persisted state (NVS blob "soh"/"state")
+    struct State {
+        float est_capacity_ah;
+        float rated_capacity_ah;
+        float last_sample_ah;
+        uint32_t updates;
+    };
+
+    Config config_;
+    State state_ = {};
+    bool loaded_ = false;
+
+    // Ah counting between anchors
+    bool have_prev_ = false;
+    uint64_t prev_time_us_ = 0;
+    float prev_current_a_ = 0.0f;
+    bool has_anchor_ = false;
+    Anchor anchor_type_ = Anchor::NONE;
+    float anchor_soc_pct_ = 0.0f;
+    double ah_since_anchor_ = 0.0;
+
+    // Anchor edge detection
+    bool at_full_ = false;
+    bool at_empty_ = false;
+    float rest_s_ = 0.0f;
+    bool rest_anchored_ = false;
+};
+
+} // namespace analytics
+
+#endif // SOH_ESTIMATOR_H
@@ -0,0 +1,91 @@
+#ifndef STRESS_HISTOGRAM_H
+#define STRESS_HISTOGRAM_H
+
+#include <stdint.h>
+#include <string>
+#include <mutex>
+#include "bms_snapshot.h"
+
+namespace analytics {
+
+/**
+ * Cumulative time-at-stress histograms for warranty / degradation modelling
+ *
+ * Two fixed 2D histograms, each cell holding seconds spent in that bin:
+ *  - temperature x SoC
+ *  - C-rate x temperature
+ * Every sample charges the interval since the previous sample to the bins
+ * the previous sample fell in, so the cost is O(1) regardless of bin count.
+ *
+ * NVS commits are wear-aware: at most once per commit interval, and only when
+ * enough new time has accumulated since the last commit.
+ */
+class StressHistogram {
+public:
+    static constexpr int TEMP_BINS = 8;     // <0, 0-10, ..., 50-60, >=60 C
+    static constexpr int SOC_BINS = 10;     // 10% each
+    static constexpr int CRATE_BINS = 9;    // signed, discharge negative
+
+    struct Config {
+        uint32_t commit_interval_s = 3600;  // minimum time between NVS commits
+        uint32_t min_commit_delta_s = 600;  // skip commits that would add less than this
+        uint32_t max_gap_s = 120;           // longer gaps are not attributed to any bin
+    };
+
+    static StressHistogram& getInstance();
+
+    void setConfig(const Config& config) { config_ = config; }
+
+    /**
+     * Feed one snapshot (max_temp_c, soc_pct, pack_current_a, capacity)
+     */
+    void update(const output::BMSSnapshot& data);
+
+    /**
+     * Export both histograms as flat row-major arrays with their bin edges
+     */
+    void toJson(std::string& json) const;
+
+    /**
+     * Commit now if anything changed (e.g. before a planned restart)
+     */
+    void persist();
+
+    void reset();
+
+    static int tempBin(float temp_c);
+    static int socBin(float soc_pct);
+    static int crateBin(float c_rate);
+
+private:
+    StressHistogram() = default;
+    StressHistogram(const StressHistogram&) = delete;
+    StressHistogram& operator=(const StressHistogram&) = delete;
+
+    void load();
+    void commitLocked(uint64_t now_us);
+
+    // Persisted state (NVS blob "stress"/"hist"), seconds per bin
+    struct Bins {
+        uint32_t temp_soc_s[TEMP_BINS][SOC_BINS];
+        uint32_t crate_temp_s[CRATE_BINS][TEMP_BINS];
+        uint32_t total_s;
+    };
+
+    Config config_;
+    mutable std::mutex mutex_;
+    Bins bins_ = {};
+    uint32_t carry_ms_ = 0;         // sub-second remainder carried between samples
+    uint32_t committed_total_s_ = 0;
+    uint64_t last_commit_us_ = 0;
+    bool loaded_ = false;
+    bool have_prev_ = false;
+    uint64_t prev_time_us_ = 0;
+    int prev_temp_bin_ = 0;         // interval is charged to the state at its start
+    int prev_soc_bin_ = 0;
+    int prev_crate_bin_ = 0;
+};
+
+} // namespace analytics
+
+#endif // STRESS_HISTOGRAM_H
@@ -0,0 +1,148 @@
+#include "ir_estimator.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace analytics {
+
+static constexpr uint64_t HOUR_US = 3600ULL * 1000000ULL;
+static constexpr float P_INITIAL = 1.0f;      // covariance after reset (1/A^2)
+static constexpr float P_MAX = 100.0f;        // cap to bound the gain after long quiet periods
+
+IREstimator& IREstimator::getInstance() {
+    static IREstimator instance;
+    return instance;
+}
+
+IREstimator::IREstimator() {
+    reset();
+}
+
+void IREstimator::reset() {
+    have_prev_ = false;
+    cell_count_ = 0;
+    p_ = P_INITIAL;
+    steps_ = 0;
+    memset(r_ohm_, 0, sizeof(r_ohm_));
+    memset(hour_sum_, 0, sizeof(hour_sum_));
+    memset(hourly_mohm_, 0, sizeof(hourly_mohm_));
+    hour_samples_ = 0;
+    hour_start_us_ = 0;
+    hourly_head_ = 0;
+    hourly_filled_ = 0;
+}
+
+void IREstimator::update(const output::BMSSnapshot& data) {
+    int cells = data.cell_count;
+    if (cells <= 0) {
+        return;
+    }
+    if (cells > MAX_CELLS) {
+        cells = MAX_CELLS;
+    }
+    if (cells != cell_count_) {
+        reset();
+        cell_count_ = cells;
+    }
+
+    if (have_prev_) {
+        const float di = data.pack_current_a - prev_current_a_;
+        const uint64_t gap_us = data.now_time_us - prev_time_us_;
+        if (fabsf(di) >= config_.min_step_a && gap_us <= (uint64_t)config_.max_step_gap_ms * 1000ULL) {
+            // Scalar RLS gain, shared by all cells
+            const float lambda = config_.forgetting;
+            const float k = p_ * di / (lambda + di * p_ * di);
+            const float max_ohm = config_.max_ir_mohm / 1000.0f;
+            for (int i = 0; i < cells; ++i) {
+                const float dv = data.cell_v[static_cast<size_t>(i)] - prev_cell_v_[i];
+                float r = r_ohm_[i] + k * (dv - di * r_ohm_[i]);
+                // Clamp so a single glitched frame cannot poison the estimate
+                r_ohm_[i] = r < 0.0f ? 0.0f : (r > max_ohm ? max_ohm : r);
+            }
+            p_ = (p_ - k * di * p_) / lambda;
+            if (p_ > P_MAX) p_ = P_MAX;
+            steps_++;
+        }
+    }
+
+    prev_time_us_ = data.now_time_us;
+    prev_current_a_ = data.pack_current_a;
+    for (int i = 0; i < cells; ++i) {
+        prev_cell_v_[i] = data.cell_v[static_cast<size_t>(i)];
+    }
+    have_prev_ = true;
+
+    // Hourly averages for the trend ring (only once there is an estimate)
+    if (hour_start_us_ == 0) {
+        hour_start_us_ = data.now_time_us;
+    }
+    if (steps_ > 0) {
+        for (int i = 0; i < cells; ++i) {
+            hour_sum_[i] += r_ohm_[i] * 1000.0f;
+        }
+        hour_samples_++;
+    }
+}
+
+void IREstimator::closeHour() {
+    if (hour_samples_ > 0) {
+        for (int i = 0; i < MAX_CELLS; ++i) {
+            hourly_mohm_[hourly_head_][i] = hour_sum_[i] / (float)hour_samples_;
+        }
+        hourly_head_ = (hourly_head_ + 1) % TREND_HOURS;
+        if (hourly_filled_ < TREND_HOURS) hourly_filled_++;
+    }
+    memset(hour_sum_, 0, sizeof(hour_sum_));
+    hour_samples_ = 0;
+}
+
+float IREstimator::getResistanceMohm(int cell) const {
+    if (cell < 0 || cell >= cell_count_) {
+        return 0.0f;
+    }
+    return r_ohm_[cell] * 1000.0f;
+}
+
+float IREstimator::getTrendMohm(int cell) const {
+    if (cell < 0 || cell >= cell_count_ || hourly_filled_ < 2) {
+        return 0.0f;
+    }
+    const int newest = (hourly_head_ + TREND_HOURS - 1) % TREND_HOURS;
+    const int oldest = (hourly_head_ + TREND_HOURS - hourly_filled_) % TREND_HOURS;
+    return hourly_mohm_[newest][cell] - hourly_mohm_[oldest][cell];
+}
+
+void IREstimator::fillSnapshot(output::BMSSnapshot& data) const {
+    data.ir_steps = steps_;
+    for (int i = 0; i < cell_count_; ++i) {
+        data.cell_ir_mohm[static_cast<size_t>(i)] = steps_ > 0 ? r_ohm_[i] * 1000.0f : 0.0f;
+    }
+}
+
+bool IREstimator::takeHourlyReport(uint64_t now_us, std::string& json) {
+    if (hour_start_us_ == 0 || now_us - hour_start_us_ < HOUR_US) {
+        return false;
+    }
+    hour_start_us_ = now_us;
+    closeHour();
+
+    char buf[64];
+    json = "{\"steps\":";
+    json += std::to_string(steps_);
+    json += ",\"hours\":";
+    json += std::to_string(hourly_filled_);
+    json += ",\"ir_mohm\":[";
+    for (int i = 0; i < cell_count_; ++i) {
+        snprintf(buf, sizeof(buf), "%s%.2f", i ? "," : "", getResistanceMohm(i));
+        json += buf;
+    }
+    json += "],\"trend_mohm\":[";
+    for (int i = 0; i < cell_count_; ++i) {
+        snprintf(buf, sizeof(buf), "%s%.2f", i ? "," : "", getTrendMohm(i));
+        json += buf;
+    }
+    json += "]}";
+    return true;
+}
+
+} // namespace analytics
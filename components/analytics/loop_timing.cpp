@@ -0,0 +1,130 @@
+#include "loop_timing.h"
+#include <stdio.h>
+
+namespace analytics {
+
+// Upper edges of all but the last bucket, roughly 1-2-5 per decade
+static constexpr uint32_t BUCKET_EDGES_US[LoopTiming::BUCKETS - 1] = {
+    100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000
+};
+
+LoopTiming& LoopTiming::getInstance() {
+    static LoopTiming instance;
+    return instance;
+}
+
+int LoopTiming::bucketOf(uint32_t us) {
+    int bucket = 0;
+    while (bucket < BUCKETS - 1 && us > BUCKET_EDGES_US[bucket]) {
+        bucket++;
+    }
+    return bucket;
+}
+
+const char* LoopTiming::phaseName(Phase phase) {
+    switch (phase) {
+        case PHASE_WAKE: return "wake";
+        case PHASE_UART: return "uart";
+        case PHASE_BUILD: return "build";
+        case PHASE_FANOUT: return "fanout";
+        case PHASE_CYCLE: return "cycle";
+        default: return "unknown";
+    }
+}
+
+void LoopTiming::add(Phase phase, uint32_t us) {
+    PhaseStats& stats = phases_[phase];
+    stats.count++;
+    stats.total_us += us;
+    if (us > stats.max_us) {
+        stats.max_us = us;
+    }
+    stats.buckets[bucketOf(us)]++;
+}
+
+void LoopTiming::record(const Cycle& cycle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    add(PHASE_WAKE, cycle.wake_us);
+    add(PHASE_UART, cycle.uart_us);
+    if (cycle.read_ok) {
+        add(PHASE_BUILD, cycle.build_us);
+        add(PHASE_FANOUT, cycle.fanout_us);
+    } else {
+        read_failures_++;
+    }
+    add(PHASE_CYCLE, cycle.cycle_us);
+
+    cycles_++;
+    total_cycles_++;
+    last_interval_us_ = cycle.interval_us;
+    if (cycle.interval_us > 0 && cycle.cycle_us > cycle.interval_us) {
+        const uint32_t missed = cycle.cycle_us / cycle.interval_us;
+        deadline_misses_++;
+        total_deadline_misses_++;
+        missed_ticks_ += missed;
+        total_missed_ticks_ += missed;
+    }
+}
+
+void LoopTiming::toJsonLocked(uint64_t now_us, std::string& json) const {
+    char buf[160];
+    snprintf(buf, sizeof(buf),
+             "{\"window_s\":%lu,\"interval_ms\":%lu,\"cycles\":%lu,\"read_failures\":%lu,"
+             "\"deadline_misses\":%lu,\"missed_ticks\":%lu",
+             (unsigned long)((now_us - window_start_us_) / 1000000ULL), (unsigned long)(last_interval_us_ / 1000),
+             (unsigned long)cycles_, (unsigned long)read_failures_,
+             (unsigned long)deadline_misses_, (unsigned long)missed_ticks_);
+    json = buf;
+    snprintf(buf, sizeof(buf), ",\"total\":{\"cycles\":%lu,\"deadline_misses\":%lu,\"missed_ticks\":%lu}",
+             (unsigned long)total_cycles_, (unsigned long)total_deadline_misses_, (unsigned long)total_missed_ticks_);
+    json += buf;
+
+    json += ",\"edges_us\":[";
+    for (int i = 0; i < BUCKETS - 1; i++) {
+        if (i > 0) json += ",";
+        json += std::to_string(BUCKET_EDGES_US[i]);
+    }
+    json += "],\"phases\":{";
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        const PhaseStats& stats = phases_[p];
+        snprintf(buf, sizeof(buf), "%s\"%s\":{\"count\":%lu,\"avg_us\":%lu,\"max_us\":%lu,\"hist\":[",
+                 p > 0 ? "," : "", phaseName((Phase)p), (unsigned long)stats.count,
+                 (unsigned long)(stats.count ? stats.total_us / stats.count : 0), (unsigned long)stats.max_us);
+        json += buf;
+        for (int b = 0; b < BUCKETS; b++) {
+            if (b > 0) json += ",";
+            json += std::to_string(stats.buckets[b]);
+        }
+        json += "]}";
+    }
+    json += "}}";
+}
+
+void LoopTiming::toJson(uint64_t now_us, std::string& json) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    toJsonLocked(now_us, json);
+}
+
+bool LoopTiming::takeWindow(uint64_t now_us, std::string& json) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (window_start_us_ == 0) {
+        window_start_us_ = now_us;
+        return false;
+    }
+    if (now_us - window_start_us_ < (uint64_t)config_.publish_interval_s * 1000000ULL) {
+        return false;
+    }
+    toJsonLocked(now_us, json);
+    for (PhaseStats& stats : phases_) {
+        stats = PhaseStats{};
+    }
+    cycles_ = 0;
+    read_failures_ = 0;
+    deadline_misses_ = 0;
+    missed_ticks_ = 0;
+    window_start_us_ = now_us;
+    return true;
+}
+
+} // namespace analytics
@@ -0,0 +1,149 @@
+#include "nvs_blob.h"
+#include <string.h>
+#include <stdlib.h>
+#include <nvs.h>
+#include <nvs_flash.h>
+#include <esp_crc.h>
+#include <esp_log.h>
+
+static const char* TAG = "nvs_blob";
+
+namespace analytics {
+
+namespace {
+
+struct BlobHeader {
+    uint16_t version;
+    uint16_t size;
+    uint32_t crc;
+};
+
+// Blobs are small; keep the staging buffer on the stack below this size
+constexpr size_t STACK_BLOB_MAX = 256;
+
+esp_err_t openNamespace(const char* ns, nvs_open_mode_t mode, nvs_handle_t* handle) {
+    esp_err_t ret = nvs_open(ns, mode, handle);
+    if (ret == ESP_ERR_NVS_NOT_INITIALIZED) {
+        // WiFi normally brings NVS up first; cover boots where it did not
+        ret = nvs_flash_init();
+        if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+            ESP_LOGW(TAG, "NVS partition needs erase (0x%x)", ret);
+            nvs_flash_erase();
+            ret = nvs_flash_init();
+        }
+        if (ret == ESP_OK) {
+            ret = nvs_open(ns, mode, handle);
+        }
+    }
+    return ret;
+}
+
+} // namespace
+
+esp_err_t nvsBlobLoad(const char* ns, const char* key, uint16_t version, void* data, size_t size) {
+    if (!ns || !key || !data || size == 0 || size > UINT16_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t ret = openNamespace(ns, NVS_READONLY, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    const size_t total = sizeof(BlobHeader) + size;
+    uint8_t stack_buf[STACK_BLOB_MAX];
+    uint8_t* buf = total <= sizeof(stack_buf) ? stack_buf : static_cast<uint8_t*>(malloc(total));
+    if (!buf) {
+        nvs_close(handle);
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t len = total;
+    ret = nvs_get_blob(handle, key, buf, &len);
+    nvs_close(handle);
+
+    if (ret == ESP_OK) {
+        BlobHeader hdr;
+        memcpy(&hdr, buf, sizeof(hdr));
+        if (len != total || hdr.size != size) {
+            ret = ESP_ERR_INVALID_SIZE;
+        } else if (hdr.version != version) {
+            ret = ESP_ERR_INVALID_VERSION;
+        } else if (hdr.crc != esp_crc32_le(0, buf + sizeof(hdr), size)) {
+            ret = ESP_ERR_INVALID_CRC;
+        } else {
+            memcpy(data, buf + sizeof(hdr), size);
+        }
+    } else if (ret == ESP_ERR_NVS_INVALID_LENGTH) {
+        // Stored blob is larger than the current layout
+        ret = ESP_ERR_INVALID_SIZE;
+    }
+
+    if (buf != stack_buf) {
+        free(buf);
+    }
+    if (ret != ESP_OK && ret != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Discarding %s/%s: %s", ns, key, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t nvsBlobSave(const char* ns, const char* key, uint16_t version, const void* data, size_t size) {
+    if (!ns || !key || !data || size == 0 || size > UINT16_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t ret = openNamespace(ns, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    const size_t total = sizeof(BlobHeader) + size;
+    uint8_t stack_buf[STACK_BLOB_MAX];
+    uint8_t* buf = total <= sizeof(stack_buf) ? stack_buf : static_cast<uint8_t*>(malloc(total));
+    if (!buf) {
+        nvs_close(handle);
+        return ESP_ERR_NO_MEM;
+    }
+
+    BlobHeader hdr;
+    hdr.version = version;
+    hdr.size = static_cast<uint16_t>(size);
+    hdr.crc = esp_crc32_le(0, static_cast<const uint8_t*>(data), size);
+    memcpy(buf, &hdr, sizeof(hdr));
+    memcpy(buf + sizeof(hdr), data, size);
+
+    ret = nvs_set_blob(handle, key, buf, total);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (buf != stack_buf) {
+        free(buf);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to store %s/%s: %s", ns, key, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t nvsBlobErase(const char* ns, const char* key) {
+    nvs_handle_t handle;
+    esp_err_t ret = openNamespace(ns, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_erase_key(handle, key);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    } else if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ret = ESP_OK;
+    }
+    nvs_close(handle);
+    return ret;
+}
+
+} // namespace analytics
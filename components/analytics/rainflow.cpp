@@ -0,0 +1,201 @@
+#include "rainflow.h"
+#include "nvs_blob.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <esp_log.h>
+
+static const char* TAG = "rainflow";
+
+namespace analytics {
+
+static constexpr const char* NVS_NAMESPACE = "rainflow";
+static constexpr const char* NVS_KEY = "hist";
+static constexpr uint16_t HIST_VERSION = 2;
+static constexpr uint16_t HIST_VERSION_NO_RESIDUE = 1;
+
+RainflowCounter& RainflowCounter::getInstance() {
+    static RainflowCounter instance;
+    return instance;
+}
+
+void RainflowCounter::load() {
+    loaded_ = true;
+    Stored stored;
+    esp_err_t err = nvsBlobLoad(NVS_NAMESPACE, NVS_KEY, HIST_VERSION, &stored, sizeof(stored));
+    if (err == ESP_OK) {
+        hist_ = stored.hist;
+        if (stored.residue_len >= 0 && stored.residue_len <= RESIDUE_MAX) {
+            memcpy(residue_, stored.residue, sizeof(residue_));
+            residue_len_ = stored.residue_len;
+            extreme_ = stored.extreme;
+            direction_ = stored.direction > 0 ? 1 : (stored.direction < 0 ? -1 : 0);
+            have_sample_ = stored.have_sample != 0;
+        }
+        ESP_LOGI(TAG, "Restored histogram, %.1f equivalent full cycles, %d residue points",
+                 hist_.equivalent_full_cycles, residue_len_);
+        return;
+    }
+    if (err != ESP_ERR_NVS_NOT_FOUND &&
+        nvsBlobLoad(NVS_NAMESPACE, NVS_KEY, HIST_VERSION_NO_RESIDUE, &stored.hist, sizeof(stored.hist)) == ESP_OK) {
+        // Older record: keep the counts, the residue starts empty
+        hist_ = stored.hist;
+        ESP_LOGI(TAG, "Restored histogram, %.1f equivalent full cycles", hist_.equivalent_full_cycles);
+    }
+}
+
+void RainflowCounter::persistLocked() {
+    Stored stored = {};
+    stored.hist = hist_;
+    memcpy(stored.residue, residue_, sizeof(residue_));
+    stored.residue_len = residue_len_;
+    stored.extreme = extreme_;
+    stored.direction = (int8_t)direction_;
+    stored.have_sample = have_sample_ ? 1 : 0;
+    if (nvsBlobSave(NVS_NAMESPACE, NVS_KEY, HIST_VERSION, &stored, sizeof(stored)) == ESP_OK) {
+        dirty_ = false;
+    }
+}
+
+void RainflowCounter::persist() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dirty_) {
+        persistLocked();
+    }
+}
+
+void RainflowCounter::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    hist_ = {};
+    residue_len_ = 0;
+    have_sample_ = false;
+    direction_ = 0;
+    dirty_ = false;
+    nvsBlobErase(NVS_NAMESPACE, NVS_KEY);
+}
+
+void RainflowCounter::countCycle(float range, float mean, uint32_t half_cycles) {
+    int dod_bin = (int)(range / (100.0f / DOD_BINS));
+    int mean_bin = (int)(mean / (100.0f / MEAN_BINS));
+    dod_bin = dod_bin < 0 ? 0 : (dod_bin >= DOD_BINS ? DOD_BINS - 1 : dod_bin);
+    mean_bin = mean_bin < 0 ? 0 : (mean_bin >= MEAN_BINS ? MEAN_BINS - 1 : mean_bin);
+
+    hist_.half_cycles[dod_bin][mean_bin] += half_cycles;
+    hist_.equivalent_full_cycles += range / 100.0f * (float)half_cycles * 0.5f;
+    dirty_ = true;
+}
+
+void RainflowCounter::pushTurningPoint(float soc) {
+    if (residue_len_ == RESIDUE_MAX) {
+        // Full stack: retire the oldest leg as a half cycle to stay bounded
+        const float a = residue_[0], b = residue_[1];
+        countCycle(fabsf(b - a), 0.5f * (a + b), 1);
+        memmove(&residue_[0], &residue_[1], sizeof(residue_[0]) * (RESIDUE_MAX - 1));
+        residue_len_--;
+        hist_.residue_overflows++;
+    }
+    residue_[residue_len_++] = soc;
+    dirty_ = true;   // the residue is persisted with the counts
+
+    // Four-point rule: an inner range no larger than both neighbours is a closed cycle
+    while (residue_len_ >= 4) {
+        const float a = residue_[residue_len_ - 4];
+        const float b = residue_[residue_len_ - 3];
+        const float c = residue_[residue_len_ - 2];
+        const float d = residue_[residue_len_ - 1];
+        const float x = fabsf(d - c);
+        const float y = fabsf(c - b);
+        const float z = fabsf(b - a);
+        if (y > x || y > z) {
+            break;
+        }
+        countCycle(y, 0.5f * (b + c), 2);
+        residue_[residue_len_ - 3] = d;
+        residue_len_ -= 2;
+    }
+}
+
+void RainflowCounter::update(const output::BMSSnapshot& data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!loaded_) {
+        load();
+        last_persist_us_ = data.now_time_us;
+    }
+
+    const float soc = data.soc_pct;
+    const float h = config_.hysteresis_pct;
+    if (!have_sample_) {
+        have_sample_ = true;
+        extreme_ = soc;
+        pushTurningPoint(soc);
+    } else if (direction_ == 0) {
+        if (soc - extreme_ >= h) {
+            direction_ = 1;
+            extreme_ = soc;
+        } else if (extreme_ - soc >= h) {
+            direction_ = -1;
+            extreme_ = soc;
+        }
+    } else if (direction_ > 0) {
+        if (soc > extreme_) {
+            extreme_ = soc;
+        } else if (extreme_ - soc >= h) {
+            pushTurningPoint(extreme_);  // peak confirmed
+            direction_ = -1;
+            extreme_ = soc;
+        }
+    } else {
+        if (soc < extreme_) {
+            extreme_ = soc;
+        } else if (soc - extreme_ >= h) {
+            pushTurningPoint(extreme_);  // valley confirmed
+            direction_ = 1;
+            extreme_ = soc;
+        }
+    }
+
+    if (dirty_ && data.now_time_us - last_persist_us_ >= (uint64_t)config_.persist_interval_s * 1000000ULL) {
+        last_persist_us_ = data.now_time_us;
+        persistLocked();
+    }
+}
+
+float RainflowCounter::getEquivalentFullCycles() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hist_.equivalent_full_cycles;
+}
+
+void RainflowCounter::toJson(std::string& json) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    char buf[64];
+
+    json = "{\"dod_bin_pct\":";
+    json += std::to_string(100 / DOD_BINS);
+    json += ",\"mean_bin_pct\":";
+    json += std::to_string(100 / MEAN_BINS);
+    snprintf(buf, sizeof(buf), ",\"equivalent_full_cycles\":%.2f", hist_.equivalent_full_cycles);
+    json += buf;
+    json += ",\"residue_points\":";
+    json += std::to_string(residue_len_);
+    json += ",\"residue_overflows\":";
+    json += std::to_string(hist_.residue_overflows);
+
+    // counts[dod_bin][mean_bin] in cycles
+    json += ",\"counts\":[";
+    for (int d = 0; d < DOD_BINS; ++d) {
+        json += d ? ",[" : "[";
+        for (int m = 0; m < MEAN_BINS; ++m) {
+            const uint32_t half = hist_.half_cycles[d][m];
+            if (half % 2) {
+                snprintf(buf, sizeof(buf), "%s%lu.5", m ? "," : "", (unsigned long)(half / 2));
+            } else {
+                snprintf(buf, sizeof(buf), "%s%lu", m ? "," : "", (unsigned long)(half / 2));
+            }
+            json += buf;
+        }
+        json += "]";
+    }
+    json += "]}";
+}
+
+} // namespace analytics
@@ -0,0 +1,66 @@
+#include "runtime_predictor.h"
+#include <math.h>
+
+namespace analytics {
+
+// Predictions beyond this are reported as unknown
+static constexpr float MAX_PREDICTION_S = 30.0f * 24.0f * 3600.0f;
+
+RuntimePredictor& RuntimePredictor::getInstance() {
+    static RuntimePredictor instance;
+    return instance;
+}
+
+void RuntimePredictor::reset() {
+    have_prev_ = false;
+    charge_valid_ = false;
+    discharge_valid_ = false;
+    charge_w_ = 0.0f;
+    discharge_w_ = 0.0f;
+}
+
+void RuntimePredictor::update(output::BMSSnapshot& data) {
+    data.time_to_empty_s = -1;
+    data.time_to_full_s = -1;
+
+    float dt_s = 0.0f;
+    if (have_prev_) {
+        dt_s = (float)((double)(data.now_time_us - prev_time_us_) / 1e6);
+        if (dt_s > (float)config_.max_gap_s) {
+            charge_valid_ = false;
+            discharge_valid_ = false;
+        }
+    }
+    prev_time_us_ = data.now_time_us;
+    have_prev_ = true;
+
+    // Power sign follows current: positive while charging
+    const float p = data.power_w;
+    const float alpha = 1.0f - expf(-dt_s / config_.tau_s);
+    if (p >= config_.idle_power_w) {
+        charge_w_ = charge_valid_ ? charge_w_ + alpha * (p - charge_w_) : p;
+        charge_valid_ = true;
+    } else if (p <= -config_.idle_power_w) {
+        discharge_w_ = discharge_valid_ ? discharge_w_ + alpha * (-p - discharge_w_) : -p;
+        discharge_valid_ = true;
+    } else {
+        return;  // idle: no meaningful rate
+    }
+
+    const float capacity_ah = data.est_capacity_ah > 0.0f ? data.est_capacity_ah : data.full_capacity_ah;
+    if (capacity_ah <= 0.0f || data.pack_voltage_v <= 0.0f) {
+        return;
+    }
+    const float soc = data.soc_pct < 0.0f ? 0.0f : (data.soc_pct > 100.0f ? 100.0f : data.soc_pct);
+    const float energy_wh = capacity_ah * data.pack_voltage_v;
+
+    if (p > 0.0f && charge_w_ > 0.0f) {
+        const float t = energy_wh * (100.0f - soc) / 100.0f / charge_w_ * 3600.0f;
+        data.time_to_full_s = t <= MAX_PREDICTION_S ? (int32_t)t : -1;
+    } else if (p < 0.0f && discharge_w_ > 0.0f) {
+        const float t = energy_wh * soc / 100.0f / discharge_w_ * 3600.0f;
+        data.time_to_empty_s = t <= MAX_PREDICTION_S ? (int32_t)t : -1;
+    }
+}
+
+} // namespace analytics
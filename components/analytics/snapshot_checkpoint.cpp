@@ -0,0 +1,183 @@
+#include "snapshot_checkpoint.h"
+#include "nvs_blob.h"
+#include <math.h>
+#include <stdio.h>
+#include <esp_log.h>
+
+static const char* TAG = "checkpoint";
+
+namespace analytics {
+
+static constexpr const char* NVS_NAMESPACE = "checkpoint";
+static constexpr const char* NVS_KEY = "snap";
+static constexpr uint16_t RECORD_VERSION = 1;
+
+static constexpr uint8_t FLAG_CHARGING = 1 << 0;
+static constexpr uint8_t FLAG_DISCHARGING = 1 << 1;
+
+SnapshotCheckpoint& SnapshotCheckpoint::getInstance() {
+    static SnapshotCheckpoint instance;
+    return instance;
+}
+
+void SnapshotCheckpoint::pack(const output::BMSSnapshot& data, Record& rec) {
+    rec = {};
+    rec.real_timestamp = (int64_t)data.real_timestamp;
+    rec.boot_id = data.boot_id;
+    rec.seq = data.seq;
+    rec.total_energy_wh = (float)data.total_energy_wh;
+    rec.pack_voltage_v = data.pack_voltage_v;
+    rec.pack_current_a = data.pack_current_a;
+    rec.soc_pct = data.soc_pct;
+    rec.power_w = data.power_w;
+    rec.full_capacity_ah = data.full_capacity_ah;
+    rec.est_capacity_ah = data.est_capacity_ah;
+    rec.soh_pct = data.soh_pct;
+    rec.peak_current_a = data.peak_current_a;
+    rec.peak_power_w = data.peak_power_w;
+    rec.min_temp_c = data.min_temp_c;
+    rec.max_temp_c = data.max_temp_c;
+    rec.time_to_empty_s = data.time_to_empty_s;
+    rec.time_to_full_s = data.time_to_full_s;
+
+    const int cells = data.cell_count < output::DEFAULT_MAX_CSV_CELLS ? data.cell_count : output::DEFAULT_MAX_CSV_CELLS;
+    for (int i = 0; i < cells; ++i) {
+        const float mv = data.cell_v[i] * 1000.0f;
+        rec.cell_mv[i] = mv <= 0.0f ? 0 : (mv >= 65535.0f ? 65535 : (uint16_t)lroundf(mv));
+    }
+    const int temps = data.temp_count < output::DEFAULT_MAX_CSV_TEMPS ? data.temp_count : output::DEFAULT_MAX_CSV_TEMPS;
+    for (int i = 0; i < temps; ++i) {
+        const float dc = data.temp_c[i] * 10.0f;
+        rec.temp_dc[i] = dc <= -32768.0f ? -32768 : (dc >= 32767.0f ? 32767 : (int16_t)lroundf(dc));
+    }
+    rec.cell_count = (uint8_t)(cells > 0 ? cells : 0);
+    rec.temp_count = (uint8_t)(temps > 0 ? temps : 0);
+    rec.min_cell_num = (uint8_t)data.min_cell_num;
+    rec.max_cell_num = (uint8_t)data.max_cell_num;
+    rec.flags = (data.charging_enabled ? FLAG_CHARGING : 0) | (data.discharging_enabled ? FLAG_DISCHARGING : 0);
+    rec.anomaly_level = data.anomaly_level;
+    rec.anomaly_cell = (uint8_t)data.anomaly_cell;
+}
+
+bool SnapshotCheckpoint::restore(output::BMSSnapshot& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Record rec;
+    if (nvsBlobLoad(NVS_NAMESPACE, NVS_KEY, RECORD_VERSION, &rec, sizeof(rec)) != ESP_OK) {
+        return false;
+    }
+    saved_peak_current_a_ = rec.peak_current_a;
+    saved_peak_power_w_ = rec.peak_power_w;
+
+    out.stale = true;
+    out.real_timestamp = (time_t)rec.real_timestamp;
+    out.total_energy_wh = rec.total_energy_wh;
+    out.pack_voltage_v = rec.pack_voltage_v;
+    out.pack_current_a = rec.pack_current_a;
+    out.soc_pct = rec.soc_pct;
+    out.power_w = rec.power_w;
+    out.full_capacity_ah = rec.full_capacity_ah;
+    out.est_capacity_ah = rec.est_capacity_ah;
+    out.soh_pct = rec.soh_pct;
+    out.peak_current_a = rec.peak_current_a;
+    out.peak_power_w = rec.peak_power_w;
+    out.min_temp_c = rec.min_temp_c;
+    out.max_temp_c = rec.max_temp_c;
+    out.time_to_empty_s = rec.time_to_empty_s;
+    out.time_to_full_s = rec.time_to_full_s;
+
+    out.cell_count = rec.cell_count <= output::DEFAULT_MAX_CSV_CELLS ? rec.cell_count : output::DEFAULT_MAX_CSV_CELLS;
+    float min_v = 0.0f, max_v = 0.0f;
+    for (int i = 0; i < out.cell_count; ++i) {
+        out.cell_v[i] = rec.cell_mv[i] / 1000.0f;
+        if (i == 0 || out.cell_v[i] < min_v) min_v = out.cell_v[i];
+        if (i == 0 || out.cell_v[i] > max_v) max_v = out.cell_v[i];
+    }
+    out.min_cell_voltage_v = min_v;
+    out.max_cell_voltage_v = max_v;
+    out.cell_voltage_delta_v = max_v - min_v;
+    out.min_cell_num = rec.min_cell_num;
+    out.max_cell_num = rec.max_cell_num;
+
+    out.temp_count = rec.temp_count <= output::DEFAULT_MAX_CSV_TEMPS ? rec.temp_count : output::DEFAULT_MAX_CSV_TEMPS;
+    for (int i = 0; i < out.temp_count; ++i) {
+        out.temp_c[i] = rec.temp_dc[i] / 10.0f;
+    }
+
+    out.charging_enabled = (rec.flags & FLAG_CHARGING) != 0;
+    out.discharging_enabled = (rec.flags & FLAG_DISCHARGING) != 0;
+    out.anomaly_level = rec.anomaly_level;
+    out.anomaly_cell = rec.anomaly_cell;
+
+    ESP_LOGI(TAG, "Restored checkpoint from boot %lu seq %lu (%.2f V, %.0f%%, peaks %.1f A / %.0f W)",
+             (unsigned long)rec.boot_id, (unsigned long)rec.seq, rec.pack_voltage_v, rec.soc_pct,
+             rec.peak_current_a, rec.peak_power_w);
+    return true;
+}
+
+void SnapshotCheckpoint::saveLocked(uint64_t now_us) {
+    last_save_us_ = now_us;
+    saved_this_boot_ = true;
+    if (nvsBlobSave(NVS_NAMESPACE, NVS_KEY, RECORD_VERSION, &latest_, sizeof(latest_)) != ESP_OK) {
+        // Retried at the next interval rather than on every sample
+        write_failures_++;
+        return;
+    }
+    writes_++;
+    saved_peak_current_a_ = latest_.peak_current_a;
+    saved_peak_power_w_ = latest_.peak_power_w;
+}
+
+void SnapshotCheckpoint::update(const output::BMSSnapshot& data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pack(data, latest_);
+    have_latest_ = true;
+
+    if (!saved_this_boot_) {
+        saveLocked(data.now_time_us);
+        return;
+    }
+
+    const uint64_t since_us = data.now_time_us - last_save_us_;
+    if (since_us >= (uint64_t)config_.min_interval_s * 1000000ULL) {
+        saveLocked(data.now_time_us);
+        return;
+    }
+
+    const float margin = 1.0f + config_.peak_margin;
+    const bool new_peak = latest_.peak_current_a > saved_peak_current_a_ * margin ||
+                          latest_.peak_power_w > saved_peak_power_w_ * margin;
+    if (new_peak && since_us >= (uint64_t)config_.peak_interval_s * 1000000ULL) {
+        saveLocked(data.now_time_us);
+    }
+}
+
+void SnapshotCheckpoint::persist() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (have_latest_) {
+        saveLocked(last_save_us_);
+    }
+}
+
+void SnapshotCheckpoint::toJson(uint64_t now_us, std::string& json) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    char buf[192];
+    snprintf(buf, sizeof(buf),
+             "{\"writes\":%lu,\"write_failures\":%lu,\"last_save_age_s\":%ld,"
+             "\"saved_peak_current_a\":%.2f,\"saved_peak_power_w\":%.1f}",
+             (unsigned long)writes_, (unsigned long)write_failures_,
+             saved_this_boot_ ? (long)((now_us - last_save_us_) / 1000000ULL) : -1L,
+             saved_peak_current_a_, saved_peak_power_w_);
+    json = buf;
+}
+
+void SnapshotCheckpoint::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    latest_ = {};
+    have_latest_ = false;
+    saved_this_boot_ = false;
+    saved_peak_current_a_ = 0.0f;
+    saved_peak_power_w_ = 0.0f;
+    nvsBlobErase(NVS_NAMESPACE, NVS_KEY);
+}
+
+} // namespace analytics
@@ -0,0 +1,168 @@
+#include "soh_estimator.h"
+#include "nvs_blob.h"
+#include <math.h>
+#include <esp_log.h>
+
+static const char* TAG = "soh";
+
+namespace analytics {
+
+static constexpr const char* NVS_NAMESPACE = "soh";
+static constexpr const char* NVS_KEY = "state";
+static constexpr uint16_t STATE_VERSION = 1;
+
+// Reject capacity samples outside this band around the rated capacity
+static constexpr float MIN_PLAUSIBLE_RATIO = 0.3f;
+static constexpr float MAX_PLAUSIBLE_RATIO = 1.5f;
+
+SohEstimator& SohEstimator::getInstance() {
+    static SohEstimator instance;
+    return instance;
+}
+
+void SohEstimator::load() {
+    loaded_ = true;
+    State stored;
+    if (nvsBlobLoad(NVS_NAMESPACE, NVS_KEY, STATE_VERSION, &stored, sizeof(stored)) == ESP_OK) {
+        state_ = stored;
+        ESP_LOGI(TAG, "Restored capacity %.2f Ah (rated %.2f Ah, %lu updates)",
+                 state_.est_capacity_ah, state_.rated_capacity_ah, (unsigned long)state_.updates);
+    }
+}
+
+void SohEstimator::save() {
+    nvsBlobSave(NVS_NAMESPACE, NVS_KEY, STATE_VERSION, &state_, sizeof(state_));
+}
+
+void SohEstimator::reset() {
+    state_ = {};
+    has_anchor_ = false;
+    ah_since_anchor_ = 0.0;
+    nvsBlobErase(NVS_NAMESPACE, NVS_KEY);
+}
+
+float SohEstimator::getSohPct() const {
+    if (state_.est_capacity_ah <= 0.0f || state_.rated_capacity_ah <= 0.0f) {
+        return 0.0f;
+    }
+    return state_.est_capacity_ah / state_.rated_capacity_ah * 100.0f;
+}
+
+SohEstimator::Anchor SohEstimator::detectAnchor(const output::BMSSnapshot& data, float dt_s) {
+    const float i = data.pack_current_a;
+    const float soc = data.soc_pct;
+
+    // Full: BMS reports full while the charge current has tapered off
+    if (soc >= config_.full_soc_pct && i >= 0.0f && i < config_.taper_current_a) {
+        if (!at_full_) {
+            at_full_ = true;
+            return Anchor::FULL;
+        }
+    } else if (soc < config_.full_soc_pct - 2.0f) {
+        at_full_ = false;
+    }
+
+    if (soc <= config_.empty_soc_pct) {
+        if (!at_empty_) {
+            at_empty_ = true;
+            return Anchor::EMPTY;
+        }
+    } else if (soc > config_.empty_soc_pct + 2.0f) {
+        at_empty_ = false;
+    }
+
+    // Rested pack: trust the BMS SoC once after each long enough rest
+    if (fabsf(i) < config_.rest_current_a) {
+        rest_s_ += dt_s;
+        if (!rest_anchored_ && rest_s_ >= (float)config_.rest_time_s) {
+            rest_anchored_ = true;
+            return Anchor::REST;
+        }
+    } else {
+        rest_s_ = 0.0f;
+        rest_anchored_ = false;
+    }
+    return Anchor::NONE;
+}
+
+void SohEstimator::onAnchor(Anchor type, float soc_pct) {
+    if (type == Anchor::FULL) soc_pct = 100.0f;
+    if (type == Anchor::EMPTY) soc_pct = 0.0f;
+
+    if (has_anchor_) {
+        const float span = soc_pct - anchor_soc_pct_;
+        const double ah = ah_since_anchor_;
+        // Counted charge must agree in sign with the SoC change
+        if (fabsf(span) >= config_.min_span_pct && (ah > 0.0) == (span > 0.0f) && ah != 0.0) {
+            const float sample_ah = (float)(fabs(ah) / (fabsf(span) / 100.0f));
+            const float rated = state_.rated_capacity_ah;
+            if (rated > 0.0f && (sample_ah < rated * MIN_PLAUSIBLE_RATIO || sample_ah > rated * MAX_PLAUSIBLE_RATIO)) {
+                ESP_LOGW(TAG, "Ignoring implausible capacity sample %.2f Ah", sample_ah);
+            } else {
+                float weight = fminf(fabsf(span) / 100.0f, 1.0f);
+                if (type == Anchor::REST || anchor_type_ == Anchor::REST) {
+                    weight *= config_.rest_weight;
+                }
+                if (state_.est_capacity_ah <= 0.0f) {
+                    state_.est_capacity_ah = sample_ah;
+                } else {
+                    state_.est_capacity_ah += config_.ewma_alpha * weight * (sample_ah - state_.est_capacity_ah);
+                }
+                state_.last_sample_ah = sample_ah;
+                state_.updates++;
+                ESP_LOGI(TAG, "Capacity sample %.2f Ah over %.0f%% SoC -> estimate %.2f Ah (SoH %.1f%%)",
+                         sample_ah, fabsf(span), state_.est_capacity_ah, getSohPct());
+                save();
+            }
+        }
+    }
+
+    has_anchor_ = true;
+    anchor_type_ = type;
+    anchor_soc_pct_ = soc_pct;
+    ah_since_anchor_ = 0.0;
+}
+
+void SohEstimator::update(const output::BMSSnapshot& data) {
+    if (!loaded_) {
+        load();
+    }
+
+    if (state_.rated_capacity_ah <= 0.0f) {
+        const float rated = config_.rated_capacity_ah > 0.0f ? config_.rated_capacity_ah : data.full_capacity_ah;
+        if (rated > 0.0f) {
+            state_.rated_capacity_ah = rated;
+            save();
+        }
+    }
+
+    float dt_s = 0.0f;
+    if (have_prev_) {
+        dt_s = (float)((double)(data.now_time_us - prev_time_us_) / 1e6);
+        if (dt_s > (float)config_.max_gap_s) {
+            // Lost samples: the Ah count since the last anchor is no longer trustworthy
+            has_anchor_ = false;
+            ah_since_anchor_ = 0.0;
+            rest_s_ = 0.0f;
+            dt_s = 0.0f;
+        } else {
+            // Trapezoidal integration, charge positive
+            ah_since_anchor_ += 0.5 * (double)(data.pack_current_a + prev_current_a_) * (double)dt_s / 3600.0;
+        }
+    }
+    prev_time_us_ = data.now_time_us;
+    prev_current_a_ = data.pack_current_a;
+    have_prev_ = true;
+
+    Anchor anchor = detectAnchor(data, dt_s);
+    if (anchor != Anchor::NONE) {
+        onAnchor(anchor, data.soc_pct);
+    }
+}
+
+void SohEstimator::fillSnapshot(output::BMSSnapshot& data) const {
+    data.est_capacity_ah = state_.est_capacity_ah;
+    data.soh_pct = getSohPct();
+}
+
+} // namespace analytics
@@ -0,0 +1,165 @@
+#include "stress_histogram.h"
+#include "nvs_blob.h"
+#include <math.h>
+#include <stdio.h>
+#include <esp_log.h>
+
+static const char* TAG = "stress";
+
+namespace analytics {
+
+static constexpr const char* NVS_NAMESPACE = "stress";
+static constexpr const char* NVS_KEY = "hist";
+static constexpr uint16_t BINS_VERSION = 1;
+
+// Lower edges of the inner temperature bins; first bin is everything below 0 C
+static constexpr float TEMP_EDGES_C[StressHistogram::TEMP_BINS - 1] = { 0, 10, 20, 30, 40, 50, 60 };
+// C-rate bin edges (discharge negative); outer bins are open-ended
+static constexpr float CRATE_EDGES[StressHistogram::CRATE_BINS - 1] = { -1.0f, -0.5f, -0.2f, -0.05f, 0.05f, 0.2f, 0.5f, 1.0f };
+
+StressHistogram& StressHistogram::getInstance() {
+    static StressHistogram instance;
+    return instance;
+}
+
+int StressHistogram::tempBin(float temp_c) {
+    int bin = 0;
+    while (bin < TEMP_BINS - 1 && temp_c >= TEMP_EDGES_C[bin]) {
+        bin++;
+    }
+    return bin;
+}
+
+int StressHistogram::socBin(float soc_pct) {
+    int bin = (int)(soc_pct / (100.0f / SOC_BINS));
+    return bin < 0 ? 0 : (bin >= SOC_BINS ? SOC_BINS - 1 : bin);
+}
+
+int StressHistogram::crateBin(float c_rate) {
+    int bin = 0;
+    while (bin < CRATE_BINS - 1 && c_rate >= CRATE_EDGES[bin]) {
+        bin++;
+    }
+    return bin;
+}
+
+void StressHistogram::load() {
+    loaded_ = true;
+    Bins stored;
+    if (nvsBlobLoad(NVS_NAMESPACE, NVS_KEY, BINS_VERSION, &stored, sizeof(stored)) == ESP_OK) {
+        bins_ = stored;
+        committed_total_s_ = bins_.total_s;
+        ESP_LOGI(TAG, "Restored stress histograms (%lu s recorded)", (unsigned long)bins_.total_s);
+    }
+}
+
+void StressHistogram::commitLocked(uint64_t now_us) {
+    last_commit_us_ = now_us;
+    if (nvsBlobSave(NVS_NAMESPACE, NVS_KEY, BINS_VERSION, &bins_, sizeof(bins_)) == ESP_OK) {
+        committed_total_s_ = bins_.total_s;
+    }
+}
+
+void StressHistogram::persist() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bins_.total_s != committed_total_s_) {
+        commitLocked(prev_time_us_);
+    }
+}
+
+void StressHistogram::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bins_ = {};
+    carry_ms_ = 0;
+    have_prev_ = false;
+    committed_total_s_ = 0;
+    nvsBlobErase(NVS_NAMESPACE, NVS_KEY);
+}
+
+void StressHistogram::update(const output::BMSSnapshot& data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!loaded_) {
+        load();
+        last_commit_us_ = data.now_time_us;
+    }
+
+    if (have_prev_) {
+        const uint64_t gap_us = data.now_time_us - prev_time_us_;
+        if (gap_us <= (uint64_t)config_.max_gap_s * 1000000ULL) {
+            const uint32_t ms = carry_ms_ + (uint32_t)(gap_us / 1000ULL);
+            const uint32_t secs = ms / 1000;
+            carry_ms_ = ms % 1000;
+            bins_.temp_soc_s[prev_temp_bin_][prev_soc_bin_] += secs;
+            bins_.crate_temp_s[prev_crate_bin_][prev_temp_bin_] += secs;
+            bins_.total_s += secs;
+        }
+    }
+
+    // Bins for the interval starting now
+    const float capacity = data.est_capacity_ah > 0.0f ? data.est_capacity_ah : data.full_capacity_ah;
+    const float c_rate = capacity > 0.0f ? data.pack_current_a / capacity : 0.0f;
+    prev_temp_bin_ = tempBin(data.temp_count > 0 ? data.max_temp_c : 25.0f);
+    prev_soc_bin_ = socBin(data.soc_pct);
+    prev_crate_bin_ = crateBin(c_rate);
+    prev_time_us_ = data.now_time_us;
+    have_prev_ = true;
+
+    // Wear-aware commit: rate limited and only when enough new time accrued
+    if (data.now_time_us - last_commit_us_ >= (uint64_t)config_.commit_interval_s * 1000000ULL) {
+        if (bins_.total_s - committed_total_s_ >= config_.min_commit_delta_s) {
+            commitLocked(data.now_time_us);
+        } else {
+            last_commit_us_ = data.now_time_us;
+        }
+    }
+}
+
+static void appendEdges(std::string& json, const float* edges, int count) {
+    char buf[24];
+    json += "[";
+    for (int i = 0; i < count; ++i) {
+        snprintf(buf, sizeof(buf), "%s%g", i ? "," : "", edges[i]);
+        json += buf;
+    }
+    json += "]";
+}
+
+static void appendFlat(std::string& json, const uint32_t* values, int count) {
+    char buf[16];
+    json += "[";
+    for (int i = 0; i < count; ++i) {
+        snprintf(buf, sizeof(buf), "%s%lu", i ? "," : "", (unsigned long)values[i]);
+        json += buf;
+    }
+    json += "]";
+}
+
+void StressHistogram::toJson(std::string& json) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    json = "{\"total_s\":";
+    json += std::to_string(bins_.total_s);
+    json += ",\"temp_edges_c\":";
+    appendEdges(json, TEMP_EDGES_C, TEMP_BINS - 1);
+    json += ",\"soc_bin_pct\":";
+    json += std::to_string(100 / SOC_BINS);
+    json += ",\"crate_edges\":";
+    appendEdges(json, CRATE_EDGES, CRATE_BINS - 1);
+
+    // Row-major: rows x cols, seconds per bin
+    json += ",\"temp_soc\":{\"rows\":";
+    json += std::to_string(TEMP_BINS);
+    json += ",\"cols\":";
+    json += std::to_string(SOC_BINS);
+    json += ",\"s\":";
+    appendFlat(json, &bins_.temp_soc_s[0][0], TEMP_BINS * SOC_BINS);
+    json += "},\"crate_temp\":{\"rows\":";
+    json += std::to_string(CRATE_BINS);
+    json += ",\"cols\":";
+    json += std::to_string(TEMP_BINS);
+    json += ",\"s\":";
+    appendFlat(json, &bins_.crate_temp_s[0][0], CRATE_BINS * TEMP_BINS);
+    json += "}}";
+}
+
+} // namespace analytics
@@ -0,0 +1,243 @@
+#include "fet_control.h"
+#include <stdio.h>
+#include <string.h>
+#include <cJSON.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <mbedtls/md.h>
+#include "nvs_blob.h"
+
+static const char* TAG = "fet_control";
+
+namespace control {
+
+static constexpr const char* NVS_NAMESPACE = "fet";
+static constexpr const char* NVS_KEY = "ctr";
+static constexpr uint16_t CTR_VERSION = 1;
+static constexpr size_t MAC_HEX_LEN = 64;
+
+FetControl& FetControl::getInstance() {
+    static FetControl instance;
+    return instance;
+}
+
+void FetControl::setCredentials(const std::string& key, const std::string& device_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    key_ = key;
+    device_id_ = device_id;
+}
+
+void FetControl::setNotify(std::function<void()> notify) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    notify_ = std::move(notify);
+}
+
+std::string FetControl::sign(const std::string& key, const std::string& device_id,
+                             uint32_t ctr, bool charge, bool discharge) {
+    char message[64];
+    const int len = snprintf(message, sizeof(message), "%s:%lu:%d:%d", device_id.c_str(),
+                             (unsigned long)ctr, charge ? 1 : 0, discharge ? 1 : 0);
+    if (len < 0 || len >= (int)sizeof(message)) {
+        return std::string();
+    }
+
+    unsigned char mac[32];
+    const mbedtls_md_info_t* md = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    if (!md || mbedtls_md_hmac(md, (const unsigned char*)key.data(), key.size(),
+                               (const unsigned char*)message, (size_t)len, mac) != 0) {
+        return std::string();
+    }
+
+    static const char HEX[] = "0123456789abcdef";
+    std::string hex(sizeof(mac) * 2, '0');
+    for (size_t i = 0; i < sizeof(mac); ++i) {
+        hex[2 * i] = HEX[mac[i] >> 4];
+        hex[2 * i + 1] = HEX[mac[i] & 0x0F];
+    }
+    return hex;
+}
+
+// Compare without an early exit so timing does not reveal how much matched
+static bool macEquals(const std::string& expected, const char* given) {
+    if (expected.size() != MAC_HEX_LEN || strlen(given) != MAC_HEX_LEN) {
+        return false;
+    }
+    uint8_t diff = 0;
+    for (size_t i = 0; i < MAC_HEX_LEN; ++i) {
+        diff |= (uint8_t)(expected[i] ^ given[i]);
+    }
+    return diff == 0;
+}
+
+void FetControl::loadCounter() {
+    counter_loaded_ = true;
+    uint32_t stored = 0;
+    if (analytics::nvsBlobLoad(NVS_NAMESPACE, NVS_KEY, CTR_VERSION, &stored, sizeof(stored)) == ESP_OK) {
+        last_ctr_ = stored;
+        persisted_ctr_ = stored;
+    }
+}
+
+bool FetControl::reject(const logging::CommandRouter::ReplyFn& reply, const char* error, uint32_t ctr) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rejected_++;
+    }
+    ESP_LOGW(TAG, "Rejected FET command ctr %lu: %s", (unsigned long)ctr, error);
+    char buf[96];
+    snprintf(buf, sizeof(buf), "{\"ctr\":%lu,\"error\":\"%s\"}", (unsigned long)ctr, error);
+    reply(buf);
+    return false;
+}
+
+bool FetControl::submit(const std::string& args, const logging::CommandRouter::ReplyFn& reply) {
+    const int64_t received_us = esp_timer_get_time();
+
+    cJSON* root = cJSON_Parse(args.c_str());
+    const cJSON* charge = cJSON_GetObjectItem(root, "charge");
+    const cJSON* discharge = cJSON_GetObjectItem(root, "discharge");
+    const cJSON* ctr_item = cJSON_GetObjectItem(root, "ctr");
+    const cJSON* mac = cJSON_GetObjectItem(root, "mac");
+    if (!cJSON_IsBool(charge) || !cJSON_IsBool(discharge) || !cJSON_IsNumber(ctr_item) ||
+        ctr_item->valuedouble < 1 || ctr_item->valuedouble > 4294967295.0 || !cJSON_IsString(mac)) {
+        cJSON_Delete(root);
+        return reject(reply, "bad request", 0);
+    }
+
+    Request req;
+    req.ctr = (uint32_t)ctr_item->valuedouble;
+    req.charge = cJSON_IsTrue(charge);
+    req.discharge = cJSON_IsTrue(discharge);
+    req.received_us = received_us;
+    req.reply = reply;
+
+    std::string key, device_id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        key = key_;
+        device_id = device_id_;
+    }
+    if (key.empty()) {
+        cJSON_Delete(root);
+        return reject(reply, "disabled", req.ctr);
+    }
+    const bool authentic = macEquals(sign(key, device_id, req.ctr, req.charge, req.discharge),
+                                     mac->valuestring);
+    cJSON_Delete(root);
+    if (!authentic) {
+        return reject(reply, "auth", req.ctr);
+    }
+
+    const uint32_t ctr = req.ctr;
+    const char* error = nullptr;
+    std::function<void()> notify;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!counter_loaded_) {
+            loadCounter();
+        }
+        if (ctr <= last_ctr_) {
+            error = "replay";
+        } else if (queue_.size() >= QUEUE_DEPTH) {
+            // Not consumed: the client may retry with the same counter
+            error = "busy";
+        } else {
+            last_ctr_ = ctr;
+            accepted_++;
+            queue_.push_back(std::move(req));
+            notify = notify_;
+        }
+    }
+    if (error) {
+        return reject(reply, error, ctr);
+    }
+
+    if (notify) {
+        notify();
+    }
+    return true;
+}
+
+int FetControl::execute(bms_interface_t* bms) {
+    int executed = 0;
+    while (true) {
+        Request req;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.empty()) {
+                break;
+            }
+            req = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        const int64_t start_us = esp_timer_get_time();
+        bool applied = false;
+        bool charge = false;
+        bool discharge = false;
+        if (bms && bms->setMosfet) {
+            applied = bms->setMosfet(bms->handle, req.charge, req.discharge);
+            charge = bms->isChargingEnabled(bms->handle);
+            discharge = bms->isDischargingEnabled(bms->handle);
+        }
+        const int64_t done_us = esp_timer_get_time();
+        const uint32_t queue_us = (uint32_t)(start_us - req.received_us);
+        const uint32_t uart_us = (uint32_t)(done_us - start_us);
+
+        char buf[160];
+        snprintf(buf, sizeof(buf),
+                 "{\"ctr\":%lu,\"applied\":%s,\"charge\":%s,\"discharge\":%s,\"queue_us\":%lu,\"uart_us\":%lu}",
+                 (unsigned long)req.ctr, applied ? "true" : "false", charge ? "true" : "false",
+                 discharge ? "true" : "false", (unsigned long)queue_us, (unsigned long)uart_us);
+        req.reply(buf);
+
+        if (applied) {
+            ESP_LOGI(TAG, "FET command %lu applied: charge %s, discharge %s", (unsigned long)req.ctr,
+                     charge ? "on" : "off", discharge ? "on" : "off");
+        } else {
+            ESP_LOGW(TAG, "FET command %lu not applied", (unsigned long)req.ctr);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        applied ? applied_++ : failed_++;
+        if (queue_us > max_queue_us_) max_queue_us_ = queue_us;
+        if (uart_us > max_uart_us_) max_uart_us_ = uart_us;
+        total_us_ += (uint64_t)(esp_timer_get_time() - req.received_us);
+        executed++;
+    }
+
+    // After the acks, so the NVS write does not delay them
+    uint32_t ctr = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (last_ctr_ != persisted_ctr_) {
+            ctr = last_ctr_;
+        }
+    }
+    if (ctr && analytics::nvsBlobSave(NVS_NAMESPACE, NVS_KEY, CTR_VERSION, &ctr, sizeof(ctr)) == ESP_OK) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        persisted_ctr_ = ctr;
+    }
+    return executed;
+}
+
+bool FetControl::hasPending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !queue_.empty();
+}
+
+void FetControl::toJson(std::string& json) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint32_t executed = applied_ + failed_;
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "{\"enabled\":%s,\"last_ctr\":%lu,\"accepted\":%lu,\"rejected\":%lu,\"applied\":%lu,\"failed\":%lu,"
+             "\"pending\":%u,\"avg_ack_us\":%lu,\"max_queue_us\":%lu,\"max_uart_us\":%lu}",
+             key_.empty() ? "false" : "true", (unsigned long)last_ctr_, (unsigned long)accepted_,
+             (unsigned long)rejected_, (unsigned long)applied_, (unsigned long)failed_, (unsigned)queue_.size(),
+             (unsigned long)(executed ? total_us_ / executed : 0), (unsigned long)max_queue_us_,
+             (unsigned long)max_uart_us_);
+    json = buf;
+}
+
+} // namespace control
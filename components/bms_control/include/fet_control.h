@@ -0,0 +1,113 @@
+#ifndef FET_CONTROL_H
+#define FET_CONTROL_H
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include "bms_interface.h"
+#include "command_router.h"
+
+namespace control {
+
+/**
+ * Authenticated remote MOSFET control ("fet" command)
+ *
+ * The command payload is
+ *   {"charge":true,"discharge":false,"ctr":42,"mac":"<hex>"}
+ * where mac is HMAC-SHA256 over "<device_id>:<ctr>:<charge>:<discharge>"
+ * (booleans as 0/1) with the key from control_config.txt. ctr must be larger
+ * than any counter accepted before; the highest one is kept in NVS so a
+ * captured command cannot be replayed after a reboot either.
+ *
+ * submit() runs on the transport task: it validates and authenticates the
+ * command, queues it and wakes the poll task through the notify callback.
+ * The poll task calls execute() before its routine read, so a write takes the
+ * next free UART slot instead of waiting for the next poll tick. Every
+ * accepted command is acknowledged on the same reply channel with the state
+ * read back from the BMS and where the time went; rejected ones get an error
+ * reply at once.
+ */
+class FetControl {
+public:
+    static constexpr size_t QUEUE_DEPTH = 4;
+
+    static FetControl& getInstance();
+
+    FetControl(const FetControl&) = delete;
+    FetControl& operator=(const FetControl&) = delete;
+
+    /**
+     * @param key HMAC key; commands are refused while it is empty
+     * @param device_id first field of the signed message
+     */
+    void setCredentials(const std::string& key, const std::string& device_id);
+
+    /**
+     * Called after a command was queued (e.g. to notify the poll task)
+     */
+    void setNotify(std::function<void()> notify);
+
+    /**
+     * CommandRouter handler
+     * @return true if the command was queued
+     */
+    bool submit(const std::string& args, const logging::CommandRouter::ReplyFn& reply);
+
+    /**
+     * Apply all queued commands and acknowledge each; poll task only
+     * @return number of commands executed
+     */
+    int execute(bms_interface_t* bms);
+
+    bool hasPending() const;
+
+    /**
+     * Counters and device-side latency as JSON
+     */
+    void toJson(std::string& json) const;
+
+    /**
+     * Lowercase hex HMAC-SHA256 of the signed message, as a client computes it
+     * @return empty string on failure
+     */
+    static std::string sign(const std::string& key, const std::string& device_id,
+                            uint32_t ctr, bool charge, bool discharge);
+
+private:
+    FetControl() = default;
+
+    struct Request {
+        uint32_t ctr;
+        bool charge;
+        bool discharge;
+        int64_t received_us;
+        logging::CommandRouter::ReplyFn reply;
+    };
+
+    bool reject(const logging::CommandRouter::ReplyFn& reply, const char* error, uint32_t ctr);
+    void loadCounter();
+
+    mutable std::mutex mutex_;
+    std::string key_;
+    std::string device_id_;
+    std::function<void()> notify_;
+    std::deque<Request> queue_;
+
+    bool counter_loaded_ = false;
+    uint32_t last_ctr_ = 0;         // highest accepted counter
+    uint32_t persisted_ctr_ = 0;    // last counter written to NVS
+
+    uint32_t accepted_ = 0;
+    uint32_t rejected_ = 0;
+    uint32_t applied_ = 0;
+    uint32_t failed_ = 0;
+    uint32_t max_queue_us_ = 0;
+    uint32_t max_uart_us_ = 0;
+    uint64_t total_us_ = 0;         // submit to ack, summed over executed commands
+};
+
+} // namespace control
+
+#endif // FET_CONTROL_H
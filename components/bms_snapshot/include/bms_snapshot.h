@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+#include <array>
+
+namespace output {
+
+constexpr int DEFAULT_MAX_CSV_CELLS = 16;
+constexpr int DEFAULT_MAX_CSV_TEMPS = 8;
+
+enum class OutputFormat
+{
+    Human = 0,
+    CSV   = 1
+};
+
+struct OutputConfig
+{
+#ifdef LOG_FORMAT_CSV
+    OutputFormat format { OutputFormat::CSV };
+#else
+    OutputFormat format { OutputFormat::Human };
+#endif
+    bool csv_print_header_once { true };
+    int header_cells { 16 };
+    int header_temps { 8 };
+};
+
+// Rolling window ids for per-cell statistics (see analytics::CellStats)
+constexpr int CELL_STATS_WINDOWS = 3;
+constexpr const char* CELL_STATS_WINDOW_NAMES[CELL_STATS_WINDOWS] = { "1m", "1h", "24h" };
+
+struct CellWindowSummary
+{
+    uint32_t samples { 0 };
+    float spread_v { 0.0f };        // max(cell mean) - min(cell mean)
+    float max_stddev_v { 0.0f };    // noisiest cell
+    int drift_cell { 0 };           // 1-based, cell drifting fastest away from the pack mean
+    float drift_mv_per_h { 0.0f };  // that cell's slope minus the pack-mean slope
+};
+
+struct BMSSnapshot
+{
+    // Unique device identifier (alphanumeric, hyphen, underscore; max 32 chars)
+    char device_id[33] { 0 };
+
+    // Loss accounting: boot_id changes on every boot, seq counts samples taken
+    // since boot from 1. A gap in seq is a sample lost after it was taken; a
+    // gap in time without one is a sample never taken.
+    uint32_t boot_id { 0 };
+    uint32_t seq { 0 };
+
+    // Last-known values restored from the NVS checkpoint at boot, not a new
+    // reading; carries seq 0 (see analytics::SnapshotCheckpoint)
+    bool stale { false };
+
+    uint64_t start_time_us { 0 };
+    uint64_t now_time_us { 0 };
+    unsigned elapsed_sec { 0 };
+    unsigned hours { 0 };
+    unsigned minutes { 0 };
+    unsigned seconds { 0 };
+
+    time_t real_timestamp { 0 };
+
+    double total_energy_wh { 0.0 };
+
+    float pack_voltage_v { 0.0f };
+    float pack_current_a { 0.0f };
+    float soc_pct { 0.0f };
+    float power_w { 0.0f };
+    float full_capacity_ah { 0.0f };
+    float est_capacity_ah { 0.0f };   // learned by analytics::SohEstimator (0 = no estimate yet)
+    float soh_pct { 0.0f };           // est_capacity_ah vs rated capacity
+
+    // Runtime prediction from smoothed power (-1 = not applicable / unknown)
+    int32_t time_to_empty_s { -1 };
+    int32_t time_to_full_s { -1 };
+
+    float peak_current_a { 0.0f };
+    float peak_power_w { 0.0f };
+
+    int cell_count { 0 };
+    float min_cell_voltage_v { 0.0f };
+    float max_cell_voltage_v { 0.0f };
+    int min_cell_num { 0 }; // 1-based
+    int max_cell_num { 0 }; // 1-based
+    float cell_voltage_delta_v { 0.0f };
+
+    int temp_count { 0 };
+    float min_temp_c { 0.0f };
+    float max_temp_c { 0.0f };
+
+    bool charging_enabled { false };
+    bool discharging_enabled { false };
+
+    std::array<float, DEFAULT_MAX_CSV_CELLS> cell_v{};
+    std::array<float, DEFAULT_MAX_CSV_TEMPS> temp_c{};
+
+    std::array<CellWindowSummary, CELL_STATS_WINDOWS> cell_stats{};
+
+    // Online DC internal resistance per cell (0 until the first load step)
+    uint32_t ir_steps { 0 };
+    std::array<float, DEFAULT_MAX_CSV_CELLS> cell_ir_mohm{};
+
+    // Cell drift vs pack median: 0 normal, 1 watch, 2 warn, 3 alarm
+    uint8_t anomaly_level { 0 };
+    int anomaly_cell { 0 };           // 1-based, 0 when normal
+    float anomaly_z { 0.0f };         // worst cell's z-score against its own baseline
+};
+
+} // namespace output
+
+#else
+#ifndef DEFAULT_MAX_CSV_CELLS
+#define DEFAULT_MAX_CSV_CELLS 16
+#endif
+#ifndef DEFAULT_MAX_CSV_TEMPS
+#define DEFAULT_MAX_CSV_TEMPS 8
+#endif
+#endif
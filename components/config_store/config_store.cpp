@@ -0,0 +1,332 @@
+#include "config_store.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cJSON.h>
+#include <esp_log.h>
+#include <esp_spiffs.h>
+#include <esp_timer.h>
+#include "nvs_blob.h"
+
+static const char* TAG = "CONFIG_STORE";
+
+static const char* NVS_NAMESPACE = "config";
+static const char* NVS_KEY = "cfg";
+
+static bms_config_t g_config;
+static bool g_initialized = false;
+
+static void set_defaults(bms_config_t* cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->mqtt.port = 1883;
+    cfg->mqtt.use_device_topic = true;
+    cfg->mqtt.qos = -1;
+    cfg->ota.timeout_ms = 30000;
+    cfg->ota.auto_rollback_enabled = true;
+    snprintf(cfg->ota.current_version, sizeof(cfg->ota.current_version), "%s", "1.0.0");
+}
+
+// Validation: alphanumeric, hyphen, underscore only
+static bool is_valid_device_id(const char* id)
+{
+    const size_t len = strlen(id);
+    if (len == 0 || len > 32) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (!isalnum((unsigned char)id[i]) && id[i] != '-' && id[i] != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static char* trim(char* s)
+{
+    while (*s && isspace((unsigned char)*s)) s++;
+    char* end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return s;
+}
+
+// Copy a string field, refusing values that would be truncated
+static bool copy_field(char* dst, size_t dst_size, const char* value, const char* name)
+{
+    if (strlen(value) >= dst_size) {
+        ESP_LOGW(TAG, "Ignoring %s: longer than %u characters", name, (unsigned)(dst_size - 1));
+        return false;
+    }
+    memcpy(dst, value, strlen(value) + 1);
+    return true;
+}
+
+typedef void (*kv_handler_t)(const char* key, const char* value, bms_config_t* cfg);
+
+// Read a key=value file with '#' comments
+static bool parse_kv_file(const char* path, kv_handler_t handler, bms_config_t* cfg)
+{
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char* key = trim(line);
+        if (key[0] == '#' || key[0] == '\0') {
+            continue;
+        }
+        char* eq_pos = strchr(key, '=');
+        if (!eq_pos) {
+            continue;
+        }
+        *eq_pos = '\0';
+        handler(trim(key), trim(eq_pos + 1), cfg);
+    }
+
+    fclose(file);
+    return true;
+}
+
+static void device_kv(const char* key, const char* value, bms_config_t* cfg)
+{
+    if (strcmp(key, "device_id") != 0) {
+        return;
+    }
+    if (is_valid_device_id(value)) {
+        memcpy(cfg->device_id, value, strlen(value) + 1);
+        cfg->sections |= CONFIG_SECTION_DEVICE_ID;
+    } else {
+        ESP_LOGW(TAG, "Invalid device_id in config (must be alphanumeric/hyphen/underscore, max 32 chars): %s", value);
+    }
+}
+
+static void mqtt_kv(const char* key, const char* value, bms_config_t* cfg)
+{
+    bms_mqtt_settings_t* mqtt = &cfg->mqtt;
+    if (strcmp(key, "host") == 0) {
+        copy_field(mqtt->host, sizeof(mqtt->host), value, "MQTT host");
+    } else if (strcmp(key, "port") == 0) {
+        int port = atoi(value);
+        if (port >= 1 && port <= 65535) {
+            mqtt->port = (uint16_t)port;
+        } else {
+            ESP_LOGW(TAG, "Ignoring MQTT port %s: must be between 1-65535", value);
+        }
+    } else if (strcmp(key, "topic") == 0) {
+        copy_field(mqtt->topic, sizeof(mqtt->topic), value, "MQTT topic");
+    } else if (strcmp(key, "use_device_topic") == 0) {
+        mqtt->use_device_topic = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+    } else if (strcmp(key, "username") == 0) {
+        copy_field(mqtt->username, sizeof(mqtt->username), value, "MQTT username");
+    } else if (strcmp(key, "password") == 0) {
+        copy_field(mqtt->password, sizeof(mqtt->password), value, "MQTT password");
+    } else if (strcmp(key, "qos") == 0) {
+        int qos = atoi(value);
+        if (qos >= 0 && qos <= 2) {
+            mqtt->qos = (int8_t)qos;
+        } else {
+            ESP_LOGW(TAG, "Ignoring MQTT qos %s: must be between 0-2", value);
+        }
+    }
+}
+
+// Shorter keys are too easy to brute-force offline from one signed command
+static constexpr size_t MIN_FET_KEY_LEN = 16;
+
+static void control_kv(const char* key, const char* value, bms_config_t* cfg)
+{
+    if (strcmp(key, "fet_key") != 0) {
+        return;
+    }
+    if (strlen(value) < MIN_FET_KEY_LEN) {
+        ESP_LOGW(TAG, "Ignoring fet_key: shorter than %u characters", (unsigned)MIN_FET_KEY_LEN);
+        return;
+    }
+    if (copy_field(cfg->control.fet_key, sizeof(cfg->control.fet_key), value, "fet_key")) {
+        cfg->sections |= CONFIG_SECTION_CONTROL;
+    }
+}
+
+static bool load_timezone(const char* path, bms_config_t* cfg)
+{
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    char buf[128] = {0};
+    size_t n = fread(buf, 1, sizeof(buf) - 1, file);
+    fclose(file);
+    buf[n] = '\0';
+
+    const char* tz = trim(buf);
+    if (tz[0] != '\0' && copy_field(cfg->timezone, sizeof(cfg->timezone), tz, "timezone")) {
+        cfg->sections |= CONFIG_SECTION_TIMEZONE;
+    }
+    return true;
+}
+
+static bool load_ota(const char* path, bms_config_t* cfg)
+{
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char* json_string = file_size >= 0 ? static_cast<char*>(malloc(file_size + 1)) : nullptr;
+    if (!json_string) {
+        fclose(file);
+        return true;
+    }
+    size_t read_size = fread(json_string, 1, file_size, file);
+    json_string[read_size] = '\0';
+    fclose(file);
+
+    cJSON* json = cJSON_Parse(json_string);
+    free(json_string);
+    if (!json) {
+        ESP_LOGE(TAG, "Failed to parse %s", path);
+        return true;
+    }
+
+    bms_ota_settings_t* ota = &cfg->ota;
+    cJSON* item = cJSON_GetObjectItem(json, "server_url");
+    if (cJSON_IsString(item)) {
+        copy_field(ota->server_url, sizeof(ota->server_url), item->valuestring, "OTA server_url");
+    }
+    item = cJSON_GetObjectItem(json, "cert_pem");
+    if (cJSON_IsString(item)) {
+        copy_field(ota->cert_pem, sizeof(ota->cert_pem), item->valuestring, "OTA cert_pem");
+    }
+    item = cJSON_GetObjectItem(json, "skip_cert_verification");
+    if (cJSON_IsBool(item)) {
+        ota->skip_cert_verification = cJSON_IsTrue(item);
+    }
+    item = cJSON_GetObjectItem(json, "timeout_ms");
+    if (cJSON_IsNumber(item)) {
+        ota->timeout_ms = (uint32_t)item->valueint;
+    }
+    item = cJSON_GetObjectItem(json, "current_version");
+    if (cJSON_IsString(item)) {
+        copy_field(ota->current_version, sizeof(ota->current_version), item->valuestring, "OTA current_version");
+    }
+    item = cJSON_GetObjectItem(json, "auto_rollback_enabled");
+    if (cJSON_IsBool(item)) {
+        ota->auto_rollback_enabled = cJSON_IsTrue(item);
+    }
+    cJSON_Delete(json);
+
+    cfg->sections |= CONFIG_SECTION_OTA;
+    return true;
+}
+
+// Parse the SPIFFS text files into cfg; returns how many files were found
+static int import_spiffs_files(bms_config_t* cfg)
+{
+    // WiFi config stays with wifi_manager, which may already have mounted SPIFFS
+    bool mounted_here = false;
+    if (!esp_spiffs_mounted(NULL)) {
+        esp_vfs_spiffs_conf_t conf = {
+            .base_path = "/spiffs",
+            .partition_label = NULL,
+            .max_files = 5,
+            .format_if_mount_failed = false
+        };
+        esp_err_t ret = esp_vfs_spiffs_register(&conf);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "SPIFFS mount failed (%s), using defaults", esp_err_to_name(ret));
+            return 0;
+        }
+        mounted_here = true;
+    }
+
+    int found = 0;
+    found += parse_kv_file("/spiffs/device_config.txt", device_kv, cfg);
+    found += load_timezone("/spiffs/timezone.txt", cfg);
+    if (parse_kv_file("/spiffs/mqtt_config.txt", mqtt_kv, cfg)) {
+        cfg->sections |= CONFIG_SECTION_MQTT;
+        found++;
+    }
+    found += load_ota("/spiffs/ota_config.txt", cfg);
+    found += parse_kv_file("/spiffs/control_config.txt", control_kv, cfg);
+
+    if (mounted_here) {
+        esp_vfs_spiffs_unregister(NULL);
+    }
+    return found;
+}
+
+esp_err_t config_store_init(void)
+{
+    if (g_initialized) {
+        return ESP_OK;
+    }
+
+    const int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = analytics::nvsBlobLoad(NVS_NAMESPACE, NVS_KEY, CONFIG_STORE_VERSION,
+                                           &g_config, sizeof(g_config));
+    if (ret == ESP_OK) {
+        g_initialized = true;
+        ESP_LOGI(TAG, "Loaded config from NVS in %lld us (sections 0x%lx)",
+                 (long long)(esp_timer_get_time() - start_us), (unsigned long)g_config.sections);
+        return ESP_OK;
+    }
+
+    set_defaults(&g_config);
+    g_initialized = true;
+    if (import_spiffs_files(&g_config) == 0) {
+        // Nothing to migrate; try again next boot in case SPIFFS gets flashed
+        ESP_LOGI(TAG, "No config in NVS or SPIFFS, using defaults");
+        return ESP_OK;
+    }
+
+    ret = analytics::nvsBlobSave(NVS_NAMESPACE, NVS_KEY, CONFIG_STORE_VERSION, &g_config, sizeof(g_config));
+    ESP_LOGI(TAG, "Imported config from SPIFFS in %lld us (sections 0x%lx)%s",
+             (long long)(esp_timer_get_time() - start_us), (unsigned long)g_config.sections,
+             ret == ESP_OK ? "" : ", not saved");
+    return ESP_OK;
+}
+
+const bms_config_t* config_store_get(void)
+{
+    if (!g_initialized) {
+        config_store_init();
+    }
+    return &g_config;
+}
+
+esp_err_t config_store_save(const bms_config_t* config)
+{
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // g_config is read without a lock from every task, so it keeps the
+    // values loaded at boot; the new record is picked up by the next init
+    return analytics::nvsBlobSave(NVS_NAMESPACE, NVS_KEY, CONFIG_STORE_VERSION, config, sizeof(*config));
+}
+
+esp_err_t config_store_import_spiffs(void)
+{
+    bms_config_t* cfg = static_cast<bms_config_t*>(malloc(sizeof(bms_config_t)));
+    if (!cfg) {
+        return ESP_ERR_NO_MEM;
+    }
+    set_defaults(cfg);
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    if (import_spiffs_files(cfg) > 0) {
+        ret = config_store_save(cfg);
+        if (ret == ESP_OK) {
+            ESP_LOGI(TAG, "Re-imported config from SPIFFS (sections 0x%lx)", (unsigned long)cfg->sections);
+        }
+    }
+    free(cfg);
+    return ret;
+}
@@ -0,0 +1,101 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bump whenever bms_config_t changes layout; older records are re-imported
+#define CONFIG_STORE_VERSION        2
+
+// bms_config_t.sections: which parts were present in the source files
+#define CONFIG_SECTION_DEVICE_ID    (1u << 0)
+#define CONFIG_SECTION_TIMEZONE     (1u << 1)
+#define CONFIG_SECTION_MQTT         (1u << 2)
+#define CONFIG_SECTION_OTA          (1u << 3)
+#define CONFIG_SECTION_CONTROL      (1u << 4)
+
+typedef struct {
+    char host[128];
+    uint16_t port;
+    char username[64];
+    char password[64];
+    char topic[128];
+    bool use_device_topic;
+    int8_t qos;                 // -1 when not configured
+} bms_mqtt_settings_t;
+
+typedef struct {
+    char server_url[256];
+    char cert_pem[2048];
+    bool skip_cert_verification;
+    uint32_t timeout_ms;
+    char current_version[32];
+    bool auto_rollback_enabled;
+} bms_ota_settings_t;
+
+typedef struct {
+    char fet_key[65];           // HMAC-SHA256 key for the "fet" command; empty = disabled
+} bms_control_settings_t;
+
+/**
+ * Device configuration, stored as one versioned binary record in NVS
+ *
+ * Fields of a section whose bit is clear in `sections` hold defaults; readers
+ * keep their own built-in behaviour for that section.
+ */
+typedef struct {
+    uint32_t sections;
+    char device_id[33];
+    char timezone[64];
+    bms_mqtt_settings_t mqtt;
+    bms_ota_settings_t ota;
+    bms_control_settings_t control;
+} bms_config_t;
+
+/**
+ * Load the configuration record
+ *
+ * Reads the NVS record. If it is missing or was written by another
+ * CONFIG_STORE_VERSION, the SPIFFS text files (device_config.txt,
+ * timezone.txt, mqtt_config.txt, ota_config.txt, control_config.txt) are imported once and the
+ * result is saved, so later boots do not touch SPIFFS.
+ *
+ * @return ESP_OK, also when neither NVS nor SPIFFS had anything (defaults)
+ */
+esp_err_t config_store_init(void);
+
+/**
+ * Get the in-memory configuration
+ *
+ * Calls config_store_init() on first use. The pointer stays valid for the
+ * lifetime of the application and its contents do not change after init, so
+ * any task may read it.
+ */
+const bms_config_t* config_store_get(void);
+
+/**
+ * Write a new configuration record to NVS
+ *
+ * The in-memory configuration keeps the values loaded at boot; the new
+ * record applies after a reboot. Safe to call from any task.
+ */
+esp_err_t config_store_save(const bms_config_t* config);
+
+/**
+ * Re-import the SPIFFS text files, e.g. after reflashing the SPIFFS image
+ *
+ * @return ESP_OK if at least one file was found and the record was saved,
+ *         ESP_ERR_NOT_FOUND if no file was found (the record is unchanged)
+ */
+esp_err_t config_store_import_spiffs(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONFIG_STORE_H
@@ -0,0 +1,171 @@
+#include "connectivity.h"
+
+#include <esp_event.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+
+#include <atomic>
+#include <mutex>
+
+static const char* TAG = "connectivity";
+
+namespace {
+
+struct Subscriber {
+  connectivity_cb_t cb;
+  void* ctx;
+};
+
+class ConnectivityBus {
+public:
+  static ConnectivityBus& I() {
+    static ConnectivityBus s;
+    return s;
+  }
+
+  esp_err_t init() {
+    if (initialized_) return ESP_OK;
+
+    // wifi_manager normally creates the default loop; tolerate either order
+    esp_err_t err = esp_event_loop_create_default();
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+      ESP_LOGE(TAG, "Failed to create default event loop: %s", esp_err_to_name(err));
+      return err;
+    }
+
+    err = esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED,
+                                              &ConnectivityBus::onEvent, this, &wifi_handler_);
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to register WIFI_EVENT handler: %s", esp_err_to_name(err));
+      return err;
+    }
+
+    err = esp_event_handler_instance_register(IP_EVENT, ESP_EVENT_ANY_ID,
+                                              &ConnectivityBus::onEvent, this, &ip_handler_);
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to register IP_EVENT handler: %s", esp_err_to_name(err));
+      esp_event_handler_instance_unregister(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, wifi_handler_);
+      wifi_handler_ = nullptr;
+      return err;
+    }
+
+    initialized_ = true;
+    ESP_LOGI(TAG, "Connectivity event bus initialized");
+    return ESP_OK;
+  }
+
+  void deinit() {
+    if (!initialized_) return;
+    esp_event_handler_instance_unregister(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, wifi_handler_);
+    esp_event_handler_instance_unregister(IP_EVENT, ESP_EVENT_ANY_ID, ip_handler_);
+    wifi_handler_ = nullptr;
+    ip_handler_ = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      sub_count_ = 0;
+    }
+    initialized_ = false;
+  }
+
+  bool active() const { return initialized_; }
+  bool online() const { return online_.load(std::memory_order_acquire); }
+  uint32_t generation() const { return generation_.load(std::memory_order_acquire); }
+
+  void info(connectivity_info_t* out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    *out = info_;
+  }
+
+  esp_err_t subscribe(connectivity_cb_t cb, void* ctx) {
+    if (!cb) return ESP_ERR_INVALID_ARG;
+    connectivity_info_t current;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (sub_count_ >= CONNECTIVITY_MAX_SUBSCRIBERS) return ESP_ERR_NO_MEM;
+      subs_[sub_count_++] = Subscriber{cb, ctx};
+      current = info_;
+    }
+    cb(&current, ctx);
+    return ESP_OK;
+  }
+
+private:
+  static void onEvent(void* arg, esp_event_base_t base, int32_t id, void* data) {
+    ConnectivityBus* self = static_cast<ConnectivityBus*>(arg);
+    if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+      const ip_event_got_ip_t* ev = static_cast<const ip_event_got_ip_t*>(data);
+      int8_t rssi = 0;
+      wifi_ap_record_t ap;
+      if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) rssi = ap.rssi;
+      self->transition(true, ev ? ev->ip_info.ip.addr : 0, rssi);
+    } else if (base == IP_EVENT && id == IP_EVENT_STA_LOST_IP) {
+      self->transition(false, 0, 0);
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
+      self->transition(false, 0, 0);
+    }
+  }
+
+  void transition(bool online, uint32_t ip, int8_t rssi) {
+    Subscriber subs[CONNECTIVITY_MAX_SUBSCRIBERS];
+    size_t count = 0;
+    connectivity_info_t snapshot;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (info_.online == online && (!online || info_.ip_address == ip)) {
+        // Repeated disconnect events while the driver retries; nothing changed
+        return;
+      }
+      info_.online = online;
+      info_.ip_address = ip;
+      info_.rssi = rssi;
+      info_.last_change_us = esp_timer_get_time();
+      if (!online) info_.disconnect_count++;
+      info_.generation++;
+      // Publish the flag before waking subscribers so readers see it first
+      online_.store(online, std::memory_order_release);
+      generation_.store(info_.generation, std::memory_order_release);
+      snapshot = info_;
+      count = sub_count_;
+      for (size_t i = 0; i < count; ++i) subs[i] = subs_[i];
+    }
+
+    ESP_LOGI(TAG, "Link %s (generation %lu)", online ? "up" : "down",
+             (unsigned long)snapshot.generation);
+    for (size_t i = 0; i < count; ++i) {
+      subs[i].cb(&snapshot, subs[i].ctx);
+    }
+  }
+
+  bool initialized_ = false;
+  esp_event_handler_instance_t wifi_handler_ = nullptr;
+  esp_event_handler_instance_t ip_handler_ = nullptr;
+
+  std::atomic<bool> online_{false};
+  std::atomic<uint32_t> generation_{0};
+
+  std::mutex mutex_;
+  connectivity_info_t info_{};
+  Subscriber subs_[CONNECTIVITY_MAX_SUBSCRIBERS]{};
+  size_t sub_count_ = 0;
+};
+
+} // namespace
+
+extern "C" {
+
+esp_err_t connectivity_init(void) { return ConnectivityBus::I().init(); }
+void connectivity_deinit(void) { ConnectivityBus::I().deinit(); }
+bool connectivity_is_active(void) { return ConnectivityBus::I().active(); }
+bool connectivity_is_online(void) { return ConnectivityBus::I().online(); }
+uint32_t connectivity_generation(void) { return ConnectivityBus::I().generation(); }
+
+void connectivity_get_info(connectivity_info_t* out) {
+  if (out) ConnectivityBus::I().info(out);
+}
+
+esp_err_t connectivity_subscribe(connectivity_cb_t cb, void* ctx) {
+  return ConnectivityBus::I().subscribe(cb, ctx);
+}
+
+} // extern "C"
@@ -0,0 +1,80 @@
+#ifndef CONNECTIVITY_H
+#define CONNECTIVITY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONNECTIVITY_MAX_SUBSCRIBERS 8
+
+// Snapshot of the station link as seen by the event bus
+typedef struct {
+  bool online;                 // station associated and holding an IP
+  int8_t rssi;                 // dBm (valid only if online)
+  uint32_t ip_address;         // network byte order (valid only if online)
+  uint32_t generation;         // incremented on every online/offline transition
+  uint32_t disconnect_count;   // total disconnects since init
+  uint64_t last_change_us;     // esp_timer time of the last transition
+} connectivity_info_t;
+
+/**
+ * @brief Subscriber callback. Runs on the default event loop task, keep it short.
+ */
+typedef void (*connectivity_cb_t)(const connectivity_info_t* info, void* ctx);
+
+/**
+ * @brief Initialize the connectivity event bus
+ *
+ * Registers WIFI_EVENT / IP_EVENT handlers on the default event loop, which
+ * wifi_manager drives. Call after wifi_manager_init() and before
+ * wifi_manager_start() so the first GOT_IP event is observed.
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t connectivity_init(void);
+
+/**
+ * @brief Unregister event handlers and drop all subscribers
+ */
+void connectivity_deinit(void);
+
+/**
+ * @brief True once connectivity_init() succeeded. Consumers should not gate
+ * traffic on the link state when the bus is not running.
+ */
+bool connectivity_is_active(void);
+
+/**
+ * @brief Lock-free check of the current link state (safe from any task)
+ */
+bool connectivity_is_online(void);
+
+/**
+ * @brief Transition counter; changes whenever the link goes up or down.
+ * Consumers compare against their last seen value to detect a reconnect.
+ */
+uint32_t connectivity_generation(void);
+
+/**
+ * @brief Copy the current link snapshot
+ */
+void connectivity_get_info(connectivity_info_t* out);
+
+/**
+ * @brief Subscribe to online/offline transitions
+ *
+ * The callback is invoked once immediately with the current state.
+ *
+ * @return ESP_OK, or ESP_ERR_NO_MEM when all subscriber slots are taken
+ */
+esp_err_t connectivity_subscribe(connectivity_cb_t cb, void* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONNECTIVITY_H
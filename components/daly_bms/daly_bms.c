@@ -106,6 +106,12 @@ static float daly_bms_get_peak_power(void* bms_handle) {
     return handle->data.peakPower;
 }
 
+static void daly_bms_set_peak_values(void* bms_handle, float peak_current, float peak_power) {
+    daly_bms_handle_t* handle = (daly_bms_handle_t*)bms_handle;
+    handle->data.peakCurrent = peak_current;
+    handle->data.peakPower = peak_power;
+}
+
 static bool daly_bms_is_charging_enabled(void* bms_handle) {
     daly_bms_handle_t* handle = (daly_bms_handle_t*)bms_handle;
     return handle->data.chargeFetState;
@@ -121,6 +127,10 @@ static float daly_bms_get_cell_voltage_delta(void* bms_handle) {
     return handle->data.cellDiff / 1000.0f; // Convert mV to V
 }
 
+static bool daly_bms_set_mosfet(void* bms_handle, bool charge_on, bool discharge_on) {
+    return daly_bms_set_mos((daly_bms_handle_t*)bms_handle, charge_on, discharge_on);
+}
+
 // Create Daly BMS interface
 bms_interface_t* daly_bms_create(uart_port_t uart_port, int rx_pin, int tx_pin) {
     daly_bms_handle_t* handle = calloc(1, sizeof(daly_bms_handle_t));
@@ -200,6 +210,8 @@ bms_interface_t* daly_bms_create(uart_port_t uart_port, int rx_pin, int tx_pin)
     interface->isChargingEnabled = daly_bms_is_charging_enabled;
     interface->isDischargingEnabled = daly_bms_is_discharging_enabled;
     interface->getCellVoltageDelta = daly_bms_get_cell_voltage_delta;
+    interface->setPeakValues = daly_bms_set_peak_values;
+    interface->setMosfet = daly_bms_set_mosfet;
 
     ESP_LOGI(TAG, "Daly BMS interface created successfully");
     return interface;
@@ -262,14 +274,23 @@ void daly_bms_send_command(daly_bms_handle_t* handle, daly_command_t cmd_id) {
         return;
     }
 
-    // Set command byte
-    handle->tx_buffer[2] = (uint8_t)cmd_id;
-
     // Clear data bytes
     for (int i = 3; i < 12; i++) {
         handle->tx_buffer[i] = 0x00;
     }
 
+    daly_bms_send_frame(handle, cmd_id);
+}
+
+// Send command with the data bytes already in tx_buffer[3..11]
+void daly_bms_send_frame(daly_bms_handle_t* handle, daly_command_t cmd_id) {
+    if (!handle) {
+        return;
+    }
+
+    // Set command byte
+    handle->tx_buffer[2] = (uint8_t)cmd_id;
+
     // Calculate checksum
     uint8_t checksum = 0;
     for (int i = 0; i < 12; i++) {
@@ -569,7 +590,7 @@ bool daly_bms_set_discharge_mos(daly_bms_handle_t* handle, bool sw) {
     memset(&handle->tx_buffer[3], 0, 9);
     handle->tx_buffer[3] = sw ? 0x01 : 0x00;
 
-    daly_bms_send_command(handle, DALY_CMD_DISCHRG_FET);
+    daly_bms_send_frame(handle, DALY_CMD_DISCHRG_FET);
 
     // No response expected for this command
     vTaskDelay(pdMS_TO_TICKS(100));
@@ -587,7 +608,7 @@ bool daly_bms_set_charge_mos(daly_bms_handle_t* handle, bool sw) {
     memset(&handle->tx_buffer[3], 0, 9);
     handle->tx_buffer[3] = sw ? 0x01 : 0x00;
 
-    daly_bms_send_command(handle, DALY_CMD_CHRG_FET);
+    daly_bms_send_frame(handle, DALY_CMD_CHRG_FET);
 
     // No response expected for this command
     vTaskDelay(pdMS_TO_TICKS(100));
@@ -595,6 +616,25 @@ bool daly_bms_set_charge_mos(daly_bms_handle_t* handle, bool sw) {
     return true;
 }
 
+// Switch both MOSFETs, then read the MOS status (0x93) back to confirm
+bool daly_bms_set_mos(daly_bms_handle_t* handle, bool charge_on, bool discharge_on) {
+    if (!handle) {
+        return false;
+    }
+
+    daly_bms_set_charge_mos(handle, charge_on);
+    daly_bms_set_discharge_mos(handle, discharge_on);
+
+    // The switch commands may be echoed; do not mistake an echo for the status
+    uart_flush_input(handle->uart_port);
+    if (!daly_bms_get_discharge_charge_mos_status(handle)) {
+        ESP_LOGW(TAG, "MOS state read-back failed");
+        return false;
+    }
+
+    return handle->data.chargeFetState == charge_on && handle->data.disChargeFetState == discharge_on;
+}
+
 // Get charge/discharge MOS status
 bool daly_bms_get_discharge_charge_mos_status(daly_bms_handle_t* handle) {
     if (!handle) {
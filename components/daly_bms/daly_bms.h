@@ -176,10 +176,12 @@ bool daly_bms_get_failure_codes(daly_bms_handle_t* handle);
 bool daly_bms_set_discharge_mos(daly_bms_handle_t* handle, bool sw);
 bool daly_bms_set_charge_mos(daly_bms_handle_t* handle, bool sw);
 bool daly_bms_get_discharge_charge_mos_status(daly_bms_handle_t* handle);
+bool daly_bms_set_mos(daly_bms_handle_t* handle, bool charge_on, bool discharge_on);
 bool daly_bms_reset(daly_bms_handle_t* handle);
 
 // Internal functions
 void daly_bms_send_command(daly_bms_handle_t* handle, daly_command_t cmd_id);
+void daly_bms_send_frame(daly_bms_handle_t* handle, daly_command_t cmd_id);
 bool daly_bms_receive_bytes(daly_bms_handle_t* handle);
 bool daly_bms_validate_checksum(daly_bms_handle_t* handle);
 void daly_bms_update_peak_values(daly_bms_handle_t* handle);
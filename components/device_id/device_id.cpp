@@ -1,10 +1,10 @@
 #include "device_id.h"
 
+#include <stdio.h>
 #include <string.h>
-#include <ctype.h>
 #include <esp_log.h>
 #include <esp_mac.h>
-#include <esp_spiffs.h>
+#include "config_store.h"
 
 static const char* TAG = "DEVICE_ID";
 
@@ -12,77 +12,18 @@ static const char* TAG = "DEVICE_ID";
 static char cached_device_id[33] = {0};
 static bool initialized = false;
 
-// Validation: alphanumeric, hyphen, underscore only
-static bool is_valid_device_id(const char* id)
-{
-    if (!id || strlen(id) == 0 || strlen(id) > 32) {
-        return false;
-    }
-
-    for (size_t i = 0; i < strlen(id); i++) {
-        char c = id[i];
-        if (!isalnum(c) && c != '-' && c != '_') {
-            return false;
-        }
-    }
-
-    return true;
-}
-
-// Try to load custom device ID from SPIFFS
+// Custom device ID from the config store (imported from device_config.txt)
 static esp_err_t load_custom_device_id(char* buffer, size_t buffer_size)
 {
-    FILE* config_file = fopen("/spiffs/device_config.txt", "r");
-    if (!config_file) {
-        ESP_LOGD(TAG, "No custom device config found in SPIFFS");
+    const bms_config_t* cfg = config_store_get();
+    if (!(cfg->sections & CONFIG_SECTION_DEVICE_ID)) {
+        ESP_LOGD(TAG, "No custom device_id configured");
         return ESP_ERR_NOT_FOUND;
     }
 
-    char line[128];
-    bool found = false;
-
-    while (fgets(line, sizeof(line), config_file)) {
-        // Remove newline
-        line[strcspn(line, "\r\n")] = '\0';
-
-        // Skip comments and empty lines
-        if (line[0] == '#' || line[0] == '\0') {
-            continue;
-        }
-
-        // Look for device_id=value
-        char* eq_pos = strchr(line, '=');
-        if (eq_pos) {
-            *eq_pos = '\0';
-            char* key = line;
-            char* value = eq_pos + 1;
-
-            // Trim whitespace from key
-            while (*key && isspace(*key)) key++;
-            char* key_end = key + strlen(key) - 1;
-            while (key_end > key && isspace(*key_end)) *key_end-- = '\0';
-
-            // Trim whitespace from value
-            while (*value && isspace(*value)) value++;
-            char* value_end = value + strlen(value) - 1;
-            while (value_end > value && isspace(*value_end)) *value_end-- = '\0';
-
-            if (strcmp(key, "device_id") == 0) {
-                if (is_valid_device_id(value)) {
-                    snprintf(buffer, buffer_size, "%s", value);
-                    found = true;
-                    ESP_LOGI(TAG, "Loaded custom device_id: %s", buffer);
-                    break;
-                } else {
-                    ESP_LOGW(TAG, "Invalid device_id in config (must be alphanumeric/hyphen/underscore, max 32 chars): %s", value);
-                }
-            }
-        }
-    }
-
-    fclose(config_file);
-
-    return found ? ESP_OK : ESP_ERR_NOT_FOUND;
+    snprintf(buffer, buffer_size, "%s", cfg->device_id);
+    ESP_LOGI(TAG, "Loaded custom device_id: %s", buffer);
+    return ESP_OK;
 }
 
 // Generate device ID from eFUSE MAC address
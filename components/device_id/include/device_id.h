@@ -11,7 +11,7 @@ extern "C" {
 /**
  * Initialize device ID subsystem
  *
- * Attempts to read custom device ID from /spiffs/device_config.txt
+ * Uses the custom device ID from the config store (device_config.txt)
  * Falls back to ESP32 chip eFUSE MAC address if not configured
  *
  * @return ESP_OK on success, error code otherwise
@@ -110,6 +110,12 @@ static float jbd_bms_get_peak_power(void* bms_handle) {
     return handle->data.peakPower;
 }
 
+static void jbd_bms_set_peak_values(void* bms_handle, float peak_current, float peak_power) {
+    jbd_bms_handle_t* handle = (jbd_bms_handle_t*)bms_handle;
+    handle->data.peakCurrent = peak_current;
+    handle->data.peakPower = peak_power;
+}
+
 static bool jbd_bms_is_charging_enabled(void* bms_handle) {
     jbd_bms_handle_t* handle = (jbd_bms_handle_t*)bms_handle;
     return handle->data.chargingEnabled;
@@ -125,6 +131,10 @@ static float jbd_bms_get_cell_voltage_delta(void* bms_handle) {
     return handle->data.maxCellVoltage - handle->data.minCellVoltage;
 }
 
+static bool jbd_bms_set_mosfet(void* bms_handle, bool charge_on, bool discharge_on) {
+    return jbd_bms_set_mos((jbd_bms_handle_t*)bms_handle, charge_on, discharge_on);
+}
+
 // Create JBD BMS interface
 bms_interface_t* jbd_bms_create(uart_port_t uart_port, int rx_pin, int tx_pin) {
     jbd_bms_handle_t* handle = calloc(1, sizeof(jbd_bms_handle_t));
@@ -204,6 +214,8 @@ bms_interface_t* jbd_bms_create(uart_port_t uart_port, int rx_pin, int tx_pin) {
     interface->isChargingEnabled = jbd_bms_is_charging_enabled;
     interface->isDischargingEnabled = jbd_bms_is_discharging_enabled;
     interface->getCellVoltageDelta = jbd_bms_get_cell_voltage_delta;
+    interface->setPeakValues = jbd_bms_set_peak_values;
+    interface->setMosfet = jbd_bms_set_mosfet;
 
     ESP_LOGI(TAG, "JBD BMS interface created successfully");
     return interface;
@@ -483,6 +495,57 @@ bool jbd_bms_read_data(jbd_bms_handle_t* handle) {
     return (retries > 0);
 }
 
+// Read one response frame: the 4-byte header, then exactly the rest of the
+// frame, so the call returns as soon as the BMS has finished sending
+static int jbd_read_frame(jbd_bms_handle_t* handle) {
+    memset(handle->rx_buffer, 0, JBD_XFER_BUFFER_LENGTH);
+    int bytes_read = uart_read_bytes(handle->uart_port, handle->rx_buffer, 4, pdMS_TO_TICKS(100));
+    if (bytes_read != 4 || handle->rx_buffer[0] != JBD_PKT_START) return -1;
+
+    // Data, CRC and stop byte
+    int rest = handle->rx_buffer[3] + 3;
+    if (4 + rest > JBD_XFER_BUFFER_LENGTH) return -1;
+
+    bytes_read = uart_read_bytes(handle->uart_port, &handle->rx_buffer[4], rest, pdMS_TO_TICKS(50));
+    return (bytes_read == rest) ? 4 + rest : -1;
+}
+
+// Switch the MOSFETs through the MOS control register (bit 0 set = charge
+// off, bit 1 set = discharge off). The write reply carries no state, so
+// HWINFO is read back to confirm what the BMS applied.
+bool jbd_bms_set_mos(jbd_bms_handle_t* handle, bool charge_on, bool discharge_on) {
+    if (!handle) {
+        return false;
+    }
+
+    uint8_t mos[2] = { 0x00, (uint8_t)((charge_on ? 0x00 : 0x01) | (discharge_on ? 0x00 : 0x02)) };
+    int cmd_len = jbd_cmd(handle, JBD_CMD_WRITE, JBD_CMD_MOS, mos, sizeof(mos));
+    if (cmd_len < 0) return false;
+
+    // Drop anything left over from an earlier timed-out read
+    uart_flush_input(handle->uart_port);
+    uart_write_bytes(handle->uart_port, (const char*)handle->tx_buffer, cmd_len);
+
+    int len = jbd_read_frame(handle);
+    if (len < 0 || !jbd_verify(handle, handle->rx_buffer, len, JBD_CMD_MOS) || handle->rx_buffer[2] != 0x00) {
+        ESP_LOGW(TAG, "MOS write not acknowledged");
+        return false;
+    }
+
+    cmd_len = jbd_cmd(handle, JBD_CMD_READ, JBD_CMD_HWINFO, NULL, 0);
+    if (cmd_len < 0) return false;
+    uart_write_bytes(handle->uart_port, (const char*)handle->tx_buffer, cmd_len);
+
+    len = jbd_read_frame(handle);
+    if (len < 0 || !jbd_verify(handle, handle->rx_buffer, len, JBD_CMD_HWINFO)) {
+        ESP_LOGW(TAG, "MOS state read-back failed");
+        return false;
+    }
+    jbd_parse_hwinfo(handle, &handle->rx_buffer[4], handle->rx_buffer[3]);
+
+    return handle->data.chargingEnabled == charge_on && handle->data.dischargingEnabled == discharge_on;
+}
+
 // Update all JBD BMS data
 bool jbd_bms_update(jbd_bms_handle_t* handle) {
     if (!handle) {
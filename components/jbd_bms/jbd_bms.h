@@ -95,6 +95,7 @@ void jbd_bms_destroy(bms_interface_t* bms_interface);
 bool jbd_bms_init(jbd_bms_handle_t* handle);
 bool jbd_bms_update(jbd_bms_handle_t* handle);
 bool jbd_bms_read_data(jbd_bms_handle_t* handle);
+bool jbd_bms_set_mos(jbd_bms_handle_t* handle, bool charge_on, bool discharge_on);
 
 // Internal functions
 
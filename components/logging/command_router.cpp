@@ -0,0 +1,113 @@
+#include "command_router.h"
+#include <esp_log.h>
+
+static const char* TAG = "CommandRouter";
+
+namespace logging {
+
+CommandRouter& CommandRouter::getInstance() {
+    static CommandRouter instance;
+    return instance;
+}
+
+void CommandRouter::registerCommand(const std::string& name, Handler handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    handlers_[name] = std::move(handler);
+    ESP_LOGI(TAG, "Registered command: %s", name.c_str());
+}
+
+void CommandRouter::registerQueuedCommand(const std::string& name, Handler handler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    handlers_.erase(name);
+    queued_handlers_[name] = std::move(handler);
+    ESP_LOGI(TAG, "Registered queued command: %s", name.c_str());
+}
+
+void CommandRouter::unregisterCommand(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    handlers_.erase(name);
+    queued_handlers_.erase(name);
+}
+
+void CommandRouter::setQueuedNotify(std::function<void()> notify) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    notify_ = std::move(notify);
+}
+
+bool CommandRouter::dispatch(const std::string& name, const std::string& args, const ReplyFn& reply) {
+    Handler handler;
+    std::function<void()> notify;
+    bool queued = false;
+    bool busy = false;
+    {
+        // Copy out so a slow handler does not block registration
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = handlers_.find(name);
+        if (it != handlers_.end()) {
+            handler = it->second;
+        } else if ((it = queued_handlers_.find(name)) != queued_handlers_.end()) {
+            queued = true;
+            if (queue_.size() >= QUEUE_DEPTH) {
+                busy = true;
+            } else {
+                queue_.push_back(Queued{it->second, args, reply});
+                notify = notify_;
+            }
+        }
+    }
+
+    if (queued) {
+        if (busy) {
+            ESP_LOGW(TAG, "Command queue full, rejecting: %s", name.c_str());
+            reply("{\"error\":\"busy\"}");
+            return false;
+        }
+        ESP_LOGD(TAG, "Queued command: %s (%zu bytes)", name.c_str(), args.size());
+        if (notify) {
+            notify();
+        }
+        return true;
+    }
+
+    if (!handler) {
+        ESP_LOGW(TAG, "Unknown command: %s", name.c_str());
+        reply("{\"error\":\"unknown command\"}");
+        return false;
+    }
+
+    ESP_LOGD(TAG, "Dispatching command: %s (%zu bytes)", name.c_str(), args.size());
+    return handler(args, reply);
+}
+
+int CommandRouter::runQueued() {
+    int ran = 0;
+    while (true) {
+        Queued cmd;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.empty()) {
+                break;
+            }
+            cmd = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        cmd.handler(cmd.args, cmd.reply);
+        ran++;
+    }
+    return ran;
+}
+
+std::vector<std::string> CommandRouter::getCommands() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> names;
+    names.reserve(handlers_.size() + queued_handlers_.size());
+    for (const auto& entry : handlers_) {
+        names.push_back(entry.first);
+    }
+    for (const auto& entry : queued_handlers_) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+} // namespace logging
@@ -0,0 +1,104 @@
+#ifndef COMMAND_ROUTER_H
+#define COMMAND_ROUTER_H
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <functional>
+#include <vector>
+#include <deque>
+
+namespace logging {
+
+/**
+ * Routes remote commands (e.g. MQTT <topic>/cmd/<name>) to registered handlers
+ *
+ * Transports own the wire format; the router only maps a command name to a
+ * handler. Handlers run on the transport's task, so they must be short and
+ * take their own locks on any state shared with the sampling loop. A handler
+ * that hands work to another task may keep a copy of the reply function and
+ * answer from there; transports make it safe to call from any task.
+ *
+ * Queued commands are for state whose lock is also held across sink I/O
+ * (LogManager): taking it on the transport's task, which holds the
+ * transport's own API lock, would deadlock against a publish. dispatch()
+ * only queues them; the owning task runs them in runQueued().
+ */
+class CommandRouter {
+public:
+    /**
+     * Send one response message; may be called several times to stream a
+     * large result in chunks
+     * @return false if the transport dropped the message
+     */
+    using ReplyFn = std::function<bool(const std::string& payload)>;
+
+    /**
+     * @param args raw command payload (may be empty)
+     * @param reply response channel bound to the requesting transport
+     * @return true if the command was handled successfully
+     */
+    using Handler = std::function<bool(const std::string& args, const ReplyFn& reply)>;
+
+    static CommandRouter& getInstance();
+
+    CommandRouter(const CommandRouter&) = delete;
+    CommandRouter& operator=(const CommandRouter&) = delete;
+
+    /**
+     * Register (or replace) a command handler
+     * @param name command name, the last topic level for MQTT
+     */
+    void registerCommand(const std::string& name, Handler handler);
+
+    /**
+     * Register (or replace) a handler that runs in runQueued() instead of on
+     * the transport's task
+     */
+    void registerQueuedCommand(const std::string& name, Handler handler);
+
+    void unregisterCommand(const std::string& name);
+
+    /**
+     * Set the callback that wakes the task calling runQueued()
+     * Called on the transport's task after a command is queued.
+     */
+    void setQueuedNotify(std::function<void()> notify);
+
+    /**
+     * Run the handler for a command
+     * Unknown commands get an {"error":"unknown command"} reply; a queued
+     * command gets {"error":"busy"} when QUEUE_DEPTH commands are waiting.
+     * @return true if a handler ran and reported success, or the command was queued
+     */
+    bool dispatch(const std::string& name, const std::string& args, const ReplyFn& reply);
+
+    /**
+     * Run the queued commands; call from the task that owns their state
+     * @return number of commands run
+     */
+    int runQueued();
+
+    std::vector<std::string> getCommands() const;
+
+    static constexpr size_t QUEUE_DEPTH = 4;
+
+private:
+    CommandRouter() = default;
+
+    struct Queued {
+        Handler handler;
+        std::string args;
+        ReplyFn reply;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Handler> handlers_;
+    std::map<std::string, Handler> queued_handlers_;
+    std::deque<Queued> queue_;
+    std::function<void()> notify_;
+};
+
+} // namespace logging
+
+#endif // COMMAND_ROUTER_H
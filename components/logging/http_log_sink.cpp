@@ -5,7 +5,6 @@
 using namespace logging;
 
 HTTPLogSink::HTTPLogSink() :
-    serializer_(nullptr),
     timeout_ms_(5000),
     initialized_(false),
     requests_sent_(0),
@@ -26,10 +25,8 @@ bool HTTPLogSink::init(const std::string& config) {
         return false;
     }
 
-    // Create serializer
-    serializer_ = logging::BMSSerializer::createSerializer(config_.format);
-    if (!serializer_) {
-        setLastError("Failed to create serializer");
+    // Default pipeline: one record per request in the configured format
+    if (!configurePipeline(PipelineConfig())) {
         return false;
     }
 
@@ -39,22 +36,29 @@ bool HTTPLogSink::init(const std::string& config) {
 
 bool HTTPLogSink::send(const output::BMSSnapshot& data) {
     if (!initialized_ || !isReady()) {
+        recordDrop(DropReason::NOT_READY);
         return false;
     }
 
-    std::string serialized;
-    if (!serializer_->serialize(data, serialized)) {
-        setLastError("Failed to serialize data");
-        errors_++;
+    return pipeline_.push(data, [this](const PipelineBuffer& payload, DropReason& reason) {
+        return sendRequest(payload, reason);
+    });
+}
+
+bool HTTPLogSink::configurePipeline(const PipelineConfig& config) {
+    std::string error;
+    if (!pipeline_.configure(this, config, config_.format, PipelineConfig::Framing::NONE, error)) {
+        setLastError(error);
         return false;
     }
-
-    std::string content_type = serializer_->getContentType();
-    return sendRequest(serialized, content_type);
+    return true;
 }
 
 void HTTPLogSink::shutdown() {
-    serializer_.reset();
+    // POST a partly filled batch
+    pipeline_.flush([this](const PipelineBuffer& payload, DropReason& reason) {
+        return sendRequest(payload, reason);
+    });
     initialized_ = false;
 }
 
@@ -66,7 +70,13 @@ bool HTTPLogSink::isReady() const {
     return initialized_ && !url_.empty();
 }
 
-bool HTTPLogSink::sendRequest(const std::string& data, const std::string& content_type) {
+bool HTTPLogSink::sendRequest(const PipelineBuffer& payload, DropReason& reason) {
+    if (!isReady()) {
+        reason = DropReason::NOT_READY;
+        return false;
+    }
+    reason = DropReason::TRANSPORT;
+
     // For ESP-IDF, we would use esp_http_client or similar
     // This is a basic implementation outline
 
@@ -90,19 +100,19 @@ bool HTTPLogSink::sendRequest(const std::string& data, const std::string& conten
             esp_http_client_set_header(client, header.first.c_str(), header.second.c_str());
         }
 
-        esp_http_client_set_header(client, "Content-Type", content_type.c_str());
+        esp_http_client_set_header(client, "Content-Type", pipeline_.getContentType().c_str());
         if (!auth_token_.empty()) {
             esp_http_client_set_header(client, "Authorization", auth_token_.c_str());
         }
 
-        esp_http_client_set_post_field(client, data.c_str(), data.length());
+        esp_http_client_set_post_field(client, payload.data(), payload.size());
 
         esp_err_t err = esp_http_client_perform(client);
         esp_http_client_cleanup(client);
 
         if (err == ESP_OK) {
             requests_sent_++;
-            bytes_sent_ += data.length();
+            bytes_sent_ += payload.size();
             last_success_ms_ = xTaskGetTickCount() * portTICK_PERIOD_MS;
             return true;
         } else {
@@ -2,7 +2,7 @@
 #define HTTP_LOG_SINK_H
 
 #include "log_sink.h"
-#include "log_serializers.h"
+#include "sink_pipeline.h"
 #include <memory>
 #include <map>
 
@@ -22,9 +22,14 @@ public:
     void shutdown() override;
     const char* getName() const override;
     bool isReady() const override;
+    bool requiresNetwork() const override { return true; }
+    SinkPriority getPriority() const override { return SinkPriority::BULK; }
+    uint32_t getBudgetUs() const override { return 100000; } // one POST on the LAN
+    bool configurePipeline(const PipelineConfig& config) override;
+    const SinkPipeline* getPipeline() const override { return &pipeline_; }
 
 private:
-    std::unique_ptr<BMSSerializer> serializer_;
+    SinkPipeline pipeline_;         // one request body per payload
     std::string url_;
     std::string method_;
     std::map<std::string, std::string> headers_;
@@ -38,7 +43,7 @@ private:
     } config_;
 
     bool parseConfig(const std::string& config_str);
-    bool sendRequest(const std::string& data, const std::string& content_type);
+    bool sendRequest(const PipelineBuffer& payload, DropReason& reason);
 
     // Stats
     size_t requests_sent_;
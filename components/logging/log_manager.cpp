@@ -1,7 +1,10 @@
 #include "log_manager.h"
 #include <time.h>
+#include <algorithm>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <cJSON.h>
+#include "connectivity.h"
 
 // Include actual sink implementations
 #ifdef INCLUDE_SERIAL_SINK
@@ -22,6 +25,8 @@
 
 namespace logging {
 
+static const char* TAG = "LogManager";
+
 // Static initialization
 LogManager& LogManager::getInstance() {
     static LogManager instance;
@@ -65,6 +70,9 @@ void LogManager::registerDefaultSinks() {
 }
 
 bool LogManager::init(const std::string& config) {
+    init_time_us_ = esp_timer_get_time();
+    seen_link_generation_ = connectivity_generation();
+
     // Parse configuration
     auto sink_configs = parseConfiguration(config);
 
@@ -73,6 +81,19 @@ bool LogManager::init(const std::string& config) {
         if (!sink_config.enabled) continue;
 
         if (addSink(sink_config.type, sink_config.config)) {
+            setBreakerConfig(sink_config.type, sink_config.breaker);
+            if (sink_config.has_priority || sink_config.budget_us > 0) {
+                SinkPriority priority = sink_config.priority;
+                if (!sink_config.has_priority) {
+                    priority = sink_dispatch_[sink_config.type].priority;
+                }
+                setSinkPriority(sink_config.type, priority, sink_config.budget_us);
+            }
+            // A rejected pipeline leaves the sink on its default one
+            if (sink_config.has_pipeline && !setSinkPipeline(sink_config.type, sink_config.pipeline)) {
+                ESP_LOGW(TAG, "Sink %s keeps its default pipeline: %s", sink_config.type.c_str(),
+                         getSinkError(sink_config.type).c_str());
+            }
             successful++;
         } else {
             ESP_LOGW("LogManager", "Failed to add sink %s: %s",
@@ -93,6 +114,15 @@ std::vector<LogManager::SinkConfig> LogManager::parseConfiguration(const std::st
         return result;
     }
 
+    // Optional fan-out budget, applied directly
+    cJSON *dispatch_item = cJSON_GetObjectItemCaseSensitive(json, "dispatch");
+    if (cJSON_IsObject(dispatch_item)) {
+        cJSON *cycle_budget = cJSON_GetObjectItemCaseSensitive(dispatch_item, "cycle_budget_us");
+        if (cJSON_IsNumber(cycle_budget) && cycle_budget->valuedouble >= 0) {
+            dispatch_config_.cycle_budget_us = static_cast<uint32_t>(cycle_budget->valuedouble);
+        }
+    }
+
     // Check if it's the new format with "sinks" array
     cJSON *sinks_array = cJSON_GetObjectItemCaseSensitive(json, "sinks");
     if (cJSON_IsArray(sinks_array)) {
@@ -114,6 +144,50 @@ std::vector<LogManager::SinkConfig> LogManager::parseConfiguration(const std::st
                 cJSON *enabled_item = cJSON_GetObjectItemCaseSensitive(sink_item, "enabled");
                 sc.enabled = cJSON_IsBool(enabled_item) ? cJSON_IsTrue(enabled_item) : true;
 
+                // Get optional breaker tuning
+                cJSON *breaker_item = cJSON_GetObjectItemCaseSensitive(sink_item, "breaker");
+                if (cJSON_IsObject(breaker_item)) {
+                    cJSON *threshold = cJSON_GetObjectItemCaseSensitive(breaker_item, "failure_threshold");
+                    if (cJSON_IsNumber(threshold) && threshold->valueint > 0) {
+                        sc.breaker.failure_threshold = static_cast<uint32_t>(threshold->valueint);
+                    }
+                    cJSON *base_backoff = cJSON_GetObjectItemCaseSensitive(breaker_item, "base_backoff_ms");
+                    if (cJSON_IsNumber(base_backoff) && base_backoff->valueint > 0) {
+                        sc.breaker.base_backoff_ms = static_cast<uint32_t>(base_backoff->valueint);
+                    }
+                    cJSON *max_backoff = cJSON_GetObjectItemCaseSensitive(breaker_item, "max_backoff_ms");
+                    if (cJSON_IsNumber(max_backoff) && max_backoff->valueint > 0) {
+                        sc.breaker.max_backoff_ms = static_cast<uint32_t>(max_backoff->valueint);
+                    }
+                    if (sc.breaker.max_backoff_ms < sc.breaker.base_backoff_ms) {
+                        sc.breaker.max_backoff_ms = sc.breaker.base_backoff_ms;
+                    }
+                }
+
+                // Get optional dispatch class and per-call budget
+                cJSON *priority_item = cJSON_GetObjectItemCaseSensitive(sink_item, "priority");
+                if (cJSON_IsString(priority_item)) {
+                    sc.has_priority = sinkPriorityFromString(priority_item->valuestring, sc.priority);
+                    if (!sc.has_priority) {
+                        ESP_LOGW(TAG, "Unknown priority '%s' for sink %s", priority_item->valuestring,
+                                 sc.type.c_str());
+                    }
+                }
+                cJSON *budget_item = cJSON_GetObjectItemCaseSensitive(sink_item, "budget_us");
+                if (cJSON_IsNumber(budget_item) && budget_item->valueint > 0) {
+                    sc.budget_us = static_cast<uint32_t>(budget_item->valueint);
+                }
+
+                // Get optional pipeline stages
+                cJSON *pipeline_item = cJSON_GetObjectItemCaseSensitive(sink_item, "pipeline");
+                if (pipeline_item) {
+                    std::string error;
+                    sc.has_pipeline = PipelineConfig::fromJson(pipeline_item, sc.pipeline, error);
+                    if (!sc.has_pipeline) {
+                        ESP_LOGW(TAG, "Ignoring pipeline for sink %s: %s", sc.type.c_str(), error.c_str());
+                    }
+                }
+
                 // Get config
                 cJSON *config_item = cJSON_GetObjectItemCaseSensitive(sink_item, "config");
                 if (cJSON_IsObject(config_item)) {
@@ -179,16 +253,559 @@ std::vector<LogManager::SinkConfig> LogManager::parseConfiguration(const std::st
 }
 
 size_t LogManager::send(const output::BMSSnapshot& data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t now_us = esp_timer_get_time();
     size_t successful = 0;
-    for (const auto& sink_pair : active_sinks_) {
-        if (sink_pair.second->send(data)) {
+    last_boot_id_.store(data.boot_id, std::memory_order_relaxed);
+    last_seq_.store(data.seq, std::memory_order_relaxed);
+
+    // Link state is a lock-free read; gate only when the bus is running
+    link_up_ = !connectivity_is_active() || connectivity_is_online();
+    const uint32_t link_generation = connectivity_generation();
+    if (link_generation != seen_link_generation_) {
+        seen_link_generation_ = link_generation;
+        if (link_up_) {
+            // Reconnected: release network sinks together once DHCP/ARP have
+            // settled; the fan-out budget defers any that no longer fit a cycle
+            resume_at_us_ = now_us + (uint64_t)RESUME_SETTLE_MS * 1000ULL;
+            for (auto& sink_pair : active_sinks_) {
+                if (sink_pair.second->requiresNetwork()) {
+                    sink_health_[sink_pair.first].resume_pending = true;
+                }
+            }
+        }
+    }
+
+    // A sink with samples still deferred queues behind them to keep its order
+    uint32_t waiting = 0;
+    for (size_t n = 0; n < deferred_count_; n++) {
+        waiting |= deferred_[(deferred_head_ + n) % DEFERRED_SLOTS].pending;
+    }
+
+    const uint32_t cycle_budget_us = dispatch_config_.cycle_budget_us;
+    DeferredSample* deferred = nullptr;
+    for (size_t i = 0; i < dispatch_order_.size(); i++) {
+        const DispatchEntry& entry = dispatch_order_[i];
+        if (!admit(entry, now_us)) {
+            continue;
+        }
+
+        // Past the budget, everything below CRITICAL waits for an idle slot
+        if (entry.dispatch->priority != SinkPriority::CRITICAL && i < MAX_DISPATCH_SINKS) {
+            const uint32_t bit = 1u << i;
+            const uint64_t spent_us = esp_timer_get_time() - now_us;
+            if ((waiting & bit) ||
+                (cycle_budget_us > 0 && spent_us + entry.dispatch->budget_us > cycle_budget_us)) {
+                if (!deferred) {
+                    deferred = &deferSample(data, now_us);
+                }
+                deferred->pending |= bit;
+                if (entry.health->state == BreakerState::HALF_OPEN) {
+                    // admit() just let this sample through as the probe
+                    deferred->probe |= bit;
+                }
+                entry.dispatch->deferred++;
+                continue;
+            }
+        }
+
+        if (deliver(entry, data, now_us)) {
             successful++;
         }
     }
 
+    const uint32_t cycle_us = (uint32_t)(esp_timer_get_time() - now_us);
+    dispatch_stats_.cycles++;
+    if (cycle_us > dispatch_stats_.max_cycle_us) {
+        dispatch_stats_.max_cycle_us = cycle_us;
+    }
+    if (cycle_budget_us > 0 && cycle_us > cycle_budget_us) {
+        dispatch_stats_.cycle_overruns++;
+    }
+
+    total_messages_sent_ += successful;
     return successful;
 }
 
+size_t LogManager::runDeferred(uint32_t budget_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return deliverDeferred(budget_us);
+}
+
+bool LogManager::hasDeferred() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return deferred_count_ > 0;
+}
+
+size_t LogManager::deliverDeferred(uint32_t budget_us) {
+    if (deferred_count_ == 0) {
+        return 0;
+    }
+
+    const uint64_t start_us = esp_timer_get_time();
+    size_t attempted = 0;
+    uint32_t blocked = 0;   // out of budget this slot; their later samples wait too
+
+    for (size_t n = 0; n < deferred_count_; n++) {
+        DeferredSample& sample = deferred_[(deferred_head_ + n) % DEFERRED_SLOTS];
+        for (size_t i = 0; i < dispatch_order_.size() && i < MAX_DISPATCH_SINKS; i++) {
+            const uint32_t bit = 1u << i;
+            if (!(sample.pending & bit) || (blocked & bit)) {
+                continue;
+            }
+            const DispatchEntry& entry = dispatch_order_[i];
+            const uint64_t call_us = esp_timer_get_time();
+            if (call_us - start_us + entry.dispatch->budget_us > budget_us) {
+                blocked |= bit;
+                continue;
+            }
+
+            // Same gates as the fan-out: the link or the breaker may have
+            // changed since the sample was queued
+            const bool probe = (sample.probe & bit) != 0;
+            sample.pending &= ~bit;
+            sample.probe &= ~bit;
+            if (!admit(entry, call_us, probe)) {
+                if (probe) {
+                    abandonProbe(entry);
+                }
+                continue;
+            }
+            const uint32_t wait_us = (uint32_t)(call_us - sample.queued_us);
+            if (wait_us > entry.dispatch->max_wait_us) {
+                entry.dispatch->max_wait_us = wait_us;
+            }
+            attempted++;
+            if (deliver(entry, sample.data, sample.queued_us)) {
+                total_messages_sent_++;
+            }
+        }
+    }
+    while (deferred_count_ > 0 && deferred_[deferred_head_].pending == 0) {
+        deferred_head_ = (deferred_head_ + 1) % DEFERRED_SLOTS;
+        deferred_count_--;
+    }
+
+    const uint32_t idle_us = (uint32_t)(esp_timer_get_time() - start_us);
+    dispatch_stats_.idle_slots++;
+    if (idle_us > dispatch_stats_.max_idle_us) {
+        dispatch_stats_.max_idle_us = idle_us;
+    }
+    if (idle_us > budget_us) {
+        dispatch_stats_.idle_overruns++;
+    }
+    return attempted;
+}
+
+bool LogManager::admit(const DispatchEntry& entry, uint64_t now_us, bool probe) {
+    SinkHealth& health = *entry.health;
+    LogSink& sink = *entry.sink;
+
+    if (sink.requiresNetwork()) {
+        // Link down: doomed sends cost nothing, and do not count against the breaker
+        if (!link_up_) {
+            health.paused++;
+            sink.recordDrop(DropReason::LINK_DOWN);
+            return false;
+        }
+        if (health.resume_pending) {
+            if (now_us < resume_at_us_) {
+                health.paused++;
+                sink.recordDrop(DropReason::LINK_DOWN);
+                return false;
+            }
+            health.resume_pending = false;
+            if (health.state == BreakerState::OPEN) {
+                // Probe right away instead of waiting out a backoff earned offline
+                health.next_probe_us = now_us;
+            }
+            sink.onNetworkResume();
+            ESP_LOGI(TAG, "Sink %s resumed after reconnect", entry.type->c_str());
+        }
+    }
+
+    // Open breaker: skip the sink entirely (no serialization, no transport)
+    // until its backoff expires, then let a single probe through. Until that
+    // probe resolves, possibly in a later idle slot, nothing else goes.
+    if (health.state == BreakerState::HALF_OPEN && !probe) {
+        health.skipped++;
+        sink.recordDrop(DropReason::BREAKER_OPEN);
+        return false;
+    }
+    if (health.state == BreakerState::OPEN) {
+        if (now_us < health.next_probe_us) {
+            health.skipped++;
+            sink.recordDrop(DropReason::BREAKER_OPEN);
+            return false;
+        }
+        health.state = BreakerState::HALF_OPEN;
+        ESP_LOGD(TAG, "Sink %s half-open, probing", entry.type->c_str());
+    }
+    return true;
+}
+
+bool LogManager::deliver(const DispatchEntry& entry, const output::BMSSnapshot& data, uint64_t cycle_us) {
+    const uint64_t start_us = esp_timer_get_time();
+    const bool ok = entry.sink->send(data);
+    const uint64_t end_us = esp_timer_get_time();
+
+    SinkDispatch& dispatch = *entry.dispatch;
+    const uint32_t call_us = (uint32_t)(end_us - start_us);
+    dispatch.calls++;
+    dispatch.total_us += call_us;
+    if (call_us > dispatch.max_us) {
+        dispatch.max_us = call_us;
+    }
+    if (call_us > dispatch.budget_us) {
+        dispatch.overruns++;
+    }
+
+    if (ok) {
+        recordSuccess(*entry.type, *entry.health);
+    } else {
+        // Backoff counts from the sample's cycle so probes stay aligned with poll ticks
+        recordFailure(*entry.type, *entry.health, cycle_us);
+    }
+    return ok;
+}
+
+LogManager::DeferredSample& LogManager::deferSample(const output::BMSSnapshot& data, uint64_t now_us) {
+    if (deferred_count_ == DEFERRED_SLOTS) {
+        // No idle slot for a while: the oldest sample goes
+        dropDeferred(deferred_[deferred_head_]);
+        deferred_head_ = (deferred_head_ + 1) % DEFERRED_SLOTS;
+        deferred_count_--;
+    }
+    DeferredSample& sample = deferred_[(deferred_head_ + deferred_count_) % DEFERRED_SLOTS];
+    sample.data = data;
+    sample.queued_us = now_us;
+    sample.pending = 0;
+    sample.probe = 0;
+    deferred_count_++;
+    return sample;
+}
+
+void LogManager::dropDeferred(DeferredSample& sample) {
+    for (size_t i = 0; i < dispatch_order_.size() && i < MAX_DISPATCH_SINKS; i++) {
+        if (sample.pending & (1u << i)) {
+            dispatch_order_[i].dispatch->deferred_dropped++;
+            dispatch_order_[i].sink->recordDrop(DropReason::DEFERRED);
+            if (sample.probe & (1u << i)) {
+                abandonProbe(dispatch_order_[i]);
+            }
+        }
+    }
+    sample.pending = 0;
+    sample.probe = 0;
+}
+
+void LogManager::abandonProbe(const DispatchEntry& entry) {
+    // The probe never reached the sink: reopen with the probe still due, so
+    // the next fan-out sends another one
+    if (entry.health->state == BreakerState::HALF_OPEN) {
+        entry.health->state = BreakerState::OPEN;
+        ESP_LOGD(TAG, "Sink %s probe dropped before delivery", entry.type->c_str());
+    }
+}
+
+void LogManager::discardDeferred() {
+    for (size_t n = 0; n < deferred_count_; n++) {
+        dropDeferred(deferred_[(deferred_head_ + n) % DEFERRED_SLOTS]);
+    }
+    deferred_head_ = 0;
+    deferred_count_ = 0;
+}
+
+void LogManager::rebuildDispatchOrder() {
+    dispatch_order_.clear();
+    for (auto& sink_pair : active_sinks_) {
+        dispatch_order_.push_back({ &sink_pair.first, sink_pair.second.get(),
+                                    &sink_health_[sink_pair.first], &sink_dispatch_[sink_pair.first] });
+    }
+    // Stable: sinks of one class keep the map's name order
+    std::stable_sort(dispatch_order_.begin(), dispatch_order_.end(),
+                     [](const DispatchEntry& a, const DispatchEntry& b) {
+                         return a.dispatch->priority < b.dispatch->priority;
+                     });
+    if (dispatch_order_.size() > MAX_DISPATCH_SINKS) {
+        ESP_LOGW(TAG, "%u sinks active, only the first %u can be deferred",
+                 (unsigned)dispatch_order_.size(), (unsigned)MAX_DISPATCH_SINKS);
+    }
+}
+
+void LogManager::recordSuccess(const std::string& sink_type, SinkHealth& health) {
+    health.total_successes++;
+    health.consecutive_failures = 0;
+
+    if (health.state != BreakerState::CLOSED) {
+        ESP_LOGI(TAG, "Sink %s recovered, breaker closed (skipped %lu samples)",
+                 sink_type.c_str(), (unsigned long)health.skipped);
+        health.state = BreakerState::CLOSED;
+        health.backoff_ms = 0;
+        health.next_probe_us = 0;
+        publishBreakerStates();
+    }
+}
+
+void LogManager::recordFailure(const std::string& sink_type, SinkHealth& health, uint64_t now_us) {
+    health.total_failures++;
+    health.consecutive_failures++;
+
+    if (health.state == BreakerState::HALF_OPEN) {
+        // Failed probe: back off exponentially up to the cap
+        uint32_t next = health.backoff_ms * 2;
+        if (next < health.config.base_backoff_ms) next = health.config.base_backoff_ms;
+        if (next > health.config.max_backoff_ms) next = health.config.max_backoff_ms;
+        health.backoff_ms = next;
+        health.state = BreakerState::OPEN;
+        health.next_probe_us = now_us + (uint64_t)health.backoff_ms * 1000ULL;
+        ESP_LOGD(TAG, "Sink %s probe failed, next probe in %lu ms",
+                 sink_type.c_str(), (unsigned long)health.backoff_ms);
+        return;
+    }
+
+    if (health.state == BreakerState::CLOSED &&
+        health.consecutive_failures >= health.config.failure_threshold) {
+        health.state = BreakerState::OPEN;
+        health.trips++;
+        health.backoff_ms = health.config.base_backoff_ms;
+        health.next_probe_us = now_us + (uint64_t)health.backoff_ms * 1000ULL;
+        ESP_LOGW(TAG, "Sink %s breaker opened after %lu failures: %s",
+                 sink_type.c_str(), (unsigned long)health.consecutive_failures,
+                 getSinkError(sink_type).c_str());
+        publishBreakerStates();
+    }
+}
+
+const char* LogManager::breakerStateToString(BreakerState state) {
+    switch (state) {
+        case BreakerState::CLOSED: return "closed";
+        case BreakerState::OPEN: return "open";
+        case BreakerState::HALF_OPEN: return "half_open";
+        default: return "unknown";
+    }
+}
+
+bool LogManager::getSinkHealth(const std::string& sink_type, SinkHealth& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sink_health_.find(sink_type);
+    if (it == sink_health_.end()) {
+        return false;
+    }
+    out = it->second;
+    return true;
+}
+
+bool LogManager::setBreakerConfig(const std::string& sink_type, const BreakerConfig& config) {
+    auto it = sink_health_.find(sink_type);
+    if (it == sink_health_.end()) {
+        return false;
+    }
+    it->second.config = config;
+    return true;
+}
+
+bool LogManager::setSinkPriority(const std::string& sink_type, SinkPriority priority, uint32_t budget_us) {
+    auto it = sink_dispatch_.find(sink_type);
+    if (it == sink_dispatch_.end()) {
+        return false;
+    }
+    // Pending bits index the current order
+    discardDeferred();
+    it->second.priority = priority;
+    if (budget_us > 0) {
+        it->second.budget_us = budget_us;
+    }
+    rebuildDispatchOrder();
+    return true;
+}
+
+std::string LogManager::getDispatchStatsJson() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cJSON *json = cJSON_CreateObject();
+    if (!json) {
+        return std::string();
+    }
+
+    const DispatchStats& stats = dispatch_stats_;
+    cJSON_AddNumberToObject(json, "cycle_budget_us", dispatch_config_.cycle_budget_us);
+    cJSON_AddNumberToObject(json, "cycles", stats.cycles);
+    cJSON_AddNumberToObject(json, "cycle_overruns", stats.cycle_overruns);
+    cJSON_AddNumberToObject(json, "max_cycle_us", stats.max_cycle_us);
+    cJSON_AddNumberToObject(json, "idle_slots", stats.idle_slots);
+    cJSON_AddNumberToObject(json, "idle_overruns", stats.idle_overruns);
+    cJSON_AddNumberToObject(json, "max_idle_us", stats.max_idle_us);
+    cJSON_AddNumberToObject(json, "deferred_pending", (double)deferred_count_);
+    cJSON *sinks = cJSON_AddObjectToObject(json, "sinks");
+    for (const DispatchEntry& entry : dispatch_order_) {
+        const SinkDispatch& dispatch = *entry.dispatch;
+        cJSON *item = cJSON_AddObjectToObject(sinks, entry.type->c_str());
+        cJSON_AddStringToObject(item, "priority", sinkPriorityToString(dispatch.priority));
+        cJSON_AddNumberToObject(item, "budget_us", dispatch.budget_us);
+        cJSON_AddNumberToObject(item, "calls", dispatch.calls);
+        cJSON_AddNumberToObject(item, "avg_us", (double)(dispatch.calls ? dispatch.total_us / dispatch.calls : 0));
+        cJSON_AddNumberToObject(item, "max_us", dispatch.max_us);
+        cJSON_AddNumberToObject(item, "overruns", dispatch.overruns);
+        cJSON_AddNumberToObject(item, "deferred", dispatch.deferred);
+        cJSON_AddNumberToObject(item, "deferred_dropped", dispatch.deferred_dropped);
+        cJSON_AddNumberToObject(item, "max_wait_us", dispatch.max_wait_us);
+    }
+
+    std::string result;
+    char *json_str = cJSON_PrintUnformatted(json);
+    if (json_str) {
+        result = json_str;
+        cJSON_free(json_str);
+    }
+    cJSON_Delete(json);
+    return result;
+}
+
+bool LogManager::setSinkPipeline(const std::string& sink_type, const PipelineConfig& config) {
+    auto it = active_sinks_.find(sink_type);
+    if (it == active_sinks_.end()) {
+        setLastError("Sink not active: " + sink_type);
+        return false;
+    }
+    return it->second->configurePipeline(config);
+}
+
+std::string LogManager::getPipelineStatsJson() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cJSON *json = cJSON_CreateObject();
+    if (!json) {
+        return std::string();
+    }
+
+    cJSON *sinks = cJSON_AddObjectToObject(json, "sinks");
+    for (const auto& sink_pair : active_sinks_) {
+        const SinkPipeline* pipeline = sink_pair.second->getPipeline();
+        if (!pipeline) {
+            continue;
+        }
+        const SinkPipeline::Stats& stats = pipeline->getStats();
+        cJSON *item = cJSON_AddObjectToObject(sinks, sink_pair.first.c_str());
+        cJSON_AddStringToObject(item, "stages", pipeline->describe().c_str());
+        cJSON_AddNumberToObject(item, "offered", stats.offered);
+        cJSON_AddNumberToObject(item, "filtered", stats.filtered);
+        cJSON_AddNumberToObject(item, "held", pipeline->heldRecords());
+        cJSON_AddNumberToObject(item, "payloads", stats.payloads);
+        cJSON_AddNumberToObject(item, "records", stats.records);
+        cJSON_AddNumberToObject(item, "failed_payloads", stats.failed_payloads);
+        cJSON_AddNumberToObject(item, "encoded_bytes", (double)stats.encoded_bytes);
+        cJSON_AddNumberToObject(item, "wire_bytes", (double)stats.wire_bytes);
+        cJSON_AddNumberToObject(item, "max_payload_bytes", stats.max_payload_bytes);
+    }
+
+    std::string result;
+    char *json_str = cJSON_PrintUnformatted(json);
+    if (json_str) {
+        result = json_str;
+        cJSON_free(json_str);
+    }
+    cJSON_Delete(json);
+    return result;
+}
+
+std::string LogManager::getBreakerStatesJson() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return breakerStatesJson();
+}
+
+std::string LogManager::breakerStatesJson() const {
+    cJSON *json = cJSON_CreateObject();
+    if (!json) {
+        return std::string();
+    }
+
+    cJSON_AddNumberToObject(json, "uptime_ms", (double)((esp_timer_get_time() - init_time_us_) / 1000));
+    cJSON *sinks = cJSON_AddObjectToObject(json, "sinks");
+    for (const auto& health_pair : sink_health_) {
+        const SinkHealth& health = health_pair.second;
+        cJSON *item = cJSON_AddObjectToObject(sinks, health_pair.first.c_str());
+        cJSON_AddStringToObject(item, "state", breakerStateToString(health.state));
+        cJSON_AddNumberToObject(item, "consecutive_failures", health.consecutive_failures);
+        cJSON_AddNumberToObject(item, "failures", health.total_failures);
+        cJSON_AddNumberToObject(item, "successes", health.total_successes);
+        cJSON_AddNumberToObject(item, "skipped", health.skipped);
+        cJSON_AddNumberToObject(item, "paused", health.paused);
+        cJSON_AddNumberToObject(item, "trips", health.trips);
+        cJSON_AddNumberToObject(item, "backoff_ms", health.backoff_ms);
+    }
+
+    std::string result;
+    char *json_str = cJSON_PrintUnformatted(json);
+    if (json_str) {
+        result = json_str;
+        cJSON_free(json_str);
+    }
+    cJSON_Delete(json);
+    return result;
+}
+
+std::string LogManager::getDropStatsJson() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cJSON *json = cJSON_CreateObject();
+    if (!json) {
+        return std::string();
+    }
+
+    // Per sink, sent + dropped accounts for every sample offered since it was
+    // added, except SD lines held in its buffer for a retried flush. Samples
+    // the pipeline filters out or holds in an open batch count as sent; see
+    // getPipelineStatsJson() for those.
+    cJSON_AddNumberToObject(json, "boot_id", last_boot_id_.load(std::memory_order_relaxed));
+    cJSON_AddNumberToObject(json, "seq", last_seq_.load(std::memory_order_relaxed));
+    cJSON *sinks = cJSON_AddObjectToObject(json, "sinks");
+    for (const auto& sink_pair : active_sinks_) {
+        const LogSink& sink = *sink_pair.second;
+        cJSON *item = cJSON_AddObjectToObject(sinks, sink_pair.first.c_str());
+        auto it = sink_health_.find(sink_pair.first);
+        cJSON_AddNumberToObject(item, "sent", it != sink_health_.end() ? it->second.total_successes : 0);
+        cJSON_AddNumberToObject(item, "dropped", sink.getTotalDrops());
+        cJSON *reasons = cJSON_AddObjectToObject(item, "reasons");
+        for (size_t i = 0; i < (size_t)DropReason::COUNT; i++) {
+            const DropReason reason = (DropReason)i;
+            cJSON_AddNumberToObject(reasons, dropReasonToString(reason), sink.getDropCount(reason));
+        }
+    }
+
+    std::string result;
+    char *json_str = cJSON_PrintUnformatted(json);
+    if (json_str) {
+        result = json_str;
+        cJSON_free(json_str);
+    }
+    cJSON_Delete(json);
+    return result;
+}
+
+size_t LogManager::publishDiagnostic(const char* channel, const std::string& payload) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return broadcastDiagnostic(channel, payload);
+}
+
+size_t LogManager::broadcastDiagnostic(const char* channel, const std::string& payload) {
+    size_t delivered = 0;
+    for (const auto& sink_pair : active_sinks_) {
+        auto it = sink_health_.find(sink_pair.first);
+        if (it != sink_health_.end() && it->second.state != BreakerState::CLOSED) {
+            continue;
+        }
+        if (sink_pair.second->sendDiagnostic(channel, payload)) {
+            delivered++;
+        }
+    }
+    return delivered;
+}
+
+void LogManager::publishBreakerStates() {
+    std::string payload = breakerStatesJson();
+    if (!payload.empty()) {
+        broadcastDiagnostic("breakers", payload);
+    }
+}
+
 bool LogManager::addSink(const std::string& sink_type, const std::string& config) {
     auto it = sink_factories_.find(sink_type);
     if (it == sink_factories_.end()) {
@@ -209,8 +826,15 @@ bool LogManager::addSink(const std::string& sink_type, const std::string& config
 
     // Remove any existing sink of this type
     removeSink(sink_type);
+    discardDeferred();
 
+    SinkDispatch dispatch;
+    dispatch.priority = new_sink->getPriority();
+    dispatch.budget_us = new_sink->getBudgetUs();
     active_sinks_.emplace(sink_type, std::move(new_sink));
+    sink_health_[sink_type] = SinkHealth{};
+    sink_dispatch_[sink_type] = dispatch;
+    rebuildDispatchOrder();
     return true;
 }
 
@@ -220,8 +844,12 @@ bool LogManager::removeSink(const std::string& sink_type) {
         return false;
     }
 
+    discardDeferred();
     it->second->shutdown();
     active_sinks_.erase(it);
+    sink_health_.erase(sink_type);
+    sink_dispatch_.erase(sink_type);
+    rebuildDispatchOrder();
     return true;
 }
 
@@ -246,12 +874,17 @@ std::string LogManager::getSinkError(const std::string& sink_type) const {
 }
 
 LogManager::Stats LogManager::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
     Stats stats;
+    stats.total_messages_sent = total_messages_sent_;
     stats.sinks_active = active_sinks_.size();
     stats.sinks_failed = 0;
-
-    // TODO: Implement proper stats collection
-    // For now, just return basic counts
+    for (const auto& health_pair : sink_health_) {
+        if (health_pair.second.state != BreakerState::CLOSED) {
+            stats.sinks_failed++;
+        }
+    }
+    stats.uptime_ms = static_cast<uint32_t>((esp_timer_get_time() - init_time_us_) / 1000);
 
     return stats;
 }
@@ -261,10 +894,17 @@ void LogManager::registerSink(const std::string& sink_type, SinkCreator creator)
 }
 
 void LogManager::shutdown() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Deliver what is still deferred before the sinks flush and close
+    deliverDeferred(UINT32_MAX);
+    discardDeferred();
     for (auto& sink_pair : active_sinks_) {
         sink_pair.second->shutdown();
     }
+    dispatch_order_.clear();
     active_sinks_.clear();
+    sink_health_.clear();
+    sink_dispatch_.clear();
 }
 
 // Set last error helper
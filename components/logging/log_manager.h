@@ -2,18 +2,30 @@
 #define LOG_MANAGER_H
 
 #include "log_sink.h"
+#include "sink_pipeline.h"
 #include "bms_snapshot.h"
+#include <array>
 #include <memory>
 #include <vector>
 #include <map>
 #include <string>
 #include <functional>
+#include <atomic>
+#include <mutex>
 
 namespace logging {
 
 /**
  * Central logging manager that coordinates multiple sinks
  * Singleton pattern ensures single point of control
+ *
+ * Sinks are configured (init, addSink, set*) before other tasks start.
+ * After that send(), runDeferred(), publishDiagnostic() and the health and
+ * stats queries may be called from any task; they take turns on one lock, so
+ * a sample is fanned out whole and a query never sees half of a fan-out.
+ * The lock is held across sink I/O, so none of these may be called from a
+ * task holding a lock a sink needs: not from a transport's callback (the
+ * MQTT command handlers hold the client lock) - queue the command instead.
  */
 class LogManager {
 public:
@@ -35,12 +47,30 @@ public:
     bool init(const std::string& config);
 
     /**
-     * Send BMS data to all active sinks
+     * Send BMS data to all active sinks, highest priority first
+     * CRITICAL sinks always get the sample. Any other sink whose budget no
+     * longer fits the cycle budget, or that still has deferred samples, gets
+     * a copy queued for runDeferred() instead.
      * @param data BMS snapshot to distribute
      * @return number of successful deliveries
      */
     size_t send(const output::BMSSnapshot& data);
 
+    /**
+     * Deliver deferred samples, oldest first, from the poll task's idle slot
+     * Each delivery passes the same link and breaker checks as in send(). A
+     * sink whose budget no longer fits the rest of the slot keeps its samples
+     * queued for a later slot.
+     * @param budget_us time available before the next poll tick
+     * @return number of deliveries attempted (0 if none fitted)
+     */
+    size_t runDeferred(uint32_t budget_us);
+
+    /**
+     * Check for deferred samples waiting for an idle slot
+     */
+    bool hasDeferred() const;
+
     /**
      * Add a new log sink
      * @param sink_type Type of sink (serial, udp, tcp, mqtt, http, etc.)
@@ -81,6 +111,144 @@ public:
      */
     void shutdown();
 
+    /**
+     * Circuit breaker state of a sink
+     * CLOSED: healthy, receives every sample
+     * OPEN: failing, skipped (no serialization) until the next probe is due
+     * HALF_OPEN: one probe sample is in flight, sent or deferred to an idle
+     *            slot; other samples are skipped until it resolves, and
+     *            success closes the breaker
+     */
+    enum class BreakerState {
+        CLOSED,
+        OPEN,
+        HALF_OPEN
+    };
+
+    /**
+     * Breaker tuning, configurable per sink via the "breaker" object
+     * Example: {"type":"http","breaker":{"failure_threshold":3,"base_backoff_ms":1000},"config":{...}}
+     */
+    struct BreakerConfig {
+        uint32_t failure_threshold = 3;      // consecutive failures before opening
+        uint32_t base_backoff_ms = 1000;     // first probe delay after opening
+        uint32_t max_backoff_ms = 300000;    // probe delay cap (doubles per failed probe)
+    };
+
+    /**
+     * Health tracking for a single sink
+     */
+    struct SinkHealth {
+        BreakerState state = BreakerState::CLOSED;
+        BreakerConfig config;
+        uint32_t consecutive_failures = 0;
+        uint32_t total_failures = 0;
+        uint32_t total_successes = 0;
+        uint32_t skipped = 0;              // samples not offered while open
+        uint32_t paused = 0;               // samples not offered while the link was down
+        bool resume_pending = false;       // waiting out the settle delay after a reconnect
+        uint32_t trips = 0;                // CLOSED -> OPEN transitions
+        uint32_t backoff_ms = 0;           // current probe delay
+        uint64_t next_probe_us = 0;        // esp_timer time of next half-open probe
+    };
+
+    /**
+     * Get health of a specific sink
+     * @param sink_type Sink type to check
+     * @param out health snapshot
+     * @return true if the sink is active
+     */
+    bool getSinkHealth(const std::string& sink_type, SinkHealth& out) const;
+
+    /**
+     * Override breaker tuning for an active sink
+     */
+    bool setBreakerConfig(const std::string& sink_type, const BreakerConfig& config);
+
+    /**
+     * Fan-out time budget, configurable via the top-level "dispatch" object;
+     * per sink, "priority" and "budget_us" override the sink's defaults
+     * Example: {"dispatch":{"cycle_budget_us":30000},"sinks":[{"type":"sdcard","priority":"bulk",...}]}
+     */
+    struct DispatchConfig {
+        uint32_t cycle_budget_us = 30000;    // 0 = never defer
+    };
+
+    /**
+     * Dispatch class, budget and timing of a single sink
+     */
+    struct SinkDispatch {
+        SinkPriority priority = SinkPriority::NORMAL;
+        uint32_t budget_us = 0;
+        uint32_t calls = 0;
+        uint32_t overruns = 0;             // calls that took longer than budget_us
+        uint32_t max_us = 0;
+        uint64_t total_us = 0;
+        uint32_t deferred = 0;             // samples moved to an idle slot
+        uint32_t deferred_dropped = 0;     // of those, overwritten before delivery
+        uint32_t max_wait_us = 0;          // longest fan-out -> deferred delivery
+    };
+
+    /**
+     * Fan-out and idle slot accounting
+     */
+    struct DispatchStats {
+        uint32_t cycles = 0;
+        uint32_t cycle_overruns = 0;       // fan-outs longer than cycle_budget_us
+        uint32_t max_cycle_us = 0;
+        uint32_t idle_slots = 0;
+        uint32_t idle_overruns = 0;        // idle slots longer than their budget
+        uint32_t max_idle_us = 0;
+    };
+
+    void setDispatchConfig(const DispatchConfig& config) { dispatch_config_ = config; }
+
+    /**
+     * Override dispatch class and per-call budget for an active sink
+     * @param budget_us 0 keeps the sink's default
+     */
+    bool setSinkPriority(const std::string& sink_type, SinkPriority priority, uint32_t budget_us);
+
+    /**
+     * Build a JSON document with fan-out budget use and every sink's dispatch
+     * class, call timing, overruns and deferrals
+     */
+    std::string getDispatchStatsJson() const;
+
+    /**
+     * Rebuild an active sink's stage pipeline
+     * A batch held by the old pipeline is discarded.
+     * @return false if the sink is not active, has no pipeline or rejects the settings
+     */
+    bool setSinkPipeline(const std::string& sink_type, const PipelineConfig& config);
+
+    /**
+     * Build a JSON document with every sink pipeline's stages, sample and
+     * payload counts and bytes before and after compression and framing
+     */
+    std::string getPipelineStatsJson() const;
+
+    /**
+     * Build a JSON document describing every sink's breaker state
+     */
+    std::string getBreakerStatesJson() const;
+
+    /**
+     * Build a JSON document with every sink's delivered and dropped sample
+     * counts by DropReason, plus the boot ID and sequence of the last sample
+     */
+    std::string getDropStatsJson() const;
+
+    /**
+     * Publish a diagnostic record on every healthy sink with a side channel
+     * @param channel channel name (e.g. "breakers")
+     * @param payload JSON payload
+     * @return number of sinks that accepted the record
+     */
+    size_t publishDiagnostic(const char* channel, const std::string& payload);
+
+    static const char* breakerStateToString(BreakerState state);
+
     /**
      * Global stats
      */
@@ -118,11 +286,50 @@ private:
     // Active sinks
     std::map<std::string, std::unique_ptr<LogSink>> active_sinks_;
 
+    // Per-sink circuit breakers, keyed like active_sinks_
+    std::map<std::string, SinkHealth> sink_health_;
+
+    // Per-sink dispatch class and timing, keyed like active_sinks_
+    std::map<std::string, SinkDispatch> sink_dispatch_;
+
+    // Active sinks in dispatch order: priority, then name. Map nodes do not
+    // move, so the pointers stay valid until the next add or remove.
+    struct DispatchEntry {
+        const std::string* type;
+        LogSink* sink;
+        SinkHealth* health;
+        SinkDispatch* dispatch;
+    };
+    std::vector<DispatchEntry> dispatch_order_;
+
+    // Samples waiting for an idle slot, shared by the sinks deferred in the
+    // same cycle; bit i of pending is dispatch_order_[i]
+    struct DeferredSample {
+        output::BMSSnapshot data;
+        uint64_t queued_us = 0;
+        uint32_t pending = 0;
+        uint32_t probe = 0;             // pending bits that carry a half-open probe
+    };
+    static constexpr size_t DEFERRED_SLOTS = 3;
+    static constexpr size_t MAX_DISPATCH_SINKS = 32;
+    std::array<DeferredSample, DEFERRED_SLOTS> deferred_;
+    size_t deferred_head_ = 0;          // oldest
+    size_t deferred_count_ = 0;
+
+    DispatchConfig dispatch_config_;
+    DispatchStats dispatch_stats_;
+
     // Configuration parser
     struct SinkConfig {
         std::string type;
         std::string config;
         bool enabled = true;
+        BreakerConfig breaker;
+        bool has_priority = false;
+        SinkPriority priority = SinkPriority::NORMAL;
+        uint32_t budget_us = 0;            // 0 = sink default
+        bool has_pipeline = false;
+        PipelineConfig pipeline;
     };
 
     std::vector<SinkConfig> parseConfiguration(const std::string& config);
@@ -133,6 +340,23 @@ private:
     // Default factory registrations
     void registerDefaultSinks();
 
+    // Breaker bookkeeping
+    void recordSuccess(const std::string& sink_type, SinkHealth& health);
+    void recordFailure(const std::string& sink_type, SinkHealth& health, uint64_t now_us);
+    void publishBreakerStates();
+    std::string breakerStatesJson() const;
+    size_t broadcastDiagnostic(const char* channel, const std::string& payload);
+
+    // Dispatch helpers
+    bool admit(const DispatchEntry& entry, uint64_t now_us, bool probe = false);
+    void abandonProbe(const DispatchEntry& entry);
+    bool deliver(const DispatchEntry& entry, const output::BMSSnapshot& data, uint64_t cycle_us);
+    size_t deliverDeferred(uint32_t budget_us);
+    DeferredSample& deferSample(const output::BMSSnapshot& data, uint64_t now_us);
+    void dropDeferred(DeferredSample& sample);
+    void discardDeferred();
+    void rebuildDispatchOrder();
+
     // Set last error helper
     void setLastError(const std::string& err);
 
@@ -141,6 +365,21 @@ private:
 
 private:
     std::string last_error_;
+
+    // Held for a whole fan-out, idle slot or diagnostic broadcast
+    mutable std::mutex mutex_;
+
+    // Global counters
+    size_t total_messages_sent_ = 0;
+    uint64_t init_time_us_ = 0;
+    std::atomic<uint32_t> last_boot_id_{0};   // read by the drops command
+    std::atomic<uint32_t> last_seq_{0};
+
+    // Connectivity gating for network sinks
+    static constexpr uint32_t RESUME_SETTLE_MS = 1000;  // let DHCP/ARP settle after GOT_IP
+    uint32_t seen_link_generation_ = 0;
+    uint64_t resume_at_us_ = 0;
+    bool link_up_ = true;
 };
 
 /**
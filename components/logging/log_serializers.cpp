@@ -43,11 +43,19 @@ public:
     ~JSONSerializer() override = default;
 
     bool serialize(const output::BMSSnapshot& data, std::string& result) override {
+        result.clear();
+        return serializeAppend(data, result);
+    }
+
+    bool serializeAppend(const output::BMSSnapshot& data, std::string& out) override {
         std::ostringstream json;
         json << std::fixed << std::setprecision(3);
 
         json << "{\n";
         json << "  \"device_id\": \"" << data.device_id << "\",\n";
+        json << "  \"boot_id\": " << data.boot_id << ",\n";
+        json << "  \"seq\": " << data.seq << ",\n";
+        json << "  \"stale\": " << (data.stale ? "true" : "false") << ",\n";
         json << "  \"timestamp\": " << data.now_time_us << ",\n";
         json << "  \"elapsed_seconds\": " << data.elapsed_sec << ",\n";
         json << "  \"elapsed_hms\": \"" << data.hours << ":"
@@ -59,7 +67,11 @@ public:
         json << "    \"current_a\": " << data.pack_current_a << ",\n";
         json << "    \"soc_pct\": " << data.soc_pct << ",\n";
         json << "    \"power_w\": " << data.power_w << ",\n";
-        json << "    \"full_capacity_ah\": " << data.full_capacity_ah << "\n";
+        json << "    \"full_capacity_ah\": " << data.full_capacity_ah << ",\n";
+        json << "    \"est_capacity_ah\": " << data.est_capacity_ah << ",\n";
+        json << "    \"soh_pct\": " << data.soh_pct << ",\n";
+        json << "    \"time_to_empty_s\": " << data.time_to_empty_s << ",\n";
+        json << "    \"time_to_full_s\": " << data.time_to_full_s << "\n";
         json << "  },\n";
 
         json << "  \"stats\": {\n";
@@ -94,13 +106,41 @@ public:
         }
         json << "]\n  },\n";
 
+        json << "  \"cell_stats\": {";
+        for (int w = 0; w < output::CELL_STATS_WINDOWS; ++w) {
+            const output::CellWindowSummary& cs = data.cell_stats[static_cast<size_t>(w)];
+            if (w > 0) json << ",";
+            json << "\n    \"" << output::CELL_STATS_WINDOW_NAMES[w] << "\": {"
+                 << "\"samples\": " << cs.samples
+                 << ", \"spread_v\": " << cs.spread_v
+                 << ", \"max_stddev_v\": " << cs.max_stddev_v
+                 << ", \"drift_cell\": " << cs.drift_cell
+                 << ", \"drift_mv_per_h\": " << cs.drift_mv_per_h << "}";
+        }
+        json << "\n  },\n";
+
+        json << "  \"internal_resistance\": {\n";
+        json << "    \"steps\": " << data.ir_steps << ",\n";
+        json << "    \"mohm\": [";
+        for (int i = 0; i < data.cell_count; ++i) {
+            if (i > 0) json << ",";
+            json << data.cell_ir_mohm[static_cast<size_t>(i)];
+        }
+        json << "]\n  },\n";
+
+        json << "  \"anomaly\": {\n";
+        json << "    \"level\": " << (int)data.anomaly_level << ",\n";
+        json << "    \"cell\": " << data.anomaly_cell << ",\n";
+        json << "    \"z\": " << data.anomaly_z << "\n";
+        json << "  },\n";
+
         json << "  \"status\": {\n";
         json << "    \"charging_enabled\": " << (data.charging_enabled ? "true" : "false") << ",\n";
         json << "    \"discharging_enabled\": " << (data.discharging_enabled ? "true" : "false") << "\n";
         json << "  }\n";
         json << "}\n";
 
-        result = json.str();
+        out += json.str();
         return true;
     }
 
@@ -140,10 +180,14 @@ public:
     }
 
     bool serialize(const output::BMSSnapshot& data, std::string& result) override {
+        result.clear();
+        return serializeAppend(data, result);
+    }
+
+    bool serializeAppend(const output::BMSSnapshot& data, std::string& out) override {
         // For CSV, we'll reuse the existing implementation
         // This is a simplified version - in practice, you might want to use the existing
         // CSV formatting directly or create a more efficient implementation
-        result.clear();
 
         char buffer[1024];
         int len = snprintf(buffer, sizeof(buffer),
@@ -159,20 +203,33 @@ public:
             data.min_temp_c, data.max_temp_c, data.charging_enabled ? 1 : 0,
             data.discharging_enabled ? 1 : 0);
 
-        result += std::string(buffer, len);
+        out.append(buffer, len);
 
         int cells = (data.cell_count < cfg_.header_cells) ? data.cell_count : cfg_.header_cells;
         for (int i = 0; i < cells; ++i) {
             len = snprintf(buffer, sizeof(buffer), ",%.3f", data.cell_v[i]);
-            result += std::string(buffer, len);
+            out.append(buffer, len);
         }
 
         int temps = (data.temp_count < cfg_.header_temps) ? data.temp_count : cfg_.header_temps;
         for (int i = 0; i < temps; ++i) {
             len = snprintf(buffer, sizeof(buffer), ",%.1f", data.temp_c[i]);
-            result += std::string(buffer, len);
+            out.append(buffer, len);
         }
 
+        // Appended after the packed groups so the cell columns keep their place
+        // for older readers. Analytics: hourly imbalance, learned capacity,
+        // runtime prediction, anomaly grade; then boot ID and sample sequence
+        // for loss accounting (seq 0: restored checkpoint)
+        const output::CellWindowSummary& cs = data.cell_stats[1];
+        len = snprintf(buffer, sizeof(buffer), ",%.4f,%.4f,%d,%.2f,%.2f,%.1f,%ld,%ld,%d,%d,%lu,%lu",
+            cs.spread_v, cs.max_stddev_v, cs.drift_cell, cs.drift_mv_per_h,
+            data.est_capacity_ah, data.soh_pct,
+            (long)data.time_to_empty_s, (long)data.time_to_full_s,
+            (int)data.anomaly_level, data.anomaly_cell,
+            (unsigned long)data.boot_id, (unsigned long)data.seq);
+        out.append(buffer, len);
+
         return true;
     }
 
@@ -196,6 +253,8 @@ public:
         for (int i = 0; i < cfg_.header_temps; ++i) {
             header += ",temp_c_" + std::to_string(i + 1);
         }
+
+        header += ",cell_spread_1h_v,cell_max_stddev_1h_v,cell_drift_1h,cell_drift_1h_mv_per_h,est_capacity_ah,soh_pct,time_to_empty_s,time_to_full_s,anomaly_level,anomaly_cell,boot_id,seq";
         
         header += "\n";
         return header;
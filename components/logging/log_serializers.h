@@ -37,6 +37,22 @@ public:
      */
     virtual bool serialize(const output::BMSSnapshot& data, std::string& result) = 0;
 
+    /**
+     * Serialize the BMS snapshot data to the end of a buffer
+     * Lets a pipeline batch records in one buffer without a copy per record.
+     * @param data BMS data to serialize
+     * @param out buffer to append to; left as it was on failure
+     * @return true if serialization succeeded
+     */
+    virtual bool serializeAppend(const output::BMSSnapshot& data, std::string& out) {
+        std::string record;
+        if (!serialize(data, record)) {
+            return false;
+        }
+        out += record;
+        return true;
+    }
+
     /**
      * Get the serialization format type
      * @return format type
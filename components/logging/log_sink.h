@@ -1,6 +1,10 @@
 #ifndef LOG_SINK_H
 #define LOG_SINK_H
 
+#include <stdint.h>
+#include <array>
+#include <atomic>
+#include <initializer_list>
 #include <memory>
 #include <string>
 #include <vector>
@@ -8,6 +12,73 @@
 
 namespace logging {
 
+/**
+ * Why a sample offered to a sink never left the device
+ * LINK_DOWN and BREAKER_OPEN are counted by LogManager, which does not offer
+ * the sample at all; the rest are counted by the sink itself.
+ */
+enum class DropReason : uint8_t {
+    LINK_DOWN,      // network sink paused while the station link is down
+    BREAKER_OPEN,   // skipped while the sink's breaker is open
+    NOT_READY,      // sink not connected or not initialized
+    SERIALIZE,      // serializer failed
+    OVERSIZE,       // record larger than the transport allows
+    QUEUE_FULL,     // socket buffer or client outbox full
+    STORAGE,        // no space or file error on the card
+    TRANSPORT,      // transport rejected or failed the send
+    DEFERRED,       // deferred past the cycle budget, overwritten before an idle slot
+    COUNT
+};
+
+inline const char* dropReasonToString(DropReason reason) {
+    switch (reason) {
+        case DropReason::LINK_DOWN: return "link_down";
+        case DropReason::BREAKER_OPEN: return "breaker_open";
+        case DropReason::NOT_READY: return "not_ready";
+        case DropReason::SERIALIZE: return "serialize";
+        case DropReason::OVERSIZE: return "oversize";
+        case DropReason::QUEUE_FULL: return "queue_full";
+        case DropReason::STORAGE: return "storage";
+        case DropReason::TRANSPORT: return "transport";
+        case DropReason::DEFERRED: return "deferred";
+        default: return "unknown";
+    }
+}
+
+/**
+ * Dispatch class of a sink, highest first
+ * LogManager offers each sample to sinks in this order. CRITICAL sinks always
+ * get it within the fan-out; the others are deferred to an idle slot once the
+ * cycle budget is spent.
+ */
+enum class SinkPriority : uint8_t {
+    CRITICAL,       // live telemetry, cheap non-blocking hand-off
+    NORMAL,
+    BULK            // storage and batch uploads
+};
+
+inline const char* sinkPriorityToString(SinkPriority priority) {
+    switch (priority) {
+        case SinkPriority::CRITICAL: return "critical";
+        case SinkPriority::NORMAL: return "normal";
+        case SinkPriority::BULK: return "bulk";
+        default: return "unknown";
+    }
+}
+
+inline bool sinkPriorityFromString(const std::string& name, SinkPriority& out) {
+    for (SinkPriority priority : { SinkPriority::CRITICAL, SinkPriority::NORMAL, SinkPriority::BULK }) {
+        if (name == sinkPriorityToString(priority)) {
+            out = priority;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct PipelineConfig;
+class SinkPipeline;
+
 /**
  * Base interface for log sinks
  */
@@ -52,11 +123,94 @@ public:
      */
     virtual std::string getLastError() const { return last_error_; }
 
+    /**
+     * Check if the sink needs the station network link
+     * Network sinks are paused by LogManager while the link is down.
+     * @return true for network transports
+     */
+    virtual bool requiresNetwork() const { return false; }
+
+    /**
+     * Called by LogManager when a paused network sink is released after the
+     * link came back. Sinks can use it to skip their own reconnect backoff.
+     */
+    virtual void onNetworkResume() {}
+
+    /**
+     * Dispatch class, overridable per sink with the "priority" config key
+     */
+    virtual SinkPriority getPriority() const { return SinkPriority::NORMAL; }
+
+    /**
+     * Time one send() is expected to stay within, in microseconds
+     * LogManager uses it to decide whether the call still fits the cycle
+     * budget and counts calls that take longer as overruns. Overridable per
+     * sink with the "budget_us" config key.
+     */
+    virtual uint32_t getBudgetUs() const { return 10000; }
+
+    /**
+     * Publish an out-of-band diagnostic record (breaker states, stats, ...)
+     * Sinks without a side channel ignore these records.
+     * @param channel short channel name, e.g. "breakers"
+     * @param payload JSON payload
+     * @return true if the record was handed to the transport
+     */
+    virtual bool sendDiagnostic(const char* /*channel*/, const std::string& /*payload*/) { return false; }
+
+    /**
+     * Rebuild the sink's stage pipeline from the entry's "pipeline" object
+     * Called by LogManager after init(); sinks without a pipeline refuse.
+     * @return false if unsupported or rejected (reason in getLastError())
+     */
+    virtual bool configurePipeline(const PipelineConfig& /*config*/) { return false; }
+
+    /**
+     * Get the sink's stage pipeline, for stats
+     * @return nullptr if the sink has none
+     */
+    virtual const SinkPipeline* getPipeline() const { return nullptr; }
+
+    /**
+     * Count a sample this sink will never deliver
+     * Every send() that returns false after losing the sample records exactly
+     * one reason; a sample kept for retry (SD write buffer) is not a drop.
+     */
+    void recordDrop(DropReason reason) {
+        drops_[(size_t)reason].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Count a lost batch of samples, one drop each
+     */
+    void recordDrops(DropReason reason, uint32_t count) {
+        drops_[(size_t)reason].fetch_add(count, std::memory_order_relaxed);
+    }
+
+    /**
+     * Get the drop count for one reason (safe from any task)
+     */
+    uint32_t getDropCount(DropReason reason) const {
+        return drops_[(size_t)reason].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Get the drop count over all reasons
+     */
+    uint32_t getTotalDrops() const {
+        uint32_t total = 0;
+        for (const auto& count : drops_) {
+            total += count.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
 protected:
     void setLastError(const std::string& err) { last_error_ = err; }
 
 private:
     std::string last_error_;
+    std::array<std::atomic<uint32_t>, (size_t)DropReason::COUNT> drops_{};
 };
 
 // Use smart pointer for automatic memory management
@@ -4,18 +4,19 @@
 #include <esp_log.h>
 #include <mqtt_client.h>
 #include <cJSON.h>
-#include <esp_spiffs.h>
 #include <esp_system.h>
 #include <esp_mac.h>
+#include <string.h>
 #include "status_led.h"
 #include "device_id.h"
+#include "config_store.h"
+#include "command_router.h"
 
 using namespace logging;
 
 static const char* TAG = "MQTT_LOG_SINK";
 
 MQTTLogSink::MQTTLogSink() :
-    serializer_(nullptr),
     mqtt_client_(nullptr),
     initialized_(false),
     connected_(false),
@@ -31,10 +32,10 @@ MQTTLogSink::~MQTTLogSink() {
 }
 
 bool MQTTLogSink::init(const std::string& config) {
-    // First load SPIFFS configuration if available
-    loadSpiffsConfig();
+    // First apply the stored configuration (mqtt_config.txt) if available
+    loadStoredConfig();
 
-    // Parse configuration (can override SPIFFS settings)
+    // Parse configuration (can override stored settings)
     if (!parseConfig(config)) {
         setLastError("Failed to parse configuration");
         return false;
@@ -55,10 +56,8 @@ bool MQTTLogSink::init(const std::string& config) {
         ESP_LOGI(TAG, "Using base MQTT topic: %s", full_topic_.c_str());
     }
 
-    // Create appropriate serializer
-    serializer_ = BMSSerializer::createSerializer(config_.format);
-
-    if (!serializer_) {
+    // Default pipeline: one record per message in the configured format
+    if (!configurePipeline(PipelineConfig())) {
         setLastError("Failed to create serializer for format: " + config_.format);
         return false;
     }
@@ -76,46 +75,69 @@ bool MQTTLogSink::init(const std::string& config) {
 bool MQTTLogSink::send(const output::BMSSnapshot& data) {
     if (!initialized_ || !isReady()) {
         setLastError("MQTT sink not ready");
+        recordDrop(DropReason::NOT_READY);
         return false;
     }
 
-    std::string serialized;
-    if (!serializer_->serialize(data, serialized)) {
-        setLastError("Failed to serialize data");
+    return pipeline_.push(data, [this](const PipelineBuffer& payload, DropReason& reason) {
+        return publish(payload, reason);
+    });
+}
+
+bool MQTTLogSink::publish(const PipelineBuffer& payload, DropReason& reason) {
+    if (!isReady()) {
+        setLastError("MQTT sink not ready");
+        reason = DropReason::NOT_READY;
         return false;
     }
 
     // Publish message
     int msg_id = esp_mqtt_client_publish(mqtt_client_,
                                        full_topic_.c_str(),
-                                       serialized.c_str(),
-                                       serialized.length(),
+                                       payload.data(),
+                                       payload.size(),
                                        config_.qos,
                                        config_.retain);
 
-    if (msg_id == -1) {
-        setLastError("Failed to publish MQTT message");
+    // -1 is a failed publish, -2 a full outbox
+    if (msg_id < 0) {
+        setLastError(msg_id == -2 ? "MQTT outbox full" : "Failed to publish MQTT message");
+        reason = msg_id == -2 ? DropReason::QUEUE_FULL : DropReason::TRANSPORT;
         return false;
     }
 
     messages_published_++;
-    bytes_published_ += serialized.length();
+    bytes_published_ += payload.size();
 
     // Notify status LED of telemetry publish (blue TX badge)
     status_led_notify_net_telemetry_tx();
 
-    ESP_LOGD(TAG, "Published MQTT message (ID: %d, %zu bytes) to topic: %s",
-             msg_id, serialized.length(), full_topic_.c_str());
+    ESP_LOGD(TAG, "Published MQTT message (ID: %d, %zu bytes, %lu records) to topic: %s",
+             msg_id, payload.size(), (unsigned long)payload.records(), full_topic_.c_str());
 
     return true;
 }
 
+bool MQTTLogSink::configurePipeline(const PipelineConfig& config) {
+    std::string error;
+    if (!pipeline_.configure(this, config, config_.format, PipelineConfig::Framing::NONE, error)) {
+        setLastError(error);
+        return false;
+    }
+    ESP_LOGI(TAG, "Pipeline: %s", pipeline_.describe().c_str());
+    return true;
+}
+
 void MQTTLogSink::shutdown() {
+    // Publish a partly filled batch while still connected
+    pipeline_.flush([this](const PipelineBuffer& payload, DropReason& reason) {
+        return publish(payload, reason);
+    });
+
     if (mqtt_client_) {
         disconnectMQTT();
     }
 
-    serializer_.reset();
     initialized_ = false;
     connected_ = false;
 }
@@ -128,6 +150,39 @@ bool MQTTLogSink::isReady() const {
     return initialized_ && connected_;
 }
 
+void MQTTLogSink::onNetworkResume() {
+    // Link is back: reconnect now instead of waiting out the client's retry timer
+    if (mqtt_client_ && !connected_) {
+        esp_err_t ret = esp_mqtt_client_reconnect(mqtt_client_);
+        if (ret != ESP_OK) {
+            ESP_LOGD(TAG, "MQTT reconnect request failed: 0x%x", ret);
+        }
+    }
+}
+
+bool MQTTLogSink::sendDiagnostic(const char* channel, const std::string& payload) {
+    if (!isReady() || !channel) {
+        return false;
+    }
+
+    // Diagnostics are retained so a dashboard sees the latest state on subscribe
+    std::string topic = full_topic_ + "/diag/" + channel;
+    int msg_id = esp_mqtt_client_publish(mqtt_client_,
+                                       topic.c_str(),
+                                       payload.c_str(),
+                                       payload.length(),
+                                       0,
+                                       1);
+    if (msg_id == -1) {
+        ESP_LOGW(TAG, "Failed to publish diagnostic record to %s", topic.c_str());
+        return false;
+    }
+
+    ESP_LOGD(TAG, "Published diagnostic record (%zu bytes) to topic: %s",
+             payload.length(), topic.c_str());
+    return true;
+}
+
 bool MQTTLogSink::parseConfig(const std::string& config_str) {
     cJSON *json = cJSON_Parse(config_str.c_str());
     if (json) {
@@ -276,86 +331,23 @@ bool MQTTLogSink::parseConfig(const std::string& config_str) {
     }
 }
 
-bool MQTTLogSink::loadSpiffsConfig() {
-    // Mount SPIFFS if not already mounted
-    esp_vfs_spiffs_conf_t conf = {
-        .base_path = "/spiffs",
-        .partition_label = NULL,
-        .max_files = 5,
-        .format_if_mount_failed = false
-    };
-
-    esp_err_t ret = esp_vfs_spiffs_register(&conf);
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "SPIFFS already mounted or mount failed (0x%x)", ret);
-    }
-
-    FILE* config_file = fopen("/spiffs/mqtt_config.txt", "r");
-    if (!config_file) {
-        ESP_LOGW(TAG, "MQTT config file not found in SPIFFS");
+bool MQTTLogSink::loadStoredConfig() {
+    const bms_config_t* cfg = config_store_get();
+    if (!(cfg->sections & CONFIG_SECTION_MQTT)) {
+        ESP_LOGW(TAG, "No MQTT config in config store");
         return false;
     }
 
-    char line[256];
-    while (fgets(line, sizeof(line), config_file)) {
-        // Remove newline
-        line[strcspn(line, "\n")] = 0;
-
-        // Skip comments and empty lines
-        if (line[0] == '#' || line[0] == '\0') {
-            continue;
-        }
-
-        char* eq_pos = strchr(line, '=');
-        if (eq_pos) {
-            *eq_pos = '\0'; // Split string
-            char* key = line;
-            char* value = eq_pos + 1;
+    const bms_mqtt_settings_t& mqtt = cfg->mqtt;
+    if (mqtt.host[0] != '\0') config_.broker_host = mqtt.host;
+    config_.broker_port = mqtt.port;
+    if (mqtt.topic[0] != '\0') config_.topic = mqtt.topic;
+    config_.use_device_topic = mqtt.use_device_topic;
+    config_.username = mqtt.username;
+    config_.password = mqtt.password;
+    if (mqtt.qos >= 0) config_.qos = mqtt.qos;
 
-            // Trim whitespace
-            while (*key && (*key == ' ' || *key == '\t')) key++;
-            char* key_end = key + strlen(key) - 1;
-            while (key_end > key && (*key_end == ' ' || *key_end == '\t')) key_end--;
-            *(key_end + 1) = '\0';
-
-            while (*value && (*value == ' ' || *value == '\t')) value++;
-            char* value_end = value + strlen(value) - 1;
-            while (value_end > value && (*value_end == ' ' || *value_end == '\t')) value_end--;
-            *(value_end + 1) = '\0';
-
-            if (strcmp(key, "host") == 0) config_.broker_host = value;
-            else if (strcmp(key, "port") == 0) {
-                config_.broker_port = atoi(value);
-                // Validate port range
-                if (config_.broker_port < 1 || config_.broker_port > 65535) {
-                    ESP_LOGE(TAG, "Invalid broker port in SPIFFS config: must be between 1-65535");
-                    fclose(config_file);
-                    return false;
-                }
-            }
-            else if (strcmp(key, "topic") == 0) config_.topic = value;
-            else if (strcmp(key, "use_device_topic") == 0) {
-                config_.use_device_topic = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
-            }
-            else if (strcmp(key, "username") == 0) config_.username = value;
-            else if (strcmp(key, "password") == 0) config_.password = value;
-            else if (strcmp(key, "qos") == 0) {
-                config_.qos = atoi(value);
-                // Validate QoS range
-                if (config_.qos < 0 || config_.qos > 2) {
-                    ESP_LOGE(TAG, "Invalid QoS value in SPIFFS config: must be between 0-2");
-                    fclose(config_file);
-                    return false;
-                }
-            }
-            else if (strcmp(key, "enabled") == 0) {
-                // Note: This doesn't affect initialization, just for info
-            }
-        }
-    }
-
-    fclose(config_file);
-    ESP_LOGI(TAG, "Loaded MQTT config from SPIFFS: %s:%d",
+    ESP_LOGI(TAG, "Loaded MQTT config from config store: %s:%d",
              config_.broker_host.c_str(), config_.broker_port);
     return true;
 }
@@ -463,6 +455,30 @@ std::string MQTTLogSink::generateMacBasedClientId() {
     return std::string(buf);
 }
 
+void MQTTLogSink::handleCommand(esp_mqtt_event_handle_t event) {
+    const std::string prefix = full_topic_ + "/cmd/";
+    if (event->topic_len <= (int)prefix.size() ||
+        prefix.compare(0, prefix.size(), event->topic, prefix.size()) != 0) {
+        return;
+    }
+    if (event->total_data_len != event->data_len) {
+        // Commands are small; fragmented payloads are not reassembled
+        ESP_LOGW(TAG, "Ignoring fragmented command payload (%d bytes)", event->total_data_len);
+        return;
+    }
+
+    std::string name(event->topic + prefix.size(), event->topic_len - prefix.size());
+    std::string args(event->data ? event->data : "", event->data_len);
+    std::string resp_topic = full_topic_ + "/resp/" + name;
+
+    // The reply owns its topic: deferred commands reply after this returns, from another task
+    CommandRouter::getInstance().dispatch(name, args, [this, resp_topic = std::move(resp_topic)](const std::string& payload) {
+        int msg_id = esp_mqtt_client_enqueue(mqtt_client_, resp_topic.c_str(),
+                                             payload.c_str(), payload.length(), 1, 0, true);
+        return msg_id >= 0;
+    });
+}
+
 void MQTTLogSink::mqttEventHandler(void* handler_args, esp_event_base_t base, int32_t event_id, void* event_data) {
     esp_mqtt_event_handle_t event = static_cast<esp_mqtt_event_handle_t>(event_data);
 
@@ -470,6 +486,15 @@ void MQTTLogSink::mqttEventHandler(void* handler_args, esp_event_base_t base, in
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "MQTT connected");
             connected_ = true;
+            {
+                // Remote commands: <topic>/cmd/<name>, replies on <topic>/resp/<name>
+                std::string cmd_topic = full_topic_ + "/cmd/#";
+                esp_mqtt_client_subscribe(mqtt_client_, cmd_topic.c_str(), 1);
+            }
+            break;
+
+        case MQTT_EVENT_DATA:
+            handleCommand(event);
             break;
 
         case MQTT_EVENT_DISCONNECTED:
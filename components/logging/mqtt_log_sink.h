@@ -2,7 +2,7 @@
 #define MQTT_LOG_SINK_H
 
 #include "log_sink.h"
-#include "log_serializers.h"
+#include "sink_pipeline.h"
 #include <memory>
 
 // ESP-IDF includes
@@ -25,9 +25,16 @@ public:
     void shutdown() override;
     const char* getName() const override;
     bool isReady() const override;
+    bool requiresNetwork() const override { return true; }
+    void onNetworkResume() override;
+    SinkPriority getPriority() const override { return SinkPriority::CRITICAL; }
+    uint32_t getBudgetUs() const override { return 5000; }   // outbox enqueue
+    bool sendDiagnostic(const char* channel, const std::string& payload) override;
+    bool configurePipeline(const PipelineConfig& config) override;
+    const SinkPipeline* getPipeline() const override { return &pipeline_; }
 
 private:
-    std::unique_ptr<BMSSerializer> serializer_;
+    SinkPipeline pipeline_;         // one message per payload
     esp_mqtt_client_handle_t mqtt_client_;
     bool initialized_;
     bool connected_;
@@ -52,10 +59,12 @@ private:
     std::string full_topic_;  // Constructed topic with device_id if enabled
 
     bool parseConfig(const std::string& config_str);
-    bool loadSpiffsConfig();
+    bool loadStoredConfig();
+    bool publish(const PipelineBuffer& payload, DropReason& reason);
     bool connectMQTT();
     std::string generateMacBasedClientId();
     void disconnectMQTT();
+    void handleCommand(esp_mqtt_event_handle_t event);
     void mqttEventHandler(void* handler_args, esp_event_base_t base, int32_t event_id, void* event_data);
 
     // Stats
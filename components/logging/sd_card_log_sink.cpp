@@ -48,10 +48,8 @@ bool SDCardLogSink::init(const std::string& config) {
         return false;
     }
 
-    // Create CSV serializer
-    serializer_ = BMSSerializer::createSerializer(SerializationFormat::CSV);
-    if (!serializer_) {
-        setLastError("Failed to create CSV serializer");
+    // Default pipeline: one CSV line per sample
+    if (!configurePipeline(PipelineConfig())) {
         return false;
     }
 
@@ -66,40 +64,44 @@ bool SDCardLogSink::init(const std::string& config) {
 }
 
 bool SDCardLogSink::send(const output::BMSSnapshot& data) {
-    if (state_ != SDCardState::READY) {
-        return false;
+    // The card already holds the original of a restored checkpoint
+    if (data.stale) {
+        return true;
     }
 
     std::lock_guard<std::mutex> lock(buffer_mutex_);
 
+    if (state_ != SDCardState::READY && !recoverFromError()) {
+        recordDrop(DropReason::NOT_READY);
+        return false;
+    }
+
     // Check free space periodically (every 100 writes to avoid overhead)
     if (stats_.current_file_lines % 100 == 0) {
         if (!checkFreeSpace()) {
+            recordDrop(DropReason::STORAGE);
             return false;
         }
     }
 
     // Check if we need to rotate the file
     if (!rotateFileIfNeeded()) {
+        recordDrop(DropReason::STORAGE);
         return false;
     }
 
-    // Serialize data to CSV
-    std::string csv_line;
-    if (!serializer_->serialize(data, csv_line)) {
-        setLastError("Failed to serialize data");
+    // Serialize into the write buffer
+    if (!pipeline_.push(data, [this](const PipelineBuffer& payload, DropReason& reason) {
+            return appendPayload(payload, reason);
+        })) {
         return false;
     }
 
-    // Add to buffer
-    write_buffer_ += csv_line + "\n";
-    stats_.current_file_lines++;
-    stats_.last_write_time_us = esp_timer_get_time();
-
     // Check if we need to flush - be more aggressive about flushing
     uint64_t now = esp_timer_get_time();
     if ((now - last_flush_time_) >= (config_.flush_interval_ms * 1000) ||
         write_buffer_.size() >= config_.buffer_size) {
+        // A failed flush keeps the buffer for the retry after recovery, so it is not a drop
         return writeBufferToFile();
     }
 
@@ -109,7 +111,13 @@ bool SDCardLogSink::send(const output::BMSSnapshot& data) {
 void SDCardLogSink::shutdown() {
     ESP_LOGI(TAG, "Shutting down SD Card Log Sink");
 
-    // Flush any remaining data
+    // Flush any remaining data, a partly filled batch included
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+        pipeline_.flush([this](const PipelineBuffer& payload, DropReason& reason) {
+            return appendPayload(payload, reason);
+        });
+    }
     flushBuffer();
 
     // Close current file
@@ -161,7 +169,32 @@ bool SDCardLogSink::flushBuffer() {
     return writeBufferToFile();
 }
 
+bool SDCardLogSink::configurePipeline(const PipelineConfig& config) {
+    // Files stay readable line by line: no compression or binary framing
+    if (config.compression != PipelineConfig::Compression::NONE ||
+        config.framing == PipelineConfig::Framing::LENGTH || config.framing == PipelineConfig::Framing::NONE) {
+        setLastError("SD card pipeline must produce text lines");
+        return false;
+    }
+
+    std::string error;
+    if (!pipeline_.configure(this, config, "csv", PipelineConfig::Framing::LINES, error)) {
+        setLastError(error);
+        return false;
+    }
+    ESP_LOGI(TAG, "Pipeline: %s", pipeline_.describe().c_str());
+    return true;
+}
+
 // Private method implementations
+bool SDCardLogSink::appendPayload(const PipelineBuffer& payload, DropReason& reason) {
+    // Called with buffer_mutex_ held; the write buffer keeps it until the next flush
+    write_buffer_.append(payload.data(), payload.size());
+    stats_.current_file_lines += payload.records();
+    stats_.last_write_time_us = esp_timer_get_time();
+    return true;
+}
+
 bool SDCardLogSink::parseConfig(const std::string& config_str) {
     if (config_str.empty() || config_str == "{}") {
         ESP_LOGI(TAG, "Using default SD card configuration");
@@ -567,8 +600,8 @@ bool SDCardLogSink::createNewFile(OpenMode mode) {
     }
 
     // Write header only for new files or when appending to a zero-sized file
-    if (serializer_->hasHeader() && is_new_file) {
-        std::string header = serializer_->getHeader();
+    if (pipeline_.serializer()->hasHeader() && is_new_file) {
+        std::string header = pipeline_.serializer()->getHeader();
         if (!header.empty()) {
             size_t written = fwrite(header.c_str(), 1, header.size(), current_file_);
             if (written != header.size()) {
@@ -635,6 +668,41 @@ void SDCardLogSink::handleSDCardError(const std::string& error) {
     state_ = SDCardState::ERROR_IO_FAILURE;
 }
 
+bool SDCardLogSink::recoverFromError() {
+    // Card back or space freed: reopen today's file and resume. LogManager's
+    // breaker spaces these attempts out while the fault persists.
+    if (state_ != SDCardState::ERROR_NO_CARD &&
+        state_ != SDCardState::ERROR_DISK_FULL &&
+        state_ != SDCardState::ERROR_IO_FAILURE) {
+        return false;
+    }
+    if (!isSDCardPresent()) {
+        state_ = SDCardState::ERROR_NO_CARD;
+        return false;
+    }
+
+    if (current_file_) {
+        fclose(current_file_);
+        current_file_ = nullptr;
+    }
+
+    const SDCardState previous = state_;
+    state_ = SDCardState::READY;
+    if (!checkFreeSpace()) {
+        return false;
+    }
+    if (!createNewFile(OpenMode::AppendIfExists)) {
+        state_ = SDCardState::ERROR_IO_FAILURE;
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Recovered from %s, logging to %s (%zu bytes pending)",
+             previous == SDCardState::ERROR_NO_CARD ? "card removal" :
+             previous == SDCardState::ERROR_DISK_FULL ? "full disk" : "I/O failure",
+             stats_.current_filename.c_str(), write_buffer_.size());
+    return true;
+}
+
 // Helper method implementations
 bool SDCardLogSink::isSDCardPresent() {
     // Check if card is mounted and accessible
@@ -2,7 +2,7 @@
 #define SD_CARD_LOG_SINK_H
 
 #include "log_sink.h"
-#include "log_serializers.h"
+#include "sink_pipeline.h"
 #include <memory>
 #include <string>
 #include <mutex>
@@ -88,6 +88,10 @@ public:
     void shutdown() override;
     const char* getName() const override;
     bool isReady() const override;
+    SinkPriority getPriority() const override { return SinkPriority::BULK; }
+    uint32_t getBudgetUs() const override { return 50000; }  // buffer flush
+    bool configurePipeline(const PipelineConfig& config) override;
+    const SinkPipeline* getPipeline() const override { return &pipeline_; }
 
     // SD card specific methods
     SDCardState getState() const { return state_; }
@@ -102,7 +106,7 @@ private:
     FileStats stats_;
 
     // Serialization and buffering
-    std::unique_ptr<BMSSerializer> serializer_;
+    SinkPipeline pipeline_;         // text lines only
     std::string write_buffer_;
     mutable std::mutex buffer_mutex_;
 
@@ -130,10 +134,12 @@ private:
     // Legacy wrapper; returns unique filename for today (no path)
     std::string generateFilename();
     bool writeBufferToFile();
+    bool appendPayload(const PipelineBuffer& payload, DropReason& reason);
     bool checkFreeSpace();
     void updateFileStats();
     bool createNewFile(OpenMode mode = OpenMode::AppendIfExists);
     void handleSDCardError(const std::string& error);
+    bool recoverFromError();
 
     // Helper methods
     bool isSDCardPresent();
@@ -58,12 +58,14 @@ bool SerialLogSink::init(const std::string& config) {
 bool SerialLogSink::send(const output::BMSSnapshot& data) {
     if (!initialized_) {
         setLastError("Serial sink not initialized");
+        recordDrop(DropReason::NOT_READY);
         return false;
     }
 
     std::string serialized;
     if (!serializer_->serialize(data, serialized)) {
         setLastError("Failed to serialize data");
+        recordDrop(DropReason::SERIALIZE);
         return false;
     }
 
@@ -78,6 +80,14 @@ bool SerialLogSink::send(const output::BMSSnapshot& data) {
         std::cout << "Pack Current (A): " << std::fixed << std::setprecision(2) << data.pack_current_a << std::endl;
         std::cout << "State of Charge (%): " << std::fixed << std::setprecision(1) << data.soc_pct << std::endl;
         std::cout << "Power (W): " << std::fixed << std::setprecision(2) << data.power_w << std::endl;
+        if (data.time_to_empty_s >= 0) {
+            std::cout << "Time to Empty: " << data.time_to_empty_s / 3600 << "h "
+                      << (data.time_to_empty_s % 3600) / 60 << "m" << std::endl;
+        }
+        if (data.time_to_full_s >= 0) {
+            std::cout << "Time to Full: " << data.time_to_full_s / 3600 << "h "
+                      << (data.time_to_full_s % 3600) / 60 << "m" << std::endl;
+        }
         std::cout << "Cells: " << data.cell_count << std::endl;
         std::cout << "Min Cell Voltage (V): " << std::fixed << std::setprecision(3) << data.min_cell_voltage_v << std::endl;
         std::cout << "Max Cell Voltage (V): " << std::fixed << std::setprecision(3) << data.max_cell_voltage_v << std::endl;
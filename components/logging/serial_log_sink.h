@@ -21,6 +21,7 @@ public:
     void shutdown() override;
     const char* getName() const override;
     bool isReady() const override;
+    uint32_t getBudgetUs() const override { return 20000; }  // a CSV line at 115200 baud
 
 private:
     std::unique_ptr<BMSSerializer> serializer_;
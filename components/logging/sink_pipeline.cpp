@@ -0,0 +1,545 @@
+#include "sink_pipeline.h"
+#include <string.h>
+#include <algorithm>
+#include <esp_timer.h>
+#include <cJSON.h>
+
+namespace logging {
+
+namespace {
+
+bool readCount(const cJSON* json, const char* key, uint32_t min, uint32_t& out, std::string& error) {
+    const cJSON* item = cJSON_GetObjectItemCaseSensitive(json, key);
+    if (!item) {
+        return true;
+    }
+    if (!cJSON_IsNumber(item) || item->valuedouble < min) {
+        error = std::string("pipeline: bad ") + key;
+        return false;
+    }
+    out = static_cast<uint32_t>(item->valuedouble);
+    return true;
+}
+
+bool readString(const cJSON* json, const char* key, std::string& out, std::string& error) {
+    const cJSON* item = cJSON_GetObjectItemCaseSensitive(json, key);
+    if (!item) {
+        return true;
+    }
+    if (!cJSON_IsString(item) || !item->valuestring) {
+        error = std::string("pipeline: bad ") + key;
+        return false;
+    }
+    out = item->valuestring;
+    return true;
+}
+
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// LZ4 length continuation: 255-valued bytes then the remainder
+bool putLength(uint8_t*& op, const uint8_t* oend, size_t len) {
+    while (len >= 255) {
+        if (op >= oend) {
+            return false;
+        }
+        *op++ = 255;
+        len -= 255;
+    }
+    if (op >= oend) {
+        return false;
+    }
+    *op++ = static_cast<uint8_t>(len);
+    return true;
+}
+
+constexpr size_t LZ4_MIN_MATCH = 4;
+constexpr size_t LZ4_LAST_LITERALS = 5;    // a block ends in at least this many literals
+constexpr size_t LZ4_MF_LIMIT = 12;        // no match starts closer than this to the end
+constexpr size_t LZ4_MAX_OFFSET = 65535;
+
+/**
+ * One sequence: token, literals, then offset and match length
+ * @param match_len 0 for the closing literals-only sequence
+ */
+bool putSequence(uint8_t*& op, const uint8_t* oend, const uint8_t* literals, size_t literal_len,
+                 size_t offset, size_t match_len) {
+    if (op >= oend) {
+        return false;
+    }
+    uint8_t* token = op++;
+    *token = static_cast<uint8_t>(std::min<size_t>(literal_len, 15) << 4);
+    if (literal_len >= 15 && !putLength(op, oend, literal_len - 15)) {
+        return false;
+    }
+    if (static_cast<size_t>(oend - op) < literal_len) {
+        return false;
+    }
+    memcpy(op, literals, literal_len);
+    op += literal_len;
+
+    if (match_len == 0) {
+        return true;
+    }
+    if (oend - op < 2) {
+        return false;
+    }
+    *op++ = static_cast<uint8_t>(offset & 0xff);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    const size_t extra = match_len - LZ4_MIN_MATCH;
+    *token |= static_cast<uint8_t>(std::min<size_t>(extra, 15));
+    return extra < 15 || putLength(op, oend, extra - 15);
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// PipelineConfig
+
+bool PipelineConfig::fromJson(const cJSON* json, PipelineConfig& out, std::string& error) {
+    if (!cJSON_IsObject(json)) {
+        error = "pipeline: not an object";
+        return false;
+    }
+
+    if (!readCount(json, "every", 1, out.every, error) ||
+        !readCount(json, "min_interval_ms", 0, out.min_interval_ms, error) ||
+        !readCount(json, "batch", 1, out.batch_records, error) ||
+        !readCount(json, "batch_bytes", 0, out.batch_bytes, error) ||
+        !readCount(json, "batch_ms", 0, out.batch_age_ms, error) ||
+        !readString(json, "format", out.format, error)) {
+        return false;
+    }
+
+    std::string value;
+    if (!readString(json, "layout", value, error)) {
+        return false;
+    }
+    if (value == "array") {
+        out.layout = Layout::ARRAY;
+    } else if (!value.empty() && value != "lines") {
+        error = "pipeline: unknown layout " + value;
+        return false;
+    }
+
+    value.clear();
+    if (!readString(json, "compress", value, error)) {
+        return false;
+    }
+    if (value == "lz4") {
+        out.compression = Compression::LZ4;
+    } else if (!value.empty() && value != "none") {
+        error = "pipeline: unknown compression " + value;
+        return false;
+    }
+
+    value.clear();
+    if (!readString(json, "framing", value, error)) {
+        return false;
+    }
+    if (value == "none") {
+        out.framing = Framing::NONE;
+    } else if (value == "lines") {
+        out.framing = Framing::LINES;
+    } else if (value == "length") {
+        out.framing = Framing::LENGTH;
+    } else if (!value.empty() && value != "default") {
+        error = "pipeline: unknown framing " + value;
+        return false;
+    }
+    return true;
+}
+
+const char* framingToString(PipelineConfig::Framing framing) {
+    switch (framing) {
+        case PipelineConfig::Framing::DEFAULT: return "default";
+        case PipelineConfig::Framing::NONE: return "none";
+        case PipelineConfig::Framing::LINES: return "lines";
+        case PipelineConfig::Framing::LENGTH: return "length";
+        default: return "unknown";
+    }
+}
+
+// ---------------------------------------------------------------------------
+// BufferPool
+
+void BufferPool::init(size_t count, size_t bytes) {
+    buffers_.clear();
+    free_.clear();
+    for (size_t i = 0; i < count; ++i) {
+        buffers_.push_back(std::make_unique<PipelineBuffer>());
+        buffers_.back()->bytes_.reserve(PipelineBuffer::HEADROOM + bytes);
+        free_.push_back(buffers_.back().get());
+    }
+}
+
+PipelineBuffer* BufferPool::acquire() {
+    if (free_.empty()) {
+        return nullptr;
+    }
+    PipelineBuffer* buffer = free_.back();
+    free_.pop_back();
+    buffer->reset();
+    return buffer;
+}
+
+void BufferPool::release(PipelineBuffer* buffer) {
+    if (buffer) {
+        free_.push_back(buffer);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Stages
+
+void DecimateStage::configure(const PipelineConfig& config) {
+    every_ = std::max<uint32_t>(config.every, 1);
+    min_interval_us_ = static_cast<uint64_t>(config.min_interval_ms) * 1000;
+    count_ = 0;
+    kept_any_ = false;
+}
+
+bool DecimateStage::accept(uint64_t now_us) {
+    if (count_++ % every_ != 0) {
+        return false;
+    }
+    if (min_interval_us_ && kept_any_ && now_us - last_kept_us_ < min_interval_us_) {
+        return false;
+    }
+    kept_any_ = true;
+    last_kept_us_ = now_us;
+    return true;
+}
+
+void AggregateStage::configure(const PipelineConfig& config) {
+    records_ = std::max<uint32_t>(config.batch_records, 1);
+    bytes_ = config.batch_bytes;
+    age_us_ = static_cast<uint64_t>(config.batch_age_ms) * 1000;
+}
+
+bool AggregateStage::complete(const PipelineBuffer& batch, size_t last_record_bytes, uint64_t age_us) const {
+    if (batch.records() >= records_) {
+        return true;
+    }
+    // Close before a record the size of the last one would overflow the limit
+    if (bytes_ && batch.size() + last_record_bytes > bytes_) {
+        return true;
+    }
+    return expired(age_us);
+}
+
+bool EncodeStage::configure(const std::string& format, PipelineConfig::Layout layout, std::string& error) {
+    // Keep the current serializer if the new settings are rejected
+    std::unique_ptr<BMSSerializer> serializer = BMSSerializer::createSerializer(format);
+    if (!serializer) {
+        error = "pipeline: unsupported format " + format;
+        return false;
+    }
+    if (layout == PipelineConfig::Layout::ARRAY && serializer->getFormat() != SerializationFormat::JSON) {
+        error = "pipeline: array layout needs json";
+        return false;
+    }
+    serializer_ = std::move(serializer);
+    layout_ = layout;
+    return true;
+}
+
+void EncodeStage::begin(PipelineBuffer& batch) {
+    if (layout_ == PipelineConfig::Layout::ARRAY) {
+        batch.bytes_ += '[';
+    }
+}
+
+bool EncodeStage::append(const output::BMSSnapshot& data, PipelineBuffer& batch) {
+    const size_t before = batch.bytes_.size();
+    if (batch.records_ > 0) {
+        if (layout_ == PipelineConfig::Layout::ARRAY) {
+            batch.bytes_ += ',';
+        } else if (batch.bytes_.back() != '\n') {
+            batch.bytes_ += '\n';
+        }
+    }
+    if (!serializer_->serializeAppend(data, batch.bytes_)) {
+        batch.bytes_.resize(before);
+        return false;
+    }
+    batch.records_++;
+    return true;
+}
+
+void EncodeStage::end(PipelineBuffer& batch) {
+    if (layout_ == PipelineConfig::Layout::ARRAY) {
+        batch.bytes_ += ']';
+    }
+}
+
+void CompressStage::configure(PipelineConfig::Compression compression) {
+    compression_ = compression;
+    if (enabled()) {
+        table_.assign(1u << HASH_BITS, 0);
+    } else {
+        table_.clear();
+        table_.shrink_to_fit();
+    }
+}
+
+size_t CompressStage::bound(size_t raw_bytes) {
+    return raw_bytes + raw_bytes / 255 + 16;
+}
+
+bool CompressStage::compress(const PipelineBuffer& in, PipelineBuffer& out) {
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(in.data());
+    const size_t n = in.size();
+    out.records_ = in.records_;
+
+    // Raw size prefix, then the block
+    out.bytes_.resize(out.head_ + 4 + bound(n));
+    uint8_t* dst = reinterpret_cast<uint8_t*>(&out.bytes_[out.head_]);
+    dst[0] = static_cast<uint8_t>(n);
+    dst[1] = static_cast<uint8_t>(n >> 8);
+    dst[2] = static_cast<uint8_t>(n >> 16);
+    dst[3] = static_cast<uint8_t>(n >> 24);
+    uint8_t* op = dst + 4;
+    const uint8_t* const oend = op + bound(n);
+
+    // Greedy single-probe match finder, as LZ4's fast mode. Positions are
+    // stored as-is; a stale or foreign entry fails the compare below.
+    size_t anchor = 0;
+    if (n > LZ4_MF_LIMIT) {
+        std::fill(table_.begin(), table_.end(), 0);
+        const size_t match_limit = n - LZ4_LAST_LITERALS;
+        const size_t last_start = n - LZ4_MF_LIMIT;
+        size_t ip = 0;
+        while (ip < last_start) {
+            const uint32_t seq = read32(src + ip);
+            const uint32_t h = (seq * 2654435761u) >> (32 - HASH_BITS);
+            const size_t candidate = table_[h];
+            table_[h] = static_cast<uint32_t>(ip);
+            if (candidate >= ip || ip - candidate > LZ4_MAX_OFFSET || read32(src + candidate) != seq) {
+                ip++;
+                continue;
+            }
+            size_t len = LZ4_MIN_MATCH;
+            while (ip + len < match_limit && src[candidate + len] == src[ip + len]) {
+                len++;
+            }
+            if (!putSequence(op, oend, src + anchor, ip - anchor, ip - candidate, len)) {
+                return false;
+            }
+            ip += len;
+            anchor = ip;
+        }
+    }
+    if (!putSequence(op, oend, src + anchor, n - anchor, 0, 0)) {
+        return false;
+    }
+
+    out.bytes_.resize(out.head_ + (op - dst));
+    return true;
+}
+
+bool FrameStage::frame(PipelineBuffer& payload) {
+    switch (framing_) {
+        case PipelineConfig::Framing::LINES:
+            if (payload.empty() || payload.bytes_.back() != '\n') {
+                payload.bytes_ += '\n';
+            }
+            return true;
+        case PipelineConfig::Framing::LENGTH: {
+            const size_t len = payload.size();
+            char* header = payload.prepend(4);
+            if (!header) {
+                return false;
+            }
+            header[0] = static_cast<char>(len >> 24);
+            header[1] = static_cast<char>(len >> 16);
+            header[2] = static_cast<char>(len >> 8);
+            header[3] = static_cast<char>(len);
+            return true;
+        }
+        default:
+            return true;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// SinkPipeline
+
+bool SinkPipeline::configure(LogSink* owner, const PipelineConfig& config, const std::string& default_format,
+                             PipelineConfig::Framing default_framing, std::string& error) {
+    reset();
+
+    PipelineConfig resolved = config;
+    if (resolved.format.empty()) {
+        resolved.format = default_format;
+    }
+    const bool compressed = resolved.compression != PipelineConfig::Compression::NONE;
+    if (resolved.framing == PipelineConfig::Framing::DEFAULT) {
+        // A stream sink's own framing is text lines; binary payloads need a length
+        resolved.framing = (compressed && default_framing == PipelineConfig::Framing::LINES)
+                               ? PipelineConfig::Framing::LENGTH : default_framing;
+    }
+    if (compressed && resolved.framing == PipelineConfig::Framing::LINES) {
+        error = "pipeline: compressed payloads cannot be line framed";
+        return false;
+    }
+
+    if (!encode_.configure(resolved.format, resolved.layout, error)) {
+        return false;
+    }
+    owner_ = owner;
+    config_ = resolved;
+    decimate_.configure(config_);
+    aggregate_.configure(config_);
+    compress_.configure(config_.compression);
+    frame_.configure(config_.framing);
+
+    // One batch buffer, plus the compressor's output
+    pool_.init(compressed ? 2 : 1, config_.batch_bytes ? config_.batch_bytes : 512);
+    stats_ = Stats();
+    return true;
+}
+
+bool SinkPipeline::push(const output::BMSSnapshot& data, const Transport& transport) {
+    if (!isConfigured()) {
+        owner_->recordDrop(DropReason::NOT_READY);
+        return false;
+    }
+    stats_.offered++;
+    const uint64_t now_us = esp_timer_get_time();
+
+    if (!decimate_.accept(now_us)) {
+        stats_.filtered++;
+        // A held batch still leaves on time while samples are filtered out
+        if (batch_ && aggregate_.expired(now_us - batch_opened_us_)) {
+            return emit(transport);
+        }
+        return true;
+    }
+
+    if (!batch_) {
+        batch_ = pool_.acquire();
+        if (!batch_) {
+            owner_->recordDrop(DropReason::QUEUE_FULL);
+            return false;
+        }
+        encode_.begin(*batch_);
+        batch_opened_us_ = now_us;
+    }
+
+    const size_t before = batch_->size();
+    if (!encode_.append(data, *batch_)) {
+        owner_->recordDrop(DropReason::SERIALIZE);
+        if (batch_->records() == 0) {
+            reset();
+        }
+        return false;
+    }
+
+    if (!aggregate_.complete(*batch_, batch_->size() - before, now_us - batch_opened_us_)) {
+        return true;
+    }
+    return emit(transport);
+}
+
+bool SinkPipeline::flush(const Transport& transport) {
+    if (!batch_) {
+        return true;
+    }
+    return emit(transport);
+}
+
+void SinkPipeline::reset() {
+    pool_.release(batch_);
+    batch_ = nullptr;
+}
+
+bool SinkPipeline::emit(const Transport& transport) {
+    PipelineBuffer* payload = batch_;
+    batch_ = nullptr;
+    encode_.end(*payload);
+    stats_.encoded_bytes += payload->size();
+
+    DropReason reason = DropReason::TRANSPORT;
+    bool ok = true;
+    if (compress_.enabled()) {
+        PipelineBuffer* compressed = pool_.acquire();
+        ok = compressed && compress_.compress(*payload, *compressed);
+        if (compressed) {
+            pool_.release(payload);
+            payload = compressed;
+        }
+        reason = DropReason::SERIALIZE;
+    }
+    if (ok && !frame_.frame(*payload)) {
+        ok = false;
+        reason = DropReason::SERIALIZE;
+    }
+
+    if (ok) {
+        stats_.payloads++;
+        stats_.wire_bytes += payload->size();
+        stats_.max_payload_bytes = std::max<uint32_t>(stats_.max_payload_bytes, payload->size());
+        reason = DropReason::TRANSPORT;
+        ok = transport(*payload, reason);
+    }
+
+    if (ok) {
+        stats_.records += payload->records();
+    } else {
+        stats_.failed_payloads++;
+        owner_->recordDrops(reason, payload->records());
+    }
+    pool_.release(payload);
+    return ok;
+}
+
+bool SinkPipeline::isText() const {
+    return !compress_.enabled() && frame_.framing() != PipelineConfig::Framing::LENGTH;
+}
+
+std::string SinkPipeline::getContentType() const {
+    if (!isText() || !serializer()) {
+        return "application/octet-stream";
+    }
+    return serializer()->getContentType();
+}
+
+std::string SinkPipeline::describe() const {
+    std::string out;
+    auto add = [&out](const std::string& part) {
+        if (!out.empty()) {
+            out += ' ';
+        }
+        out += part;
+    };
+    if (config_.every > 1) {
+        add("every=" + std::to_string(config_.every));
+    }
+    if (config_.min_interval_ms) {
+        add("min_interval_ms=" + std::to_string(config_.min_interval_ms));
+    }
+    if (config_.batch_records > 1) {
+        add("batch=" + std::to_string(config_.batch_records));
+    }
+    if (config_.batch_bytes) {
+        add("batch_bytes=" + std::to_string(config_.batch_bytes));
+    }
+    if (config_.batch_age_ms) {
+        add("batch_ms=" + std::to_string(config_.batch_age_ms));
+    }
+    add(config_.format);
+    if (config_.layout == PipelineConfig::Layout::ARRAY) {
+        add("array");
+    }
+    if (compress_.enabled()) {
+        add("lz4");
+    }
+    add(framingToString(config_.framing));
+    return out;
+}
+
+} // namespace logging
@@ -0,0 +1,293 @@
+#ifndef SINK_PIPELINE_H
+#define SINK_PIPELINE_H
+
+#include "log_sink.h"
+#include "log_serializers.h"
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct cJSON;
+
+namespace logging {
+
+/**
+ * Stage settings of a sink pipeline, from the sink entry's "pipeline" object
+ * Example: {"type":"mqtt","pipeline":{"every":5,"batch":10,"batch_ms":60000,"compress":"lz4"},"config":{...}}
+ * Every stage defaults to pass-through, so an empty object changes nothing.
+ */
+struct PipelineConfig {
+    enum class Layout {
+        LINES,      // records one after the other, newline-separated
+        ARRAY       // JSON only: one array of records
+    };
+
+    enum class Compression {
+        NONE,
+        LZ4         // LZ4 block, prefixed with the raw size (32-bit little-endian)
+    };
+
+    enum class Framing {
+        DEFAULT,    // the sink's own
+        NONE,       // transport keeps the boundaries (MQTT message, datagram, HTTP body)
+        LINES,      // newline-terminated, for streams and files
+        LENGTH      // 32-bit big-endian length prefix, for binary streams
+    };
+
+    // filter / decimate
+    uint32_t every = 1;                 // keep one sample in this many
+    uint32_t min_interval_ms = 0;       // and none closer than this to the last one kept
+
+    // aggregate
+    uint32_t batch_records = 1;         // records per payload
+    uint32_t batch_bytes = 0;           // close early when the next record would not fit (0 = no limit)
+    uint32_t batch_age_ms = 0;          // close early once the oldest record is this old (0 = no limit)
+
+    // encode
+    std::string format;                 // empty = the sink's format
+    Layout layout = Layout::LINES;
+
+    // compress
+    Compression compression = Compression::NONE;
+
+    // frame
+    Framing framing = Framing::DEFAULT;
+
+    /**
+     * Parse a "pipeline" object
+     * @return false with error set on an unknown value
+     */
+    static bool fromJson(const cJSON* json, PipelineConfig& out, std::string& error);
+};
+
+/**
+ * Pooled byte buffer with headroom for a frame header
+ * Stages append to the tail and prepend into the headroom, so a payload is
+ * never moved once it is written. Capacity is kept between uses.
+ */
+class PipelineBuffer {
+public:
+    static constexpr size_t HEADROOM = 8;
+
+    const char* data() const { return bytes_.data() + head_; }
+    size_t size() const { return bytes_.size() - head_; }
+    bool empty() const { return size() == 0; }
+
+    // Records carried by this payload
+    uint32_t records() const { return records_; }
+
+private:
+    friend class SinkPipeline;
+    friend class BufferPool;
+    friend class EncodeStage;
+    friend class CompressStage;
+    friend class FrameStage;
+
+    void reset() {
+        bytes_.assign(HEADROOM, '\0');
+        head_ = HEADROOM;
+        records_ = 0;
+    }
+
+    char* prepend(size_t n) {
+        if (n > head_) {
+            return nullptr;
+        }
+        head_ -= n;
+        return &bytes_[head_];
+    }
+
+    std::string bytes_;
+    size_t head_ = HEADROOM;
+    uint32_t records_ = 0;
+};
+
+/**
+ * Fixed set of buffers reserved once and handed between stages
+ */
+class BufferPool {
+public:
+    void init(size_t count, size_t bytes);
+    PipelineBuffer* acquire();          // nullptr when all are out
+    void release(PipelineBuffer* buffer);
+
+private:
+    std::vector<std::unique_ptr<PipelineBuffer>> buffers_;
+    std::vector<PipelineBuffer*> free_;
+};
+
+/**
+ * Filter: keeps every Nth sample, at most one per min_interval_ms
+ */
+class DecimateStage {
+public:
+    void configure(const PipelineConfig& config);
+    bool accept(uint64_t now_us);
+
+private:
+    uint32_t every_ = 1;
+    uint64_t min_interval_us_ = 0;
+    uint32_t count_ = 0;
+    uint64_t last_kept_us_ = 0;
+    bool kept_any_ = false;
+};
+
+/**
+ * Aggregate: decides when an open batch is complete
+ */
+class AggregateStage {
+public:
+    void configure(const PipelineConfig& config);
+    bool complete(const PipelineBuffer& batch, size_t last_record_bytes, uint64_t age_us) const;
+    bool expired(uint64_t age_us) const { return age_us_ != 0 && age_us >= age_us_; }
+
+private:
+    uint32_t records_ = 1;
+    size_t bytes_ = 0;
+    uint64_t age_us_ = 0;
+};
+
+/**
+ * Encode: serializes records straight into the batch buffer
+ */
+class EncodeStage {
+public:
+    bool configure(const std::string& format, PipelineConfig::Layout layout, std::string& error);
+    void begin(PipelineBuffer& batch);
+    bool append(const output::BMSSnapshot& data, PipelineBuffer& batch);
+    void end(PipelineBuffer& batch);
+    BMSSerializer* serializer() const { return serializer_.get(); }
+
+private:
+    std::unique_ptr<BMSSerializer> serializer_;
+    PipelineConfig::Layout layout_ = PipelineConfig::Layout::LINES;
+};
+
+/**
+ * Compress: LZ4 block format, so any LZ4 library decodes it
+ * (lz4.block.decompress in Python, LZ4_decompress_safe after the size prefix)
+ */
+class CompressStage {
+public:
+    void configure(PipelineConfig::Compression compression);
+    bool enabled() const { return compression_ != PipelineConfig::Compression::NONE; }
+    static size_t bound(size_t raw_bytes);
+    bool compress(const PipelineBuffer& in, PipelineBuffer& out);
+
+private:
+    static constexpr int HASH_BITS = 10;     // 4 KB match table
+    PipelineConfig::Compression compression_ = PipelineConfig::Compression::NONE;
+    std::vector<uint32_t> table_;
+};
+
+/**
+ * Frame: marks payload boundaries for the transport
+ */
+class FrameStage {
+public:
+    void configure(PipelineConfig::Framing framing) { framing_ = framing; }
+    PipelineConfig::Framing framing() const { return framing_; }
+    bool frame(PipelineBuffer& payload);
+
+private:
+    PipelineConfig::Framing framing_ = PipelineConfig::Framing::NONE;
+};
+
+/**
+ * Filter -> aggregate -> encode -> compress -> frame -> transport
+ *
+ * Shared by the MQTT, HTTP, TCP, UDP and SD sinks in place of their own
+ * serializer. A sample goes through the filter, is encoded straight into the
+ * open batch buffer and, once the batch is complete, compressed into the
+ * second pool buffer and framed in its headroom before the sink's transport
+ * gets it. Nothing is copied between stages and nothing is allocated per
+ * sample once the buffers have grown to the largest payload.
+ *
+ * Drop accounting: a filtered sample is not a drop (see Stats::filtered); a
+ * held sample counts as accepted, and a batch the transport rejects charges
+ * every record in it to the reason the transport gives.
+ */
+class SinkPipeline {
+public:
+    /**
+     * Sink transport for one payload
+     * @param reason set to why the payload was lost when returning false
+     */
+    using Transport = std::function<bool(const PipelineBuffer& payload, DropReason& reason)>;
+
+    struct Stats {
+        uint32_t offered = 0;
+        uint32_t filtered = 0;          // dropped on purpose by the filter stage
+        uint32_t payloads = 0;          // handed to the transport
+        uint32_t records = 0;           // in payloads the transport accepted
+        uint32_t failed_payloads = 0;
+        uint64_t encoded_bytes = 0;     // before compression and framing
+        uint64_t wire_bytes = 0;        // as handed to the transport
+        uint32_t max_payload_bytes = 0;
+    };
+
+    /**
+     * Build the stages
+     * @param owner sink charged with drops
+     * @param default_format used when config.format is empty
+     * @param default_framing used when config.framing is DEFAULT
+     */
+    bool configure(LogSink* owner, const PipelineConfig& config, const std::string& default_format,
+                   PipelineConfig::Framing default_framing, std::string& error);
+
+    /**
+     * Offer a sample
+     * @return false if the sample (and any batch it closed) was lost
+     */
+    bool push(const output::BMSSnapshot& data, const Transport& transport);
+
+    /**
+     * Send a partly filled batch now (shutdown, forced flush)
+     * @return true if nothing was held or it was delivered
+     */
+    bool flush(const Transport& transport);
+
+    /**
+     * Discard a held batch without counting it
+     */
+    void reset();
+
+    bool isConfigured() const { return encode_.serializer() != nullptr; }
+    BMSSerializer* serializer() const { return encode_.serializer(); }
+    const PipelineConfig& config() const { return config_; }
+    const Stats& getStats() const { return stats_; }
+    uint32_t heldRecords() const { return batch_ ? batch_->records() : 0; }
+
+    // Text records with no binary framing: stream and file headers make sense
+    bool isText() const;
+
+    // MIME type of a payload
+    std::string getContentType() const;
+
+    // Short stage summary, e.g. "every=5 batch=10 csv lz4 length"
+    std::string describe() const;
+
+private:
+    bool emit(const Transport& transport);
+
+    LogSink* owner_ = nullptr;
+    PipelineConfig config_;
+    BufferPool pool_;
+    DecimateStage decimate_;
+    AggregateStage aggregate_;
+    EncodeStage encode_;
+    CompressStage compress_;
+    FrameStage frame_;
+
+    PipelineBuffer* batch_ = nullptr;   // open batch, from pool_
+    uint64_t batch_opened_us_ = 0;
+    Stats stats_;
+};
+
+const char* framingToString(PipelineConfig::Framing framing);
+
+} // namespace logging
+
+#endif // SINK_PIPELINE_H
@@ -1,36 +1,50 @@
 #include "tcp_log_sink.h"
-#include <tuple>
-#include <iostream>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <algorithm>
 
-// ESP-IDF / POSIX includes
+// ESP-IDF / POSIX includes (lwIP provides the BSD socket API)
 #include <esp_log.h>
-#include <esp_netif.h>
+#include <esp_timer.h>
+#include <cJSON.h>
 #include <errno.h>
-#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
 
 using namespace logging;
 
+static const char* TAG = "TCPLogSink";
+
 TCPLogSink::TCPLogSink() :
-    serializer_(nullptr),
     socket_fd_(-1),
+    server_addr_(0),
     initialized_(false),
     mode_(Mode::CLIENT),
-    is_connected_(false),
-    last_attempt_ms_(0),
-    total_bytes_sent_(0),
-    connections_count_(0),
-    reconnections_count_(0)
+    state_(ConnState::IDLE),
+    state_since_us_(0),
+    next_attempt_us_(0),
+    ring_head_(0),
+    queued_bytes_(0),
+    front_sent_(0),
+    last_record_us_(0),
+    record_gap_us_(0)
 {
     setLastError("");
 }
 
 TCPLogSink::~TCPLogSink() {
     shutdown();
-    // For now, we're not allocating dest_addr_ so we don't need to delete it
 }
 
 bool TCPLogSink::init(const std::string& config) {
@@ -39,56 +53,93 @@ bool TCPLogSink::init(const std::string& config) {
         return false;
     }
 
-    // Create serializer
-    serializer_ = logging::BMSSerializer::createSerializer(config_.format);
-    if (!serializer_) {
-        setLastError("Failed to create serializer for format: " + config_.format);
-        return false;
-    }
-
     mode_ = config_.mode;
+    if (mode_ == Mode::SERVER) {
+        return listen();
+    }
 
-    // Create socket
-    if (!createSocket()) {
+    struct in_addr addr;
+    if (inet_pton(AF_INET, config_.host.c_str(), &addr) != 1) {
+        setLastError("Invalid server address: " + config_.host);
         return false;
     }
+    server_addr_ = addr.s_addr;
 
-    if (mode_ == Mode::CLIENT) {
-        // For now, we'll just return false since we're not implementing TCP sockets
-        setLastError("TCP client mode not implemented for ESP-IDF");
+    // Default pipeline: one newline-terminated record per payload
+    if (!configurePipeline(PipelineConfig())) {
         return false;
-    } else { // SERVER mode
-        return listen();
     }
 
+    config_.ring_bytes = std::max<size_t>(config_.ring_bytes, 1024);
+    config_.segment_bytes = std::min(std::max<size_t>(config_.segment_bytes, 64), config_.ring_bytes);
+    ring_.assign(config_.ring_bytes, 0);
+    ring_head_ = 0;
+    queued_bytes_ = 0;
+    records_.clear();
+    front_sent_ = 0;
     initialized_ = true;
+
+    // An unreachable server is not an init failure: records queue while it retries
+    ESP_LOGI(TAG, "Streaming to %s:%d (%s, %u byte ring, %u byte segments, %d ms budget)",
+             config_.host.c_str(), config_.port, config_.format.c_str(), (unsigned)config_.ring_bytes,
+             (unsigned)config_.segment_bytes, config_.coalesce_ms);
+    startConnect(esp_timer_get_time());
     return true;
 }
 
 bool TCPLogSink::send(const output::BMSSnapshot& data) {
     if (!initialized_ || !isReady()) {
+        recordDrop(DropReason::NOT_READY);
         return false;
     }
-
-    std::string serialized;
-    if (!serializer_->serialize(data, serialized)) {
-        setLastError("Failed to serialize data");
+    if (state_ == ConnState::IDLE && !config_.auto_reconnect) {
+        setLastError("Not connected");
+        recordDrop(DropReason::NOT_READY);
         return false;
     }
 
-    bool success = false;
+    const int64_t now_us = esp_timer_get_time();
+    if (last_record_us_ != 0) {
+        record_gap_us_ = now_us - last_record_us_;
+    }
+    last_record_us_ = now_us;
 
-    // For now, we'll just return false since we're not implementing TCP sockets
-    setLastError("TCP socket not implemented for ESP-IDF");
-    return false;
+    if (!pipeline_.push(data, [this, now_us](const PipelineBuffer& payload, DropReason& reason) {
+            return enqueue(payload, now_us, reason);
+        })) {
+        return false;
+    }
+    service(now_us);
+    return true;
 }
 
-void TCPLogSink::shutdown() {
-    // Close client sockets
-    // For now, we're not managing any client sockets
+bool TCPLogSink::configurePipeline(const PipelineConfig& config) {
+    std::string error;
+    if (!pipeline_.configure(this, config, config_.format, PipelineConfig::Framing::LINES, error)) {
+        setLastError(error);
+        return false;
+    }
+    ESP_LOGI(TAG, "Pipeline: %s", pipeline_.describe().c_str());
+    return true;
+}
 
+void TCPLogSink::shutdown() {
+    if (initialized_) {
+        // A partly filled batch joins the ring for the final flush
+        const int64_t now_us = esp_timer_get_time();
+        pipeline_.flush([this, now_us](const PipelineBuffer& payload, DropReason& reason) {
+            return enqueue(payload, now_us, reason);
+        });
+    }
+    if (state_ == ConnState::CONNECTED) {
+        flush();
+    }
     closeSocket();
-    serializer_.reset();
+    state_ = ConnState::IDLE;
+    ring_.clear();
+    records_.clear();
+    queued_bytes_ = 0;
+    front_sent_ = 0;
     initialized_ = false;
 }
 
@@ -97,105 +148,391 @@ const char* TCPLogSink::getName() const {
 }
 
 bool TCPLogSink::isReady() const {
-    return initialized_ && socket_fd_ >= 0;
+    // Records are accepted into the ring while a connection is being set up
+    return initialized_ && mode_ == Mode::CLIENT;
+}
+
+void TCPLogSink::onNetworkResume() {
+    // The link is back: skip the rest of the reconnect interval
+    if (state_ == ConnState::IDLE && config_.auto_reconnect) {
+        next_attempt_us_ = esp_timer_get_time();
+    }
 }
 
 bool TCPLogSink::connect() {
-    if (is_connected_) {
-        return true;
+    if (!initialized_) {
+        return false;
     }
+    const int64_t now_us = esp_timer_get_time();
+    if (state_ == ConnState::IDLE) {
+        startConnect(now_us);
+    } else if (state_ == ConnState::CONNECTING) {
+        checkConnect(now_us);
+    }
+    return state_ == ConnState::CONNECTED;
+}
 
-    // For now, we'll just return false since we're not implementing TCP sockets
-    setLastError("TCP connect not implemented for ESP-IDF");
+bool TCPLogSink::listen() {
+    setLastError("TCP server mode not implemented");
     return false;
 }
 
-bool TCPLogSink::listen() {
-    if (socket_fd_ < 0) {
-        if (!createSocket()) {
-            return false;
+bool TCPLogSink::reconnect() {
+    if (!initialized_) {
+        return false;
+    }
+    if (state_ != ConnState::IDLE) {
+        dropConnection(esp_timer_get_time(), "reconnect requested");
+    }
+    return connect();
+}
+
+bool TCPLogSink::flush() {
+    if (state_ == ConnState::CONNECTED && queued_bytes_ > 0) {
+        writeRing(queued_bytes_);
+    }
+    return queued_bytes_ == 0;
+}
+
+void TCPLogSink::service(int64_t now_us) {
+    if (state_ == ConnState::IDLE) {
+        if (!config_.auto_reconnect || now_us < next_attempt_us_) {
+            return;
         }
+        startConnect(now_us);
+    } else if (state_ == ConnState::CONNECTING) {
+        checkConnect(now_us);
+    } else if (peerClosed()) {
+        dropConnection(now_us, "closed by server");
+    }
+    if (state_ != ConnState::CONNECTED || queued_bytes_ == 0) {
+        return;
+    }
+
+    // Whole segments go out at once; the remainder waits for more records
+    // unless holding it would blow the latency budget
+    size_t bytes = queued_bytes_;
+    if (!flushDue(now_us)) {
+        bytes -= bytes % config_.segment_bytes;
+    }
+    if (bytes > 0) {
+        writeRing(bytes);
+    }
+}
+
+bool TCPLogSink::startConnect(int64_t now_us) {
+    state_since_us_ = now_us;
+    if (!createSocket()) {
+        stats_.connect_failures++;
+        next_attempt_us_ = now_us + (int64_t)config_.reconnect_interval_ms * 1000;
+        return false;
     }
 
-    // For now, we'll just return false since we're not implementing TCP sockets
-    setLastError("TCP listen not implemented for ESP-IDF");
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)config_.port);
+    addr.sin_addr.s_addr = server_addr_;
+    if (::connect(socket_fd_, reinterpret_cast<const struct sockaddr*>(&addr), sizeof(addr)) == 0) {
+        state_ = ConnState::CONNECTING;
+        checkConnect(now_us);
+        return state_ == ConnState::CONNECTED;
+    }
+    if (errno != EINPROGRESS) {
+        setLastError(std::string("connect failed: ") + strerror(errno));
+        closeSocket();
+        stats_.connect_failures++;
+        next_attempt_us_ = now_us + (int64_t)config_.reconnect_interval_ms * 1000;
+        return false;
+    }
+    state_ = ConnState::CONNECTING;
     return false;
 }
 
-bool TCPLogSink::parseConfig(const std::string& config_str) {
-    std::string config = config_str + ",";  // Sentinel
+void TCPLogSink::checkConnect(int64_t now_us) {
+    // Writable once the handshake finished, successfully or not
+    fd_set wfds;
+    FD_ZERO(&wfds);
+    FD_SET(socket_fd_, &wfds);
+    struct timeval tv = { 0, 0 };
+    const int ready = select(socket_fd_ + 1, nullptr, &wfds, nullptr, &tv);
+    if (ready == 0) {
+        if (now_us - state_since_us_ >= (int64_t)config_.connect_timeout_ms * 1000) {
+            setLastError("connect timed out");
+            dropConnection(now_us, "connect timed out");
+        }
+        return;
+    }
 
-    size_t start = 0;
-    size_t pos = config.find('=');
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (ready < 0 || getsockopt(socket_fd_, SOL_SOCKET, SO_ERROR, &err, &len) < 0) {
+        err = errno;
+    }
+    if (err != 0) {
+        setLastError(std::string("connect failed: ") + strerror(err));
+        dropConnection(now_us, "connect failed");
+        return;
+    }
 
-    while (pos != std::string::npos) {
-        size_t next_comma = config.find(',', pos);
-        size_t prev_comma = config.rfind(',', pos-1);
+    state_ = ConnState::CONNECTED;
+    state_since_us_ = now_us;
+    stats_.connects++;
+    stats_.last_connect_us = now_us;
+    if (stats_.disconnects > 0) {
+        ESP_LOGI(TAG, "Reconnected to %s:%d after %lld ms, %u bytes queued", config_.host.c_str(), config_.port,
+                 (long long)((now_us - stats_.last_disconnect_us) / 1000), (unsigned)queued_bytes_);
+    } else {
+        ESP_LOGI(TAG, "Connected to %s:%d", config_.host.c_str(), config_.port);
+    }
+    if (!sendHeader()) {
+        dropConnection(now_us, "header write failed");
+    }
+}
 
-        std::string key = config.substr(prev_comma+1, pos-prev_comma-1);
-        std::string value = config.substr(pos+1, next_comma-pos-1);
+bool TCPLogSink::peerClosed() {
+    // The collector never sends; EOF or a reset is the only thing to read
+    char buf[64];
+    const ssize_t n = recv(socket_fd_, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n == 0) {
+        return true;
+    }
+    return n < 0 && errno != EAGAIN && errno != EWOULDBLOCK;
+}
 
-        auto first_non_space = key.find_first_not_of(" \t\r\n");
-        auto last_non_space = key.find_last_not_of(" \t\r\n");
-        if (first_non_space != std::string::npos) {
-          key = key.substr(first_non_space, last_non_space - first_non_space + 1);
-        }
+void TCPLogSink::dropConnection(int64_t now_us, const char* reason) {
+    const bool was_connected = state_ == ConnState::CONNECTED;
+    closeSocket();
+    state_ = ConnState::IDLE;
+    state_since_us_ = now_us;
+    next_attempt_us_ = now_us + (int64_t)config_.reconnect_interval_ms * 1000;
+
+    if (was_connected) {
+        stats_.disconnects++;
+        stats_.last_disconnect_us = now_us;
+        ESP_LOGW(TAG, "Connection to %s:%d lost (%s), %u bytes queued", config_.host.c_str(), config_.port,
+                 reason, (unsigned)queued_bytes_);
+    } else {
+        stats_.connect_failures++;
+        ESP_LOGD(TAG, "Connect to %s:%d failed (%s)", config_.host.c_str(), config_.port, reason);
+    }
+
+    // The rest of a half-written payload would start the next stream mid-frame
+    if (front_sent_ > 0 && !records_.empty()) {
+        const size_t rest = records_.front().len - front_sent_;
+        ring_head_ = (ring_head_ + rest) % ring_.size();
+        queued_bytes_ -= rest;
+        recordDrops(DropReason::TRANSPORT, records_.front().records);
+        records_.pop_front();
+        front_sent_ = 0;
+    }
+}
+
+bool TCPLogSink::sendHeader() {
+    // No text header in front of a binary stream
+    if (!pipeline_.isText() || !pipeline_.serializer()->hasHeader()) {
+        return true;
+    }
+    const std::string header = pipeline_.serializer()->getHeader();
+    if (header.empty()) {
+        return true;
+    }
+    // A fresh connection has an empty send buffer, so this does not block
+    const ssize_t sent = ::send(socket_fd_, header.data(), header.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent != (ssize_t)header.size()) {
+        setLastError(std::string("header write failed: ") + (sent < 0 ? strerror(errno) : "short write"));
+        return false;
+    }
+    stats_.bytes_sent += (size_t)sent;
+    stats_.writes++;
+    return true;
+}
 
-        first_non_space = value.find_first_not_of(" \t\r\n");
-        last_non_space = value.find_last_not_of(" \t\r\n");
-        if (first_non_space != std::string::npos) {
-            value = value.substr(first_non_space, last_non_space - first_non_space + 1);
+bool TCPLogSink::enqueue(const PipelineBuffer& payload, int64_t now_us, DropReason& reason) {
+    const size_t len = payload.size();
+    if (len > ring_.size()) {
+        setLastError("Payload larger than the send ring");
+        reason = DropReason::OVERSIZE;
+        return false;
+    }
+    if (queued_bytes_ + len > ring_.size()) {
+        // Make room first if the socket takes anything
+        service(now_us);
+    }
+    if (queued_bytes_ + len > ring_.size()) {
+        setLastError("Send ring full");
+        reason = DropReason::QUEUE_FULL;
+        return false;
+    }
+
+    const size_t tail = (ring_head_ + queued_bytes_) % ring_.size();
+    const size_t first = std::min(len, ring_.size() - tail);
+    memcpy(&ring_[tail], payload.data(), first);
+    if (first < len) {
+        memcpy(&ring_[0], payload.data() + first, len - first);
+    }
+    queued_bytes_ += len;
+    records_.push_back({ (uint32_t)len, payload.records(), now_us });
+    if (queued_bytes_ > stats_.max_queued_bytes) {
+        stats_.max_queued_bytes = (uint32_t)queued_bytes_;
+    }
+    return true;
+}
+
+size_t TCPLogSink::writeRing(size_t max_bytes) {
+    size_t written = 0;
+    while (written < max_bytes && state_ == ConnState::CONNECTED) {
+        // Up to two pieces when the queued bytes wrap around the end of the ring
+        const size_t want = max_bytes - written;
+        const size_t first = std::min(want, ring_.size() - ring_head_);
+        struct iovec iov[2];
+        iov[0].iov_base = &ring_[ring_head_];
+        iov[0].iov_len = first;
+        iov[1].iov_base = &ring_[0];
+        iov[1].iov_len = want - first;
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iov[1].iov_len > 0 ? 2 : 1;
+
+        const ssize_t sent = sendmsg(socket_fd_, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                setLastError(std::string("send failed: ") + strerror(errno));
+                dropConnection(esp_timer_get_time(), "send failed");
+            }
+            break;
+        }
+        if (sent == 0) {
+            break;
         }
 
-        if (!value.empty() && value.front() == '"' && value.back() == '"') {
-            value = value.substr(1, value.length()-2);
+        written += (size_t)sent;
+        ring_head_ = (ring_head_ + (size_t)sent) % ring_.size();
+        queued_bytes_ -= (size_t)sent;
+        stats_.bytes_sent += (size_t)sent;
+        stats_.writes++;
+
+        front_sent_ += (uint32_t)sent;
+        while (!records_.empty() && front_sent_ >= records_.front().len) {
+            front_sent_ -= records_.front().len;
+            stats_.records_sent += records_.front().records;
+            records_.pop_front();
         }
+    }
+    return written;
+}
+
+bool TCPLogSink::flushDue(int64_t now_us) const {
+    if (records_.empty()) {
+        return false;
+    }
+    if (config_.coalesce_ms <= 0) {
+        return true;
+    }
+    // Flush now if waiting for the next record would put the oldest one over budget
+    const int64_t deadline_us = records_.front().queued_us + (int64_t)config_.coalesce_ms * 1000;
+    return now_us + record_gap_us_ >= deadline_us;
+}
 
+bool TCPLogSink::parseConfig(const std::string& config_str) {
+    auto apply = [this](const std::string& key, const std::string& value) {
         if (key == "host") config_.host = value;
         else if (key == "port") config_.port = atoi(value.c_str());
         else if (key == "format") config_.format = value;
-        else if (key == "mode") {
-            if (value == "client") mode_ = Mode::CLIENT;
-            else if (value == "server") mode_ = Mode::SERVER;
-            else mode_ = Mode::CLIENT;
-        }
+        else if (key == "mode") config_.mode = (value == "server") ? Mode::SERVER : Mode::CLIENT;
         else if (key == "reconnect_interval_ms") config_.reconnect_interval_ms = atoi(value.c_str());
+        else if (key == "connect_timeout_ms") config_.connect_timeout_ms = atoi(value.c_str());
         else if (key == "auto_reconnect") config_.auto_reconnect = (value == "true");
         else if (key == "max_connections") config_.max_connections = atoi(value.c_str());
+        else if (key == "ring_bytes") config_.ring_bytes = (size_t)strtoul(value.c_str(), nullptr, 10);
+        else if (key == "segment_bytes") config_.segment_bytes = (size_t)strtoul(value.c_str(), nullptr, 10);
+        else if (key == "coalesce_ms") config_.coalesce_ms = atoi(value.c_str());
+        else if (key == "nodelay") config_.nodelay = (value == "true");
+    };
+
+    // JSON object from the "sinks" configuration
+    cJSON* json = cJSON_Parse(config_str.c_str());
+    if (json) {
+        cJSON* item = nullptr;
+        cJSON_ArrayForEach(item, json) {
+            if (!item->string) continue;
+            if (cJSON_IsString(item)) {
+                apply(item->string, item->valuestring);
+            } else if (cJSON_IsBool(item)) {
+                apply(item->string, cJSON_IsTrue(item) ? "true" : "false");
+            } else if (cJSON_IsNumber(item)) {
+                apply(item->string, std::to_string((long long)item->valuedouble));
+            }
+        }
+        cJSON_Delete(json);
+    } else {
+        // Key=value form: "host=192.168.1.100,port=3331,format=csv"
+        std::string config = config_str + ",";  // Sentinel
+
+        size_t start = 0;
+        size_t pos = config.find('=');
+
+        while (pos != std::string::npos) {
+            size_t next_comma = config.find(',', pos);
+            size_t prev_comma = config.rfind(',', pos-1);
+
+            std::string key = config.substr(prev_comma+1, pos-prev_comma-1);
+            std::string value = config.substr(pos+1, next_comma-pos-1);
+
+            auto first_non_space = key.find_first_not_of(" \t\r\n");
+            auto last_non_space = key.find_last_not_of(" \t\r\n");
+            if (first_non_space != std::string::npos) {
+              key = key.substr(first_non_space, last_non_space - first_non_space + 1);
+            }
+
+            first_non_space = value.find_first_not_of(" \t\r\n");
+            last_non_space = value.find_last_not_of(" \t\r\n");
+            if (first_non_space != std::string::npos) {
+                value = value.substr(first_non_space, last_non_space - first_non_space + 1);
+            }
+
+            if (!value.empty() && value.front() == '"' && value.back() == '"') {
+                value = value.substr(1, value.length()-2);
+            }
+
+            apply(key, value);
+
+            start = next_comma + 1;
+            pos = config.find('=', start);
+            if (next_comma+1 >= config.length()) break;
+        }
+    }
 
-        start = next_comma + 1;
-        pos = config.find('=', start);
-        if (next_comma+1 >= config.length()) break;
+    if (config_.port < 1 || config_.port > 65535) {
+        setLastError("Invalid port");
+        return false;
     }
     return true;
 }
 
 bool TCPLogSink::createSocket() {
-    // ESP-IDF doesn't have standard POSIX socket functions
-    // We'll need to use ESP-IDF specific APIs
-    setLastError("TCP socket not implemented for ESP-IDF");
-    return false;
-}
-
-void TCPLogSink::closeSocket() {
-    // Close socket
-    // For ESP-IDF, we would use appropriate APIs
-    socket_fd_ = -1;
-    is_connected_ = false;
-}
-
-void TCPLogSink::closeClient(int client_fd) {
-    // Close client socket
-    // For ESP-IDF, we would use appropriate APIs
-}
+    socket_fd_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (socket_fd_ < 0) {
+        setLastError(std::string("socket failed: ") + strerror(errno));
+        return false;
+    }
 
-bool TCPLogSink::handleClientConnection(int client_fd) {
-    // TODO: Implement client connection handling
+    const int flags = fcntl(socket_fd_, F_GETFL, 0);
+    if (flags < 0 || fcntl(socket_fd_, F_SETFL, flags | O_NONBLOCK) < 0) {
+        setLastError(std::string("fcntl failed: ") + strerror(errno));
+        closeSocket();
+        return false;
+    }
+    // The ring coalesces; Nagle would hold back the short tail of each flush
+    const int nodelay = config_.nodelay ? 1 : 0;
+    if (setsockopt(socket_fd_, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay)) < 0) {
+        ESP_LOGW(TAG, "TCP_NODELAY failed: %s", strerror(errno));
+    }
     return true;
 }
 
-bool TCPLogSink::sendToClient(int client_fd, const std::string& data) {
-    // For now, we'll just return false since we're not implementing TCP sockets
-    setLastError("TCP sendToClient not implemented for ESP-IDF");
-    return false;
+void TCPLogSink::closeSocket() {
+    if (socket_fd_ >= 0) {
+        close(socket_fd_);
+        socket_fd_ = -1;
+    }
 }
@@ -2,16 +2,35 @@
 #define TCP_LOG_SINK_H
 
 #include "log_sink.h"
-#include "log_serializers.h"
+#include "sink_pipeline.h"
+#include <stdint.h>
+#include <deque>
 #include <memory>
-#include <map>
+#include <vector>
 
 namespace logging {
 
 /**
- * TCP log sink for sending data to TCP servers
- * Supports both client and server (listening) modes
- * Handles connection management and reconnection
+ * TCP log sink streaming records to a collector (client mode)
+ *
+ * Every payload from the sink pipeline (by default one newline-terminated
+ * record) is appended to a send ring; a CSV header goes out first on every
+ * new connection unless the pipeline compresses or length-frames. The socket is
+ * non-blocking throughout: connect() is started and checked on later sends,
+ * a full socket buffer leaves the bytes in the ring, and a lost connection is
+ * retried every reconnect_interval_ms. Nothing on the poll path waits for the
+ * network.
+ *
+ * Small records are coalesced: the ring is written in whole segments and a
+ * partial segment is held back until its oldest record would miss the
+ * coalesce_ms latency budget at the next send (judged from the spacing of the
+ * last two records). TCP_NODELAY is set because the ring already does the
+ * batching; Nagle would only delay the final short segment of a flush by an
+ * ACK round trip. lwIP has no TCP_CORK, so corking happens in the ring.
+ *
+ * Payloads still queued when a connection drops are sent on the next one; a
+ * payload cut off mid-write is dropped so the stream stays frame-aligned.
+ * Server mode is not implemented.
  */
 class TCPLogSink : public LogSink {
 public:
@@ -20,6 +39,18 @@ public:
         SERVER       // Listen for incoming connections
     };
 
+    struct Stats {
+        size_t bytes_sent = 0;
+        size_t records_sent = 0;      // records completely handed to the socket
+        size_t writes = 0;            // sendmsg() calls that moved data
+        size_t connects = 0;          // connections established
+        size_t connect_failures = 0;  // refused or timed out attempts
+        size_t disconnects = 0;       // established connections lost
+        uint32_t max_queued_bytes = 0;
+        int64_t last_connect_us = 0;
+        int64_t last_disconnect_us = 0;
+    };
+
     TCPLogSink();
     ~TCPLogSink() override;
 
@@ -28,15 +59,45 @@ public:
     void shutdown() override;
     const char* getName() const override;
     bool isReady() const override;
+    bool requiresNetwork() const override { return true; }
+    void onNetworkResume() override;
+    SinkPriority getPriority() const override { return SinkPriority::CRITICAL; }
+    uint32_t getBudgetUs() const override { return 2000; }
+    bool configurePipeline(const PipelineConfig& config) override;
+    const SinkPipeline* getPipeline() const override { return &pipeline_; }
 
     // TCP-specific operations
     bool connect();
     bool listen();
     bool reconnect();
 
+    /**
+     * Write everything queued that the socket accepts, ignoring the budget
+     * @return true if the ring is empty afterwards
+     */
+    bool flush();
+
+    bool isConnected() const { return state_ == ConnState::CONNECTED; }
+    size_t queuedBytes() const { return queued_bytes_; }
+    const Stats& getStats() const { return stats_; }
+
 private:
-    std::unique_ptr<BMSSerializer> serializer_;
+    enum class ConnState {
+        IDLE,         // no socket; next attempt at next_attempt_us
+        CONNECTING,   // non-blocking connect in progress
+        CONNECTED
+    };
+
+    // Payload in the ring; the front one may be partly written
+    struct Queued {
+        uint32_t len;
+        uint32_t records;
+        int64_t queued_us;
+    };
+
+    SinkPipeline pipeline_;
     int socket_fd_;
+    uint32_t server_addr_;            // IPv4, network byte order
     bool initialized_;
     Mode mode_;
 
@@ -46,27 +107,46 @@ private:
         int port = 3331;
         std::string format = "json";
         int reconnect_interval_ms = 5000;
+        int connect_timeout_ms = 3000;
         bool auto_reconnect = true;
         Mode mode = Mode::CLIENT;
         int max_connections = 1;  // For server mode
+        size_t ring_bytes = 8192;      // send ring per connection
+        size_t segment_bytes = 1440;   // write unit; lwIP default MSS
+        int coalesce_ms = 5000;        // latency budget for a held-back record, 0 = write at once
+        bool nodelay = true;           // TCP_NODELAY
     } config_;
 
-    // State management
-    bool is_connected_;
-    uint32_t last_attempt_ms_;
+    // Connection state
+    ConnState state_;
+    int64_t state_since_us_;
+    int64_t next_attempt_us_;
+
+    // Send ring
+    std::vector<char> ring_;
+    size_t ring_head_;                // next byte to write to the socket
+    size_t queued_bytes_;
+    std::deque<Queued> records_;      // payloads, oldest first
+    uint32_t front_sent_;             // bytes of records_.front() already written
+    int64_t last_record_us_;
+    int64_t record_gap_us_;           // spacing of the last two records
 
     bool parseConfig(const std::string& config_str);
     bool createSocket();
     void closeSocket();
-    void closeClient(int client_fd);
 
-    bool handleClientConnection(int client_fd);
-    bool sendToClient(int client_fd, const std::string& data);
+    void service(int64_t now_us);
+    bool startConnect(int64_t now_us);
+    void checkConnect(int64_t now_us);
+    bool peerClosed();
+    void dropConnection(int64_t now_us, const char* reason);
+    bool sendHeader();
+
+    bool enqueue(const PipelineBuffer& payload, int64_t now_us, DropReason& reason);
+    size_t writeRing(size_t max_bytes);
+    bool flushDue(int64_t now_us) const;
 
-    // Stats
-    size_t total_bytes_sent_;
-    size_t connections_count_;
-    size_t reconnections_count_;
+    Stats stats_;
 };
 
 } // namespace logging
@@ -3,16 +3,23 @@
 #include <iostream>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
 
-// ESP-IDF / POSIX includes
+// ESP-IDF / POSIX includes (lwIP provides the BSD socket API)
 #include <esp_log.h>
-#include <esp_netif.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 
 using namespace logging;
 
+static const char* TAG = "UDPLogSink";
+
 UDPLogSink::UDPLogSink() :
-    serializer_(nullptr),
     socket_fd_(-1),
     dest_addr_(nullptr),
     initialized_(false),
@@ -21,13 +28,10 @@ UDPLogSink::UDPLogSink() :
     errors_(0)
 {
     setLastError("");
-    // For now, we'll just set dest_addr_ to nullptr
-    // In a real implementation, we'd need to allocate and initialize properly
 }
 
 UDPLogSink::~UDPLogSink() {
     shutdown();
-    // For now, we're not allocating dest_addr_ so we don't need to delete it
 }
 
 bool UDPLogSink::init(const std::string& config) {
@@ -36,9 +40,8 @@ bool UDPLogSink::init(const std::string& config) {
         return false;
     }
 
-    // Create serializer
-    serializer_ = logging::BMSSerializer::createSerializer(config_.format);
-    if (!serializer_) {
+    // Default pipeline: one record per datagram in the configured format
+    if (!configurePipeline(PipelineConfig())) {
         setLastError("Failed to create serializer for format: " + config_.format);
         return false;
     }
@@ -54,32 +57,77 @@ bool UDPLogSink::init(const std::string& config) {
 
 bool UDPLogSink::send(const output::BMSSnapshot& data) {
     if (!initialized_ || !isReady()) {
+        recordDrop(DropReason::NOT_READY);
         return false;
     }
 
-    std::string serialized;
-    if (!serializer_->serialize(data, serialized)) {
-        setLastError("Failed to serialize data");
-        errors_++;
+    return pipeline_.push(data, [this](const PipelineBuffer& payload, DropReason& reason) {
+        return sendPacket(payload, reason);
+    });
+}
+
+bool UDPLogSink::sendPacket(const PipelineBuffer& payload, DropReason& reason) {
+    if (!isReady()) {
+        reason = DropReason::NOT_READY;
         return false;
     }
 
     // Check packet size
-    if (serialized.length() > config_.max_packet_size) {
+    if (payload.size() > config_.max_packet_size) {
         setLastError("Data too large for UDP packet");
         errors_++;
+        reason = DropReason::OVERSIZE;
+        return false;
+    }
+
+    // Non-blocking: a full socket buffer drops this payload instead of stalling the poll loop
+    const ssize_t sent = sendto(socket_fd_, payload.data(), payload.size(), MSG_DONTWAIT,
+                                reinterpret_cast<const struct sockaddr*>(dest_addr_), sizeof(*dest_addr_));
+    if (sent < 0) {
+        const int err = errno;
+        setLastError(std::string("sendto failed: ") + strerror(err));
+        errors_++;
+        const bool full = err == EAGAIN || err == EWOULDBLOCK || err == ENOBUFS || err == ENOMEM;
+        reason = full ? DropReason::QUEUE_FULL : DropReason::TRANSPORT;
         return false;
     }
 
-    // For now, we'll just return false since we're not implementing UDP sockets
-    setLastError("UDP socket not implemented for ESP-IDF");
-    errors_++;
-    return false;
+    total_bytes_sent_ += (size_t)sent;
+    packets_sent_++;
+    return true;
+}
+
+bool UDPLogSink::configurePipeline(const PipelineConfig& config) {
+    // A batch closes before it outgrows a datagram. Compressed batches are
+    // capped so that even incompressible data fits, unless batch_bytes says
+    // how far to trust the ratio.
+    PipelineConfig packet_config = config;
+    if (packet_config.compression == PipelineConfig::Compression::NONE) {
+        if (packet_config.batch_bytes == 0 || packet_config.batch_bytes > config_.max_packet_size) {
+            packet_config.batch_bytes = config_.max_packet_size;
+        }
+    } else if (packet_config.batch_bytes == 0) {
+        size_t raw = config_.max_packet_size;
+        while (raw > 0 && 4 + CompressStage::bound(raw) > config_.max_packet_size) {
+            raw -= 16;
+        }
+        packet_config.batch_bytes = raw;
+    }
+
+    std::string error;
+    if (!pipeline_.configure(this, packet_config, config_.format, PipelineConfig::Framing::NONE, error)) {
+        setLastError(error);
+        return false;
+    }
+    ESP_LOGI(TAG, "Pipeline: %s", pipeline_.describe().c_str());
+    return true;
 }
 
 void UDPLogSink::shutdown() {
+    pipeline_.flush([this](const PipelineBuffer& payload, DropReason& reason) {
+        return sendPacket(payload, reason);
+    });
     closeSocket();
-    serializer_.reset();
     initialized_ = false;
 }
 
@@ -137,19 +185,51 @@ bool UDPLogSink::parseConfig(const std::string& config_str) {
 }
 
 bool UDPLogSink::createSocket() {
-    // ESP-IDF doesn't have standard POSIX socket functions
-    // We'll need to use ESP-IDF specific APIs
-    setLastError("UDP socket not implemented for ESP-IDF");
-    return false;
+    dest_addr_ = new sockaddr_in();
+    dest_addr_->sin_family = AF_INET;
+    dest_addr_->sin_port = htons((uint16_t)config_.port);
+    if (inet_pton(AF_INET, config_.ip.c_str(), &dest_addr_->sin_addr) != 1) {
+        setLastError("Invalid destination address: " + config_.ip);
+        closeSocket();
+        return false;
+    }
+
+    socket_fd_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (socket_fd_ < 0) {
+        setLastError(std::string("socket failed: ") + strerror(errno));
+        closeSocket();
+        return false;
+    }
+    if (!configureSocket()) {
+        closeSocket();
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Sending to %s:%d (%s)", config_.ip.c_str(), config_.port, config_.format.c_str());
+    return true;
 }
 
 bool UDPLogSink::configureSocket() {
-    // Set socket to non-blocking mode
-    // For ESP-IDF, we would use appropriate APIs
+    const int flags = fcntl(socket_fd_, F_GETFL, 0);
+    if (flags < 0 || fcntl(socket_fd_, F_SETFL, flags | O_NONBLOCK) < 0) {
+        setLastError(std::string("fcntl failed: ") + strerror(errno));
+        return false;
+    }
+    if (config_.broadcast) {
+        const int one = 1;
+        if (setsockopt(socket_fd_, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one)) < 0) {
+            setLastError(std::string("SO_BROADCAST failed: ") + strerror(errno));
+            return false;
+        }
+    }
     return true;
 }
 
 void UDPLogSink::closeSocket() {
-    // Close socket
-    // For ESP-IDF, we would use appropriate APIs
+    if (socket_fd_ >= 0) {
+        close(socket_fd_);
+        socket_fd_ = -1;
+    }
+    delete dest_addr_;
+    dest_addr_ = nullptr;
 }
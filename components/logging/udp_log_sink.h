@@ -2,7 +2,7 @@
 #define UDP_LOG_SINK_H
 
 #include "log_sink.h"
-#include "log_serializers.h"
+#include "sink_pipeline.h"
 #include <memory>
 
 struct sockaddr_in;
@@ -24,9 +24,14 @@ public:
     void shutdown() override;
     const char* getName() const override;
     bool isReady() const override;
+    bool requiresNetwork() const override { return true; }
+    SinkPriority getPriority() const override { return SinkPriority::CRITICAL; }
+    uint32_t getBudgetUs() const override { return 2000; }
+    bool configurePipeline(const PipelineConfig& config) override;
+    const SinkPipeline* getPipeline() const override { return &pipeline_; }
 
 private:
-    std::unique_ptr<BMSSerializer> serializer_;
+    SinkPipeline pipeline_;         // one datagram per payload
     int socket_fd_;
     struct sockaddr_in* dest_addr_;
     bool initialized_;
@@ -45,6 +50,7 @@ private:
     bool createSocket();
     bool configureSocket();
     void closeSocket();
+    bool sendPacket(const PipelineBuffer& payload, DropReason& reason);
 
     // Stats
     size_t total_bytes_sent_;
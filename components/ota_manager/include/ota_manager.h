@@ -52,13 +52,14 @@ typedef void (*ota_progress_callback_t)(ota_status_t status, int progress, const
 esp_err_t ota_manager_init(const ota_config_t* config, ota_progress_callback_t callback);
 
 /**
- * @brief Load OTA configuration from SPIFFS
+ * @brief Load OTA configuration from the config store
+ * 
+ * The store imports /spiffs/ota_config.txt once; see config_store.h
  * 
- * @param config_path Path to configuration file
  * @param config Output configuration structure
- * @return ESP_OK on success
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no OTA config was imported
  */
-esp_err_t ota_manager_load_config(const char* config_path, ota_config_t* config);
+esp_err_t ota_manager_config_from_store(ota_config_t* config);
 
 /**
  * @brief Check for available firmware updates
@@ -6,8 +6,8 @@
 #include <esp_http_client.h>
 #include <esp_app_format.h>
 #include <esp_image_format.h>
-#include <esp_spiffs.h>
 #include <cJSON.h>
+#include "config_store.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
@@ -65,82 +65,27 @@ esp_err_t ota_manager_init(const ota_config_t* config, ota_progress_callback_t c
     return ESP_OK;
 }
 
-esp_err_t ota_manager_load_config(const char* config_path, ota_config_t* config)
+esp_err_t ota_manager_config_from_store(ota_config_t* config)
 {
-    if (!config_path || !config) {
+    if (!config) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    FILE *file = fopen(config_path, "r");
-    if (!file) {
-        ESP_LOGE(TAG, "Failed to open OTA config file: %s", config_path);
+    const bms_config_t* cfg = config_store_get();
+    if (!(cfg->sections & CONFIG_SECTION_OTA)) {
+        ESP_LOGE(TAG, "No OTA configuration (ota_config.txt was not imported)");
         return ESP_ERR_NOT_FOUND;
     }
 
-    // Read file content
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    char *json_string = malloc(file_size + 1);
-    if (!json_string) {
-        fclose(file);
-        return ESP_ERR_NO_MEM;
-    }
-
-    size_t read_size = fread(json_string, 1, file_size, file);
-    json_string[read_size] = '\0';
-    fclose(file);
-
-    // Parse JSON
-    cJSON *json = cJSON_Parse(json_string);
-    free(json_string);
-
-    if (!json) {
-        ESP_LOGE(TAG, "Failed to parse OTA config JSON");
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    // Extract configuration values
-    cJSON *server_url = cJSON_GetObjectItem(json, "server_url");
-    cJSON *cert_pem = cJSON_GetObjectItem(json, "cert_pem");
-    cJSON *skip_cert = cJSON_GetObjectItem(json, "skip_cert_verification");
-    cJSON *timeout = cJSON_GetObjectItem(json, "timeout_ms");
-    cJSON *version = cJSON_GetObjectItem(json, "current_version");
-    cJSON *auto_rollback = cJSON_GetObjectItem(json, "auto_rollback_enabled");
-
-    // Set default values
     memset(config, 0, sizeof(ota_config_t));
-    config->timeout_ms = 30000;
-    config->auto_rollback_enabled = true;
-    strcpy(config->current_version, "1.0.0");
-
-    if (cJSON_IsString(server_url)) {
-        strncpy(config->server_url, server_url->valuestring, sizeof(config->server_url) - 1);
-    }
-
-    if (cJSON_IsString(cert_pem)) {
-        strncpy(config->cert_pem, cert_pem->valuestring, sizeof(config->cert_pem) - 1);
-    }
-
-    if (cJSON_IsBool(skip_cert)) {
-        config->skip_cert_verification = cJSON_IsTrue(skip_cert);
-    }
-
-    if (cJSON_IsNumber(timeout)) {
-        config->timeout_ms = timeout->valueint;
-    }
-
-    if (cJSON_IsString(version)) {
-        strncpy(config->current_version, version->valuestring, sizeof(config->current_version) - 1);
-    }
-
-    if (cJSON_IsBool(auto_rollback)) {
-        config->auto_rollback_enabled = cJSON_IsTrue(auto_rollback);
-    }
-
-    cJSON_Delete(json);
-    ESP_LOGI(TAG, "OTA configuration loaded from %s", config_path);
+    strncpy(config->server_url, cfg->ota.server_url, sizeof(config->server_url) - 1);
+    strncpy(config->cert_pem, cfg->ota.cert_pem, sizeof(config->cert_pem) - 1);
+    config->skip_cert_verification = cfg->ota.skip_cert_verification;
+    config->timeout_ms = cfg->ota.timeout_ms;
+    strncpy(config->current_version, cfg->ota.current_version, sizeof(config->current_version) - 1);
+    config->auto_rollback_enabled = cfg->ota.auto_rollback_enabled;
+
+    ESP_LOGI(TAG, "OTA configuration loaded from config store");
     return ESP_OK;
 }
 
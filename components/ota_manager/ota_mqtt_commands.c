@@ -2,6 +2,7 @@
 #include "ota_mqtt_config.h"
 #include "ota_manager.h"
 #include "ota_status_logger.h"
+#include "config_store.h"
 #include <esp_log.h>
 #include <mqtt_client.h>
 #include <cJSON.h>
@@ -29,7 +30,7 @@ static ota_mqtt_config_t g_cmd_mqtt_config = {
 
 // Forward declarations
 static void ota_cmd_mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
-static bool load_mqtt_config_from_spiffs(void);
+static bool load_mqtt_config_from_store(void);
 static void handle_ota_command(const char* payload, int payload_len);
 static void ota_update_task(void *pvParameter);
 
@@ -45,8 +46,8 @@ esp_err_t ota_mqtt_commands_init(const char* command_topic)
         g_ota_cmd_topic[sizeof(g_ota_cmd_topic) - 1] = '\0';
     }
 
-    // Load MQTT configuration from existing MQTT config file
-    if (!load_mqtt_config_from_spiffs()) {
+    // Load MQTT configuration shared with the telemetry sink
+    if (!load_mqtt_config_from_store()) {
         ESP_LOGW(TAG, "Failed to load MQTT config, using defaults");
     }
 
@@ -167,74 +168,29 @@ static void ota_cmd_mqtt_event_handler(void *handler_args, esp_event_base_t base
     }
 }
 
-static bool load_mqtt_config_from_spiffs(void)
+static bool load_mqtt_config_from_store(void)
 {
-    FILE *file = fopen("/spiffs/mqtt_config.txt", "r");
-    if (!file) {
-        ESP_LOGD(TAG, "MQTT config file not found, using defaults");
+    const bms_config_t* cfg = config_store_get();
+    if (!(cfg->sections & CONFIG_SECTION_MQTT)) {
+        ESP_LOGD(TAG, "No MQTT configuration imported, using defaults");
         return false;
     }
 
-    char line[256];
+    const bms_mqtt_settings_t* mqtt = &cfg->mqtt;
     bool config_loaded = false;
-
-    while (fgets(line, sizeof(line), file)) {
-        // Remove newline
-        line[strcspn(line, "\n")] = 0;
-        line[strcspn(line, "\r")] = 0;
-
-        // Skip comments and empty lines
-        if (line[0] == '#' || line[0] == '\0') {
-            continue;
-        }
-
-        char* eq_pos = strchr(line, '=');
-        if (eq_pos) {
-            *eq_pos = '\0'; // Split string
-            char* key = line;
-            char* value = eq_pos + 1;
-
-            // Trim whitespace
-            while (*key && (*key == ' ' || *key == '\t')) key++;
-            char* key_end = key + strlen(key) - 1;
-            while (key_end > key && (*key_end == ' ' || *key_end == '\t')) key_end--;
-            *(key_end + 1) = '\0';
-
-            while (*value && (*value == ' ' || *value == '\t')) value++;
-            char* value_end = value + strlen(value) - 1;
-            while (value_end > value && (*value_end == ' ' || *value_end == '\t')) value_end--;
-            *(value_end + 1) = '\0';
-
-            // Parse configuration values
-            if (strcmp(key, "host") == 0) {
-                strncpy(g_cmd_mqtt_config.broker_host, value, sizeof(g_cmd_mqtt_config.broker_host) - 1);
-                g_cmd_mqtt_config.broker_host[sizeof(g_cmd_mqtt_config.broker_host) - 1] = '\0';
-                config_loaded = true;
-            }
-            else if (strcmp(key, "port") == 0) {
-                int port = atoi(value);
-                if (port > 0 && port <= 65535) {
-                    g_cmd_mqtt_config.broker_port = port;
-                }
-            }
-            else if (strcmp(key, "username") == 0) {
-                strncpy(g_cmd_mqtt_config.username, value, sizeof(g_cmd_mqtt_config.username) - 1);
-                g_cmd_mqtt_config.username[sizeof(g_cmd_mqtt_config.username) - 1] = '\0';
-            }
-            else if (strcmp(key, "password") == 0) {
-                strncpy(g_cmd_mqtt_config.password, value, sizeof(g_cmd_mqtt_config.password) - 1);
-                g_cmd_mqtt_config.password[sizeof(g_cmd_mqtt_config.password) - 1] = '\0';
-            }
-            else if (strcmp(key, "qos") == 0) {
-                int qos = atoi(value);
-                if (qos >= 0 && qos <= 2) {
-                    g_cmd_mqtt_config.qos = qos;
-                }
-            }
-        }
+    if (mqtt->host[0] != '\0') {
+        strncpy(g_cmd_mqtt_config.broker_host, mqtt->host, sizeof(g_cmd_mqtt_config.broker_host) - 1);
+        g_cmd_mqtt_config.broker_host[sizeof(g_cmd_mqtt_config.broker_host) - 1] = '\0';
+        config_loaded = true;
+    }
+    g_cmd_mqtt_config.broker_port = mqtt->port;
+    strncpy(g_cmd_mqtt_config.username, mqtt->username, sizeof(g_cmd_mqtt_config.username) - 1);
+    g_cmd_mqtt_config.username[sizeof(g_cmd_mqtt_config.username) - 1] = '\0';
+    strncpy(g_cmd_mqtt_config.password, mqtt->password, sizeof(g_cmd_mqtt_config.password) - 1);
+    g_cmd_mqtt_config.password[sizeof(g_cmd_mqtt_config.password) - 1] = '\0';
+    if (mqtt->qos >= 0) {
+        g_cmd_mqtt_config.qos = mqtt->qos;
     }
-
-    fclose(file);
 
     if (config_loaded) {
         ESP_LOGI(TAG, "MQTT configuration loaded for OTA commands: %s:%d",
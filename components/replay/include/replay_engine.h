@@ -0,0 +1,94 @@
+#ifndef REPLAY_ENGINE_H
+#define REPLAY_ENGINE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include "bms_snapshot.h"
+#include "replay_source.h"
+
+namespace replay {
+
+/**
+ * Feeds recorded snapshots through a chain of pipeline stages
+ *
+ * Stages are plain callbacks (analytics updates, LogManager::send, ...) so the
+ * same engine drives the on-device pipeline and the host build. Every stage,
+ * and the source parse itself, is timed individually.
+ */
+class ReplayEngine {
+public:
+    ReplayEngine();
+
+    using Stage = std::function<void(output::BMSSnapshot& data)>;
+    using Clock = int64_t (*)();
+
+    struct Options {
+        bool realtime = false;        // pace records by their recorded timestamps
+        float speed = 1.0f;           // realtime multiplier (2.0 = twice as fast)
+        uint32_t loops = 1;           // replay the source this many times
+        uint64_t max_samples = 0;     // stop after this many samples (0 = no limit)
+    };
+
+    struct StageStats {
+        std::string name;
+        uint64_t calls = 0;
+        uint64_t total_us = 0;
+        uint32_t max_us = 0;
+    };
+
+    struct Report {
+        uint64_t samples = 0;
+        size_t parse_errors = 0;
+        uint64_t wall_us = 0;
+        double samples_per_s = 0.0;
+        std::vector<StageStats> stages;   // "parse" first, then stages in order
+    };
+
+    /**
+     * Append a stage; stages run in registration order for every sample
+     */
+    void addStage(const std::string& name, Stage stage);
+
+    /**
+     * Clock used for stage timing and realtime pacing (default esp_timer_get_time)
+     * Host harnesses that virtualize esp_timer pass a real clock here.
+     */
+    void setClock(Clock clock);
+
+    /**
+     * Replay the whole source (honouring options) and return timing
+     */
+    Report run(ReplaySource& source, const Options& options);
+
+    /**
+     * Request a running replay to stop after the current sample
+     */
+    void stop() { stop_requested_ = true; }
+
+    /**
+     * Human-readable report: throughput plus avg/max per stage
+     */
+    static std::string formatReport(const Report& report);
+
+    /**
+     * Compact JSON report for diagnostics:
+     * {"samples":..,"parse_errors":..,"wall_ms":..,"samples_per_s":..,"stages":[{"name":..,"avg_us":..,"max_us":..}]}
+     */
+    static std::string reportToJson(const Report& report);
+
+private:
+    struct NamedStage {
+        std::string name;
+        Stage fn;
+    };
+
+    std::vector<NamedStage> stages_;
+    Clock clock_;
+    volatile bool stop_requested_ = false;
+};
+
+} // namespace replay
+
+#endif // REPLAY_ENGINE_H
@@ -0,0 +1,100 @@
+#ifndef REPLAY_SOURCE_H
+#define REPLAY_SOURCE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <memory>
+#include <vector>
+#include "bms_snapshot.h"
+
+namespace replay {
+
+/**
+ * Source of recorded BMSSnapshots
+ */
+class ReplaySource {
+public:
+    virtual ~ReplaySource() = default;
+
+    virtual bool open(const std::string& path) = 0;
+
+    /**
+     * Read the next record
+     * @param out snapshot to fill (reset first)
+     * @return false at end of input
+     */
+    virtual bool next(output::BMSSnapshot& out) = 0;
+
+    /**
+     * Rewind to the first record (for looped replays)
+     */
+    virtual bool rewind() = 0;
+
+    virtual void close() = 0;
+
+    /**
+     * Records that could not be parsed and were skipped
+     */
+    virtual size_t getErrorCount() const = 0;
+
+    const std::string& getLastError() const { return last_error_; }
+
+    /**
+     * Create a source for a captured log, chosen by file extension
+     * Only CSV (.csv/.txt, as written by the SD card sink) is supported.
+     * @return source, or nullptr for unsupported formats
+     */
+    static std::unique_ptr<ReplaySource> create(const std::string& path);
+
+protected:
+    std::string last_error_;
+};
+
+/**
+ * Reader for CSV logs produced by the CSV serializer (SD card, serial capture)
+ *
+ * Columns are mapped by header name, so files from older firmware with fewer
+ * columns still load. The header lists every cell_v_N/temp_c_N column, but a
+ * row carries only cell_count cells then temp_count temperatures, so those
+ * and the named columns after them are placed by the row's counts.
+ * Header lines repeated mid-file (one per rotated file
+ * concatenated together) are detected and re-mapped. A file without a header
+ * is read with the current serializer's column order.
+ */
+class CsvReplaySource : public ReplaySource {
+public:
+    CsvReplaySource();
+    ~CsvReplaySource() override;
+
+    bool open(const std::string& path) override;
+    bool next(output::BMSSnapshot& out) override;
+    bool rewind() override;
+    void close() override;
+    size_t getErrorCount() const override { return errors_; }
+
+    /**
+     * Parse one data line with the current column map (exposed for tests/tools)
+     */
+    bool parseLine(char* line, output::BMSSnapshot& out);
+
+    /**
+     * Build the column map from a header line
+     */
+    void mapHeader(const char* header);
+
+    static constexpr size_t MAX_LINE = 2048;
+
+private:
+    FILE* file_;
+    char* line_buf_;
+    size_t errors_;
+    std::vector<uint8_t> columns_;    // Field of each column before the groups
+    std::vector<uint8_t> trailing_;   // Field of each column after the groups
+    int header_cells_ = 0;
+    int header_temps_ = 0;
+};
+
+} // namespace replay
+
+#endif // REPLAY_SOURCE_H
@@ -0,0 +1,147 @@
+#include "replay_engine.h"
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+#include <esp_timer.h>
+
+namespace replay {
+
+static int64_t defaultClock() {
+    return esp_timer_get_time();
+}
+
+ReplayEngine::ReplayEngine()
+    : clock_(defaultClock)
+{
+}
+
+void ReplayEngine::setClock(Clock clock) {
+    clock_ = clock ? clock : defaultClock;
+}
+
+void ReplayEngine::addStage(const std::string& name, Stage stage) {
+    stages_.push_back({ name, std::move(stage) });
+}
+
+static inline void account(ReplayEngine::StageStats& stats, uint64_t elapsed_us) {
+    stats.calls++;
+    stats.total_us += elapsed_us;
+    if (elapsed_us > stats.max_us) {
+        stats.max_us = (uint32_t)elapsed_us;
+    }
+}
+
+ReplayEngine::Report ReplayEngine::run(ReplaySource& source, const Options& options) {
+    Report report;
+    report.stages.resize(stages_.size() + 1);
+    report.stages[0].name = "parse";
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        report.stages[i + 1].name = stages_[i].name;
+    }
+    stop_requested_ = false;
+
+    output::BMSSnapshot snapshot;
+    const uint64_t wall_start = clock_();
+
+    // Recorded time base: the first record maps to replay start, later loops continue after it
+    bool have_base = false;
+    time_t first_ts = 0;
+    uint64_t loop_offset_us = 0;
+    uint64_t last_rel_us = 0;
+
+    for (uint32_t loop = 0; loop < options.loops && !stop_requested_; ++loop) {
+        if (loop > 0) {
+            if (!source.rewind()) {
+                break;
+            }
+            loop_offset_us += last_rel_us + 1000000ULL;
+        }
+
+        for (;;) {
+            if (stop_requested_ || (options.max_samples && report.samples >= options.max_samples)) {
+                break;
+            }
+
+            uint64_t t0 = clock_();
+            const bool ok = source.next(snapshot);
+            account(report.stages[0], clock_() - t0);
+            if (!ok) {
+                break;
+            }
+
+            // Synthesize monotonic timing from the recorded timestamps
+            const time_t ts = snapshot.real_timestamp ? snapshot.real_timestamp : (time_t)snapshot.elapsed_sec;
+            if (!have_base) {
+                first_ts = ts;
+                have_base = true;
+            }
+            const uint64_t rel_us = ts >= first_ts ? (uint64_t)(ts - first_ts) * 1000000ULL : last_rel_us;
+            last_rel_us = rel_us;
+            snapshot.start_time_us = 0;
+            snapshot.now_time_us = loop_offset_us + rel_us;
+
+            if (options.realtime && options.speed > 0.0f) {
+                const uint64_t due_us = wall_start + (uint64_t)((double)snapshot.now_time_us / options.speed);
+                const uint64_t now_us = clock_();
+                if (due_us > now_us) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(due_us - now_us));
+                }
+            }
+
+            for (size_t i = 0; i < stages_.size(); ++i) {
+                t0 = clock_();
+                stages_[i].fn(snapshot);
+                account(report.stages[i + 1], clock_() - t0);
+            }
+            report.samples++;
+        }
+    }
+
+    report.wall_us = clock_() - wall_start;
+    report.parse_errors = source.getErrorCount();
+    report.samples_per_s = report.wall_us ? (double)report.samples * 1e6 / (double)report.wall_us : 0.0;
+    return report;
+}
+
+std::string ReplayEngine::formatReport(const Report& report) {
+    char line[160];
+    std::string out;
+    snprintf(line, sizeof(line), "replay: %llu samples in %.3f s (%.0f samples/s), %u parse errors\n",
+             (unsigned long long)report.samples, (double)report.wall_us / 1e6,
+             report.samples_per_s, (unsigned)report.parse_errors);
+    out += line;
+    snprintf(line, sizeof(line), "  %-16s %10s %10s %10s %7s\n", "stage", "calls", "avg_us", "max_us", "share");
+    out += line;
+
+    uint64_t total = 0;
+    for (const auto& stage : report.stages) {
+        total += stage.total_us;
+    }
+    for (const auto& stage : report.stages) {
+        const double avg = stage.calls ? (double)stage.total_us / (double)stage.calls : 0.0;
+        const double share = total ? 100.0 * (double)stage.total_us / (double)total : 0.0;
+        snprintf(line, sizeof(line), "  %-16s %10llu %10.1f %10u %6.1f%%\n", stage.name.c_str(),
+                 (unsigned long long)stage.calls, avg, (unsigned)stage.max_us, share);
+        out += line;
+    }
+    return out;
+}
+
+std::string ReplayEngine::reportToJson(const Report& report) {
+    char buf[160];
+    snprintf(buf, sizeof(buf), "{\"samples\":%llu,\"parse_errors\":%u,\"wall_ms\":%llu,\"samples_per_s\":%.0f,\"stages\":[",
+             (unsigned long long)report.samples, (unsigned)report.parse_errors,
+             (unsigned long long)(report.wall_us / 1000), report.samples_per_s);
+    std::string json = buf;
+    for (size_t i = 0; i < report.stages.size(); ++i) {
+        const StageStats& stage = report.stages[i];
+        const double avg = stage.calls ? (double)stage.total_us / (double)stage.calls : 0.0;
+        snprintf(buf, sizeof(buf), "%s{\"name\":\"%s\",\"avg_us\":%.1f,\"max_us\":%u}", i ? "," : "",
+                 stage.name.c_str(), avg, (unsigned)stage.max_us);
+        json += buf;
+    }
+    json += "]}";
+    return json;
+}
+
+} // namespace replay
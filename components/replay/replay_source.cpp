@@ -0,0 +1,282 @@
+#include "replay_source.h"
+#include "log_serializers.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+namespace replay {
+
+namespace {
+
+enum Field : uint8_t {
+    F_IGNORE = 0,
+    F_DEVICE_ID,
+    F_TIMESTAMP,
+    F_ELAPSED_SEC,
+    F_ENERGY_WH,
+    F_PACK_V,
+    F_PACK_I,
+    F_SOC,
+    F_POWER,
+    F_FULL_CAPACITY,
+    F_PEAK_I,
+    F_PEAK_P,
+    F_CELL_COUNT,
+    F_MIN_CELL_V,
+    F_MIN_CELL_NUM,
+    F_MAX_CELL_V,
+    F_MAX_CELL_NUM,
+    F_CELL_DELTA_V,
+    F_TEMP_COUNT,
+    F_MIN_TEMP,
+    F_MAX_TEMP,
+    F_CHARGING,
+    F_DISCHARGING,
+    F_BOOT_ID,
+    F_SEQ
+};
+
+struct NamedField {
+    const char* name;
+    Field field;
+};
+
+// Column names as written by the CSV serializer header
+constexpr NamedField NAMED_FIELDS[] = {
+    { "device_id", F_DEVICE_ID },
+    { "timestamp", F_TIMESTAMP },
+    { "elapsed_sec", F_ELAPSED_SEC },
+    { "total_energy_wh", F_ENERGY_WH },
+    { "pack_voltage_v", F_PACK_V },
+    { "pack_current_a", F_PACK_I },
+    { "soc_pct", F_SOC },
+    { "power_w", F_POWER },
+    { "full_capacity_ah", F_FULL_CAPACITY },
+    { "peak_current_a", F_PEAK_I },
+    { "peak_power_w", F_PEAK_P },
+    { "cell_count", F_CELL_COUNT },
+    { "min_cell_voltage_v", F_MIN_CELL_V },
+    { "min_cell_num", F_MIN_CELL_NUM },
+    { "max_cell_voltage_v", F_MAX_CELL_V },
+    { "max_cell_num", F_MAX_CELL_NUM },
+    { "cell_voltage_delta_v", F_CELL_DELTA_V },
+    { "temp_count", F_TEMP_COUNT },
+    { "min_temp_c", F_MIN_TEMP },
+    { "max_temp_c", F_MAX_TEMP },
+    { "charging_enabled", F_CHARGING },
+    { "discharging_enabled", F_DISCHARGING },
+    { "boot_id", F_BOOT_ID },
+    { "seq", F_SEQ },
+};
+
+void applyField(Field f, const char* v, output::BMSSnapshot& out) {
+    switch (f) {
+        case F_DEVICE_ID:
+            strncpy(out.device_id, v, sizeof(out.device_id) - 1);
+            break;
+        case F_TIMESTAMP: out.real_timestamp = (time_t)strtoll(v, nullptr, 10); break;
+        case F_ELAPSED_SEC: out.elapsed_sec = (unsigned)strtoul(v, nullptr, 10); break;
+        case F_ENERGY_WH: out.total_energy_wh = strtod(v, nullptr); break;
+        case F_PACK_V: out.pack_voltage_v = strtof(v, nullptr); break;
+        case F_PACK_I: out.pack_current_a = strtof(v, nullptr); break;
+        case F_SOC: out.soc_pct = strtof(v, nullptr); break;
+        case F_POWER: out.power_w = strtof(v, nullptr); break;
+        case F_FULL_CAPACITY: out.full_capacity_ah = strtof(v, nullptr); break;
+        case F_PEAK_I: out.peak_current_a = strtof(v, nullptr); break;
+        case F_PEAK_P: out.peak_power_w = strtof(v, nullptr); break;
+        case F_CELL_COUNT: out.cell_count = atoi(v); break;
+        case F_MIN_CELL_V: out.min_cell_voltage_v = strtof(v, nullptr); break;
+        case F_MIN_CELL_NUM: out.min_cell_num = atoi(v); break;
+        case F_MAX_CELL_V: out.max_cell_voltage_v = strtof(v, nullptr); break;
+        case F_MAX_CELL_NUM: out.max_cell_num = atoi(v); break;
+        case F_CELL_DELTA_V: out.cell_voltage_delta_v = strtof(v, nullptr); break;
+        case F_TEMP_COUNT: out.temp_count = atoi(v); break;
+        case F_MIN_TEMP: out.min_temp_c = strtof(v, nullptr); break;
+        case F_MAX_TEMP: out.max_temp_c = strtof(v, nullptr); break;
+        case F_CHARGING: out.charging_enabled = atoi(v) != 0; break;
+        case F_DISCHARGING: out.discharging_enabled = atoi(v) != 0; break;
+        case F_BOOT_ID: out.boot_id = (uint32_t)strtoul(v, nullptr, 10); break;
+        case F_SEQ: out.seq = (uint32_t)strtoul(v, nullptr, 10); break;
+        default: break;
+    }
+}
+
+// Split in place on commas; empty fields are kept
+size_t splitFields(char* line, char** fields, size_t max_fields) {
+    size_t n = 0;
+    char* p = line;
+    while (n < max_fields) {
+        fields[n++] = p;
+        char* comma = strchr(p, ',');
+        if (!comma) {
+            break;
+        }
+        *comma = '\0';
+        p = comma + 1;
+    }
+    return n;
+}
+
+void trimEol(char* line) {
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+        line[--len] = '\0';
+    }
+}
+
+} // namespace
+
+std::unique_ptr<ReplaySource> ReplaySource::create(const std::string& path) {
+    const size_t dot = path.find_last_of('.');
+    const std::string ext = dot == std::string::npos ? "" : path.substr(dot + 1);
+    if (ext.empty() || strcasecmp(ext.c_str(), "csv") == 0 || strcasecmp(ext.c_str(), "txt") == 0) {
+        return std::unique_ptr<ReplaySource>(new CsvReplaySource());
+    }
+    // No binary capture format exists yet (SerializationFormat::BINARY is unimplemented)
+    return nullptr;
+}
+
+CsvReplaySource::CsvReplaySource()
+    : file_(nullptr)
+    , line_buf_(nullptr)
+    , errors_(0)
+{
+}
+
+CsvReplaySource::~CsvReplaySource() {
+    close();
+}
+
+bool CsvReplaySource::open(const std::string& path) {
+    close();
+    file_ = fopen(path.c_str(), "r");
+    if (!file_) {
+        last_error_ = "Cannot open " + path;
+        return false;
+    }
+    line_buf_ = static_cast<char*>(malloc(MAX_LINE));
+    if (!line_buf_) {
+        close();
+        last_error_ = "Out of memory";
+        return false;
+    }
+
+    // Default to the current serializer layout until a header says otherwise
+    std::unique_ptr<logging::BMSSerializer> csv = logging::BMSSerializer::createSerializer("csv");
+    mapHeader(csv ? csv->getHeader().c_str() : "");
+    errors_ = 0;
+    return true;
+}
+
+void CsvReplaySource::close() {
+    if (file_) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+    free(line_buf_);
+    line_buf_ = nullptr;
+}
+
+bool CsvReplaySource::rewind() {
+    if (!file_) {
+        return false;
+    }
+    ::rewind(file_);
+    return true;
+}
+
+void CsvReplaySource::mapHeader(const char* header) {
+    columns_.clear();
+    trailing_.clear();
+    header_cells_ = 0;
+    header_temps_ = 0;
+    std::string copy(header);
+    char* fields[128];
+    const size_t n = splitFields(&copy[0], fields, 128);
+    for (size_t i = 0; i < n; ++i) {
+        char* name = fields[i];
+        trimEol(name);
+        if (strncmp(name, "cell_v_", 7) == 0) {
+            header_cells_++;
+            continue;
+        }
+        if (strncmp(name, "temp_c_", 7) == 0) {
+            header_temps_++;
+            continue;
+        }
+        uint8_t col = F_IGNORE;
+        for (const auto& nf : NAMED_FIELDS) {
+            if (strcmp(name, nf.name) == 0) {
+                col = nf.field;
+                break;
+            }
+        }
+        // Named columns after the groups follow the packed values in each row
+        (header_cells_ || header_temps_ ? trailing_ : columns_).push_back(col);
+    }
+}
+
+bool CsvReplaySource::parseLine(char* line, output::BMSSnapshot& out) {
+    char* fields[128];
+    const size_t n = splitFields(line, fields, 128);
+    if (n < 2) {
+        return false;
+    }
+
+    out = output::BMSSnapshot{};
+    const size_t lead = n < columns_.size() ? n : columns_.size();
+    for (size_t i = 0; i < lead; ++i) {
+        applyField(static_cast<Field>(columns_[i]), fields[i], out);
+    }
+
+    // Rows carry only cell_count cells and temp_count temperatures, up to the
+    // header's group sizes, so the tail is placed by the row's own counts
+    int cells = out.cell_count < header_cells_ ? out.cell_count : header_cells_;
+    int temps = out.temp_count < header_temps_ ? out.temp_count : header_temps_;
+    if (cells < 0) cells = 0;
+    if (temps < 0) temps = 0;
+    size_t col = columns_.size();
+    if (n < col + (size_t)cells + (size_t)temps) {
+        return false;
+    }
+    for (int i = 0; i < cells; ++i, ++col) {
+        if (i < output::DEFAULT_MAX_CSV_CELLS) out.cell_v[static_cast<size_t>(i)] = strtof(fields[col], nullptr);
+    }
+    for (int i = 0; i < temps; ++i, ++col) {
+        if (i < output::DEFAULT_MAX_CSV_TEMPS) out.temp_c[static_cast<size_t>(i)] = strtof(fields[col], nullptr);
+    }
+    for (size_t i = 0; i < trailing_.size() && col < n; ++i, ++col) {
+        applyField(static_cast<Field>(trailing_[i]), fields[col], out);
+    }
+
+    out.cell_count = cells > output::DEFAULT_MAX_CSV_CELLS ? output::DEFAULT_MAX_CSV_CELLS : cells;
+    out.temp_count = temps > output::DEFAULT_MAX_CSV_TEMPS ? output::DEFAULT_MAX_CSV_TEMPS : temps;
+    out.hours = out.elapsed_sec / 3600;
+    out.minutes = (out.elapsed_sec % 3600) / 60;
+    out.seconds = out.elapsed_sec % 60;
+    return true;
+}
+
+bool CsvReplaySource::next(output::BMSSnapshot& out) {
+    if (!file_) {
+        return false;
+    }
+    while (fgets(line_buf_, MAX_LINE, file_)) {
+        trimEol(line_buf_);
+        if (line_buf_[0] == '\0' || line_buf_[0] == '#') {
+            continue;
+        }
+        if (strncmp(line_buf_, "device_id,", 10) == 0) {
+            // Header (first line, or the start of a concatenated rotated file)
+            mapHeader(line_buf_);
+            continue;
+        }
+        if (parseLine(line_buf_, out)) {
+            return true;
+        }
+        errors_++;
+    }
+    return false;
+}
+
+} // namespace replay
@@ -0,0 +1,107 @@
+#ifndef WEB_UI_H
+#define WEB_UI_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <esp_http_server.h>
+#include <esp_partition.h>
+#include "bms_snapshot.h"
+
+namespace web_ui {
+
+/**
+ * Local dashboard: static assets from the "www" flash partition plus a
+ * Server-Sent Events stream of the latest snapshot
+ *
+ * Assets are pre-gzipped by tools/web_ui/build_www.py and sent straight from
+ * the memory-mapped partition, so serving a file allocates nothing and never
+ * runs on the sampling task. publish() only copies the snapshot; formatting
+ * and sending happen on the HTTP server task into one fixed event buffer.
+ */
+class WebUi {
+public:
+    static constexpr int MAX_SSE_CLIENTS = 4;
+
+    struct Stats {
+        uint32_t assets = 0;          // files in the mapped bundle
+        uint32_t requests = 0;        // asset requests answered 200
+        uint32_t not_modified = 0;    // answered 304 from If-None-Match
+        uint32_t not_found = 0;
+        uint32_t sse_clients = 0;
+        uint32_t sse_rejected = 0;    // connects refused, all slots busy
+        uint32_t events_sent = 0;
+        uint32_t events_dropped = 0;  // failed sends; the client is closed
+    };
+
+    static WebUi& getInstance();
+
+    WebUi(const WebUi&) = delete;
+    WebUi& operator=(const WebUi&) = delete;
+
+    /**
+     * Map the www partition and start the HTTP server
+     * Without a valid bundle only /events is served.
+     */
+    bool start(uint16_t port = 80);
+
+    void stop();
+
+    /**
+     * Hand over the latest snapshot; cheap enough for the sampling loop
+     */
+    void publish(const output::BMSSnapshot& data);
+
+    Stats getStats() const;
+
+    /**
+     * {"assets":..,"requests":..,"not_modified":..,"not_found":..,"sse_clients":..,
+     *  "sse_rejected":..,"events_sent":..,"events_dropped":..}
+     */
+    void toJson(std::string& out) const;
+
+private:
+    WebUi() = default;
+
+    struct Entry;
+
+    const Entry* findAsset(const char* path) const;
+    bool mapBundle();
+    void pushLatest();
+    bool sendEvent(int fd);
+    int formatEvent();
+    void removeClient(int fd);
+
+    static esp_err_t handleAsset(httpd_req_t* req);
+    static esp_err_t handleEvents(httpd_req_t* req);
+    static void pushWork(void* arg);
+    static void onClose(httpd_handle_t server, int fd);
+
+    httpd_handle_t server_ = nullptr;
+    const uint8_t* bundle_ = nullptr;
+    const Entry* entries_ = nullptr;
+    uint32_t entry_count_ = 0;
+    esp_partition_mmap_handle_t mmap_handle_ = 0;
+
+    // Latest snapshot, written by publish() and read on the server task
+    std::mutex snapshot_mutex_;
+    output::BMSSnapshot latest_;
+    uint32_t latest_seq_ = 0;
+
+    // Server task only
+    output::BMSSnapshot work_;
+    uint32_t work_seq_ = 0;
+    char event_buf_[1024];
+    int event_len_ = 0;
+    int sse_fds_[MAX_SSE_CLIENTS] = { -1, -1, -1, -1 };
+
+    std::atomic<uint32_t> sse_count_{0};
+    std::atomic<bool> push_queued_{false};
+    mutable std::mutex stats_mutex_;
+    Stats stats_;
+};
+
+} // namespace web_ui
+
+#endif // WEB_UI_H
@@ -0,0 +1,405 @@
+#include "web_ui.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+
+static const char* TAG = "WebUi";
+
+namespace web_ui {
+
+/**
+ * Bundle layout written by tools/web_ui/build_www.py (little-endian):
+ * a 16-byte header, `count` entries sorted by path, then the gzip bodies.
+ * Offsets are from the start of the partition.
+ */
+struct BundleHeader {
+    char magic[4];      // "BWW1"
+    uint32_t count;
+    uint32_t data_size;
+    uint32_t reserved;
+};
+
+struct WebUi::Entry {
+    char path[64];
+    char content_type[32];
+    uint32_t offset;
+    uint32_t size;
+    uint32_t flags;
+    char etag[20];
+};
+
+static_assert(sizeof(BundleHeader) == 16, "bundle header layout");
+
+namespace {
+
+constexpr uint32_t FLAG_GZIP = 1u << 0;
+constexpr uint32_t FLAG_IMMUTABLE = 1u << 1;
+
+// Holds the connection open; events follow on the same socket
+const char SSE_HEADER[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+    "retry: 3000\n\n";
+
+bool terminated(const char* s, size_t size) {
+    return memchr(s, '\0', size) != nullptr;
+}
+
+} // namespace
+
+WebUi& WebUi::getInstance() {
+    static WebUi instance;
+    return instance;
+}
+
+bool WebUi::mapBundle() {
+    static_assert(sizeof(Entry) == 128, "bundle entry layout");
+
+    const esp_partition_t* part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           ESP_PARTITION_SUBTYPE_ANY, "www");
+    if (!part) {
+        ESP_LOGW(TAG, "No www partition, dashboard assets disabled");
+        return false;
+    }
+
+    const void* base = nullptr;
+    esp_err_t ret = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &base, &mmap_handle_);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map www partition: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(base);
+    BundleHeader hdr;
+    memcpy(&hdr, bytes, sizeof(hdr));
+    bool valid = memcmp(hdr.magic, "BWW1", 4) == 0 &&
+                 hdr.count <= (part->size - sizeof(hdr)) / sizeof(Entry);
+    const Entry* entries = reinterpret_cast<const Entry*>(bytes + sizeof(hdr));
+    for (uint32_t i = 0; valid && i < hdr.count; ++i) {
+        const Entry& e = entries[i];
+        valid = terminated(e.path, sizeof(e.path)) && terminated(e.content_type, sizeof(e.content_type)) &&
+                terminated(e.etag, sizeof(e.etag)) && e.offset <= part->size && e.size <= part->size - e.offset;
+    }
+    if (!valid) {
+        ESP_LOGW(TAG, "www partition holds no valid bundle (flash it with idf.py flash)");
+        esp_partition_munmap(mmap_handle_);
+        mmap_handle_ = 0;
+        return false;
+    }
+
+    bundle_ = bytes;
+    entries_ = entries;
+    entry_count_ = hdr.count;
+    ESP_LOGI(TAG, "Mapped %lu dashboard assets (%lu bytes)", (unsigned long)hdr.count,
+             (unsigned long)hdr.data_size);
+    return true;
+}
+
+const WebUi::Entry* WebUi::findAsset(const char* path) const {
+    uint32_t lo = 0;
+    uint32_t hi = entry_count_;
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        const int cmp = strcmp(entries_[mid].path, path);
+        if (cmp == 0) {
+            return &entries_[mid];
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return nullptr;
+}
+
+bool WebUi::start(uint16_t port) {
+    if (server_) {
+        return true;
+    }
+
+    mapBundle();
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = port;
+    // SSE clients plus a few asset fetches; the oldest idle socket is recycled
+    config.max_open_sockets = MAX_SSE_CLIENTS + 3;
+    config.lru_purge_enable = true;
+    config.uri_match_fn = httpd_uri_match_wildcard;
+    config.close_fn = onClose;
+    config.send_wait_timeout = 2;
+    // Same priority as the sampling loop so a busy client never preempts a poll
+    config.task_priority = tskIDLE_PRIORITY + 1;
+
+    esp_err_t ret = httpd_start(&server_, &config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start HTTP server: %s", esp_err_to_name(ret));
+        server_ = nullptr;
+        return false;
+    }
+
+    // Matched in registration order, so /events goes before the wildcard
+    const httpd_uri_t events = { .uri = "/events", .method = HTTP_GET, .handler = handleEvents, .user_ctx = nullptr };
+    const httpd_uri_t assets = { .uri = "/*", .method = HTTP_GET, .handler = handleAsset, .user_ctx = nullptr };
+    httpd_register_uri_handler(server_, &events);
+    httpd_register_uri_handler(server_, &assets);
+
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.assets = entry_count_;
+    }
+    ESP_LOGI(TAG, "Dashboard listening on port %u", port);
+    return true;
+}
+
+void WebUi::stop() {
+    if (server_) {
+        httpd_stop(server_);
+        server_ = nullptr;
+    }
+    for (int& fd : sse_fds_) {
+        fd = -1;
+    }
+    sse_count_.store(0);
+    if (bundle_) {
+        esp_partition_munmap(mmap_handle_);
+        bundle_ = nullptr;
+        entries_ = nullptr;
+        entry_count_ = 0;
+    }
+}
+
+void WebUi::publish(const output::BMSSnapshot& data) {
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+        latest_ = data;
+        latest_seq_++;
+    }
+    if (!server_ || sse_count_.load() == 0) {
+        return;
+    }
+    // One pending push at a time; it always sends the newest snapshot
+    if (!push_queued_.exchange(true)) {
+        if (httpd_queue_work(server_, pushWork, nullptr) != ESP_OK) {
+            push_queued_.store(false);
+        }
+    }
+}
+
+esp_err_t WebUi::handleAsset(httpd_req_t* req) {
+    WebUi& self = getInstance();
+
+    char path[64];
+    const size_t len = strcspn(req->uri, "?#");
+    if (len >= sizeof(path)) {
+        return httpd_resp_send_err(req, HTTPD_414_URI_TOO_LONG, nullptr);
+    }
+    memcpy(path, req->uri, len);
+    path[len] = '\0';
+    if (strcmp(path, "/") == 0) {
+        strcpy(path, "/index.html");
+    }
+
+    const Entry* e = self.bundle_ ? self.findAsset(path) : nullptr;
+    if (!e) {
+        std::lock_guard<std::mutex> lock(self.stats_mutex_);
+        self.stats_.not_found++;
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, nullptr);
+    }
+
+    httpd_resp_set_hdr(req, "ETag", e->etag);
+    httpd_resp_set_hdr(req, "Cache-Control",
+                       (e->flags & FLAG_IMMUTABLE) ? "public, max-age=31536000, immutable" : "no-cache");
+
+    char if_none_match[sizeof(e->etag)];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        strcmp(if_none_match, e->etag) == 0) {
+        {
+            std::lock_guard<std::mutex> lock(self.stats_mutex_);
+            self.stats_.not_modified++;
+        }
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, nullptr, 0);
+    }
+
+    httpd_resp_set_type(req, e->content_type);
+    if (e->flags & FLAG_GZIP) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    }
+    {
+        std::lock_guard<std::mutex> lock(self.stats_mutex_);
+        self.stats_.requests++;
+    }
+    // Straight from the flash mapping, no copy
+    return httpd_resp_send(req, reinterpret_cast<const char*>(self.bundle_ + e->offset), e->size);
+}
+
+esp_err_t WebUi::handleEvents(httpd_req_t* req) {
+    WebUi& self = getInstance();
+    const int fd = httpd_req_to_sockfd(req);
+
+    int slot = -1;
+    for (int i = 0; i < MAX_SSE_CLIENTS; ++i) {
+        if (self.sse_fds_[i] == fd) {
+            slot = i;
+            break;
+        }
+        if (slot < 0 && self.sse_fds_[i] < 0) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        {
+            std::lock_guard<std::mutex> lock(self.stats_mutex_);
+            self.stats_.sse_rejected++;
+        }
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "10");
+        return httpd_resp_send(req, "too many dashboard clients", HTTPD_RESP_USE_STRLEN);
+    }
+
+    if (httpd_send(req, SSE_HEADER, sizeof(SSE_HEADER) - 1) < 0) {
+        return ESP_FAIL;
+    }
+    if (self.sse_fds_[slot] != fd) {
+        self.sse_fds_[slot] = fd;
+        self.sse_count_.fetch_add(1);
+    }
+
+    // Current state right away instead of waiting for the next poll
+    if (self.formatEvent() > 0) {
+        self.sendEvent(fd);
+    }
+    ESP_LOGI(TAG, "Dashboard client connected (fd %d, %lu open)", fd, (unsigned long)self.sse_count_.load());
+    return ESP_OK;
+}
+
+void WebUi::pushWork(void* arg) {
+    (void)arg;
+    getInstance().pushLatest();
+}
+
+void WebUi::pushLatest() {
+    push_queued_.store(false);
+    if (formatEvent() <= 0) {
+        return;
+    }
+    for (int i = 0; i < MAX_SSE_CLIENTS; ++i) {
+        if (sse_fds_[i] >= 0) {
+            sendEvent(sse_fds_[i]);
+        }
+    }
+}
+
+bool WebUi::sendEvent(int fd) {
+    const int sent = httpd_socket_send(server_, fd, event_buf_, event_len_, 0);
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    if (sent == event_len_) {
+        stats_.events_sent++;
+        return true;
+    }
+    // Dead or stalled client; onClose frees the slot
+    stats_.events_dropped++;
+    httpd_sess_trigger_close(server_, fd);
+    return false;
+}
+
+int WebUi::formatEvent() {
+    uint32_t seq;
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+        seq = latest_seq_;
+        if (seq != work_seq_) {
+            work_ = latest_;
+        }
+    }
+    if (seq == 0) {
+        return 0;  // nothing published yet
+    }
+    if (seq == work_seq_ && event_len_ > 0) {
+        return event_len_;
+    }
+    work_seq_ = seq;
+
+    const output::BMSSnapshot& s = work_;
+    char* p = event_buf_;
+    char* const end = event_buf_ + sizeof(event_buf_);
+    auto append = [&p, end](int n) {
+        p = (n < 0 || n >= end - p) ? end : p + n;
+    };
+
+    append(snprintf(p, end - p,
+        "id: %lu\ndata: {\"dev\":\"%s\",\"boot\":%lu,\"seq\":%lu,\"stale\":%s,\"t\":%lld,\"up\":%lu,\"v\":%.2f,\"i\":%.2f,\"p\":%.1f,"
+        "\"soc\":%.1f,\"soh\":%.1f,\"cap\":%.2f,\"wh\":%.1f,\"tte\":%ld,\"ttf\":%ld,"
+        "\"cmin\":%d,\"cmax\":%d,\"dv\":%.3f,\"chg\":%s,\"dsg\":%s,\"an\":%d,\"anc\":%d,\"cells\":[",
+        (unsigned long)seq, s.device_id, (unsigned long)s.boot_id, (unsigned long)s.seq,
+        s.stale ? "true" : "false",
+        (long long)s.real_timestamp, (unsigned long)s.elapsed_sec,
+        s.pack_voltage_v, s.pack_current_a, s.power_w, s.soc_pct, s.soh_pct, s.est_capacity_ah,
+        s.total_energy_wh, (long)s.time_to_empty_s, (long)s.time_to_full_s,
+        s.min_cell_num, s.max_cell_num, s.cell_voltage_delta_v,
+        s.charging_enabled ? "true" : "false", s.discharging_enabled ? "true" : "false",
+        (int)s.anomaly_level, s.anomaly_cell));
+
+    const int cells = s.cell_count < output::DEFAULT_MAX_CSV_CELLS ? s.cell_count : output::DEFAULT_MAX_CSV_CELLS;
+    for (int i = 0; i < cells; ++i) {
+        append(snprintf(p, end - p, i ? ",%.3f" : "%.3f", s.cell_v[static_cast<size_t>(i)]));
+    }
+    append(snprintf(p, end - p, "],\"temps\":["));
+    const int temps = s.temp_count < output::DEFAULT_MAX_CSV_TEMPS ? s.temp_count : output::DEFAULT_MAX_CSV_TEMPS;
+    for (int i = 0; i < temps; ++i) {
+        append(snprintf(p, end - p, i ? ",%.1f" : "%.1f", s.temp_c[static_cast<size_t>(i)]));
+    }
+    append(snprintf(p, end - p, "]}\n\n"));
+
+    if (p == end) {
+        ESP_LOGW(TAG, "Event larger than %u bytes, not sent", (unsigned)sizeof(event_buf_));
+        event_len_ = 0;
+        return 0;
+    }
+    event_len_ = static_cast<int>(p - event_buf_);
+    return event_len_;
+}
+
+void WebUi::removeClient(int fd) {
+    for (int& slot : sse_fds_) {
+        if (slot == fd) {
+            slot = -1;
+            sse_count_.fetch_sub(1);
+            ESP_LOGI(TAG, "Dashboard client closed (fd %d)", fd);
+        }
+    }
+}
+
+void WebUi::onClose(httpd_handle_t server, int fd) {
+    (void)server;
+    getInstance().removeClient(fd);
+    close(fd);
+}
+
+WebUi::Stats WebUi::getStats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    Stats stats = stats_;
+    stats.sse_clients = sse_count_.load();
+    return stats;
+}
+
+void WebUi::toJson(std::string& out) const {
+    const Stats s = getStats();
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "{\"assets\":%lu,\"requests\":%lu,\"not_modified\":%lu,\"not_found\":%lu,\"sse_clients\":%lu,"
+             "\"sse_rejected\":%lu,\"events_sent\":%lu,\"events_dropped\":%lu}",
+             (unsigned long)s.assets, (unsigned long)s.requests, (unsigned long)s.not_modified,
+             (unsigned long)s.not_found, (unsigned long)s.sse_clients, (unsigned long)s.sse_rejected,
+             (unsigned long)s.events_sent, (unsigned long)s.events_dropped);
+    out = buf;
+}
+
+} // namespace web_ui
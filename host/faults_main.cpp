@@ -0,0 +1,409 @@
+// Fault-injection harness: how long the sinks take to recover, and what it costs
+//
+//   bms_faults [options]
+//     --scenario <name>   run one scenario (default: all, in the order below)
+//     --fault-s <n>       fault duration for every scenario (default: per scenario)
+//     --settle-s <n>      healthy time before each fault (default 60)
+//     --recover-s <n>     give up on a sink this long after the fault clears (default 900)
+//     --interval-ms <n>   poll interval (default 1000)
+//     --link-detect-ms <n> time for the station to notice a lost link (default 6000)
+//     --dir <path>        SD card mount point (default ./faults_sd, emptied at start)
+//     --verbose           print ESP_LOGI output
+//
+// Scenarios:
+//   sd_removal      card pulled: stat/fopen/fwrite fail
+//   disk_full       card full: no free space, writes fail with ENOSPC
+//   broker_restart  MQTT broker down: session dropped, reconnects refused
+//   wifi_drop       WiFi lost: sockets fail, the station notices after the detect delay
+//   http_outage     HTTP endpoint unreachable: every request blocks for its timeout
+//
+// The sdcard, mqtt and http sinks run with the device's configuration under
+// LogManager on the virtual clock. Per scenario and sink the report gives the
+// time from the fault clearing to the first delivered sample, the samples
+// lost from the fault until then, how long LogManager::send() blocked the
+// poll loop and how long the idle slot spent on deferred sinks (including poll
+// ticks that were swallowed). Exits non-zero if a
+// sink affected by a fault had not recovered by the end of its window.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "connectivity.h"
+#include "fault_injection.h"
+#include "host_clock.h"
+#include "sim_bms.h"
+#include "sim_source.h"
+#include "log_manager.h"
+#include "mqtt_log_sink.h"
+#include "http_log_sink.h"
+#include "replay_engine.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Scenario {
+    const char* name;
+    fault_id_t fault;
+    uint32_t default_fault_s;
+};
+
+constexpr Scenario SCENARIOS[] = {
+    { "sd_removal", FAULT_SD_REMOVED, 180 },
+    { "disk_full", FAULT_SD_FULL, 180 },
+    { "broker_restart", FAULT_BROKER_DOWN, 30 },
+    { "wifi_drop", FAULT_LINK_DOWN, 60 },
+    { "http_outage", FAULT_HTTP_DOWN, 120 },
+};
+
+constexpr const char* SINKS[] = { "sdcard", "mqtt", "http" };
+constexpr size_t SINK_COUNT = sizeof(SINKS) / sizeof(SINKS[0]);
+
+// 2025-01-01T00:00:00Z, as in bms_soak
+constexpr time_t FAULTS_EPOCH = 1735689600;
+
+struct FaultOptions {
+    std::string scenario;
+    uint32_t fault_s = 0;
+    uint32_t settle_s = 60;
+    uint32_t recover_s = 900;
+    uint32_t interval_ms = 1000;
+    uint32_t link_detect_ms = 6000;
+    std::string dir = "faults_sd";
+};
+
+void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [--scenario name] [--fault-s n] [--settle-s n] [--recover-s n]\n"
+            "          [--interval-ms n] [--link-detect-ms n] [--dir path] [--verbose]\n"
+            "scenarios:", prog);
+    for (const auto& scenario : SCENARIOS) {
+        fprintf(stderr, " %s", scenario.name);
+    }
+    fputc('\n', stderr);
+}
+
+std::string deviceConfig(const std::string& dir) {
+    // Same sink settings as app_main; the HTTP sink is opt-in on the device
+    return "{\"sinks\":["
+           "{\"type\":\"mqtt\",\"config\":{\"format\":\"csv\",\"qos\":1}},"
+           "{\"type\":\"sdcard\",\"config\":{\"mount_point\":\"" + dir + "\",\"file_prefix\":\"bms_data\","
+           "\"buffer_size\":32768,\"flush_interval_ms\":120000,\"fsync_interval_ms\":60000,"
+           "\"max_lines_per_file\":10000,\"enable_free_space_check\":true,\"min_free_space_mb\":10}},"
+           "{\"type\":\"http\",\"config\":\"url=http://collector.local/ingest,format=json,timeout_ms=5000\"}"
+           "]}";
+}
+
+/**
+ * Drives the scenarios from inside the pipeline: raises and clears faults on
+ * the virtual clock and accounts every LogManager::send() per sink
+ */
+class FaultRunner {
+public:
+    struct SinkResult {
+        bool affected = false;
+        bool recovered = false;
+        int64_t ttr_us = -1;          // fault cleared -> first delivered sample
+        uint32_t offered = 0;         // samples polled while the sink was not yet recovered
+        uint32_t delivered = 0;       // deliveries since the fault, deferred ones included
+        uint32_t lost = 0;            // offered minus delivered (failed, skipped or paused)
+        uint32_t failures = 0;
+        uint32_t skipped = 0;
+        uint32_t paused = 0;
+    };
+
+    struct Result {
+        const Scenario* scenario = nullptr;
+        uint32_t fault_s = 0;
+        uint32_t fault_hits = 0;
+        SinkResult sinks[SINK_COUNT];
+        uint64_t sends = 0;
+        uint64_t blocked_us = 0;      // total time inside send() while faulted/recovering
+        uint64_t max_send_us = 0;
+        uint64_t idle_us = 0;         // time in the idle slot running deferred sinks
+        uint64_t max_idle_us = 0;
+        uint64_t missed_polls = 0;
+        double baseline_send_us = 0;  // average send() during the settle period
+    };
+
+    FaultRunner(const FaultOptions& options, std::vector<const Scenario*> scenarios,
+                host::SimSource& source, replay::ReplayEngine& engine)
+        : options_(options), scenarios_(std::move(scenarios)), source_(source), engine_(engine) {}
+
+    void send(output::BMSSnapshot& s) {
+        if (current_ >= scenarios_.size()) {
+            return;
+        }
+        const int64_t now = esp_timer_get_time();
+        if (phase_start_us_ == 0) {
+            startScenario(now);
+        }
+        advancePhase(now);
+
+        logging::LogManager& log = logging::LogManager::getInstance();
+        const int64_t t0 = esp_timer_get_time();
+        log.send(s);
+        const uint64_t send_us = (uint64_t)(esp_timer_get_time() - t0);
+
+        // Idle slot right after the fan-out, up to the next tick
+        const int64_t t1 = esp_timer_get_time();
+        log.runDeferred(options_.interval_ms * 1000);
+        const uint64_t idle_us = (uint64_t)(esp_timer_get_time() - t1);
+
+        Result& r = results_.back();
+        if (phase_ == Phase::SETTLE) {
+            settle_sends_++;
+            settle_send_us_ += send_us;
+        } else {
+            r.sends++;
+            r.blocked_us += send_us;
+            if (send_us > r.max_send_us) {
+                r.max_send_us = send_us;
+            }
+            r.idle_us += idle_us;
+            if (idle_us > r.max_idle_us) {
+                r.max_idle_us = idle_us;
+            }
+            account(r, esp_timer_get_time());
+        }
+        snapshotHealth();
+    }
+
+    const std::vector<Result>& results() const { return results_; }
+
+private:
+    enum class Phase { SETTLE, FAULT, RECOVER };
+
+    void startScenario(int64_t now) {
+        const Scenario* scenario = scenarios_[current_];
+        results_.emplace_back();
+        results_.back().scenario = scenario;
+        results_.back().fault_s = options_.fault_s ? options_.fault_s : scenario->default_fault_s;
+        phase_ = Phase::SETTLE;
+        phase_start_us_ = now;
+        settle_sends_ = 0;
+        settle_send_us_ = 0;
+        snapshotHealth();
+    }
+
+    void advancePhase(int64_t now) {
+        Result& r = results_.back();
+        if (phase_ == Phase::SETTLE && now - phase_start_us_ >= (int64_t)options_.settle_s * 1000000) {
+            r.baseline_send_us = settle_sends_ ? (double)settle_send_us_ / (double)settle_sends_ : 0.0;
+            fault_reset_counters();
+            missed_at_fault_ = source_.missedPolls();
+            fault_set(r.scenario->fault, true);
+            phase_ = Phase::FAULT;
+            phase_start_us_ = now;
+            fprintf(stderr, "[%s] fault raised for %u s\n", r.scenario->name, (unsigned)r.fault_s);
+        } else if (phase_ == Phase::FAULT && now - phase_start_us_ >= (int64_t)r.fault_s * 1000000) {
+            fault_set(r.scenario->fault, false);
+            r.fault_hits = fault_hits(r.scenario->fault);
+            phase_ = Phase::RECOVER;
+            phase_start_us_ = now;
+            cleared_us_ = now;
+        } else if (phase_ == Phase::RECOVER &&
+                   (allSettled(r) || now - phase_start_us_ >= (int64_t)options_.recover_s * 1000000)) {
+            finishScenario(r);
+        }
+    }
+
+    void finishScenario(Result& r) {
+        r.missed_polls = source_.missedPolls() - missed_at_fault_;
+        current_++;
+        phase_start_us_ = 0;
+        if (current_ >= scenarios_.size()) {
+            engine_.stop();
+        }
+    }
+
+    bool allSettled(const Result& r) const {
+        for (size_t i = 0; i < SINK_COUNT; ++i) {
+            if (r.sinks[i].affected && !r.sinks[i].recovered) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void account(Result& r, int64_t now) {
+        logging::LogManager& log = logging::LogManager::getInstance();
+        for (size_t i = 0; i < SINK_COUNT; ++i) {
+            SinkResult& sink = r.sinks[i];
+            logging::LogManager::SinkHealth health;
+            if (sink.recovered || !log.getSinkHealth(SINKS[i], health)) {
+                continue;
+            }
+            // A deferred sample is delivered in a later idle slot, so count
+            // deliveries rather than matching them to this sample
+            const uint32_t delivered = health.total_successes - last_[i].total_successes;
+            sink.delivered += delivered;
+            sink.failures += health.total_failures - last_[i].total_failures;
+            sink.skipped += health.skipped - last_[i].skipped;
+            sink.paused += health.paused - last_[i].paused;
+            sink.offered++;
+            sink.lost = sink.offered > sink.delivered ? sink.offered - sink.delivered : 0;
+            if (!delivered) {
+                sink.affected = true;
+            } else if (phase_ == Phase::RECOVER && sink.affected) {
+                sink.recovered = true;
+                sink.ttr_us = now - cleared_us_;
+            }
+        }
+    }
+
+    void snapshotHealth() {
+        logging::LogManager& log = logging::LogManager::getInstance();
+        for (size_t i = 0; i < SINK_COUNT; ++i) {
+            log.getSinkHealth(SINKS[i], last_[i]);
+        }
+    }
+
+    const FaultOptions& options_;
+    std::vector<const Scenario*> scenarios_;
+    host::SimSource& source_;
+    replay::ReplayEngine& engine_;
+
+    std::vector<Result> results_;
+    size_t current_ = 0;
+    Phase phase_ = Phase::SETTLE;
+    int64_t phase_start_us_ = 0;
+    int64_t cleared_us_ = 0;
+    uint64_t settle_sends_ = 0;
+    uint64_t settle_send_us_ = 0;
+    uint64_t missed_at_fault_ = 0;
+    logging::LogManager::SinkHealth last_[SINK_COUNT];
+};
+
+bool printResults(const std::vector<FaultRunner::Result>& results) {
+    bool ok = true;
+    fprintf(stderr, "\n%-16s %-7s %9s %8s %6s %6s %7s %6s\n",
+            "scenario", "sink", "ttr_s", "offered", "lost", "fails", "skipped", "paused");
+    for (const auto& r : results) {
+        for (size_t i = 0; i < SINK_COUNT; ++i) {
+            const FaultRunner::SinkResult& sink = r.sinks[i];
+            char ttr[16];
+            if (!sink.affected) {
+                snprintf(ttr, sizeof(ttr), "-");
+            } else if (sink.recovered) {
+                snprintf(ttr, sizeof(ttr), "%.1f", (double)sink.ttr_us / 1e6);
+            } else {
+                snprintf(ttr, sizeof(ttr), "NONE");
+                ok = false;
+            }
+            fprintf(stderr, "%-16s %-7s %9s %8u %6u %6u %7u %6u\n",
+                    i == 0 ? r.scenario->name : "", SINKS[i], ttr,
+                    (unsigned)sink.offered, (unsigned)sink.lost, (unsigned)sink.failures,
+                    (unsigned)sink.skipped, (unsigned)sink.paused);
+        }
+        fprintf(stderr, "  %u s fault, %u failed calls; send() blocked %.1f s (max %.0f ms, baseline %.1f ms), "
+                        "idle slot %.1f s (max %.0f ms), %llu poll ticks missed\n",
+                (unsigned)r.fault_s, (unsigned)r.fault_hits, (double)r.blocked_us / 1e6,
+                (double)r.max_send_us / 1e3, r.baseline_send_us / 1e3,
+                (double)r.idle_us / 1e6, (double)r.max_idle_us / 1e3,
+                (unsigned long long)r.missed_polls);
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    FaultOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--scenario") == 0 && has_value) {
+            options.scenario = argv[++i];
+        } else if (strcmp(arg, "--fault-s") == 0 && has_value) {
+            options.fault_s = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--settle-s") == 0 && has_value) {
+            options.settle_s = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--recover-s") == 0 && has_value) {
+            options.recover_s = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--interval-ms") == 0 && has_value) {
+            options.interval_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--link-detect-ms") == 0 && has_value) {
+            options.link_detect_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--dir") == 0 && has_value) {
+            options.dir = argv[++i];
+        } else if (strcmp(arg, "--verbose") == 0) {
+            host_log_level = ESP_LOG_INFO;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<const Scenario*> scenarios;
+    for (const auto& scenario : SCENARIOS) {
+        if (options.scenario.empty() || options.scenario == scenario.name) {
+            scenarios.push_back(&scenario);
+        }
+    }
+    if (scenarios.empty() || options.interval_ms == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (host_log_level < ESP_LOG_INFO) {
+        // Sinks log every failed write; the report is what matters here
+        host_log_level = ESP_LOG_NONE;
+    }
+
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    host_clock_set_virtual(FAULTS_EPOCH);
+    if (!host_clock_wall_is_virtual()) {
+        fprintf(stderr, "time() is not virtualized on this platform (needs -Wl,--wrap=time)\n");
+        return 2;
+    }
+
+    std::error_code ec;
+    fs::remove_all(options.dir, ec);
+    fault_set_sd_root(options.dir.c_str());
+    fault_set_link_detect_ms(options.link_detect_ms);
+    fault_track_link(true);
+    connectivity_init();
+
+    logging::LogManager& log = logging::LogManager::getInstance();
+    log.registerSink("mqtt", [](const std::string&) {
+        return std::unique_ptr<logging::LogSink>(new logging::MQTTLogSink());
+    });
+    log.registerSink("http", [](const std::string&) {
+        return std::unique_ptr<logging::LogSink>(new logging::HTTPLogSink());
+    });
+    if (!log.init(deviceConfig(options.dir))) {
+        fprintf(stderr, "Failed to start sinks\n");
+        return 1;
+    }
+
+    bms_interface_t* bms = sim_bms_create(NULL);
+    if (!bms) {
+        return 1;
+    }
+
+    host::SimSource source(bms, options.interval_ms, UINT64_MAX, "faults");
+    replay::ReplayEngine engine;
+    engine.setClock(host_clock_real_us);
+    FaultRunner runner(options, scenarios, source, engine);
+    engine.addStage("log_send", [&runner](output::BMSSnapshot& s) {
+        runner.send(s);
+    });
+
+    source.open("");
+    const replay::ReplayEngine::Report report = engine.run(source, replay::ReplayEngine::Options());
+    const std::string dispatch = log.getDispatchStatsJson();
+    log.shutdown();
+    sim_bms_destroy(bms);
+
+    fputs(replay::ReplayEngine::formatReport(report).c_str(), stderr);
+    const bool ok = printResults(runner.results());
+    fprintf(stderr, "dispatch: %s\n", dispatch.c_str());
+    fprintf(stderr, "faults %s\n", ok ? "PASSED" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,343 @@
+// Command-to-ack latency of the authenticated MOSFET control path
+//
+//   bms_fet_latency [options]
+//     --commands <n>      FET commands per mode (default 200)
+//     --interval-ms <n>   poll interval (default 1000)
+//     --read-ms <n>       UART time of one measurement read (default 120)
+//     --write-ms <n>      UART time of one FET write with read-back (default 40)
+//     --seed <n>          command arrival times (default 1)
+//     --verbose           print ESP_LOGI output
+//
+// One simulated monitor on the virtual clock: a sim_bms whose reads and FET
+// writes take the modeled UART time, the real MQTTLogSink subscribed to its
+// command topic on the in-process broker, and the poll loop of main.cpp.
+// Signed commands arrive at random points of the poll cycle through
+// mqtt_broker_deliver(); the broker hook catches the acks on <topic>/resp/fet
+// and the latency is from delivery to ack.
+//
+// Two schedules are measured:
+//   priority   the command wakes the poll task and takes the next free UART
+//              slot ahead of the routine read (what main.cpp does)
+//   poll-slot  the command waits for the next poll tick and runs after its read
+//
+// Afterwards a command with a bad MAC and a replayed counter must be refused.
+// Exits non-zero if an ack is missing, not applied or reports the wrong state.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <cJSON.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "device_shim.h"
+#include "host_clock.h"
+#include "mqtt_broker.h"
+#include "sim_bms.h"
+#include "command_router.h"
+#include "fet_control.h"
+#include "mqtt_log_sink.h"
+
+namespace {
+
+constexpr time_t FET_EPOCH = 1767225600;   // 2026-01-01 00:00:00 UTC
+constexpr const char* DEVICE_ID = "fet-0001";
+constexpr const char* FET_KEY = "host-harness-fet-key-0123";
+constexpr const char* TOPIC = "bms/telemetry/fet-0001";
+
+struct LatencyOptions {
+    uint32_t commands = 200;
+    uint32_t interval_ms = 1000;
+    uint32_t read_ms = 120;
+    uint32_t write_ms = 40;
+    uint32_t seed = 1;
+};
+
+// Simulated BMS with UART time on the virtual clock
+bms_interface_t* g_inner = nullptr;
+int64_t g_read_us = 0;
+int64_t g_write_us = 0;
+
+void uartBusy(int64_t us) {
+    // 1 ms steps so commands keep arriving while the UART is busy
+    while (us > 0) {
+        const int64_t step = us < 1000 ? us : 1000;
+        host_clock_sleep_us(step);
+        us -= step;
+    }
+}
+
+bool timedRead(void* handle) {
+    uartBusy(g_read_us);
+    return g_inner->readMeasurements(handle);
+}
+
+bool timedSetMosfet(void* handle, bool charge_on, bool discharge_on) {
+    uartBusy(g_write_us);
+    return g_inner->setMosfet(handle, charge_on, discharge_on);
+}
+
+struct Command {
+    int64_t deliver_us;
+    uint32_t ctr;
+    bool charge;
+    bool discharge;
+    std::string mac;
+};
+
+struct Ack {
+    int64_t at_us;
+    bool applied;
+    bool charge;
+    bool discharge;
+    std::string error;
+};
+
+// Delivery queue, sorted by time, and what came back
+std::vector<Command> g_commands;
+size_t g_next_command = 0;
+std::map<uint32_t, int64_t> g_delivered;
+std::map<uint32_t, Ack> g_acks;
+bool g_notified = false;
+
+void deliverDue() {
+    const int64_t now = esp_timer_get_time();
+    while (g_next_command < g_commands.size() && g_commands[g_next_command].deliver_us <= now) {
+        const Command& cmd = g_commands[g_next_command++];
+        char payload[160];
+        snprintf(payload, sizeof(payload), "{\"charge\":%s,\"discharge\":%s,\"ctr\":%lu,\"mac\":\"%s\"}",
+                 cmd.charge ? "true" : "false", cmd.discharge ? "true" : "false",
+                 (unsigned long)cmd.ctr, cmd.mac.c_str());
+        const std::string topic = std::string(TOPIC) + "/cmd/fet";
+        g_delivered[cmd.ctr] = now;
+        if (mqtt_broker_deliver(topic.c_str(), payload, (int)strlen(payload)) == 0) {
+            fprintf(stderr, "command %lu reached no subscriber\n", (unsigned long)cmd.ctr);
+        }
+    }
+}
+
+void onPublish(void*, esp_mqtt_client_handle_t, const char* topic, const char* data, int len, int) {
+    const std::string resp = std::string(TOPIC) + "/resp/fet";
+    if (resp != topic) {
+        return;
+    }
+    cJSON* root = cJSON_ParseWithLength(data, (size_t)len);
+    const cJSON* ctr = cJSON_GetObjectItem(root, "ctr");
+    if (cJSON_IsNumber(ctr)) {
+        Ack ack;
+        ack.at_us = esp_timer_get_time();
+        ack.applied = cJSON_IsTrue(cJSON_GetObjectItem(root, "applied"));
+        ack.charge = cJSON_IsTrue(cJSON_GetObjectItem(root, "charge"));
+        ack.discharge = cJSON_IsTrue(cJSON_GetObjectItem(root, "discharge"));
+        const cJSON* error = cJSON_GetObjectItem(root, "error");
+        if (cJSON_IsString(error)) {
+            ack.error = error->valuestring;
+        }
+        g_acks[(uint32_t)ctr->valuedouble] = ack;
+    }
+    cJSON_Delete(root);
+}
+
+Command makeCommand(uint32_t ctr, bool charge, bool discharge, int64_t deliver_us) {
+    Command cmd;
+    cmd.deliver_us = deliver_us;
+    cmd.ctr = ctr;
+    cmd.charge = charge;
+    cmd.discharge = discharge;
+    cmd.mac = control::FetControl::sign(FET_KEY, DEVICE_ID, ctr, charge, discharge);
+    return cmd;
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const size_t idx = (size_t)(p * (double)(values.size() - 1) + 0.5);
+    return values[std::min(idx, values.size() - 1)];
+}
+
+/**
+ * Run one schedule: one command in every poll interval at a random offset.
+ * @return number of failed commands
+ */
+int runMode(const char* name, bool priority, const LatencyOptions& options, bms_interface_t* bms,
+            uint32_t& next_ctr, std::mt19937& rng) {
+    const int64_t interval_us = (int64_t)options.interval_ms * 1000;
+    const int64_t start_us = esp_timer_get_time();
+    std::uniform_int_distribution<int64_t> offset(0, interval_us - 1);
+
+    g_commands.clear();
+    g_next_command = 0;
+    const uint32_t first_ctr = next_ctr;
+    bool charge = false;
+    for (uint32_t i = 0; i < options.commands; ++i) {
+        // Starts from the second interval so the first tick is not special
+        g_commands.push_back(makeCommand(next_ctr++, charge, true, start_us + (int64_t)(i + 1) * interval_us + offset(rng)));
+        charge = !charge;
+    }
+    const int64_t end_us = start_us + (int64_t)(options.commands + 2) * interval_us;
+
+    control::FetControl& fet = control::FetControl::getInstance();
+    int64_t next_tick_us = start_us;
+    g_notified = false;
+    while (esp_timer_get_time() < end_us) {
+        // xTaskNotifyWait(): woken by the tick or, in priority mode, a command
+        while (esp_timer_get_time() < next_tick_us && !(priority && g_notified)) {
+            host_clock_advance_us(1000);
+        }
+        if (priority && g_notified) {
+            g_notified = false;
+            fet.execute(bms);
+        }
+        if (esp_timer_get_time() >= next_tick_us) {
+            next_tick_us += interval_us;
+            bms->readMeasurements(bms->handle);
+            if (!priority) {
+                g_notified = false;
+                fet.execute(bms);
+            }
+        }
+    }
+
+    std::vector<double> latency_ms;
+    int failures = 0;
+    for (uint32_t ctr = first_ctr; ctr < next_ctr; ++ctr) {
+        const Command& cmd = g_commands[ctr - first_ctr];
+        auto ack = g_acks.find(ctr);
+        if (ack == g_acks.end()) {
+            fprintf(stderr, "%s: command %lu was never acknowledged\n", name, (unsigned long)ctr);
+            failures++;
+            continue;
+        }
+        if (!ack->second.applied || ack->second.charge != cmd.charge || ack->second.discharge != cmd.discharge) {
+            fprintf(stderr, "%s: command %lu ack mismatch (applied %d charge %d discharge %d%s%s)\n", name,
+                    (unsigned long)ctr, ack->second.applied, ack->second.charge, ack->second.discharge,
+                    ack->second.error.empty() ? "" : ", error ", ack->second.error.c_str());
+            failures++;
+            continue;
+        }
+        latency_ms.push_back((double)(ack->second.at_us - g_delivered[ctr]) / 1000.0);
+    }
+
+    printf("%-10s acks %4zu/%-4u  p50 %7.1f ms  p90 %7.1f ms  p99 %7.1f ms  max %7.1f ms\n", name,
+           latency_ms.size(), options.commands, percentile(latency_ms, 0.50), percentile(latency_ms, 0.90),
+           percentile(latency_ms, 0.99), latency_ms.empty() ? 0.0 : *std::max_element(latency_ms.begin(), latency_ms.end()));
+    return failures;
+}
+
+// A refused command must be answered at once with the expected error
+int expectRejected(const char* what, const Command& cmd, const char* error) {
+    g_commands.assign(1, cmd);
+    g_next_command = 0;
+    g_acks.erase(cmd.ctr);
+    deliverDue();
+    auto ack = g_acks.find(cmd.ctr);
+    if (ack == g_acks.end() || ack->second.error != error) {
+        fprintf(stderr, "%s: expected error \"%s\", got \"%s\"\n", what, error,
+                ack == g_acks.end() ? "(no reply)" : ack->second.error.c_str());
+        return 1;
+    }
+    printf("%-10s refused with \"%s\"\n", what, error);
+    return 0;
+}
+
+void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [--commands n] [--interval-ms n] [--read-ms n] [--write-ms n] [--seed n] [--verbose]\n",
+            prog);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    LatencyOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--commands") == 0 && has_value) {
+            options.commands = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--interval-ms") == 0 && has_value) {
+            options.interval_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--read-ms") == 0 && has_value) {
+            options.read_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--write-ms") == 0 && has_value) {
+            options.write_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--seed") == 0 && has_value) {
+            options.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--verbose") == 0) {
+            host_log_level = ESP_LOG_INFO;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.commands == 0 || options.interval_ms == 0 || options.read_ms >= options.interval_ms) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (host_log_level < ESP_LOG_INFO) {
+        host_log_level = ESP_LOG_NONE;
+    }
+
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    host_clock_set_virtual(FET_EPOCH);
+    host_clock_add_ticker(deliverDue);
+    mqtt_broker_set_hook(onPublish, nullptr);
+    host_device_id_set(DEVICE_ID);
+
+    sim_bms_config_t config = SIM_BMS_CONFIG_DEFAULT();
+    config.initial_soc = 0.5f;
+    bms_interface_t* sim = sim_bms_create(&config);
+    g_inner = sim;
+    g_read_us = (int64_t)options.read_ms * 1000;
+    g_write_us = (int64_t)options.write_ms * 1000;
+    bms_interface_t timed = *sim;
+    timed.readMeasurements = timedRead;
+    timed.setMosfet = timedSetMosfet;
+
+    control::FetControl& fet = control::FetControl::getInstance();
+    fet.setCredentials(FET_KEY, DEVICE_ID);
+    fet.setNotify([]() { g_notified = true; });
+    logging::CommandRouter::getInstance().registerCommand(
+        "fet", [](const std::string& args, const logging::CommandRouter::ReplyFn& reply) {
+            return control::FetControl::getInstance().submit(args, reply);
+        });
+
+    logging::MQTTLogSink sink;
+    if (!sink.init("{\"broker_host\":\"127.0.0.1\",\"format\":\"csv\",\"qos\":0}")) {
+        fprintf(stderr, "mqtt sink: %s\n", sink.getLastError().c_str());
+        return 1;
+    }
+
+    printf("%u commands per mode, poll %u ms, UART read %u ms, FET write %u ms\n", options.commands,
+           options.interval_ms, options.read_ms, options.write_ms);
+    std::mt19937 rng(options.seed);
+    uint32_t next_ctr = 1;
+    int failures = 0;
+    failures += runMode("priority", true, options, &timed, next_ctr, rng);
+    failures += runMode("poll-slot", false, options, &timed, next_ctr, rng);
+
+    const int64_t now = esp_timer_get_time();
+    Command forged = makeCommand(next_ctr, true, true, now);
+    forged.mac[0] = forged.mac[0] == '0' ? '1' : '0';
+    failures += expectRejected("bad mac", forged, "auth");
+    failures += expectRejected("replay", makeCommand(next_ctr - 1, true, true, now), "replay");
+
+    std::string stats;
+    fet.toJson(stats);
+    printf("fet_status %s\n", stats.c_str());
+
+    sink.shutdown();
+    sim_bms_destroy(sim);
+    if (failures) {
+        printf("fet latency FAILED (%d)\n", failures);
+        return 1;
+    }
+    printf("fet latency PASSED\n");
+    return 0;
+}
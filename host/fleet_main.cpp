@@ -0,0 +1,635 @@
+// Virtual fleet: many simulated monitors publishing through the real sinks
+//
+//   bms_fleet [options]
+//     --devices <n>       simulated devices (default 200)
+//     --transport <t>     mqtt, udp or both (default mqtt)
+//     --format <f>        csv or json (default csv)
+//     --interval-ms <n>   poll interval of every device (default 1000)
+//     --seconds <n>       run time (default 30)
+//     --jitter-ms <n>     longest BMS read time between a tick and the publish (default 150)
+//     --drift-ppm <n>     largest clock error of a device (default 100)
+//     --qos <n>           MQTT QoS (default 0)
+//     --udp-target <ip:port> send UDP there (e.g. to bms_collector) instead of the built-in receiver
+//     --stats-s <n>       progress line every n seconds, 0 = off (default 5)
+//     --verbose           print ESP_LOGI output
+//
+// Every device is its own sim_bms, SimSource and MQTTLogSink and/or
+// UDPLogSink instance with a unique device_id (fleet-0001, ...), so it builds
+// the same snapshots and payloads and publishes on the same topics as a
+// monitor. One loop on the real clock schedules all of them: devices start at
+// random phases, tick on their own slightly drifting clocks and publish after
+// a random BMS read time.
+//
+// The stand-ins count what arrives: the in-process MQTT broker
+// (shims/mqtt_broker.h) and a UDP socket on 127.0.0.1 read by the same loop.
+// Latency is from the moment a sample was ready on its device to its arrival,
+// so it grows once the host cannot keep up with the fleet. Exits non-zero if a
+// publish failed or never arrived.
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <esp_log.h>
+#include "device_shim.h"
+#include "host_clock.h"
+#include "mqtt_broker.h"
+#include "sim_bms.h"
+#include "sim_source.h"
+#include "mqtt_log_sink.h"
+#include "udp_log_sink.h"
+
+namespace {
+
+struct FleetOptions {
+    uint32_t devices = 200;
+    bool mqtt = true;
+    bool udp = false;
+    std::string format = "csv";
+    uint32_t interval_ms = 1000;
+    uint32_t seconds = 30;
+    uint32_t jitter_ms = 150;
+    uint32_t drift_ppm = 100;
+    int qos = 0;
+    std::string udp_target;
+    uint32_t stats_s = 5;
+};
+
+volatile sig_atomic_t g_stop = 0;
+
+void onSignal(int) {
+    g_stop = 1;
+}
+
+void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [--devices n] [--transport mqtt|udp|both] [--format csv|json]\n"
+            "          [--interval-ms n] [--seconds n] [--jitter-ms n] [--drift-ppm n] [--qos n]\n"
+            "          [--udp-target ip:port] [--stats-s n] [--verbose]\n", prog);
+}
+
+/**
+ * Latency histogram with about 1.5% resolution: exact below 128 us, then 64
+ * buckets per power of two
+ */
+class LatencyHistogram {
+public:
+    void record(int64_t us) {
+        const uint64_t v = us > 0 ? (uint64_t)us : 0;
+        const size_t bucket = bucketOf(v);
+        if (bucket >= counts_.size()) {
+            counts_.resize(bucket + 1, 0);
+        }
+        counts_[bucket]++;
+        count_++;
+        sum_us_ += v;
+        if (v > max_us_) {
+            max_us_ = v;
+        }
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t maxUs() const { return max_us_; }
+    double meanUs() const { return count_ ? (double)sum_us_ / (double)count_ : 0.0; }
+
+    // Lower edge of the bucket holding the given fraction of samples
+    uint64_t percentileUs(double fraction) const {
+        if (count_ == 0) {
+            return 0;
+        }
+        const uint64_t rank = (uint64_t)(fraction * (double)(count_ - 1));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen > rank) {
+                return valueOf(i);
+            }
+        }
+        return max_us_;
+    }
+
+private:
+    static size_t bucketOf(uint64_t v) {
+        if (v < 128) {
+            return (size_t)v;
+        }
+        const int shift = 63 - __builtin_clzll(v) - 6;
+        return 128 + (size_t)(shift - 1) * 64 + (size_t)((v >> shift) - 64);
+    }
+
+    static uint64_t valueOf(size_t bucket) {
+        if (bucket < 128) {
+            return bucket;
+        }
+        const int shift = (int)((bucket - 128) / 64) + 1;
+        return (uint64_t)((bucket - 128) % 64 + 64) << shift;
+    }
+
+    std::vector<uint64_t> counts_;
+    uint64_t count_ = 0;
+    uint64_t sum_us_ = 0;
+    uint64_t max_us_ = 0;
+};
+
+struct TransportStats {
+    const char* name;
+    uint64_t published = 0;       // accepted by the sink
+    uint64_t failed = 0;          // send() returned false
+    uint64_t arrived = 0;         // seen by the stand-in
+    uint64_t bytes = 0;           // payload bytes seen by the stand-in
+    uint64_t interval_arrived = 0;
+    std::string first_error;
+    LatencyHistogram latency;
+};
+
+struct Device {
+    std::string id;
+    bms_interface_t* bms = nullptr;
+    std::unique_ptr<host::SimSource> source;
+    std::unique_ptr<logging::MQTTLogSink> mqtt;
+    std::unique_ptr<logging::UDPLogSink> udp;
+    int64_t period_us = 0;        // interval as measured by the device's own clock
+    int64_t next_tick_us = 0;
+    std::deque<int64_t> udp_ready_us;   // sent, not yet received
+    uint32_t rng = 0;
+};
+
+struct Due {
+    int64_t at_us;
+    uint32_t device;
+    bool operator>(const Due& other) const { return at_us > other.at_us; }
+};
+
+uint32_t nextRandom(uint32_t& state) {
+    uint32_t x = state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state = x;
+    return x;
+}
+
+// Uniform in [0, 1)
+double uniform(uint32_t& state) {
+    return (double)(nextRandom(state) >> 8) / 16777216.0;
+}
+
+// Payloads start with the device id: CSV as the first field, JSON as the first key
+std::string deviceIdOf(const char* data, size_t len) {
+    const char* end = data + len;
+    if (len && data[0] != '{') {
+        const char* comma = static_cast<const char*>(memchr(data, ',', len));
+        return std::string(data, comma ? comma : end);
+    }
+    static const char KEY[] = "\"device_id\"";
+    const char* key = static_cast<const char*>(memmem(data, len, KEY, sizeof(KEY) - 1));
+    if (!key) {
+        return std::string();
+    }
+    const char* open = static_cast<const char*>(memchr(key + sizeof(KEY) - 1, '"', (size_t)(end - key) - (sizeof(KEY) - 1)));
+    if (!open) {
+        return std::string();
+    }
+    const char* close = static_cast<const char*>(memchr(open + 1, '"', (size_t)(end - open - 1)));
+    return close ? std::string(open + 1, close) : std::string();
+}
+
+class Fleet {
+public:
+    explicit Fleet(const FleetOptions& options) : options_(options) {
+        mqtt_stats_.name = "mqtt";
+        udp_stats_.name = "udp";
+    }
+
+    ~Fleet() {
+        mqtt_broker_set_hook(nullptr, nullptr);
+        for (auto& device : devices_) {
+            device.mqtt.reset();
+            device.udp.reset();
+            if (device.bms) {
+                sim_bms_destroy(device.bms);
+            }
+        }
+        if (udp_rx_fd_ >= 0) {
+            close(udp_rx_fd_);
+        }
+    }
+
+    bool setUp() {
+        std::string udp_config;
+        if (options_.udp) {
+            if (options_.udp_target.empty()) {
+                if (!openReceiver()) {
+                    return false;
+                }
+                udp_config = "ip=127.0.0.1,port=" + std::to_string(udp_rx_port_);
+            } else {
+                const size_t colon = options_.udp_target.rfind(':');
+                udp_config = "ip=" + options_.udp_target.substr(0, colon);
+                if (colon != std::string::npos) {
+                    udp_config += ",port=" + options_.udp_target.substr(colon + 1);
+                }
+            }
+            udp_config += ",broadcast=false,format=" + options_.format;
+        }
+        const std::string mqtt_config = "{\"broker_host\":\"127.0.0.1\",\"format\":\"" + options_.format +
+                                        "\",\"qos\":" + std::to_string(options_.qos) + "}";
+        mqtt_broker_set_hook(onBrokerPublish, this);
+
+        const int64_t interval_us = (int64_t)options_.interval_ms * 1000;
+        devices_.resize(options_.devices);
+        for (uint32_t i = 0; i < options_.devices; ++i) {
+            Device& d = devices_[i];
+            char id[24];
+            snprintf(id, sizeof(id), "fleet-%04u", (unsigned)(i + 1));
+            d.id = id;
+            d.rng = 0x9E3779B9u * (i + 1);
+            index_[d.id] = i;
+
+            sim_bms_config_t config = SIM_BMS_CONFIG_DEFAULT();
+            config.seed = i + 1;
+            config.initial_soc = 0.3f + 0.65f * (float)uniform(d.rng);
+            config.day_load_a = 5.0f + 25.0f * (float)uniform(d.rng);
+            d.bms = sim_bms_create(&config);
+            d.source.reset(new host::SimSource(d.bms, options_.interval_ms, 0, id));
+            d.source->open(std::string());
+
+            // The sinks take the topic and client id from device_id_get() in init()
+            host_device_id_set(id);
+            if (options_.mqtt) {
+                d.mqtt.reset(new logging::MQTTLogSink());
+                if (!d.mqtt->init(mqtt_config)) {
+                    fprintf(stderr, "%s: mqtt sink: %s\n", id, d.mqtt->getLastError().c_str());
+                    return false;
+                }
+            }
+            if (options_.udp) {
+                d.udp.reset(new logging::UDPLogSink());
+                if (!d.udp->init(udp_config)) {
+                    fprintf(stderr, "%s: udp sink: %s\n", id, d.udp->getLastError().c_str());
+                    return false;
+                }
+            }
+
+            // Devices booted at random times; crystals are off by up to drift_ppm
+            const double drift = ((uniform(d.rng) * 2.0) - 1.0) * (double)options_.drift_ppm * 1e-6;
+            d.period_us = (int64_t)((double)interval_us * (1.0 + drift));
+            d.next_tick_us = (int64_t)(uniform(d.rng) * (double)interval_us);
+        }
+        return true;
+    }
+
+    void run() {
+        const int64_t start_us = host_clock_real_us();
+        for (uint32_t i = 0; i < devices_.size(); ++i) {
+            devices_[i].next_tick_us += start_us;
+            schedule(i);
+        }
+        const int64_t end_us = start_us + (int64_t)options_.seconds * 1000000;
+        int64_t next_stats_us = start_us + (int64_t)options_.stats_s * 1000000;
+        int64_t busy_us = 0;
+        int64_t interval_start_us = start_us;
+
+        while (!g_stop) {
+            int64_t now = host_clock_real_us();
+            if (now >= end_us) {
+                break;
+            }
+            if (options_.stats_s && now >= next_stats_us) {
+                printProgress(now - start_us, now - interval_start_us);
+                interval_start_us = now;
+                next_stats_us += (int64_t)options_.stats_s * 1000000;
+            }
+            const Due due = queue_.top();
+            if (due.at_us > now) {
+                const int64_t until = std::min(std::min(due.at_us, end_us), next_stats_us);
+                waitFor(until - now);
+                continue;
+            }
+
+            const int64_t t0 = now;
+            queue_.pop();
+            publish(due);
+            schedule(due.device);
+            drainReceiver();
+            now = host_clock_real_us();
+            busy_us += now - t0;
+            const int64_t behind = t0 - due.at_us;
+            if (behind > max_behind_us_) {
+                max_behind_us_ = behind;
+            }
+        }
+
+        // Let the last datagrams land
+        const int64_t settle_until = host_clock_real_us() + 200000;
+        while (udp_rx_fd_ >= 0 && pendingUdp() && host_clock_real_us() < settle_until) {
+            waitFor(10000);
+        }
+        wall_us_ = host_clock_real_us() - start_us;
+        busy_us_ = busy_us;
+    }
+
+    // Prints the report; true when every publish arrived
+    bool report() const {
+        const double wall_s = (double)wall_us_ / 1e6;
+        fprintf(stderr, "\nfleet: %u devices, %s, every %u ms, %.1f s, %llu polls (%llu read errors)\n",
+                options_.devices, options_.format.c_str(), options_.interval_ms, wall_s,
+                (unsigned long long)polls_, (unsigned long long)poll_errors_);
+        fprintf(stderr, "  loop busy %.1f%%, furthest behind schedule %.1f ms\n",
+                wall_us_ ? 100.0 * (double)busy_us_ / (double)wall_us_ : 0.0, (double)max_behind_us_ / 1000.0);
+
+        bool ok = true;
+        const TransportStats* all[] = { &mqtt_stats_, &udp_stats_ };
+        for (const TransportStats* t : all) {
+            const bool enabled = t == &mqtt_stats_ ? options_.mqtt : options_.udp;
+            if (!enabled) {
+                continue;
+            }
+            const bool measured = t == &mqtt_stats_ || udp_rx_fd_ >= 0;
+            fprintf(stderr, "  %-4s published %llu (%.0f/s), failed %llu", t->name,
+                    (unsigned long long)t->published, (double)t->published / wall_s,
+                    (unsigned long long)t->failed);
+            if (t->failed) {
+                fprintf(stderr, " (first: %s;", t->first_error.c_str());
+                // Reasons as counted by the sinks themselves
+                for (size_t r = 0; r < (size_t)logging::DropReason::COUNT; r++) {
+                    uint64_t drops = 0;
+                    for (const Device& d : devices_) {
+                        const logging::LogSink* sink = t == &mqtt_stats_ ? (const logging::LogSink*)d.mqtt.get()
+                                                                         : (const logging::LogSink*)d.udp.get();
+                        drops += sink ? sink->getDropCount((logging::DropReason)r) : 0;
+                    }
+                    if (drops) {
+                        fprintf(stderr, " %s %llu", logging::dropReasonToString((logging::DropReason)r),
+                                (unsigned long long)drops);
+                    }
+                }
+                fprintf(stderr, ")");
+            }
+            if (!measured) {
+                fprintf(stderr, ", sent to %s (not measured)\n", options_.udp_target.c_str());
+                ok = ok && t->failed == 0;
+                continue;
+            }
+            const uint64_t lost = t->published > t->arrived ? t->published - t->arrived : 0;
+            fprintf(stderr, ", arrived %llu, lost %llu, %.1f kB/s\n", (unsigned long long)t->arrived,
+                    (unsigned long long)lost, (double)t->bytes / wall_s / 1000.0);
+            const LatencyHistogram& h = t->latency;
+            fprintf(stderr, "       latency us: mean %.0f, p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, max %llu\n",
+                    h.meanUs(), (unsigned long long)h.percentileUs(0.50), (unsigned long long)h.percentileUs(0.90),
+                    (unsigned long long)h.percentileUs(0.99), (unsigned long long)h.percentileUs(0.999),
+                    (unsigned long long)h.maxUs());
+            ok = ok && t->failed == 0 && lost == 0;
+        }
+        return ok;
+    }
+
+private:
+    static void onBrokerPublish(void* arg, esp_mqtt_client_handle_t, const char* topic, const char* data,
+                                int len, int) {
+        Fleet* fleet = static_cast<Fleet*>(arg);
+        // Telemetry only: diagnostics and command replies share the topic prefix
+        if (strstr(topic, "/diag/") || strstr(topic, "/resp/")) {
+            return;
+        }
+        (void)data;
+        TransportStats& t = fleet->mqtt_stats_;
+        t.arrived++;
+        t.interval_arrived++;
+        t.bytes += (uint64_t)len;
+        // Publishing is synchronous: this is the sample being sent right now
+        t.latency.record(host_clock_real_us() - fleet->publishing_ready_us_);
+    }
+
+    bool openReceiver() {
+        udp_rx_fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (udp_rx_fd_ < 0) {
+            perror("socket");
+            return false;
+        }
+        const int rcvbuf = 8 << 20;
+        setsockopt(udp_rx_fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (bind(udp_rx_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            getsockname(udp_rx_fd_, reinterpret_cast<struct sockaddr*>(&addr), &len) != 0) {
+            perror("bind");
+            return false;
+        }
+        udp_rx_port_ = ntohs(addr.sin_port);
+        return true;
+    }
+
+    void schedule(uint32_t index) {
+        Device& d = devices_[index];
+        // Ready once the BMS read after the tick finished
+        const int64_t read_us = (int64_t)(uniform(d.rng) * (double)options_.jitter_ms * 1000.0);
+        queue_.push(Due{ d.next_tick_us + read_us, index });
+        d.next_tick_us += d.period_us;
+    }
+
+    void publish(const Due& due) {
+        Device& d = devices_[due.device];
+        polls_++;
+        if (!d.source->poll(snapshot_)) {
+            poll_errors_++;
+            return;
+        }
+        if (d.mqtt) {
+            publishing_ready_us_ = due.at_us;
+            if (d.mqtt->send(snapshot_)) {
+                mqtt_stats_.published++;
+            } else {
+                noteFailure(mqtt_stats_, *d.mqtt);
+            }
+        }
+        if (d.udp) {
+            if (d.udp->send(snapshot_)) {
+                udp_stats_.published++;
+                if (udp_rx_fd_ >= 0) {
+                    d.udp_ready_us.push_back(due.at_us);
+                }
+            } else {
+                noteFailure(udp_stats_, *d.udp);
+            }
+        }
+    }
+
+    static void noteFailure(TransportStats& t, const logging::LogSink& sink) {
+        if (t.failed++ == 0) {
+            t.first_error = sink.getLastError();
+        }
+    }
+
+    void waitFor(int64_t us) {
+        if (us <= 0) {
+            return;
+        }
+        struct pollfd pfd;
+        pfd.fd = udp_rx_fd_;
+        pfd.events = POLLIN;
+        struct timespec timeout;
+        timeout.tv_sec = (time_t)(us / 1000000);
+        timeout.tv_nsec = (long)(us % 1000000) * 1000;
+        if (ppoll(&pfd, udp_rx_fd_ >= 0 ? 1 : 0, &timeout, nullptr) > 0) {
+            drainReceiver();
+        }
+    }
+
+    void drainReceiver() {
+        if (udp_rx_fd_ < 0) {
+            return;
+        }
+        char buf[2048];
+        while (true) {
+            const ssize_t n = recv(udp_rx_fd_, buf, sizeof(buf), 0);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            const int64_t now = host_clock_real_us();
+            auto it = index_.find(deviceIdOf(buf, (size_t)n));
+            if (it == index_.end()) {
+                continue;
+            }
+            // Loopback keeps a socket's datagrams in order
+            Device& d = devices_[it->second];
+            udp_stats_.arrived++;
+            udp_stats_.interval_arrived++;
+            udp_stats_.bytes += (uint64_t)n;
+            if (!d.udp_ready_us.empty()) {
+                udp_stats_.latency.record(now - d.udp_ready_us.front());
+                d.udp_ready_us.pop_front();
+            }
+        }
+    }
+
+    bool pendingUdp() const {
+        return udp_stats_.arrived < udp_stats_.published;
+    }
+
+    void printProgress(int64_t elapsed_us, int64_t interval_us) {
+        const double interval_s = (double)interval_us / 1e6;
+        fprintf(stderr, "  t=%4.0fs", (double)elapsed_us / 1e6);
+        TransportStats* all[] = { &mqtt_stats_, &udp_stats_ };
+        for (TransportStats* t : all) {
+            const bool enabled = t == &mqtt_stats_ ? options_.mqtt : options_.udp;
+            if (!enabled || (t == &udp_stats_ && udp_rx_fd_ < 0)) {
+                continue;
+            }
+            fprintf(stderr, "  %s %7.0f/s p99 %6.1f ms", t->name, (double)t->interval_arrived / interval_s,
+                    (double)t->latency.percentileUs(0.99) / 1000.0);
+            t->interval_arrived = 0;
+        }
+        fprintf(stderr, "  behind %.1f ms\n", (double)max_behind_us_ / 1000.0);
+    }
+
+    FleetOptions options_;
+    std::vector<Device> devices_;
+    std::unordered_map<std::string, uint32_t> index_;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due>> queue_;
+    output::BMSSnapshot snapshot_;
+    int64_t publishing_ready_us_ = 0;
+
+    int udp_rx_fd_ = -1;
+    uint16_t udp_rx_port_ = 0;
+
+    TransportStats mqtt_stats_;
+    TransportStats udp_stats_;
+    uint64_t polls_ = 0;
+    uint64_t poll_errors_ = 0;
+    int64_t max_behind_us_ = 0;
+    int64_t wall_us_ = 0;
+    int64_t busy_us_ = 0;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    FleetOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--devices") == 0 && has_value) {
+            options.devices = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--transport") == 0 && has_value) {
+            const char* t = argv[++i];
+            options.mqtt = strcmp(t, "mqtt") == 0 || strcmp(t, "both") == 0;
+            options.udp = strcmp(t, "udp") == 0 || strcmp(t, "both") == 0;
+            if (!options.mqtt && !options.udp) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(arg, "--format") == 0 && has_value) {
+            options.format = argv[++i];
+        } else if (strcmp(arg, "--interval-ms") == 0 && has_value) {
+            options.interval_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--seconds") == 0 && has_value) {
+            options.seconds = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--jitter-ms") == 0 && has_value) {
+            options.jitter_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--drift-ppm") == 0 && has_value) {
+            options.drift_ppm = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--qos") == 0 && has_value) {
+            options.qos = atoi(argv[++i]);
+        } else if (strcmp(arg, "--udp-target") == 0 && has_value) {
+            options.udp_target = argv[++i];
+        } else if (strcmp(arg, "--stats-s") == 0 && has_value) {
+            options.stats_s = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--verbose") == 0) {
+            host_log_level = ESP_LOG_INFO;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.devices == 0 || options.interval_ms == 0 || (options.format != "csv" && options.format != "json")) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // One UDP socket per device
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    Fleet fleet(options);
+    const int64_t setup_start = host_clock_real_us();
+    // Every sink warns about the missing SPIFFS config; once per device is noise
+    const esp_log_level_t log_level = host_log_level;
+    if (log_level < ESP_LOG_INFO) {
+        host_log_level = ESP_LOG_ERROR;
+    }
+    const bool set_up = fleet.setUp();
+    host_log_level = log_level;
+    if (!set_up) {
+        return 1;
+    }
+    fprintf(stderr, "fleet: %u devices up in %.0f ms\n", options.devices,
+            (double)(host_clock_real_us() - setup_start) / 1000.0);
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    fleet.run();
+    return fleet.report() ? 0 : 1;
+}
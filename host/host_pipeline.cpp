@@ -0,0 +1,87 @@
+#include "host_pipeline.h"
+#include "log_manager.h"
+#include "cell_stats.h"
+#include "ir_estimator.h"
+#include "soh_estimator.h"
+#include "rainflow.h"
+#include "stress_histogram.h"
+#include "runtime_predictor.h"
+#include "history_store.h"
+#include "anomaly_detector.h"
+
+namespace host {
+
+static size_t g_null_bytes = 0;
+
+bool NullLogSink::init(const std::string& config) {
+    const bool csv = config.find("\"csv\"") != std::string::npos;
+    serializer_ = logging::BMSSerializer::createSerializer(csv ? "csv" : "json");
+    return serializer_ != nullptr;
+}
+
+bool NullLogSink::send(const output::BMSSnapshot& data) {
+    if (!serializer_->serialize(data, buffer_)) {
+        setLastError("Serialization failed");
+        return false;
+    }
+    g_null_bytes += buffer_.size();
+    return true;
+}
+
+void NullLogSink::shutdown() {
+    serializer_.reset();
+}
+
+size_t NullLogSink::totalBytes() {
+    return g_null_bytes;
+}
+
+void registerHostSinks() {
+    logging::LogManager::getInstance().registerSink("null", [](const std::string&) {
+        return std::unique_ptr<logging::LogSink>(new NullLogSink());
+    });
+}
+
+void addAnalyticsStages(replay::ReplayEngine& engine) {
+    engine.addStage("cell_stats", [](output::BMSSnapshot& s) {
+        analytics::CellStats& cell_stats = analytics::CellStats::getInstance();
+        cell_stats.update(s);
+        cell_stats.fillSummary(s);
+    });
+    engine.addStage("ir", [](output::BMSSnapshot& s) {
+        analytics::IREstimator& ir = analytics::IREstimator::getInstance();
+        ir.update(s);
+        ir.fillSnapshot(s);
+        std::string report;
+        if (ir.takeHourlyReport(s.now_time_us, report)) {
+            logging::LogManager::getInstance().publishDiagnostic("ir", report);
+        }
+    });
+    engine.addStage("soh", [](output::BMSSnapshot& s) {
+        analytics::SohEstimator& soh = analytics::SohEstimator::getInstance();
+        soh.update(s);
+        soh.fillSnapshot(s);
+    });
+    engine.addStage("runtime", [](output::BMSSnapshot& s) {
+        analytics::RuntimePredictor::getInstance().update(s);
+    });
+    engine.addStage("anomaly", [](output::BMSSnapshot& s) {
+        analytics::AnomalyDetector& anomaly = analytics::AnomalyDetector::getInstance();
+        anomaly.update(s);
+        std::string alarm;
+        if (anomaly.takeEvent(alarm)) {
+            logging::LogManager::getInstance().publishDiagnostic("alarm", alarm);
+        }
+    });
+    engine.addStage("history", [](output::BMSSnapshot& s) {
+        analytics::HistoryStore::getInstance().append(s);
+    });
+    engine.addStage("rainflow", [](output::BMSSnapshot& s) {
+        analytics::RainflowCounter::getInstance().update(s);
+    });
+    engine.addStage("stress", [](output::BMSSnapshot& s) {
+        analytics::StressHistogram::getInstance().update(s);
+    });
+}
+
+} // namespace host
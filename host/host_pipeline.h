@@ -0,0 +1,45 @@
+#ifndef HOST_PIPELINE_H
+#define HOST_PIPELINE_H
+
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include "log_sink.h"
+#include "log_serializers.h"
+#include "replay_engine.h"
+
+namespace host {
+
+/**
+ * Stand-in transport: serializes every sample (json or csv) and drops the bytes
+ * Registered with LogManager as "null"; measures pipeline cost without I/O.
+ */
+class NullLogSink : public logging::LogSink {
+public:
+    bool init(const std::string& config) override;
+    bool send(const output::BMSSnapshot& data) override;
+    void shutdown() override;
+    const char* getName() const override { return "null"; }
+    bool isReady() const override { return serializer_ != nullptr; }
+
+    // Bytes serialized by all instances since start
+    static size_t totalBytes();
+
+private:
+    std::unique_ptr<logging::BMSSerializer> serializer_;
+    std::string buffer_;
+};
+
+/**
+ * Register the host-only sink types with LogManager
+ */
+void registerHostSinks();
+
+/**
+ * Add the analytics chain as replay stages, in the same order as the main loop
+ */
+void addAnalyticsStages(replay::ReplayEngine& engine);
+
+} // namespace host
+
+#endif // HOST_PIPELINE_H
@@ -0,0 +1,379 @@
+// Sink pipeline stages through the real MQTT and UDP sinks
+//
+//   bms_pipeline_bench [options]
+//     --samples <n>       samples per run (default 3600, one hour at 1 Hz)
+//     --format <f>        csv or json (default csv)
+//     --verbose           print ESP_LOGI output
+//
+// One simulated monitor on the virtual clock feeds the same sample stream to
+// an MQTTLogSink (in-process broker, shims/mqtt_broker.h) and a UDPLogSink
+// (socket on 127.0.0.1) once per pipeline configuration:
+//
+//   plain        one record per message/datagram, as without a pipeline
+//   batch        10 records per payload
+//   batch+lz4    10 records per payload, LZ4 compressed
+//   batch+lz4 60 60 records per MQTT message; UDP closes its batches early
+//                so they fit a datagram even uncompressed
+//   every 5      one sample in five
+//
+// A JSON record is larger than the UDP sink's default 1400-byte datagram, so
+// the JSON runs raise max_packet_size to what loopback carries.
+//
+// The stand-ins decode every payload (LZ4 included), split it into records
+// and read their sequence numbers. Per sink and run: payloads, wire bytes per
+// record, compression ratio and send() cost per sample. Exits non-zero if a
+// record is lost, duplicated or out of order, or a kept sample never arrives.
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cJSON.h>
+#include <esp_log.h>
+#include "device_shim.h"
+#include "host_clock.h"
+#include "mqtt_broker.h"
+#include "sim_bms.h"
+#include "sim_source.h"
+#include "mqtt_log_sink.h"
+#include "udp_log_sink.h"
+
+namespace {
+
+struct BenchOptions {
+    uint32_t samples = 3600;
+    std::string format = "csv";
+};
+
+struct Run {
+    const char* name;
+    const char* pipeline;           // the sink entry's "pipeline" object
+    uint32_t every;                 // for the expected sequence
+};
+
+const Run RUNS[] = {
+    { "plain",        "{}",                                   1 },
+    { "batch",        "{\"batch\":10}",                       1 },
+    { "batch+lz4",    "{\"batch\":10,\"compress\":\"lz4\"}",  1 },
+    { "batch+lz4 60", "{\"batch\":60,\"compress\":\"lz4\"}",  1 },
+    { "every 5",      "{\"every\":5}",                        5 },
+};
+
+/**
+ * LZ4 block decoder with the pipeline's raw size prefix
+ * @return false on a malformed block or a size mismatch
+ */
+bool lz4Decode(const char* data, size_t len, std::string& out) {
+    if (len < 4) {
+        return false;
+    }
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(data);
+    const size_t raw = (size_t)src[0] | ((size_t)src[1] << 8) | ((size_t)src[2] << 16) | ((size_t)src[3] << 24);
+    out.clear();
+    out.reserve(raw);
+    size_t ip = 4;
+    while (ip < len) {
+        const uint8_t token = src[ip++];
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            uint8_t b;
+            do {
+                if (ip >= len) return false;
+                b = src[ip++];
+                literals += b;
+            } while (b == 255);
+        }
+        if (ip + literals > len) {
+            return false;
+        }
+        out.append(data + ip, literals);
+        ip += literals;
+        if (ip >= len) {
+            break;
+        }
+        if (ip + 2 > len) {
+            return false;
+        }
+        const size_t offset = (size_t)src[ip] | ((size_t)src[ip + 1] << 8);
+        ip += 2;
+        size_t match = token & 15;
+        if (match == 15) {
+            uint8_t b;
+            do {
+                if (ip >= len) return false;
+                b = src[ip++];
+                match += b;
+            } while (b == 255);
+        }
+        match += 4;
+        if (offset == 0 || offset > out.size()) {
+            return false;
+        }
+        // Byte by byte: matches may overlap their own output
+        size_t from = out.size() - offset;
+        for (size_t i = 0; i < match; ++i) {
+            out += out[from + i];
+        }
+    }
+    return out.size() == raw;
+}
+
+/**
+ * What one stand-in received
+ */
+struct Receiver {
+    explicit Receiver(const char* receiver_name) : name(receiver_name) {}
+
+    const char* name;
+    bool compressed = false;
+    uint64_t payloads = 0;
+    uint64_t bytes = 0;
+    uint64_t decode_errors = 0;
+    std::vector<uint32_t> seqs;
+    std::string decoded;
+
+    void reset(bool lz4) {
+        compressed = lz4;
+        payloads = 0;
+        bytes = 0;
+        decode_errors = 0;
+        seqs.clear();
+    }
+
+    void consume(const char* data, size_t len) {
+        payloads++;
+        bytes += len;
+        if (compressed) {
+            if (!lz4Decode(data, len, decoded)) {
+                decode_errors++;
+                return;
+            }
+            data = decoded.data();
+            len = decoded.size();
+        }
+        // JSON: every "seq": key; CSV: the last column of every line
+        const char* end = data + len;
+        if (len && data[0] == '{') {
+            static const char KEY[] = "\"seq\": ";
+            const char* p = data;
+            while ((p = static_cast<const char*>(memmem(p, (size_t)(end - p), KEY, sizeof(KEY) - 1))) != nullptr) {
+                p += sizeof(KEY) - 1;
+                seqs.push_back((uint32_t)strtoul(p, nullptr, 10));
+            }
+            return;
+        }
+        const char* line = data;
+        while (line < end) {
+            const char* nl = static_cast<const char*>(memchr(line, '\n', (size_t)(end - line)));
+            const char* stop = nl ? nl : end;
+            const char* field = static_cast<const char*>(memrchr(line, ',', (size_t)(stop - line)));
+            if (field) {
+                // The last line of a datagram has no newline: stop at its end
+                uint32_t seq = 0;
+                for (const char* d = field + 1; d < stop && *d >= '0' && *d <= '9'; ++d) {
+                    seq = seq * 10 + (uint32_t)(*d - '0');
+                }
+                seqs.push_back(seq);
+            } else {
+                decode_errors++;
+            }
+            line = stop + 1;
+        }
+    }
+};
+
+Receiver g_mqtt("mqtt");
+Receiver g_udp("udp");
+
+void onBrokerPublish(void*, esp_mqtt_client_handle_t, const char*, const char* data, int len, int) {
+    g_mqtt.consume(data, (size_t)len);
+}
+
+int openReceiver(uint16_t& port) {
+    const int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    const int rcvbuf = 8 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len) != 0) {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+void drain(int fd) {
+    char buf[65536];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        g_udp.consume(buf, (size_t)n);
+    }
+}
+
+bool configure(logging::LogSink& sink, const char* pipeline_json) {
+    cJSON* json = cJSON_Parse(pipeline_json);
+    logging::PipelineConfig config;
+    std::string error;
+    const bool ok = logging::PipelineConfig::fromJson(json, config, error) && sink.configurePipeline(config);
+    cJSON_Delete(json);
+    if (!ok) {
+        fprintf(stderr, "%s: %s\n", sink.getName(), error.empty() ? sink.getLastError().c_str() : error.c_str());
+    }
+    return ok;
+}
+
+int check(const Run& run, const BenchOptions& options, const Receiver& rx, const logging::LogSink& sink,
+          int64_t send_us) {
+    const logging::SinkPipeline::Stats& st = sink.getPipeline()->getStats();
+    const double records = (double)(rx.seqs.empty() ? 1 : rx.seqs.size());
+    printf("%-13s %-4s  %5zu records in %5llu payloads  %6.1f B/record  ratio %4.2f  max %5u B  send() %5.1f us/sample\n",
+           run.name, rx.name, rx.seqs.size(), (unsigned long long)rx.payloads, (double)rx.bytes / records,
+           st.wire_bytes ? (double)st.encoded_bytes / (double)st.wire_bytes : 0.0, (unsigned)st.max_payload_bytes,
+           (double)send_us / options.samples);
+
+    // Samples 1, 1 + every, ... in order, each once
+    int failures = 0;
+    uint32_t expected = 1;
+    size_t i = 0;
+    for (; i < rx.seqs.size() && expected <= options.samples; ++i, expected += run.every) {
+        if (rx.seqs[i] != expected) {
+            fprintf(stderr, "%s %s: record %zu has seq %u, expected %u\n", run.name, rx.name, i, rx.seqs[i], expected);
+            failures++;
+            break;
+        }
+    }
+    const size_t kept = (options.samples + run.every - 1) / run.every;
+    if (rx.seqs.size() != kept) {
+        fprintf(stderr, "%s %s: %zu of %zu kept records arrived\n", run.name, rx.name, rx.seqs.size(), kept);
+        failures++;
+    }
+    if (rx.decode_errors || sink.getTotalDrops() || st.records != kept) {
+        fprintf(stderr, "%s %s: %llu decode errors, %u drops, %u records delivered\n", run.name, rx.name,
+                (unsigned long long)rx.decode_errors, (unsigned)sink.getTotalDrops(), (unsigned)st.records);
+        failures++;
+    }
+    return failures;
+}
+
+int runPipeline(const Run& run, const BenchOptions& options, int udp_fd, uint16_t udp_port) {
+    // Same seed every run, so every pipeline sees the same samples
+    sim_bms_config_t config = SIM_BMS_CONFIG_DEFAULT();
+    bms_interface_t* bms = sim_bms_create(&config);
+    host::SimSource source(bms, 1000, options.samples, "pipe-0001");
+    source.open(std::string());
+
+    logging::MQTTLogSink mqtt;
+    logging::UDPLogSink udp;
+    const std::string mqtt_config = "{\"broker_host\":\"127.0.0.1\",\"format\":\"" + options.format + "\",\"qos\":0}";
+    std::string udp_config = "ip=127.0.0.1,port=" + std::to_string(udp_port) + ",broadcast=false,format=" +
+                             options.format;
+    if (options.format == "json") {
+        udp_config += ",max_packet_size=65000";
+    }
+    if (!mqtt.init(mqtt_config) || !udp.init(udp_config)) {
+        fprintf(stderr, "%s: sink init: %s %s\n", run.name, mqtt.getLastError().c_str(), udp.getLastError().c_str());
+        sim_bms_destroy(bms);
+        return 1;
+    }
+    if (!configure(mqtt, run.pipeline) || !configure(udp, run.pipeline)) {
+        sim_bms_destroy(bms);
+        return 1;
+    }
+    const bool lz4 = mqtt.getPipeline()->config().compression != logging::PipelineConfig::Compression::NONE;
+    g_mqtt.reset(lz4);
+    g_udp.reset(lz4);
+
+    output::BMSSnapshot snapshot;
+    int64_t mqtt_us = 0;
+    int64_t udp_us = 0;
+    while (source.next(snapshot)) {
+        int64_t t0 = host_clock_real_us();
+        mqtt.send(snapshot);
+        int64_t t1 = host_clock_real_us();
+        udp.send(snapshot);
+        udp_us += host_clock_real_us() - t1;
+        mqtt_us += t1 - t0;
+        drain(udp_fd);
+    }
+    // Shutdown sends the last, partly filled batch
+    mqtt.shutdown();
+    udp.shutdown();
+    drain(udp_fd);
+
+    int failures = 0;
+    failures += check(run, options, g_mqtt, mqtt, mqtt_us);
+    failures += check(run, options, g_udp, udp, udp_us);
+    sim_bms_destroy(bms);
+    return failures;
+}
+
+void usage(const char* prog) {
+    fprintf(stderr, "usage: %s [--samples n] [--format csv|json] [--verbose]\n", prog);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--samples") == 0 && has_value) {
+            options.samples = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--format") == 0 && has_value) {
+            options.format = argv[++i];
+        } else if (strcmp(arg, "--verbose") == 0) {
+            host_log_level = ESP_LOG_INFO;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.samples == 0 || (options.format != "csv" && options.format != "json")) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (host_log_level < ESP_LOG_INFO) {
+        host_log_level = ESP_LOG_NONE;
+    }
+
+    host_clock_set_virtual(1735689600);
+    host_device_id_set("pipe-0001");
+    uint16_t udp_port = 0;
+    const int udp_fd = openReceiver(udp_port);
+    if (udp_fd < 0) {
+        return 1;
+    }
+    mqtt_broker_set_hook(onBrokerPublish, nullptr);
+
+    printf("pipeline bench: %u samples, %s\n", options.samples, options.format.c_str());
+    int failures = 0;
+    for (const Run& run : RUNS) {
+        failures += runPipeline(run, options, udp_fd, udp_port);
+    }
+
+    mqtt_broker_set_hook(nullptr, nullptr);
+    close(udp_fd);
+    if (failures) {
+        printf("pipeline bench FAILED (%d)\n", failures);
+        return 1;
+    }
+    printf("pipeline bench PASSED\n");
+    return 0;
+}
@@ -0,0 +1,250 @@
+// Host replay tool: feeds a captured CSV log through analytics and LogManager
+//
+//   bms_replay [options] <log.csv>
+//     --realtime          pace samples by their recorded timestamps
+//     --speed <x>         realtime multiplier (default 1.0)
+//     --loops <n>         replay the file n times (default 1)
+//     --max <n>           stop after n samples
+//     --sink <type>       null (default, serialize only), serial, none
+//     --format <fmt>      serializer for the sink: json (default), csv, human
+//     --no-analytics      skip the analytics stages
+//     --verbose           print ESP_LOGI output
+//
+//   bms_replay --check
+//     round-trips packs of several sizes through CSVSerializer and
+//     CsvReplaySource, in the current layout and without the columns that
+//     follow the temperatures (older firmware)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <esp_log.h>
+#include "log_manager.h"
+#include "log_serializers.h"
+#include "replay_engine.h"
+#include "replay_source.h"
+#include "history_store.h"
+#include "host_pipeline.h"
+
+namespace {
+
+replay::ReplayEngine g_engine;
+
+void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [--realtime] [--speed x] [--loops n] [--max n] [--sink null|serial|none]\n"
+            "          [--format json|csv|human] [--no-analytics] [--verbose] <log.csv>\n"
+            "       %s --check\n", prog, prog);
+}
+
+void onSignal(int) {
+    g_engine.stop();
+}
+
+// Number of columns the CSV serializer appends after the temperatures
+size_t trailingColumns() {
+    std::unique_ptr<logging::BMSSerializer> csv = logging::BMSSerializer::createSerializer("csv");
+    const std::string header = csv->getHeader();
+    const size_t last_temp = header.rfind(",temp_c_");
+    size_t n = 0;
+    for (size_t at = header.find(',', last_temp + 1); at != std::string::npos; at = header.find(',', at + 1)) {
+        n++;
+    }
+    return n;
+}
+
+int runCheck() {
+    struct Pack {
+        int cells;
+        int temps;
+    };
+    static const Pack PACKS[] = { { 4, 3 }, { 16, 8 }, { 7, 0 }, { 1, 1 }, { 13, 2 } };
+    const size_t trailing = trailingColumns();
+    std::unique_ptr<logging::BMSSerializer> csv = logging::BMSSerializer::createSerializer("csv");
+
+    char path[] = "/tmp/bms_replay_checkXXXXXX";
+    const int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "cannot create temp file\n");
+        return 1;
+    }
+    close(fd);
+
+    int failures = 0;
+    for (int legacy = 0; legacy < 2; ++legacy) {
+        // legacy: rows and header end with the temperatures
+        std::string header = csv->getHeader();
+        std::vector<output::BMSSnapshot> written;
+        std::string text;
+        for (size_t p = 0; p < sizeof(PACKS) / sizeof(PACKS[0]); ++p) {
+            output::BMSSnapshot s{};
+            snprintf(s.device_id, sizeof(s.device_id), "check-%zu", p);
+            s.elapsed_sec = 10 * (unsigned)p;
+            s.pack_voltage_v = 3.3f * (float)PACKS[p].cells;
+            s.cell_count = PACKS[p].cells;
+            s.temp_count = PACKS[p].temps;
+            for (int i = 0; i < s.cell_count; ++i) s.cell_v[static_cast<size_t>(i)] = 3.2f + 0.01f * (float)i;
+            for (int i = 0; i < s.temp_count; ++i) s.temp_c[static_cast<size_t>(i)] = 20.5f + (float)i;
+            s.boot_id = 7;
+            s.seq = (uint32_t)p + 1;
+            std::string row;
+            csv->serialize(s, row);
+            if (legacy) {
+                for (size_t i = 0; i < trailing; ++i) row.erase(row.rfind(','));
+                s.boot_id = 0;
+                s.seq = 0;
+            }
+            text += row + "\n";
+            written.push_back(s);
+        }
+        if (legacy) {
+            header.erase(header.rfind(",temp_c_"));
+            header += ",temp_c_" + std::to_string(output::DEFAULT_MAX_CSV_TEMPS) + "\n";
+        }
+
+        FILE* f = fopen(path, "w");
+        if (!f) {
+            fprintf(stderr, "cannot write %s\n", path);
+            return 1;
+        }
+        fputs(header.c_str(), f);
+        fputs(text.c_str(), f);
+        fclose(f);
+
+        replay::CsvReplaySource source;
+        if (!source.open(path)) {
+            fprintf(stderr, "%s\n", source.getLastError().c_str());
+            return 1;
+        }
+        const char* layout = legacy ? "legacy" : "current";
+        output::BMSSnapshot r;
+        size_t row = 0;
+        for (; source.next(r) && row < written.size(); ++row) {
+            const output::BMSSnapshot& w = written[row];
+            bool ok = strcmp(r.device_id, w.device_id) == 0 && r.cell_count == w.cell_count &&
+                      r.temp_count == w.temp_count && r.boot_id == w.boot_id && r.seq == w.seq &&
+                      r.elapsed_sec == w.elapsed_sec;
+            for (int i = 0; ok && i < w.cell_count; ++i) {
+                ok = fabsf(r.cell_v[static_cast<size_t>(i)] - w.cell_v[static_cast<size_t>(i)]) < 0.0006f;
+            }
+            for (int i = 0; ok && i < w.temp_count; ++i) {
+                ok = fabsf(r.temp_c[static_cast<size_t>(i)] - w.temp_c[static_cast<size_t>(i)]) < 0.06f;
+            }
+            printf("%-8s %2ds/%dt  %s\n", layout, w.cell_count, w.temp_count, ok ? "ok" : "MISMATCH");
+            if (!ok) {
+                fprintf(stderr, "%s %s: cells %d temps %d boot %u seq %u, cell_v_1 %.3f, temp_c_1 %.1f\n", layout,
+                        w.device_id, r.cell_count, r.temp_count, (unsigned)r.boot_id, (unsigned)r.seq,
+                        r.cell_v[0], r.temp_c[0]);
+                failures++;
+            }
+        }
+        if (row != written.size() || source.getErrorCount() != 0) {
+            fprintf(stderr, "%s: %zu of %zu rows read, %zu errors\n", layout, row, written.size(),
+                    source.getErrorCount());
+            failures++;
+        }
+        source.close();
+    }
+    unlink(path);
+
+    if (failures) {
+        printf("replay check FAILED (%d)\n", failures);
+        return 1;
+    }
+    printf("replay check PASSED\n");
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    replay::ReplayEngine::Options options;
+    std::string sink = "null";
+    std::string format = "json";
+    std::string path;
+    bool with_analytics = true;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--realtime") == 0) {
+            options.realtime = true;
+        } else if (strcmp(arg, "--speed") == 0 && has_value) {
+            options.speed = strtof(argv[++i], nullptr);
+        } else if (strcmp(arg, "--loops") == 0 && has_value) {
+            options.loops = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--max") == 0 && has_value) {
+            options.max_samples = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--sink") == 0 && has_value) {
+            sink = argv[++i];
+        } else if (strcmp(arg, "--format") == 0 && has_value) {
+            format = argv[++i];
+        } else if (strcmp(arg, "--no-analytics") == 0) {
+            with_analytics = false;
+        } else if (strcmp(arg, "--verbose") == 0) {
+            host_log_level = ESP_LOG_INFO;
+        } else if (strcmp(arg, "--check") == 0) {
+            return runCheck();
+        } else if (arg[0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            path = arg;
+        }
+    }
+    if (path.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::unique_ptr<replay::ReplaySource> source = replay::ReplaySource::create(path);
+    if (!source) {
+        fprintf(stderr, "Unsupported capture format: %s\n", path.c_str());
+        return 1;
+    }
+    if (!source->open(path)) {
+        fprintf(stderr, "%s\n", source->getLastError().c_str());
+        return 1;
+    }
+
+    logging::LogManager& log = logging::LogManager::getInstance();
+    if (sink != "none") {
+        host::registerHostSinks();
+        const std::string config = "{\"sinks\":[{\"type\":\"" + sink +
+                                   "\",\"config\":{\"format\":\"" + format + "\"}}]}";
+        if (!log.init(config)) {
+            fprintf(stderr, "Failed to start %s sink\n", sink.c_str());
+            return 1;
+        }
+    }
+
+    if (with_analytics) {
+        analytics::HistoryStore::getInstance().init();
+        host::addAnalyticsStages(g_engine);
+    }
+    if (sink != "none") {
+        g_engine.addStage("log_send", [&log](output::BMSSnapshot& s) {
+            log.send(s);
+        });
+        // No poll ticks to leave room for: drain deferred sink work every sample
+        g_engine.addStage("log_idle", [&log](output::BMSSnapshot&) {
+            log.runDeferred(UINT32_MAX);
+        });
+    }
+
+    signal(SIGINT, onSignal);
+    const replay::ReplayEngine::Report report = g_engine.run(*source, options);
+    source->close();
+    log.shutdown();
+
+    fputs(replay::ReplayEngine::formatReport(report).c_str(), stderr);
+    if (sink == "null") {
+        fprintf(stderr, "  serialized %zu bytes (%.1f bytes/sample)\n", host::NullLogSink::totalBytes(),
+                report.samples ? (double)host::NullLogSink::totalBytes() / (double)report.samples : 0.0);
+    }
+    return report.samples > 0 ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+// Host connectivity bus
+//
+// Without a harness there is no WiFi stack: the bus stays inactive so sinks are
+// never paused. With fault_track_link() enabled it reports itself active and
+// follows FAULT_LINK_DOWN, including the station's detect delay.
+#include "connectivity.h"
+#include "fault_injection.h"
+#include "host_clock.h"
+#include <esp_timer.h>
+#include <string.h>
+
+namespace {
+
+struct Subscriber {
+    connectivity_cb_t cb;
+    void* ctx;
+};
+
+Subscriber g_subscribers[CONNECTIVITY_MAX_SUBSCRIBERS];
+size_t g_subscriber_count = 0;
+connectivity_info_t g_info = { true, -55, 0x0100A8C0, 0, 0, 0 };
+
+// Pick up link transitions lazily; notifies subscribers on a change
+void update() {
+    const bool online = fault_link_online();
+    if (online == g_info.online) {
+        return;
+    }
+    g_info.online = online;
+    g_info.generation++;
+    g_info.last_change_us = (uint64_t)esp_timer_get_time();
+    if (!online) {
+        g_info.disconnect_count++;
+    }
+    for (size_t i = 0; i < g_subscriber_count; ++i) {
+        g_subscribers[i].cb(&g_info, g_subscribers[i].ctx);
+    }
+}
+
+} // namespace
+
+esp_err_t connectivity_init(void) {
+    host_clock_add_ticker(update);
+    return ESP_OK;
+}
+
+void connectivity_deinit(void) {
+    g_subscriber_count = 0;
+}
+
+bool connectivity_is_active(void) {
+    return fault_link_tracked();
+}
+
+bool connectivity_is_online(void) {
+    update();
+    return g_info.online;
+}
+
+uint32_t connectivity_generation(void) {
+    update();
+    return g_info.generation;
+}
+
+void connectivity_get_info(connectivity_info_t* out) {
+    if (out) {
+        update();
+        *out = g_info;
+    }
+}
+
+esp_err_t connectivity_subscribe(connectivity_cb_t cb, void* ctx) {
+    if (!cb) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (g_subscriber_count >= CONNECTIVITY_MAX_SUBSCRIBERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    g_subscribers[g_subscriber_count++] = { cb, ctx };
+    host_clock_add_ticker(update);
+    update();
+    cb(&g_info, ctx);
+    return ESP_OK;
+}
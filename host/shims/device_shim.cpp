@@ -0,0 +1,55 @@
+// Host stand-ins for the device identity, status LED and SPIFFS hooks the network sinks and config store call
+#include <esp_mac.h>
+#include <esp_spiffs.h>
+#include <stdio.h>
+#include <string.h>
+#include "device_id.h"
+#include "device_shim.h"
+#include "status_led.h"
+
+namespace {
+
+char g_device_id[33] = "host";
+
+} // namespace
+
+void host_device_id_set(const char* id) {
+    snprintf(g_device_id, sizeof(g_device_id), "%s", id ? id : "host");
+}
+
+esp_err_t device_id_get(char* buffer, size_t buffer_size) {
+    const size_t len = strlen(g_device_id) + 1;
+    if (!buffer || buffer_size < len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(buffer, g_device_id, len);
+    return ESP_OK;
+}
+
+esp_err_t esp_read_mac(uint8_t* mac, esp_mac_type_t type) {
+    static const uint8_t MAC[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    if (!mac) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(mac, MAC, sizeof(MAC));
+    mac[5] = (uint8_t)(mac[5] + (uint8_t)type);
+    return ESP_OK;
+}
+
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t* conf) {
+    (void)conf;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_vfs_spiffs_unregister(const char* partition_label) {
+    (void)partition_label;
+    return ESP_ERR_INVALID_STATE;
+}
+
+bool esp_spiffs_mounted(const char* partition_label) {
+    (void)partition_label;
+    return false;
+}
+
+void status_led_notify_net_telemetry_tx(void) {
+}
@@ -0,0 +1,13 @@
+#pragma once
+// Host-side control of the device identity stand-in (shims/device_shim.cpp)
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Id returned by device_id_get() from now on (default "host"). Sinks read it
+// in init(), so harnesses running several virtual devices set it before each.
+void host_device_id_set(const char* id);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,17 @@
+#pragma once
+// Host stand-in for ESP-IDF driver/sdspi_host.h
+#include "driver/spi_common.h"
+
+typedef struct {
+    int slot;
+    int max_freq_khz;
+} sdmmc_host_t;
+
+typedef struct {
+    spi_host_device_t host_id;
+    gpio_num_t gpio_cs;
+} sdspi_device_config_t;
+
+#define SDSPI_DEFAULT_DMA SPI_DMA_CH_AUTO
+#define SDSPI_HOST_DEFAULT() sdmmc_host_t{ SPI2_HOST, 20000 }
+#define SDSPI_DEVICE_CONFIG_DEFAULT() sdspi_device_config_t{ SPI2_HOST, GPIO_NUM_NC }
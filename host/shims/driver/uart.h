@@ -0,0 +1,2 @@
+#pragma once
+// Host stand-in: the serial sink writes through stdio, nothing from the UART driver is used
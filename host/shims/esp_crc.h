@@ -0,0 +1,13 @@
+#pragma once
+// Host stand-in for ESP-IDF esp_crc.h
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t esp_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
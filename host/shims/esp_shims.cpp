@@ -0,0 +1,166 @@
+// Host implementations of the small ESP-IDF APIs used by the shared sources
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_crc.h>
+#include <esp_heap_caps.h>
+#include <freertos/task.h>
+#include "host_clock.h"
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+esp_log_level_t host_log_level = ESP_LOG_WARN;
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+        case ESP_ERR_NVS_NOT_INITIALIZED: return "ESP_ERR_NVS_NOT_INITIALIZED";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+        default: return "ESP_ERR_UNKNOWN";
+    }
+}
+
+namespace {
+
+std::atomic<bool> g_virtual_clock{false};
+std::atomic<int64_t> g_virtual_us{0};
+time_t g_virtual_epoch = 0;
+
+std::vector<void (*)(void)> g_tickers;
+bool g_in_ticker = false;
+
+void runTickers() {
+    if (g_in_ticker) {
+        return;
+    }
+    g_in_ticker = true;
+    for (auto fn : g_tickers) {
+        fn();
+    }
+    g_in_ticker = false;
+}
+
+} // namespace
+
+void host_clock_set_virtual(time_t epoch) {
+    g_virtual_epoch = epoch;
+    g_virtual_us = 0;
+    g_virtual_clock = true;
+}
+
+void host_clock_advance_us(int64_t us) {
+    g_virtual_us += us;
+    runTickers();
+}
+
+void host_clock_sleep_us(int64_t us) {
+    if (us <= 0) {
+        return;
+    }
+    if (g_virtual_clock) {
+        host_clock_advance_us(us);
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+    runTickers();
+}
+
+void host_clock_add_ticker(void (*fn)(void)) {
+    for (auto existing : g_tickers) {
+        if (existing == fn) {
+            return;
+        }
+    }
+    g_tickers.push_back(fn);
+}
+
+bool host_clock_is_virtual(void) {
+    return g_virtual_clock;
+}
+
+#if defined(__linux__)
+extern "C" time_t __real_time(time_t* out);
+
+// Linked in place of time(); CMakeLists.txt adds -Wl,--wrap=time on Linux
+extern "C" time_t __wrap_time(time_t* out) {
+    if (!g_virtual_clock) {
+        return __real_time(out);
+    }
+    const time_t now = g_virtual_epoch + (time_t)(g_virtual_us / 1000000);
+    if (out) {
+        *out = now;
+    }
+    return now;
+}
+#endif
+
+bool host_clock_wall_is_virtual(void) {
+    return g_virtual_clock && time(nullptr) == g_virtual_epoch + (time_t)(g_virtual_us / 1000000);
+}
+
+int64_t host_clock_real_us(void) {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+int64_t esp_timer_get_time(void) {
+    return g_virtual_clock ? g_virtual_us.load() : host_clock_real_us();
+}
+
+void vTaskDelay(TickType_t ticks) {
+    host_clock_sleep_us((int64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+uint32_t esp_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    // Same polynomial and pre/post inversion as the ROM crc32_le
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; ++i) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    (void)caps;
+    return malloc(size);
+}
+
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    (void)caps;
+    return calloc(n, size);
+}
+
+void heap_caps_free(void* ptr) {
+    free(ptr);
+}
+
+size_t heap_caps_get_total_size(uint32_t caps) {
+    // Report no PSRAM so the history store picks its internal-RAM tier sizes
+    return (caps & MALLOC_CAP_SPIRAM) ? 0 : 320 * 1024;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    return heap_caps_get_total_size(caps);
+}
@@ -0,0 +1,25 @@
+#pragma once
+// Host stand-in for ESP-IDF esp_spiffs.h: there is no SPIFFS partition on the host,
+// registration always fails and readers fall back to their built-in defaults
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+typedef struct {
+    const char* base_path;
+    const char* partition_label;
+    size_t max_files;
+    bool format_if_mount_failed;
+} esp_vfs_spiffs_conf_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t* conf);
+esp_err_t esp_vfs_spiffs_unregister(const char* partition_label);
+bool esp_spiffs_mounted(const char* partition_label);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,3 @@
+#pragma once
+// Host stand-in for ESP-IDF esp_system.h
+#include "esp_err.h"
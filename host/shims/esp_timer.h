@@ -0,0 +1,14 @@
+#pragma once
+// Host stand-in for ESP-IDF esp_timer.h: microseconds since process start
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int64_t esp_timer_get_time(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,100 @@
+// Fault switches shared by the host stand-ins
+#include "fault_injection.h"
+#include <esp_timer.h>
+#include <string.h>
+#include <string>
+
+namespace {
+
+struct FaultState {
+    bool active = false;
+    int64_t since_us = 0;
+    uint32_t hits = 0;
+};
+
+FaultState g_faults[FAULT_COUNT];
+std::string g_sd_root;
+uint32_t g_link_detect_ms = 6000;
+bool g_link_tracked = false;
+
+} // namespace
+
+void fault_set(fault_id_t id, bool active) {
+    if (id >= FAULT_COUNT || g_faults[id].active == active) {
+        return;
+    }
+    g_faults[id].active = active;
+    if (active) {
+        g_faults[id].since_us = esp_timer_get_time();
+    }
+}
+
+bool fault_is_active(fault_id_t id) {
+    return id < FAULT_COUNT && g_faults[id].active;
+}
+
+int64_t fault_since_us(fault_id_t id) {
+    return id < FAULT_COUNT ? g_faults[id].since_us : 0;
+}
+
+uint32_t fault_hits(fault_id_t id) {
+    return id < FAULT_COUNT ? g_faults[id].hits : 0;
+}
+
+void fault_note_hit(fault_id_t id) {
+    if (id < FAULT_COUNT) {
+        g_faults[id].hits++;
+    }
+}
+
+void fault_reset_counters(void) {
+    for (auto& fault : g_faults) {
+        fault.hits = 0;
+    }
+}
+
+const char* fault_name(fault_id_t id) {
+    switch (id) {
+        case FAULT_SD_REMOVED: return "sd_removed";
+        case FAULT_SD_FULL: return "sd_full";
+        case FAULT_BROKER_DOWN: return "broker_down";
+        case FAULT_HTTP_DOWN: return "http_down";
+        case FAULT_LINK_DOWN: return "link_down";
+        default: return "unknown";
+    }
+}
+
+void fault_set_sd_root(const char* path) {
+    g_sd_root = path ? path : "";
+    while (g_sd_root.size() > 1 && g_sd_root.back() == '/') {
+        g_sd_root.pop_back();
+    }
+}
+
+bool fault_is_sd_path(const char* path) {
+    if (g_sd_root.empty() || !path) {
+        return false;
+    }
+    const size_t n = g_sd_root.size();
+    return strncmp(path, g_sd_root.c_str(), n) == 0 && (path[n] == '\0' || path[n] == '/');
+}
+
+void fault_set_link_detect_ms(uint32_t ms) {
+    g_link_detect_ms = ms;
+}
+
+void fault_track_link(bool enable) {
+    g_link_tracked = enable;
+}
+
+bool fault_link_tracked(void) {
+    return g_link_tracked;
+}
+
+bool fault_link_online(void) {
+    const FaultState& link = g_faults[FAULT_LINK_DOWN];
+    if (!link.active) {
+        return true;
+    }
+    return esp_timer_get_time() - link.since_us < (int64_t)g_link_detect_ms * 1000;
+}
@@ -0,0 +1,59 @@
+#pragma once
+// Fault injection for host harnesses
+//
+// The host stand-ins consult these switches on every call the sinks make:
+//   - FAT: stat/fopen/fwrite/fflush on the card mount point (shims/fault_io_wrap.cpp,
+//     linked with -Wl,--wrap) and esp_vfs_fat_info (shims/sdcard_shim.cpp)
+//   - sockets: connect/send/sendto (shims/fault_io_wrap.cpp)
+//   - MQTT: the esp-mqtt client stand-in (shims/mqtt_shim.cpp)
+//   - HTTP: the esp_http_client stand-in (shims/http_shim.cpp)
+//   - WiFi: the connectivity stand-in (shims/connectivity_shim.cpp)
+// Calls that would block on the device (transport timeouts) block on the host
+// clock, so a harness running on the virtual clock sees the same stalls.
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    FAULT_SD_REMOVED = 0,   // mount point gone: stat/fopen fail with ENOENT, writes with EIO
+    FAULT_SD_FULL,          // no free clusters: esp_vfs_fat_info reports 0 free, writes fail with ENOSPC
+    FAULT_BROKER_DOWN,      // MQTT broker restarting: sessions dropped, connects refused
+    FAULT_HTTP_DOWN,        // HTTP endpoint unreachable: requests block for their timeout, then fail
+    FAULT_LINK_DOWN,        // WiFi lost: sockets fail, the station reports offline after the detect delay
+    FAULT_COUNT
+} fault_id_t;
+
+void fault_set(fault_id_t id, bool active);
+bool fault_is_active(fault_id_t id);
+
+// Esp_timer time at which the fault was last raised (0 if never)
+int64_t fault_since_us(fault_id_t id);
+
+// Calls failed by this fault since the last fault_reset_counters()
+uint32_t fault_hits(fault_id_t id);
+void fault_note_hit(fault_id_t id);
+void fault_reset_counters(void);
+
+const char* fault_name(fault_id_t id);
+
+// Paths under this directory belong to the simulated SD card
+void fault_set_sd_root(const char* path);
+bool fault_is_sd_path(const char* path);
+
+// How long the station takes to notice a lost link (beacon timeout), default 6000 ms
+void fault_set_link_detect_ms(uint32_t ms);
+
+// Enable link tracking: the connectivity stand-in reports itself active and
+// follows FAULT_LINK_DOWN, so LogManager gates network sinks as on the device
+void fault_track_link(bool enable);
+bool fault_link_tracked(void);
+
+// Station view of the link: false once FAULT_LINK_DOWN has lasted the detect delay
+bool fault_link_online(void);
+
+#ifdef __cplusplus
+}
+#endif
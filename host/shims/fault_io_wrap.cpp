@@ -0,0 +1,141 @@
+// Link-time wrappers that route the FAT and socket calls through the fault switches
+//
+// Only linked into harnesses built with
+//   -Wl,--wrap=fopen,--wrap=fclose,--wrap=fwrite,--wrap=fflush,--wrap=stat
+//   -Wl,--wrap=connect,--wrap=send,--wrap=sendto
+// Streams opened under the SD root (fault_set_sd_root) fail as a removed or
+// full card would; every other call goes straight to libc.
+#include "fault_injection.h"
+#include <errno.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <vector>
+
+extern "C" {
+FILE* __real_fopen(const char* path, const char* mode);
+int __real_fclose(FILE* stream);
+size_t __real_fwrite(const void* ptr, size_t size, size_t n, FILE* stream);
+int __real_fflush(FILE* stream);
+int __real_stat(const char* path, struct stat* st);
+int __real_connect(int fd, const struct sockaddr* addr, socklen_t len);
+ssize_t __real_send(int fd, const void* buf, size_t len, int flags);
+ssize_t __real_sendto(int fd, const void* buf, size_t len, int flags, const struct sockaddr* addr, socklen_t alen);
+}
+
+namespace {
+
+// Streams on the simulated card; a handful at most
+std::vector<FILE*> g_sd_streams;
+
+bool isSdStream(FILE* stream) {
+    return !g_sd_streams.empty() &&
+           std::find(g_sd_streams.begin(), g_sd_streams.end(), stream) != g_sd_streams.end();
+}
+
+// Errno a card write fails with right now, 0 if it may proceed
+int sdWriteError() {
+    if (fault_is_active(FAULT_SD_REMOVED)) {
+        fault_note_hit(FAULT_SD_REMOVED);
+        return EIO;
+    }
+    if (fault_is_active(FAULT_SD_FULL)) {
+        fault_note_hit(FAULT_SD_FULL);
+        return ENOSPC;
+    }
+    return 0;
+}
+
+int linkError() {
+    if (fault_is_active(FAULT_LINK_DOWN)) {
+        fault_note_hit(FAULT_LINK_DOWN);
+        return ENETUNREACH;
+    }
+    return 0;
+}
+
+} // namespace
+
+extern "C" FILE* __wrap_fopen(const char* path, const char* mode) {
+    if (!fault_is_sd_path(path)) {
+        return __real_fopen(path, mode);
+    }
+    if (fault_is_active(FAULT_SD_REMOVED)) {
+        fault_note_hit(FAULT_SD_REMOVED);
+        errno = ENOENT;
+        return nullptr;
+    }
+    FILE* stream = __real_fopen(path, mode);
+    if (stream) {
+        g_sd_streams.push_back(stream);
+    }
+    return stream;
+}
+
+extern "C" int __wrap_fclose(FILE* stream) {
+    auto it = std::find(g_sd_streams.begin(), g_sd_streams.end(), stream);
+    if (it != g_sd_streams.end()) {
+        g_sd_streams.erase(it);
+    }
+    return __real_fclose(stream);
+}
+
+extern "C" size_t __wrap_fwrite(const void* ptr, size_t size, size_t n, FILE* stream) {
+    if (isSdStream(stream)) {
+        const int err = sdWriteError();
+        if (err) {
+            errno = err;
+            return 0;
+        }
+    }
+    return __real_fwrite(ptr, size, n, stream);
+}
+
+extern "C" int __wrap_fflush(FILE* stream) {
+    if (stream && isSdStream(stream)) {
+        const int err = sdWriteError();
+        if (err) {
+            errno = err;
+            return EOF;
+        }
+    }
+    return __real_fflush(stream);
+}
+
+extern "C" int __wrap_stat(const char* path, struct stat* st) {
+    if (fault_is_sd_path(path) && fault_is_active(FAULT_SD_REMOVED)) {
+        fault_note_hit(FAULT_SD_REMOVED);
+        errno = ENOENT;
+        return -1;
+    }
+    return __real_stat(path, st);
+}
+
+extern "C" int __wrap_connect(int fd, const struct sockaddr* addr, socklen_t len) {
+    const int err = linkError();
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return __real_connect(fd, addr, len);
+}
+
+extern "C" ssize_t __wrap_send(int fd, const void* buf, size_t len, int flags) {
+    const int err = linkError();
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return __real_send(fd, buf, len, flags);
+}
+
+extern "C" ssize_t __wrap_sendto(int fd, const void* buf, size_t len, int flags,
+                                 const struct sockaddr* addr, socklen_t alen) {
+    const int err = linkError();
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return __real_sendto(fd, buf, len, flags, addr, alen);
+}
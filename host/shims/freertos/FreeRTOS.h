@@ -0,0 +1,11 @@
+#pragma once
+// Host stand-in for FreeRTOS.h: tick type and conversions only (1 tick = 1 ms)
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define portTICK_PERIOD_MS      1
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))
+#define pdTRUE                  1
+#define pdFALSE                 0
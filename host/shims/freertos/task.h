@@ -0,0 +1,14 @@
+#pragma once
+// Host stand-in for FreeRTOS task.h: delays go through the host clock
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,35 @@
+#pragma once
+// Virtual time for host harnesses
+//
+// Once enabled, esp_timer_get_time() returns the virtual monotonic clock and
+// time() (wrapped at link time with -Wl,--wrap=time on Linux) returns the
+// virtual wall clock. Both only move when host_clock_advance_us() is called.
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void host_clock_set_virtual(time_t epoch);
+void host_clock_advance_us(int64_t us);
+bool host_clock_is_virtual(void);
+
+// Real monotonic microseconds, unaffected by the virtual clock
+int64_t host_clock_real_us(void);
+
+// Block the caller: advances the virtual clock when enabled, sleeps otherwise.
+// Used by stand-ins that model a blocking call (vTaskDelay, transport timeouts).
+void host_clock_sleep_us(int64_t us);
+
+// Run fn every time the clock moves; stands in for the background tasks of
+// ESP-IDF components (e.g. the esp-mqtt client task). Not re-entered.
+void host_clock_add_ticker(void (*fn)(void));
+
+// True when time() calls from the shared sources follow the virtual clock
+bool host_clock_wall_is_virtual(void);
+
+#ifdef __cplusplus
+}
+#endif
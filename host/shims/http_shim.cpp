@@ -0,0 +1,60 @@
+// Host esp_http_client: an in-process endpoint with a fixed round trip
+#include <esp_http_client.h>
+#include "fault_injection.h"
+#include "host_clock.h"
+
+namespace {
+
+// LAN round trip for a small POST, connection setup included
+constexpr int64_t ROUND_TRIP_US = 20000;
+constexpr int DEFAULT_TIMEOUT_MS = 5000;
+
+} // namespace
+
+struct esp_http_client {
+    int timeout_ms = DEFAULT_TIMEOUT_MS;
+    int body_len = 0;
+};
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t* config) {
+    if (!config || !config->url) {
+        return nullptr;
+    }
+    esp_http_client* client = new esp_http_client();
+    if (config->timeout_ms > 0) {
+        client->timeout_ms = config->timeout_ms;
+    }
+    return client;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char* key, const char* value) {
+    return client && key && value ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char* data, int len) {
+    if (!client || (!data && len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    client->body_len = len;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client) {
+    if (!client) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const fault_id_t fault = fault_is_active(FAULT_LINK_DOWN) ? FAULT_LINK_DOWN : FAULT_HTTP_DOWN;
+    if (fault_is_active(fault)) {
+        // Connect never completes: the caller is blocked for the whole timeout
+        fault_note_hit(fault);
+        host_clock_sleep_us((int64_t)client->timeout_ms * 1000);
+        return ESP_ERR_HTTP_CONNECT;
+    }
+    host_clock_sleep_us(ROUND_TRIP_US);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client) {
+    delete client;
+    return ESP_OK;
+}
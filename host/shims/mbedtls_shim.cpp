@@ -0,0 +1,23 @@
+// mbedtls HMAC on top of OpenSSL libcrypto (see mbedtls/md.h)
+#include <mbedtls/md.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+struct mbedtls_md_info_t {
+    mbedtls_md_type_t type;
+};
+
+static const mbedtls_md_info_t SHA256_INFO = { MBEDTLS_MD_SHA256 };
+
+const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t md_type) {
+    return md_type == MBEDTLS_MD_SHA256 ? &SHA256_INFO : nullptr;
+}
+
+int mbedtls_md_hmac(const mbedtls_md_info_t* md_info, const unsigned char* key, size_t keylen,
+                    const unsigned char* input, size_t ilen, unsigned char* output) {
+    if (md_info != &SHA256_INFO) {
+        return -1;
+    }
+    unsigned int len = 0;
+    return HMAC(EVP_sha256(), key, (int)keylen, input, ilen, output, &len) ? 0 : -1;
+}
@@ -0,0 +1,26 @@
+#pragma once
+// Broker side of the in-process esp-mqtt stand-in (shims/mqtt_shim.cpp)
+//
+// Harnesses that need to see what reaches the broker install a hook; it runs
+// synchronously inside esp_mqtt_client_publish() for every accepted message.
+// mqtt_broker_deliver() plays the other direction, a message published by
+// some remote client, and runs the subscribers' event handlers synchronously.
+#include "mqtt_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*mqtt_broker_hook_t)(void* arg, esp_mqtt_client_handle_t client, const char* topic,
+                                   const char* data, int len, int qos);
+
+// NULL removes the hook
+void mqtt_broker_set_hook(mqtt_broker_hook_t hook, void* arg);
+
+// Post MQTT_EVENT_DATA to every connected client subscribed to topic;
+// returns the number of clients it reached
+int mqtt_broker_deliver(const char* topic, const char* data, int len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,280 @@
+// Host esp-mqtt client talking to an in-process broker
+//
+// The real client runs its own task; here the state machine advances whenever
+// the host clock moves (host_clock_add_ticker) and on every API call.
+//   - connect attempts succeed unless FAULT_BROKER_DOWN or FAULT_LINK_DOWN is set;
+//     a failed attempt is retried after network.reconnect_timeout_ms
+//   - FAULT_BROKER_DOWN drops the session at once (broker closed the socket)
+//   - the session also drops once the station reports the link offline
+//   - publishing into a dead link the station has not noticed yet blocks for
+//     network.timeout_ms before the write fails and the session drops
+//   - a started client connects at once when the broker is reachable
+//   - accepted publishes are passed to the broker hook (mqtt_broker.h)
+//   - subscriptions live for the session; mqtt_broker_deliver() posts
+//     MQTT_EVENT_DATA to connected clients with a matching filter
+#include <mqtt_client.h>
+#include <esp_timer.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "fault_injection.h"
+#include "host_clock.h"
+#include "mqtt_broker.h"
+
+namespace {
+
+constexpr int DEFAULT_RECONNECT_TIMEOUT_MS = 10000;
+constexpr int DEFAULT_NETWORK_TIMEOUT_MS = 10000;
+
+enum class ClientState {
+    STOPPED,
+    WAITING,      // next connect attempt at next_attempt_us
+    CONNECTED
+};
+
+} // namespace
+
+struct esp_mqtt_client {
+    ClientState state = ClientState::STOPPED;
+    int64_t next_attempt_us = 0;
+    int reconnect_timeout_ms = DEFAULT_RECONNECT_TIMEOUT_MS;
+    int network_timeout_ms = DEFAULT_NETWORK_TIMEOUT_MS;
+    bool auto_reconnect = true;
+    int next_msg_id = 0;
+    size_t outbox = 0;                 // enqueued while offline, sent on reconnect
+    std::vector<std::string> subscriptions;
+    esp_event_handler_t handler = nullptr;
+    void* handler_arg = nullptr;
+};
+
+namespace {
+
+std::vector<esp_mqtt_client*> g_clients;
+mqtt_broker_hook_t g_broker_hook = nullptr;
+void* g_broker_hook_arg = nullptr;
+
+void postEvent(esp_mqtt_client* client, esp_mqtt_event_id_t id, int msg_id = 0) {
+    if (!client->handler) {
+        return;
+    }
+    esp_mqtt_event_t event = {};
+    event.event_id = id;
+    event.client = client;
+    event.msg_id = msg_id;
+    client->handler(client->handler_arg, "MQTT_EVENTS", id, &event);
+}
+
+bool brokerReachable() {
+    return !fault_is_active(FAULT_BROKER_DOWN) && !fault_is_active(FAULT_LINK_DOWN);
+}
+
+void dropSession(esp_mqtt_client* client, int64_t now_us) {
+    client->state = ClientState::WAITING;
+    client->next_attempt_us = now_us + (int64_t)client->reconnect_timeout_ms * 1000;
+    client->subscriptions.clear();
+    postEvent(client, MQTT_EVENT_DISCONNECTED);
+}
+
+// Exact match, or a filter ending in "/#" matching everything below its prefix
+bool topicMatches(const std::string& filter, const char* topic) {
+    if (filter.size() >= 2 && filter.compare(filter.size() - 2, 2, "/#") == 0) {
+        return strncmp(topic, filter.c_str(), filter.size() - 1) == 0;
+    }
+    return filter == topic;
+}
+
+void service(esp_mqtt_client* client) {
+    const int64_t now_us = esp_timer_get_time();
+    if (client->state == ClientState::CONNECTED) {
+        if (fault_is_active(FAULT_BROKER_DOWN)) {
+            fault_note_hit(FAULT_BROKER_DOWN);
+            dropSession(client, now_us);
+        } else if (!fault_link_online()) {
+            fault_note_hit(FAULT_LINK_DOWN);
+            dropSession(client, now_us);
+        }
+        return;
+    }
+    if (client->state != ClientState::WAITING || now_us < client->next_attempt_us) {
+        return;
+    }
+    if (!brokerReachable()) {
+        fault_note_hit(fault_is_active(FAULT_LINK_DOWN) ? FAULT_LINK_DOWN : FAULT_BROKER_DOWN);
+        client->state = client->auto_reconnect ? ClientState::WAITING : ClientState::STOPPED;
+        client->next_attempt_us = now_us + (int64_t)client->reconnect_timeout_ms * 1000;
+        postEvent(client, MQTT_EVENT_ERROR);
+        postEvent(client, MQTT_EVENT_DISCONNECTED);
+        return;
+    }
+    client->state = ClientState::CONNECTED;
+    client->outbox = 0;
+    postEvent(client, MQTT_EVENT_CONNECTED);
+}
+
+void serviceAll() {
+    // Handlers may stop or destroy clients; iterate over a copy
+    const std::vector<esp_mqtt_client*> clients = g_clients;
+    for (auto* client : clients) {
+        if (std::find(g_clients.begin(), g_clients.end(), client) != g_clients.end()) {
+            service(client);
+        }
+    }
+}
+
+} // namespace
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t* config) {
+    if (!config) {
+        return nullptr;
+    }
+    esp_mqtt_client* client = new esp_mqtt_client();
+    if (config->network.reconnect_timeout_ms > 0) {
+        client->reconnect_timeout_ms = config->network.reconnect_timeout_ms;
+    }
+    if (config->network.timeout_ms > 0) {
+        client->network_timeout_ms = config->network.timeout_ms;
+    }
+    client->auto_reconnect = !config->network.disable_auto_reconnect;
+    g_clients.push_back(client);
+    host_clock_add_ticker(serviceAll);
+    return client;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t,
+                                         esp_event_handler_t event_handler, void* event_handler_arg) {
+    if (!client) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    client->handler = event_handler;
+    client->handler_arg = event_handler_arg;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client) {
+    if (!client) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (client->state != ClientState::STOPPED) {
+        return ESP_FAIL;
+    }
+    client->state = ClientState::WAITING;
+    client->next_attempt_us = esp_timer_get_time();
+    service(client);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client) {
+    if (!client) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    client->state = ClientState::STOPPED;
+    client->subscriptions.clear();
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_destroy(esp_mqtt_client_handle_t client) {
+    if (!client) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    g_clients.erase(std::remove(g_clients.begin(), g_clients.end(), client), g_clients.end());
+    delete client;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_reconnect(esp_mqtt_client_handle_t client) {
+    if (!client || client->state == ClientState::STOPPED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (client->state == ClientState::WAITING) {
+        client->next_attempt_us = esp_timer_get_time();
+        service(client);
+    }
+    return ESP_OK;
+}
+
+void mqtt_broker_set_hook(mqtt_broker_hook_t hook, void* arg) {
+    g_broker_hook = hook;
+    g_broker_hook_arg = arg;
+}
+
+int mqtt_broker_deliver(const char* topic, const char* data, int len) {
+    if (!topic) {
+        return 0;
+    }
+    serviceAll();
+    int delivered = 0;
+    const std::vector<esp_mqtt_client*> clients = g_clients;
+    for (auto* client : clients) {
+        if (std::find(g_clients.begin(), g_clients.end(), client) == g_clients.end() ||
+            client->state != ClientState::CONNECTED || !client->handler) {
+            continue;
+        }
+        const auto& subs = client->subscriptions;
+        if (std::none_of(subs.begin(), subs.end(), [topic](const std::string& f) { return topicMatches(f, topic); })) {
+            continue;
+        }
+        std::string topic_copy(topic);
+        std::string payload(data ? data : "", len > 0 ? (size_t)len : 0);
+        esp_mqtt_event_t event = {};
+        event.event_id = MQTT_EVENT_DATA;
+        event.client = client;
+        event.topic = &topic_copy[0];
+        event.topic_len = (int)topic_copy.size();
+        event.data = &payload[0];
+        event.data_len = (int)payload.size();
+        event.total_data_len = event.data_len;
+        event.qos = 1;
+        client->handler(client->handler_arg, "MQTT_EVENTS", MQTT_EVENT_DATA, &event);
+        delivered++;
+    }
+    return delivered;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char* topic, const char* data,
+                            int len, int qos, int retain) {
+    (void)retain;
+    if (!client || !topic) {
+        return -1;
+    }
+    service(client);
+    if (client->state != ClientState::CONNECTED) {
+        return -1;
+    }
+    if (fault_is_active(FAULT_LINK_DOWN)) {
+        // Write into a dead link: blocks until the transport times out
+        fault_note_hit(FAULT_LINK_DOWN);
+        host_clock_sleep_us((int64_t)client->network_timeout_ms * 1000);
+        if (client->state == ClientState::CONNECTED) {
+            dropSession(client, esp_timer_get_time());
+        }
+        return -1;
+    }
+    if (g_broker_hook) {
+        g_broker_hook(g_broker_hook_arg, client, topic, data, len > 0 ? len : (data ? (int)strlen(data) : 0), qos);
+    }
+    return ++client->next_msg_id;
+}
+
+int esp_mqtt_client_enqueue(esp_mqtt_client_handle_t client, const char* topic, const char* data,
+                            int len, int qos, int retain, bool store) {
+    if (!client || !topic) {
+        return -1;
+    }
+    if (client->state != ClientState::CONNECTED && store) {
+        client->outbox++;
+        return ++client->next_msg_id;
+    }
+    return esp_mqtt_client_publish(client, topic, data, len, qos, retain);
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char* topic, int qos) {
+    (void)qos;
+    if (!client || !topic || client->state != ClientState::CONNECTED) {
+        return -1;
+    }
+    if (std::find(client->subscriptions.begin(), client->subscriptions.end(), topic) == client->subscriptions.end()) {
+        client->subscriptions.push_back(topic);
+    }
+    return ++client->next_msg_id;
+}
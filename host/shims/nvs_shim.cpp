@@ -0,0 +1,98 @@
+// In-memory NVS for host builds: persisted analytics state lives for the process lifetime
+#include <nvs.h>
+#include <nvs_flash.h>
+#include <string.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::mutex g_nvs_mutex;
+std::map<std::string, std::vector<uint8_t>> g_nvs_store;  // "<namespace>/<key>"
+std::map<nvs_handle_t, std::string> g_nvs_handles;
+nvs_handle_t g_next_handle = 1;
+
+std::string storeKey(nvs_handle_t handle, const char* key) {
+    auto it = g_nvs_handles.find(handle);
+    return it == g_nvs_handles.end() ? std::string() : it->second + "/" + key;
+}
+
+} // namespace
+
+esp_err_t nvs_flash_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    std::lock_guard<std::mutex> lock(g_nvs_mutex);
+    g_nvs_store.clear();
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle) {
+    (void)open_mode;
+    if (!name || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(g_nvs_mutex);
+    *out_handle = g_next_handle++;
+    g_nvs_handles[*out_handle] = name;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(g_nvs_mutex);
+    g_nvs_handles.erase(handle);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> lock(g_nvs_mutex);
+    return g_nvs_handles.count(handle) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length) {
+    if (!key || !length) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(g_nvs_mutex);
+    auto it = g_nvs_store.find(storeKey(handle, key));
+    if (it == g_nvs_store.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (!out_value) {
+        *length = it->second.size();
+        return ESP_OK;
+    }
+    if (*length < it->second.size()) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, it->second.data(), it->second.size());
+    *length = it->second.size();
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+    if (!key || (!value && length)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(g_nvs_mutex);
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    g_nvs_store[storeKey(handle, key)].assign(bytes, bytes + length);
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char* key, uint32_t* out_value) {
+    size_t len = sizeof(*out_value);
+    return nvs_get_blob(handle, key, out_value, &len);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char* key, uint32_t value) {
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    std::lock_guard<std::mutex> lock(g_nvs_mutex);
+    return g_nvs_store.erase(storeKey(handle, key)) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
@@ -0,0 +1,63 @@
+// Host SD card: the mount point is an ordinary directory, capacity comes from statvfs()
+#include <esp_vfs_fat.h>
+#include "fault_injection.h"
+#include <driver/gpio.h>
+#include <driver/spi_common.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+namespace {
+
+sdmmc_card_t g_card = { { "HOST" }, { 0, 512, 0 }, 1UL << 30 };
+
+} // namespace
+
+esp_err_t gpio_set_drive_capability(gpio_num_t, gpio_drive_cap_t) {
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t, gpio_pull_mode_t) {
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t, const spi_bus_config_t*, int) {
+    return ESP_OK;
+}
+
+esp_err_t esp_vfs_fat_sdspi_mount(const char* base_path, const sdmmc_host_t*, const sdspi_device_config_t*,
+                                  const esp_vfs_fat_sdmmc_mount_config_t*, sdmmc_card_t** out_card) {
+    if (mkdir(base_path, 0755) != 0 && errno != EEXIST) {
+        return ESP_FAIL;
+    }
+    uint64_t total = 0;
+    uint64_t free_bytes = 0;
+    if (esp_vfs_fat_info(base_path, &total, &free_bytes) == ESP_OK) {
+        g_card.csd.capacity = (int)(total / (uint64_t)g_card.csd.sector_size);
+    }
+    *out_card = &g_card;
+    return ESP_OK;
+}
+
+esp_err_t esp_vfs_fat_sdcard_unmount(const char*, sdmmc_card_t*) {
+    return ESP_OK;
+}
+
+esp_err_t esp_vfs_fat_info(const char* base_path, uint64_t* out_total_bytes, uint64_t* out_free_bytes) {
+    if (fault_is_active(FAULT_SD_REMOVED)) {
+        fault_note_hit(FAULT_SD_REMOVED);
+        return ESP_FAIL;
+    }
+    struct statvfs vfs;
+    if (statvfs(base_path, &vfs) != 0) {
+        return ESP_FAIL;
+    }
+    *out_total_bytes = (uint64_t)vfs.f_blocks * vfs.f_frsize;
+    *out_free_bytes = (uint64_t)vfs.f_bavail * vfs.f_frsize;
+    if (fault_is_active(FAULT_SD_FULL)) {
+        fault_note_hit(FAULT_SD_FULL);
+        *out_free_bytes = 0;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,19 @@
+#pragma once
+// Host stand-in for ESP-IDF sdmmc_cmd.h: only the card info fields the SD sink logs
+#include <stdint.h>
+
+typedef struct {
+    char name[8];
+} sdmmc_cid_t;
+
+typedef struct {
+    int capacity;
+    int sector_size;
+    int tr_speed;
+} sdmmc_csd_t;
+
+typedef struct {
+    sdmmc_cid_t cid;
+    sdmmc_csd_t csd;
+    uint32_t ocr;
+} sdmmc_card_t;
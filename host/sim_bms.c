@@ -0,0 +1,336 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "sim_bms.h"
+
+static const char *TAG = "sim_bms";
+
+typedef struct {
+    sim_bms_config_t config;
+    uint32_t rng;
+    int64_t last_update_us;
+    float load_a;                // current load step (discharge, positive)
+    int64_t next_step_us;
+
+    // Per-cell state
+    float cell_soc[SIM_MAX_CELLS];
+    float cell_capacity_ah[SIM_MAX_CELLS];
+    float cell_ir_ohm[SIM_MAX_CELLS];
+    float cell_v[SIM_MAX_CELLS];
+    float temps[SIM_MAX_TEMP_SENSORS];
+
+    // Protection trips and the software MOS lock (setMosfet); a FET conducts
+    // only while neither is set
+    bool charge_tripped;
+    bool discharge_tripped;
+    bool charge_locked;
+    bool discharge_locked;
+
+    // Reported values
+    float pack_v;
+    float current_a;             // positive = charging
+    float soc;
+    float peak_current;
+    float peak_power;
+    bool charging_enabled;
+    bool discharging_enabled;
+    int min_cell;
+    int max_cell;
+} sim_bms_handle_t;
+
+static uint32_t sim_rand(sim_bms_handle_t* h) {
+    uint32_t x = h->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    h->rng = x;
+    return x;
+}
+
+// Uniform in [-1, 1)
+static float sim_noise(sim_bms_handle_t* h) {
+    return (float)(sim_rand(h) & 0xFFFF) / 32768.0f - 1.0f;
+}
+
+// LiFePO4-like open circuit voltage: steep knees, long flat plateau
+static float sim_ocv(float soc) {
+    if (soc < 0.0f) soc = 0.0f;
+    if (soc > 1.0f) soc = 1.0f;
+    if (soc < 0.1f) return 2.90f + soc * 3.5f;                 // 2.90 .. 3.25
+    if (soc > 0.95f) return 3.35f + (soc - 0.95f) * 4.0f;      // 3.35 .. 3.55
+    return 3.25f + (soc - 0.1f) * (0.10f / 0.85f);             // plateau
+}
+
+static void sim_step(sim_bms_handle_t* h) {
+    const int64_t now_us = esp_timer_get_time();
+    float dt_s = (float)(now_us - h->last_update_us) / 1e6f;
+    h->last_update_us = now_us;
+    if (dt_s < 0.0f) dt_s = 0.0f;
+    if (dt_s > 60.0f) dt_s = 60.0f;
+
+    // Daily profile by local hour
+    time_t wall = time(NULL);
+    struct tm tm_now;
+    localtime_r(&wall, &tm_now);
+    const int hour = tm_now.tm_hour;
+
+    if (now_us >= h->next_step_us) {
+        // New load step every 1-10 minutes
+        h->load_a = h->config.day_load_a * (1.0f + 0.6f * sim_noise(h));
+        h->next_step_us = now_us + (int64_t)(60 + (sim_rand(h) % 540)) * 1000000LL;
+    }
+
+    float current = 0.0f;
+    if (hour >= 8 && hour < 18) {
+        current = h->discharging_enabled ? -h->load_a : 0.0f;
+    } else if (hour >= 22 || hour < 6) {
+        if (h->charging_enabled) {
+            // CC bulk, then taper as the highest cell nears full
+            float taper = (1.0f - h->cell_soc[h->max_cell]) * 20.0f;
+            if (taper > 1.0f) taper = 1.0f;
+            current = h->config.night_charge_a * taper;
+            if (current < 0.5f) current = 0.0f;
+        }
+    } else {
+        current = -0.3f;  // standby draw
+    }
+    h->current_a = current;
+
+    // Coulomb counting per cell (series string: same current, different capacity)
+    float soc_sum = 0.0f;
+    float pack_v = 0.0f;
+    int min_i = 0;
+    int max_i = 0;
+    for (int i = 0; i < h->config.cell_count; ++i) {
+        h->cell_soc[i] += current * dt_s / 3600.0f / h->cell_capacity_ah[i];
+        if (h->cell_soc[i] < 0.0f) h->cell_soc[i] = 0.0f;
+        if (h->cell_soc[i] > 1.0f) h->cell_soc[i] = 1.0f;
+        h->cell_v[i] = sim_ocv(h->cell_soc[i]) + current * h->cell_ir_ohm[i] + 0.0005f * sim_noise(h);
+        pack_v += h->cell_v[i];
+        soc_sum += h->cell_soc[i];
+        if (h->cell_v[i] < h->cell_v[min_i]) min_i = i;
+        if (h->cell_v[i] > h->cell_v[max_i]) max_i = i;
+    }
+    h->pack_v = pack_v;
+    h->soc = soc_sum / (float)h->config.cell_count;
+    h->min_cell = min_i;
+    h->max_cell = max_i;
+
+    // Protection: stop charging at the first full cell, stop discharging at the first empty one
+    if (h->cell_v[max_i] >= 3.60f) h->charge_tripped = true;
+    if (h->cell_v[max_i] < 3.40f) h->charge_tripped = false;
+    if (h->cell_v[min_i] <= 2.95f) h->discharge_tripped = true;
+    if (h->cell_v[min_i] > 3.20f) h->discharge_tripped = false;
+    h->charging_enabled = !h->charge_tripped && !h->charge_locked;
+    h->discharging_enabled = !h->discharge_tripped && !h->discharge_locked;
+
+    // Temperatures: daily ambient swing plus I^2R self-heating
+    const float ambient = 22.0f + 6.0f * sinf((float)(hour - 9) * 3.14159f / 12.0f);
+    for (int t = 0; t < h->config.temp_count; ++t) {
+        const float target = ambient + current * current * 0.004f + (float)t * 0.5f;
+        h->temps[t] += (target - h->temps[t]) * (dt_s / 600.0f > 1.0f ? 1.0f : dt_s / 600.0f);
+    }
+
+    const float abs_i = fabsf(current);
+    if (abs_i > h->peak_current) h->peak_current = abs_i;
+    if (abs_i * pack_v > h->peak_power) h->peak_power = abs_i * pack_v;
+}
+
+static bool sim_read_measurements(void* bms_handle) {
+    sim_step((sim_bms_handle_t*)bms_handle);
+    return true;
+}
+
+static float sim_get_pack_voltage(void* bms_handle) {
+    return ((sim_bms_handle_t*)bms_handle)->pack_v;
+}
+
+static float sim_get_pack_current(void* bms_handle) {
+    return ((sim_bms_handle_t*)bms_handle)->current_a;
+}
+
+static float sim_get_soc(void* bms_handle) {
+    return ((sim_bms_handle_t*)bms_handle)->soc * 100.0f;
+}
+
+static float sim_get_power(void* bms_handle) {
+    sim_bms_handle_t* h = (sim_bms_handle_t*)bms_handle;
+    return h->pack_v * h->current_a;
+}
+
+static float sim_get_full_capacity(void* bms_handle) {
+    return ((sim_bms_handle_t*)bms_handle)->config.capacity_ah;
+}
+
+static int sim_get_cell_count(void* bms_handle) {
+    return ((sim_bms_handle_t*)bms_handle)->config.cell_count;
+}
+
+static float sim_get_cell_voltage(void* bms_handle, int cell) {
+    sim_bms_handle_t* h = (sim_bms_handle_t*)bms_handle;
+    if (cell >= 0 && cell < h->config.cell_count) {
+        return h->cell_v[cell];
+    }
+    return 0.0f;
+}
+
+static float sim_get_min_cell_voltage(void* bms_handle) {
+    sim_bms_handle_t* h = (sim_bms_handle_t*)bms_handle;
+    return h->cell_v[h->min_cell];
+}
+
+static float sim_get_max_cell_voltage(void* bms_handle) {
+    sim_bms_handle_t* h = (sim_bms_handle_t*)bms_handle;
+    return h->cell_v[h->max_cell];
+}
+
+static int sim_get_min_cell_number(void* bms_handle) {
+    return ((sim_bms_handle_t*)bms_handle)->min_cell + 1;
+}
+
+static int sim_get_max_cell_number(void* bms_handle) {
+    return ((sim_bms_handle_t*)bms_handle)->max_cell + 1;
+}
+
+static int sim_get_temperature_count(void* bms_handle) {
+    return ((sim_bms_handle_t*)bms_handle)->config.temp_count;
+}
+
+static float sim_get_temperature(void* bms_handle, int sensor) {
+    sim_bms_handle_t* h = (sim_bms_handle_t*)bms_handle;
+    if (sensor >= 0 && sensor < h->config.temp_count) {
+        return h->temps[sensor];
+    }
+    return 0.0f;
+}
+
+static float sim_get_max_temperature(void* bms_handle) {
+    sim_bms_handle_t* h = (sim_bms_handle_t*)bms_handle;
+    float max_t = h->temps[0];
+    for (int t = 1; t < h->config.temp_count; ++t) {
+        if (h->temps[t] > max_t) max_t = h->temps[t];
+    }
+    return max_t;
+}
+
+static float sim_get_min_temperature(void* bms_handle) {
+    sim_bms_handle_t* h = (sim_bms_handle_t*)bms_handle;
+    float min_t = h->temps[0];
+    for (int t = 1; t < h->config.temp_count; ++t) {
+        if (h->temps[t] < min_t) min_t = h->temps[t];
+    }
+    return min_t;
+}
+
+static float sim_get_peak_current(void* bms_handle) {
+    return ((sim_bms_handle_t*)bms_handle)->peak_current;
+}
+
+static float sim_get_peak_power(void* bms_handle) {
+    return ((sim_bms_handle_t*)bms_handle)->peak_power;
+}
+
+static bool sim_set_mosfet(void* bms_handle, bool charge_on, bool discharge_on) {
+    sim_bms_handle_t* h = (sim_bms_handle_t*)bms_handle;
+    h->charge_locked = !charge_on;
+    h->discharge_locked = !discharge_on;
+    h->charging_enabled = !h->charge_tripped && !h->charge_locked;
+    h->discharging_enabled = !h->discharge_tripped && !h->discharge_locked;
+    return h->charging_enabled == charge_on && h->discharging_enabled == discharge_on;
+}
+
+static void sim_set_peak_values(void* bms_handle, float peak_current, float peak_power) {
+    sim_bms_handle_t* h = (sim_bms_handle_t*)bms_handle;
+    h->peak_current = peak_current;
+    h->peak_power = peak_power;
+}
+
+static bool sim_is_charging_enabled(void* bms_handle) {
+    return ((sim_bms_handle_t*)bms_handle)->charging_enabled;
+}
+
+static bool sim_is_discharging_enabled(void* bms_handle) {
+    return ((sim_bms_handle_t*)bms_handle)->discharging_enabled;
+}
+
+static float sim_get_cell_voltage_delta(void* bms_handle) {
+    sim_bms_handle_t* h = (sim_bms_handle_t*)bms_handle;
+    return h->cell_v[h->max_cell] - h->cell_v[h->min_cell];
+}
+
+bms_interface_t* sim_bms_create(const sim_bms_config_t* config) {
+    sim_bms_handle_t* handle = calloc(1, sizeof(sim_bms_handle_t));
+    if (!handle) {
+        ESP_LOGE(TAG, "Failed to allocate memory for simulated BMS handle");
+        return NULL;
+    }
+
+    sim_bms_config_t defaults = SIM_BMS_CONFIG_DEFAULT();
+    handle->config = config ? *config : defaults;
+    if (handle->config.cell_count < 1 || handle->config.cell_count > SIM_MAX_CELLS) {
+        handle->config.cell_count = defaults.cell_count;
+    }
+    if (handle->config.temp_count < 1 || handle->config.temp_count > SIM_MAX_TEMP_SENSORS) {
+        handle->config.temp_count = defaults.temp_count;
+    }
+    handle->rng = handle->config.seed ? handle->config.seed : 1;
+
+    for (int i = 0; i < handle->config.cell_count; ++i) {
+        handle->cell_capacity_ah[i] = handle->config.capacity_ah * (1.0f + 0.02f * sim_noise(handle));
+        handle->cell_ir_ohm[i] = 0.0008f * (1.0f + 0.25f * sim_noise(handle));
+        handle->cell_soc[i] = handle->config.initial_soc + 0.01f * sim_noise(handle);
+    }
+    for (int t = 0; t < handle->config.temp_count; ++t) {
+        handle->temps[t] = 22.0f;
+    }
+    handle->charging_enabled = true;
+    handle->discharging_enabled = true;
+    handle->last_update_us = esp_timer_get_time();
+    handle->next_step_us = handle->last_update_us;
+
+    bms_interface_t* interface = calloc(1, sizeof(bms_interface_t));
+    if (!interface) {
+        ESP_LOGE(TAG, "Failed to allocate memory for BMS interface");
+        free(handle);
+        return NULL;
+    }
+
+    interface->handle = handle;
+    interface->readMeasurements = sim_read_measurements;
+    interface->getPackVoltage = sim_get_pack_voltage;
+    interface->getPackCurrent = sim_get_pack_current;
+    interface->getStateOfCharge = sim_get_soc;
+    interface->getPower = sim_get_power;
+    interface->getFullCapacity = sim_get_full_capacity;
+    interface->getCellCount = sim_get_cell_count;
+    interface->getCellVoltage = sim_get_cell_voltage;
+    interface->getMinCellVoltage = sim_get_min_cell_voltage;
+    interface->getMaxCellVoltage = sim_get_max_cell_voltage;
+    interface->getMinCellNumber = sim_get_min_cell_number;
+    interface->getMaxCellNumber = sim_get_max_cell_number;
+    interface->getTemperatureCount = sim_get_temperature_count;
+    interface->getTemperature = sim_get_temperature;
+    interface->getMaxTemperature = sim_get_max_temperature;
+    interface->getMinTemperature = sim_get_min_temperature;
+    interface->getPeakCurrent = sim_get_peak_current;
+    interface->getPeakPower = sim_get_peak_power;
+    interface->isChargingEnabled = sim_is_charging_enabled;
+    interface->isDischargingEnabled = sim_is_discharging_enabled;
+    interface->getCellVoltageDelta = sim_get_cell_voltage_delta;
+    interface->setPeakValues = sim_set_peak_values;
+    interface->setMosfet = sim_set_mosfet;
+
+    ESP_LOGI(TAG, "Simulated BMS created (%d cells, %.0f Ah)", handle->config.cell_count,
+             (double)handle->config.capacity_ah);
+    return interface;
+}
+
+void sim_bms_destroy(bms_interface_t* bms_interface) {
+    if (bms_interface) {
+        free(bms_interface->handle);
+        free(bms_interface);
+    }
+}
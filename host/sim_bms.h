@@ -0,0 +1,43 @@
+#ifndef SIM_BMS_H
+#define SIM_BMS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "bms_interface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_MAX_CELLS 24
+#define SIM_MAX_TEMP_SENSORS 4
+
+// Simulated pack configuration
+typedef struct {
+    int cell_count;              // series cells (<= SIM_MAX_CELLS)
+    int temp_count;              // temperature sensors (<= SIM_MAX_TEMP_SENSORS)
+    float capacity_ah;           // nominal pack capacity
+    float initial_soc;           // 0..1
+    float day_load_a;            // mean discharge current during the day
+    float night_charge_a;        // bulk charge current overnight
+    uint32_t seed;               // cell spread and load noise
+} sim_bms_config_t;
+
+#define SIM_BMS_CONFIG_DEFAULT() { 16, 4, 100.0f, 0.8f, 20.0f, 15.0f, 1 }
+
+/**
+ * Simulated LiFePO4 pack behind the common BMS interface
+ *
+ * Time comes from esp_timer_get_time() and time(), so under the host virtual
+ * clock a daily profile plays out: load steps during the day, rest in the
+ * evening, CC/CV charge overnight. Cells differ slightly in capacity and
+ * internal resistance so spreads, drift and IR estimates are non-trivial.
+ */
+bms_interface_t* sim_bms_create(const sim_bms_config_t* config);
+void sim_bms_destroy(bms_interface_t* bms_interface);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIM_BMS_H
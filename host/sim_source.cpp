@@ -0,0 +1,115 @@
+#include "sim_source.h"
+#include <stdio.h>
+#include <time.h>
+#include <esp_timer.h>
+#include "host_clock.h"
+
+namespace host {
+
+SimSource::SimSource(bms_interface_t* bms, uint32_t interval_ms, uint64_t samples, const char* device_id)
+    : bms_(bms)
+    , interval_us_((int64_t)interval_ms * 1000)
+    , remaining_(samples)
+    , device_id_(device_id ? device_id : "sim")
+{
+}
+
+bool SimSource::open(const std::string&) {
+    start_time_ = esp_timer_get_time();
+    last_time_ = start_time_;
+    next_tick_us_ = (int64_t)start_time_;
+    return true;
+}
+
+bool SimSource::next(output::BMSSnapshot& s) {
+    while (remaining_ > 0) {
+        remaining_--;
+        if (polled_) {
+            waitForTick();
+        }
+        polled_ = true;
+        if (poll(s)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SimSource::poll(output::BMSSnapshot& s) {
+    if (!bms_->readMeasurements(bms_->handle)) {
+        errors_++;
+        return false;
+    }
+    fill(s);
+    return true;
+}
+
+void SimSource::waitForTick() {
+    // Same contract as the periodic timer + task notification in the main loop:
+    // polls sit on a fixed grid, and ticks that fire while the previous cycle is
+    // still running collapse into one pending notification.
+    next_tick_us_ += interval_us_;
+    const int64_t now = esp_timer_get_time();
+    if (now < next_tick_us_) {
+        host_clock_advance_us(next_tick_us_ - now);
+        return;
+    }
+    const int64_t overrun = (now - next_tick_us_) / interval_us_;
+    missed_ += (uint64_t)overrun;
+    next_tick_us_ += overrun * interval_us_;
+}
+
+void SimSource::fill(output::BMSSnapshot& s) {
+    void* h = bms_->handle;
+    const uint64_t current_time = esp_timer_get_time();
+    const float power = bms_->getPower(h);
+    total_energy_wh_ += power * ((double)(current_time - last_time_) / 1e6 / 3600);
+    last_time_ = current_time;
+    const unsigned int elapsed_sec = (unsigned int)((current_time - start_time_) / 1000000);
+
+    s = output::BMSSnapshot{};
+    snprintf(s.device_id, sizeof(s.device_id), "%s", device_id_.c_str());
+    s.boot_id = 1;
+    s.seq = ++seq_;
+    s.start_time_us = start_time_;
+    s.now_time_us = current_time;
+    s.elapsed_sec = elapsed_sec;
+    s.hours = elapsed_sec / 3600;
+    s.minutes = (elapsed_sec % 3600) / 60;
+    s.seconds = elapsed_sec % 60;
+    s.real_timestamp = time(NULL);
+    s.total_energy_wh = total_energy_wh_;
+
+    s.pack_voltage_v = bms_->getPackVoltage(h);
+    s.pack_current_a = bms_->getPackCurrent(h);
+    s.soc_pct = bms_->getStateOfCharge(h);
+    s.power_w = power;
+    s.full_capacity_ah = bms_->getFullCapacity(h);
+    s.peak_current_a = bms_->getPeakCurrent(h);
+    s.peak_power_w = bms_->getPeakPower(h);
+
+    s.cell_count = bms_->getCellCount(h);
+    s.min_cell_voltage_v = bms_->getMinCellVoltage(h);
+    s.max_cell_voltage_v = bms_->getMaxCellVoltage(h);
+    s.min_cell_num = bms_->getMinCellNumber(h);
+    s.max_cell_num = bms_->getMaxCellNumber(h);
+    s.cell_voltage_delta_v = bms_->getCellVoltageDelta(h);
+
+    s.temp_count = bms_->getTemperatureCount(h);
+    s.min_temp_c = bms_->getMinTemperature(h);
+    s.max_temp_c = bms_->getMaxTemperature(h);
+
+    s.charging_enabled = bms_->isChargingEnabled(h);
+    s.discharging_enabled = bms_->isDischargingEnabled(h);
+
+    const int cells = s.cell_count < output::DEFAULT_MAX_CSV_CELLS ? s.cell_count : output::DEFAULT_MAX_CSV_CELLS;
+    for (int i = 0; i < cells; ++i) {
+        s.cell_v[static_cast<size_t>(i)] = bms_->getCellVoltage(h, i);
+    }
+    const int temps = s.temp_count < output::DEFAULT_MAX_CSV_TEMPS ? s.temp_count : output::DEFAULT_MAX_CSV_TEMPS;
+    for (int i = 0; i < temps; ++i) {
+        s.temp_c[static_cast<size_t>(i)] = bms_->getTemperature(h, i);
+    }
+}
+
+} // namespace host
@@ -0,0 +1,55 @@
+#ifndef HOST_SIM_SOURCE_H
+#define HOST_SIM_SOURCE_H
+
+#include <stdint.h>
+#include <string>
+#include "bms_interface.h"
+#include "replay_source.h"
+
+namespace host {
+
+/**
+ * Polls a BMS (normally sim_bms) once per call, advancing the virtual clock to
+ * the next poll tick, and builds the snapshot the way the main loop does
+ *
+ * A stage that blocks past a tick (on the virtual clock) delays the next poll
+ * the way it would on the device; the ticks it swallowed are counted.
+ */
+class SimSource : public replay::ReplaySource {
+public:
+    SimSource(bms_interface_t* bms, uint32_t interval_ms, uint64_t samples, const char* device_id);
+
+    bool open(const std::string& path) override;
+    bool next(output::BMSSnapshot& s) override;
+    bool rewind() override { return false; }
+    void close() override {}
+    size_t getErrorCount() const override { return errors_; }
+
+    // Poll ticks that fell inside an overrunning cycle and were coalesced
+    uint64_t missedPolls() const { return missed_; }
+
+    // Read the BMS now and build a snapshot, for callers that schedule polls
+    // themselves (several simulated devices on one loop); false on a read error
+    bool poll(output::BMSSnapshot& s);
+
+private:
+    void waitForTick();
+    void fill(output::BMSSnapshot& s);
+
+    bms_interface_t* bms_;
+    int64_t interval_us_;
+    uint64_t remaining_;
+    std::string device_id_;
+    size_t errors_ = 0;
+    bool polled_ = false;
+    int64_t next_tick_us_ = 0;
+    uint64_t missed_ = 0;
+    uint64_t start_time_ = 0;
+    uint64_t last_time_ = 0;
+    double total_energy_wh_ = 0.0;
+    uint32_t seq_ = 0;
+};
+
+} // namespace host
+
+#endif // HOST_SIM_SOURCE_H
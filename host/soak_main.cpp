@@ -0,0 +1,451 @@
+// Accelerated-time soak test: simulated BMS -> snapshot -> analytics -> LogManager -> sinks
+//
+//   bms_soak [options]
+//     --days <n>          simulated days (default 30)
+//     --interval-ms <n>   poll interval (default 1000)
+//     --dir <path>        SD card mount point (default ./soak_sd, emptied at start)
+//     --max-lines <n>     SD sink lines per file before a numbered file (default 10000)
+//     --growth-kb <n>     allowed live-heap growth after day 1 (default 64)
+//     --keep-files        keep verified SD files instead of deleting them daily
+//     --verbose           print ESP_LOGI output
+//
+// Time is virtual: esp_timer_get_time() and time() advance one poll interval per
+// sample, so 30 days at 1 Hz run in minutes. Every simulated midnight the files
+// the SD sink wrote for the finished day are checked (header, line count, field
+// count, timestamps inside the day) and heap statistics are printed. Exits
+// non-zero on rotation errors or live-heap growth beyond the limit.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+#include <cJSON.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "host_clock.h"
+#include "host_pipeline.h"
+#include "sim_bms.h"
+#include "sim_source.h"
+#include "log_manager.h"
+#include "log_serializers.h"
+#include "replay_engine.h"
+#include "history_store.h"
+
+namespace fs = std::filesystem;
+
+// ---------------------------------------------------------------------------
+// Allocation accounting (C++ new/delete and cJSON)
+// ---------------------------------------------------------------------------
+
+namespace {
+
+std::atomic<uint64_t> g_allocs{0};
+std::atomic<uint64_t> g_frees{0};
+std::atomic<int64_t> g_live_bytes{0};
+std::atomic<int64_t> g_peak_bytes{0};
+
+size_t usableSize(void* p) {
+#if defined(__APPLE__)
+    return malloc_size(p);
+#else
+    return malloc_usable_size(p);
+#endif
+}
+
+void* trackedAlloc(size_t size) {
+    void* p = malloc(size ? size : 1);
+    if (p) {
+        g_allocs.fetch_add(1, std::memory_order_relaxed);
+        const int64_t live = g_live_bytes.fetch_add((int64_t)usableSize(p), std::memory_order_relaxed) +
+                             (int64_t)usableSize(p);
+        int64_t peak = g_peak_bytes.load(std::memory_order_relaxed);
+        while (live > peak && !g_peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+    }
+    return p;
+}
+
+void trackedFree(void* p) {
+    if (p) {
+        g_frees.fetch_add(1, std::memory_order_relaxed);
+        g_live_bytes.fetch_sub((int64_t)usableSize(p), std::memory_order_relaxed);
+        free(p);
+    }
+}
+
+// Bytes held by the allocator but not in use, as a fragmentation indicator
+struct ArenaInfo {
+    size_t arena = 0;
+    size_t in_use = 0;
+    size_t free_chunks = 0;
+};
+
+ArenaInfo arenaInfo() {
+    ArenaInfo info;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 mi = mallinfo2();
+    info.arena = mi.arena;
+    info.in_use = mi.uordblks;
+    info.free_chunks = mi.fordblks;
+#endif
+    return info;
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    void* p = trackedAlloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    void* p = trackedAlloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return trackedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return trackedAlloc(size);
+}
+
+void operator delete(void* p) noexcept {
+    trackedFree(p);
+}
+
+void operator delete[](void* p) noexcept {
+    trackedFree(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    trackedFree(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    trackedFree(p);
+}
+
+// ---------------------------------------------------------------------------
+// Simulated poll loop as a replay source
+// ---------------------------------------------------------------------------
+
+namespace {
+
+struct SoakOptions {
+    uint32_t days = 30;
+    uint32_t interval_ms = 1000;
+    std::string dir = "soak_sd";
+    uint32_t max_lines = 10000;
+    uint32_t growth_kb = 64;
+    bool keep_files = false;
+};
+
+// 2025-01-01T00:00:00Z; TZ is forced to UTC so file dates are deterministic
+constexpr time_t SOAK_EPOCH = 1735689600;
+
+// ---------------------------------------------------------------------------
+// Daily checks
+// ---------------------------------------------------------------------------
+
+std::string dateOf(time_t t) {
+    struct tm tm_t;
+    gmtime_r(&t, &tm_t);
+    char buf[16];
+    strftime(buf, sizeof(buf), "%Y%m%d", &tm_t);
+    return buf;
+}
+
+size_t countFields(const std::string& line) {
+    size_t n = 1;
+    for (char c : line) {
+        if (c == ',') n++;
+    }
+    return n;
+}
+
+class SoakMonitor {
+public:
+    SoakMonitor(const SoakOptions& options, const std::string& header)
+        : options_(options), header_(header) {
+        if (!header_.empty() && header_.back() == '\n') {
+            header_.pop_back();
+        }
+        header_fields_ = countFields(header_);
+        // Rows carry only the populated cell/temp columns; the header lists the maximum
+        size_t arrays = 0;
+        for (size_t at = header_.find(",cell_v_"); at != std::string::npos; at = header_.find(",cell_v_", at + 1)) {
+            arrays++;
+        }
+        for (size_t at = header_.find(",temp_c_"); at != std::string::npos; at = header_.find(",temp_c_", at + 1)) {
+            arrays++;
+        }
+        fixed_fields_ = header_fields_ - arrays;
+    }
+
+    // Stage run after LogManager::send for every sample
+    void onSample(const output::BMSSnapshot& s) {
+        const std::string date = dateOf(s.real_timestamp);
+        if (current_date_.empty()) {
+            current_date_ = date;
+        }
+        if (date != current_date_) {
+            // The first write of the new day made the SD sink close the old day's files
+            endOfDay();
+            current_date_ = date;
+        }
+        day_samples_++;
+    }
+
+    // Flush and check the final (partial) day
+    void finish() {
+        logging::LogManager::getInstance().shutdown();
+        endOfDay();
+    }
+
+    bool passed() const {
+        return rotation_errors_ == 0 && growthBytes() <= (int64_t)options_.growth_kb * 1024;
+    }
+
+    void printSummary() const {
+        fprintf(stderr, "soak: %u days, %llu SD files checked, %u rotation errors\n", day_index_,
+                (unsigned long long)files_checked_, rotation_errors_);
+        fprintf(stderr, "  live heap after day 1: %lld B, at end: %lld B, growth %lld B (limit %u KB)\n",
+                (long long)day1_live_, (long long)g_live_bytes.load(), (long long)growthBytes(),
+                options_.growth_kb);
+        fprintf(stderr, "  heap high-water: %lld B, allocations: %llu, frees: %llu\n",
+                (long long)g_peak_bytes.load(), (unsigned long long)g_allocs.load(),
+                (unsigned long long)g_frees.load());
+    }
+
+private:
+    int64_t growthBytes() const {
+        return day_index_ > 1 ? g_live_bytes.load() - day1_live_ : 0;
+    }
+
+    void endOfDay() {
+        day_index_++;
+        const uint64_t allocs = g_allocs.load();
+        const int64_t live = g_live_bytes.load();
+        if (day_index_ == 1) {
+            day1_live_ = live;
+        }
+
+        size_t files = 0;
+        const uint64_t lines = checkDayFiles(current_date_, files);
+        if (lines != day_samples_) {
+            fprintf(stderr, "  %s: %llu lines on card, %llu samples logged\n", current_date_.c_str(),
+                    (unsigned long long)lines, (unsigned long long)day_samples_);
+            rotation_errors_++;
+        }
+
+        const ArenaInfo arena = arenaInfo();
+        fprintf(stderr,
+                "day %3u %s: %6llu samples, %2zu files, live %7lld B (peak %7lld B), "
+                "%8.1f allocs/sample, arena %zu KB (%.1f%% free)\n",
+                day_index_, current_date_.c_str(), (unsigned long long)day_samples_, files,
+                (long long)live, (long long)g_peak_bytes.load(),
+                day_samples_ ? (double)(allocs - day_allocs_) / (double)day_samples_ : 0.0,
+                arena.arena / 1024, arena.arena ? 100.0 * (double)arena.free_chunks / (double)arena.arena : 0.0);
+
+        day_allocs_ = allocs;
+        day_samples_ = 0;
+    }
+
+    // Validate every file written for one date; returns the data lines found
+    uint64_t checkDayFiles(const std::string& date, size_t& files) {
+        uint64_t total_lines = 0;
+        std::vector<fs::path> day_files;
+        for (const auto& entry : fs::directory_iterator(options_.dir)) {
+            if (entry.is_regular_file() && entry.path().filename().string().rfind(date, 0) == 0) {
+                day_files.push_back(entry.path());
+            }
+        }
+        files = day_files.size();
+
+        std::string line;
+        for (const fs::path& path : day_files) {
+            FILE* f = fopen(path.c_str(), "r");
+            if (!f) {
+                rotationError(path, "cannot open");
+                continue;
+            }
+            files_checked_++;
+            uint64_t file_lines = 0;
+            bool first = true;
+            while (readLine(f, line)) {
+                if (first) {
+                    first = false;
+                    if (line != header_) {
+                        rotationError(path, "missing or stale header");
+                    }
+                    continue;
+                }
+                file_lines++;
+                const size_t fields = countFields(line);
+                if (fields < fixed_fields_ || fields > header_fields_) {
+                    rotationError(path, "field count mismatch");
+                    break;
+                }
+                const char* ts = strchr(line.c_str(), ',');
+                if (!ts || dateOf((time_t)strtoll(ts + 1, nullptr, 10)) != date) {
+                    rotationError(path, "sample from another day");
+                    break;
+                }
+            }
+            fclose(f);
+            if (file_lines > options_.max_lines) {
+                rotationError(path, "exceeds max_lines_per_file");
+            }
+            total_lines += file_lines;
+            if (!options_.keep_files) {
+                fs::remove(path);
+            }
+        }
+        return total_lines;
+    }
+
+    static bool readLine(FILE* f, std::string& line) {
+        line.clear();
+        int c;
+        while ((c = fgetc(f)) != EOF) {
+            if (c == '\n') return true;
+            line.push_back((char)c);
+        }
+        return !line.empty();
+    }
+
+    void rotationError(const fs::path& path, const char* what) {
+        rotation_errors_++;
+        fprintf(stderr, "  rotation error: %s: %s\n", path.filename().c_str(), what);
+    }
+
+    const SoakOptions& options_;
+    std::string header_;
+    size_t header_fields_ = 0;
+    size_t fixed_fields_ = 0;
+    std::string current_date_;
+    uint64_t day_samples_ = 0;
+    uint64_t day_allocs_ = 0;
+    uint32_t day_index_ = 0;
+    int64_t day1_live_ = 0;
+    uint64_t files_checked_ = 0;
+    uint32_t rotation_errors_ = 0;
+};
+
+void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [--days n] [--interval-ms n] [--dir path] [--max-lines n] [--growth-kb n]\n"
+            "          [--keep-files] [--verbose]\n", prog);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    SoakOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--days") == 0 && has_value) {
+            options.days = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--interval-ms") == 0 && has_value) {
+            options.interval_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--dir") == 0 && has_value) {
+            options.dir = argv[++i];
+        } else if (strcmp(arg, "--max-lines") == 0 && has_value) {
+            options.max_lines = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--growth-kb") == 0 && has_value) {
+            options.growth_kb = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--keep-files") == 0) {
+            options.keep_files = true;
+        } else if (strcmp(arg, "--verbose") == 0) {
+            host_log_level = ESP_LOG_INFO;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.days == 0 || options.interval_ms == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    setenv("TZ", "UTC0", 1);
+    tzset();
+    host_clock_set_virtual(SOAK_EPOCH);
+    if (!host_clock_wall_is_virtual()) {
+        fprintf(stderr, "time() is not virtualized on this platform (needs -Wl,--wrap=time)\n");
+        return 2;
+    }
+
+    cJSON_Hooks hooks = { trackedAlloc, trackedFree };
+    cJSON_InitHooks(&hooks);
+
+    // Start from an empty card
+    std::error_code ec;
+    fs::remove_all(options.dir, ec);
+
+    bms_interface_t* bms = sim_bms_create(NULL);
+    if (!bms) {
+        return 1;
+    }
+
+    host::registerHostSinks();
+    const std::string config =
+        "{\"sinks\":["
+        "{\"type\":\"sdcard\",\"config\":{\"mount_point\":\"" + options.dir + "\","
+        "\"max_lines_per_file\":" + std::to_string(options.max_lines) + ",\"min_free_space_mb\":1}},"
+        "{\"type\":\"null\",\"config\":{\"format\":\"json\"}}]}";
+    logging::LogManager& log = logging::LogManager::getInstance();
+    if (!log.init(config)) {
+        fprintf(stderr, "Failed to start sinks\n");
+        return 1;
+    }
+    analytics::HistoryStore::getInstance().init();
+
+    std::unique_ptr<logging::BMSSerializer> csv = logging::BMSSerializer::createSerializer("csv");
+    SoakMonitor monitor(options, csv->getHeader());
+
+    // Stage timing must use the real clock, not the virtual one
+    replay::ReplayEngine engine;
+    engine.setClock(host_clock_real_us);
+    host::addAnalyticsStages(engine);
+    engine.addStage("log_send", [&log](output::BMSSnapshot& s) {
+        log.send(s);
+    });
+    // Idle slot for sinks deferred past the fan-out budget, as in the main loop
+    const uint32_t idle_budget_us = options.interval_ms * 1000;
+    engine.addStage("log_idle", [&log, idle_budget_us](output::BMSSnapshot&) {
+        log.runDeferred(idle_budget_us);
+    });
+    engine.addStage("soak_check", [&monitor](output::BMSSnapshot& s) {
+        monitor.onSample(s);
+    });
+
+    const uint64_t samples = (uint64_t)options.days * 86400ULL * 1000ULL / options.interval_ms;
+    host::SimSource source(bms, options.interval_ms, samples, "soak");
+    source.open("");
+    const replay::ReplayEngine::Report report = engine.run(source, replay::ReplayEngine::Options());
+    monitor.finish();
+
+    fputs(replay::ReplayEngine::formatReport(report).c_str(), stderr);
+    monitor.printSummary();
+    sim_bms_destroy(bms);
+
+    const bool ok = monitor.passed();
+    fprintf(stderr, "soak %s\n", ok ? "PASSED" : "FAILED");
+    return ok ? 0 : 1;
+}
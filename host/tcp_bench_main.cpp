@@ -0,0 +1,488 @@
+// TCP sink against a local server: throughput, coalescing and reconnect time
+//
+//   bms_tcp_bench [options]
+//     --records <n>       records per throughput run (default 50000)
+//     --rate <hz>         record rate of the paced runs (default 20)
+//     --coalesce-ms <n>   latency budget of the paced runs (default 250)
+//     --paced-s <n>       length of the paced run (default 10)
+//     --reconnect-ms <n>  sink reconnect interval (default 1000)
+//     --down-ms <n>       how long the server stays away (default 2000)
+//     --format <f>        csv or json (default csv)
+//     --verbose           print ESP_LOGI output
+//
+// The real TCPLogSink streams simulated snapshots to a loopback server run by
+// the same loop on the real clock. The server reads without blocking and
+// counts records by their sequence number.
+//
+//   throughput  back-to-back records, written at once (coalesce_ms=0) and
+//               coalesced into segments; records/s, writes and send() cost
+//   paced       records at --rate with the --coalesce-ms budget; records per
+//               write and send-to-arrival latency against the budget
+//   reconnect   the server closes the connection and its listener, returns
+//               after --down-ms; time from its return to the reconnect and to
+//               the first record, and what was lost in between
+//
+// One device at 1 Hz with the default 5 s budget coalesces like --rate 20
+// with --coalesce-ms 250. Exits non-zero if records go missing outside the
+// outage or the budget is exceeded.
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <esp_log.h>
+#include "device_shim.h"
+#include "host_clock.h"
+#include "sim_bms.h"
+#include "sim_source.h"
+#include "tcp_log_sink.h"
+
+namespace {
+
+struct BenchOptions {
+    uint32_t records = 50000;
+    uint32_t rate_hz = 20;
+    uint32_t coalesce_ms = 250;
+    uint32_t paced_s = 10;
+    uint32_t reconnect_ms = 1000;
+    uint32_t down_ms = 2000;
+    std::string format = "csv";
+};
+
+/**
+ * Loopback collector stand-in: one listener, one connection at a time,
+ * records split on newlines (CSV) or braces (JSON)
+ */
+class Server {
+public:
+    bool start(uint16_t port) {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        const int one = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(listen_fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(listen_fd_, 4) < 0) {
+            perror("server");
+            return false;
+        }
+        socklen_t len = sizeof(addr);
+        getsockname(listen_fd_, (struct sockaddr*)&addr, &len);
+        port_ = ntohs(addr.sin_port);
+        fcntl(listen_fd_, F_SETFL, O_NONBLOCK);
+        return true;
+    }
+
+    // Close the connection and the listener, dropping anything unread
+    void stop() {
+        if (conn_fd_ >= 0) {
+            close(conn_fd_);
+            conn_fd_ = -1;
+        }
+        if (listen_fd_ >= 0) {
+            close(listen_fd_);
+            listen_fd_ = -1;
+        }
+        partial_.clear();
+        json_depth_ = 0;
+    }
+
+    // Accept and read whatever is there; returns records received
+    size_t poll() {
+        if (conn_fd_ < 0 && listen_fd_ >= 0) {
+            conn_fd_ = accept(listen_fd_, nullptr, nullptr);
+            if (conn_fd_ >= 0) {
+                fcntl(conn_fd_, F_SETFL, O_NONBLOCK);
+                accepts_++;
+                last_accept_us_ = host_clock_real_us();
+                partial_.clear();
+                json_depth_ = 0;
+            }
+        }
+        size_t got = 0;
+        char buf[65536];
+        while (conn_fd_ >= 0) {
+            const ssize_t n = recv(conn_fd_, buf, sizeof(buf), 0);
+            if (n > 0) {
+                got += consume(buf, (size_t)n);
+            } else {
+                if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    close(conn_fd_);
+                    conn_fd_ = -1;
+                }
+                break;
+            }
+        }
+        return got;
+    }
+
+    uint16_t port() const { return port_; }
+    uint32_t accepts() const { return accepts_; }
+    int64_t lastAcceptUs() const { return last_accept_us_; }
+    size_t bytes() const { return bytes_; }
+
+    // Arrival time of each sequence number
+    std::map<uint32_t, int64_t> arrivals;
+
+private:
+    size_t consume(const char* data, size_t n) {
+        bytes_ += n;
+        size_t got = 0;
+        const int64_t now = host_clock_real_us();
+        for (size_t i = 0; i < n; ++i) {
+            const char c = data[i];
+            partial_ += c;
+            if (c == '\n' && (json_depth_ == 0)) {
+                got += record(now);
+                partial_.clear();
+            } else if (c == '{') {
+                json_depth_++;
+            } else if (c == '}') {
+                json_depth_--;
+            }
+        }
+        return got;
+    }
+
+    size_t record(int64_t now) {
+        // JSON: "seq": field; CSV: the last column (skip the header)
+        if (partial_.compare(0, 10, "device_id,") == 0) {
+            return 0;
+        }
+        long seq = -1;
+        const size_t key = partial_.find("\"seq\":");
+        if (key != std::string::npos) {
+            seq = strtol(partial_.c_str() + key + 6, nullptr, 10);
+        } else {
+            const size_t comma = partial_.rfind(',');
+            if (comma != std::string::npos) {
+                seq = strtol(partial_.c_str() + comma + 1, nullptr, 10);
+            }
+        }
+        if (seq < 0) {
+            return 0;
+        }
+        arrivals.emplace((uint32_t)seq, now);
+        return 1;
+    }
+
+    int listen_fd_ = -1;
+    int conn_fd_ = -1;
+    uint16_t port_ = 0;
+    uint32_t accepts_ = 0;
+    int64_t last_accept_us_ = 0;
+    size_t bytes_ = 0;
+    std::string partial_;
+    int json_depth_ = 0;
+};
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const size_t idx = (size_t)(p * (double)(values.size() - 1) + 0.5);
+    return values[std::min(idx, values.size() - 1)];
+}
+
+std::string sinkConfig(const BenchOptions& options, uint16_t port, uint32_t coalesce_ms) {
+    return "{\"mode\":\"client\",\"host\":\"127.0.0.1\",\"port\":" + std::to_string(port) +
+           ",\"format\":\"" + options.format + "\",\"coalesce_ms\":" + std::to_string(coalesce_ms) +
+           ",\"reconnect_interval_ms\":" + std::to_string(options.reconnect_ms) + "}";
+}
+
+void sleepUntil(int64_t until_us) {
+    const int64_t now = host_clock_real_us();
+    if (until_us > now) {
+        usleep((useconds_t)(until_us - now));
+    }
+}
+
+// Back-to-back records; the server is read after every send
+int runThroughput(const char* name, const BenchOptions& options, uint32_t coalesce_ms,
+                  output::BMSSnapshot snapshot) {
+    Server server;
+    if (!server.start(0)) {
+        return 1;
+    }
+    logging::TCPLogSink sink;
+    if (!sink.init(sinkConfig(options, server.port(), coalesce_ms))) {
+        fprintf(stderr, "%s: %s\n", name, sink.getLastError().c_str());
+        return 1;
+    }
+    while (!sink.connect()) {
+        server.poll();
+    }
+
+    const int64_t start = host_clock_real_us();
+    int64_t send_us = 0;
+    int64_t send_max_us = 0;
+    uint32_t accepted = 0;
+    for (uint32_t i = 0; i < options.records; ++i) {
+        snapshot.seq = i + 1;
+        const int64_t t0 = host_clock_real_us();
+        accepted += sink.send(snapshot) ? 1 : 0;
+        const int64_t dt = host_clock_real_us() - t0;
+        send_us += dt;
+        send_max_us = std::max(send_max_us, dt);
+        server.poll();
+    }
+    while (!sink.flush() || server.arrivals.size() < accepted) {
+        if (host_clock_real_us() - start > 30000000) {
+            break;
+        }
+        server.poll();
+    }
+    const double secs = (double)(host_clock_real_us() - start) / 1e6;
+
+    const logging::TCPLogSink::Stats& st = sink.getStats();
+    printf("%-22s %7.0f rec/s %6.1f MB/s  %6zu writes (%5.1f rec, %5.0f B each)  send() avg %5.2f us max %5lld us  drops %u\n",
+           name, server.arrivals.size() / secs, server.bytes() / secs / 1e6, st.writes,
+           st.writes ? (double)st.records_sent / st.writes : 0.0, st.writes ? (double)st.bytes_sent / st.writes : 0.0,
+           (double)send_us / options.records, (long long)send_max_us, (unsigned)sink.getTotalDrops());
+    sink.shutdown();
+    server.stop();
+    if (server.arrivals.size() != accepted) {
+        fprintf(stderr, "%s: %u records accepted, %zu arrived\n", name, accepted, server.arrivals.size());
+        return 1;
+    }
+    return 0;
+}
+
+// Paced records within the budget
+int runPaced(const BenchOptions& options, output::BMSSnapshot snapshot) {
+    Server server;
+    if (!server.start(0)) {
+        return 1;
+    }
+    logging::TCPLogSink sink;
+    if (!sink.init(sinkConfig(options, server.port(), options.coalesce_ms))) {
+        fprintf(stderr, "paced: %s\n", sink.getLastError().c_str());
+        return 1;
+    }
+
+    const int64_t period_us = 1000000 / options.rate_hz;
+    const uint32_t count = options.paced_s * options.rate_hz;
+    std::map<uint32_t, int64_t> sent_at;
+    const int64_t start = host_clock_real_us();
+    for (uint32_t i = 0; i < count; ++i) {
+        sleepUntil(start + (int64_t)i * period_us);
+        snapshot.seq = i + 1;
+        sent_at[snapshot.seq] = host_clock_real_us();
+        sink.send(snapshot);
+        server.poll();
+    }
+    // The last records wait for a next send that never comes
+    sleepUntil(host_clock_real_us() + period_us);
+    sink.flush();
+    const int64_t settle = host_clock_real_us() + 200000;
+    while (server.arrivals.size() < count && host_clock_real_us() < settle) {
+        server.poll();
+    }
+
+    std::vector<double> latency_ms;
+    for (const auto& a : server.arrivals) {
+        auto it = sent_at.find(a.first);
+        if (it != sent_at.end() && a.first < count) {
+            latency_ms.push_back((double)(a.second - it->second) / 1000.0);
+        }
+    }
+    const logging::TCPLogSink::Stats& st = sink.getStats();
+    const double max_ms = latency_ms.empty() ? 0.0 : *std::max_element(latency_ms.begin(), latency_ms.end());
+    printf("paced %3u Hz, %4u ms    %zu/%u arrived, %.1f records per write; latency p50 %.1f ms p99 %.1f ms max %.1f ms\n",
+           options.rate_hz, options.coalesce_ms, server.arrivals.size(), count,
+           st.writes > 1 ? (double)st.records_sent / (st.writes - 1) : 0.0,
+           percentile(latency_ms, 0.5), percentile(latency_ms, 0.99), max_ms);
+    sink.shutdown();
+    server.stop();
+
+    int failures = 0;
+    if (server.arrivals.size() != count) {
+        fprintf(stderr, "paced: %zu of %u records arrived\n", server.arrivals.size(), count);
+        failures++;
+    }
+    // One record interval of slack: the budget is judged at send time
+    if (max_ms > options.coalesce_ms + 1000.0 / options.rate_hz + 20.0) {
+        fprintf(stderr, "paced: latency %.1f ms over the %u ms budget\n", max_ms, options.coalesce_ms);
+        failures++;
+    }
+    return failures;
+}
+
+// Server outage in the middle of a paced stream
+int runReconnect(const BenchOptions& options, output::BMSSnapshot snapshot) {
+    Server server;
+    if (!server.start(0)) {
+        return 1;
+    }
+    const uint16_t port = server.port();
+    logging::TCPLogSink sink;
+    if (!sink.init(sinkConfig(options, port, options.coalesce_ms))) {
+        fprintf(stderr, "reconnect: %s\n", sink.getLastError().c_str());
+        return 1;
+    }
+
+    const int64_t period_us = 1000000 / options.rate_hz;
+    const int64_t start = host_clock_real_us();
+    const int64_t down_at = start + 2000000;
+    const int64_t up_at = down_at + (int64_t)options.down_ms * 1000;
+    const int64_t end_at = up_at + (int64_t)options.reconnect_ms * 1000 + 3000000;
+    bool down = false;
+    bool restarted = false;
+    uint32_t seq = 0;
+    uint32_t last_before_down = 0;
+    int64_t restart_us = 0;
+    int64_t send_max_us = 0;
+
+    for (int64_t tick = start; tick < end_at; tick += period_us) {
+        sleepUntil(tick);
+        const int64_t now = host_clock_real_us();
+        if (!down && !restarted && now >= down_at) {
+            server.poll();
+            last_before_down = seq;
+            server.stop();
+            down = true;
+        }
+        if (down && now >= up_at) {
+            if (!server.start(port)) {
+                return 1;
+            }
+            restart_us = host_clock_real_us();
+            down = false;
+            restarted = true;
+        }
+        snapshot.seq = ++seq;
+        const int64_t t0 = host_clock_real_us();
+        sink.send(snapshot);
+        send_max_us = std::max(send_max_us, host_clock_real_us() - t0);
+        server.poll();
+    }
+    sink.flush();
+    const int64_t settle = host_clock_real_us() + 200000;
+    while (host_clock_real_us() < settle) {
+        server.poll();
+    }
+
+    // First record after the restart that arrived on the new connection
+    int64_t first_after_us = 0;
+    for (const auto& a : server.arrivals) {
+        if (a.second >= restart_us && (first_after_us == 0 || a.second < first_after_us)) {
+            first_after_us = a.second;
+        }
+    }
+    uint32_t missing = 0;
+    uint32_t missing_outside = 0;
+    const uint32_t outage_first = last_before_down + 1;
+    const uint32_t outage_last = outage_first + (uint32_t)((up_at - down_at + (int64_t)options.reconnect_ms * 1000) / period_us) + 2;
+    for (uint32_t s = 1; s <= seq; ++s) {
+        if (!server.arrivals.count(s)) {
+            missing++;
+            if (s < outage_first - options.rate_hz || s > outage_last) {
+                missing_outside++;
+            }
+        }
+    }
+    const logging::TCPLogSink::Stats& st = sink.getStats();
+    printf("reconnect (%u ms down)  server back -> connected %.0f ms, -> first record %.0f ms; "
+           "%u of %u records missing (queue_full %u, transport %u, unread at close %u); send() max %lld us\n",
+           options.down_ms, server.accepts() >= 2 ? (server.lastAcceptUs() - restart_us) / 1000.0 : -1.0,
+           first_after_us ? (first_after_us - restart_us) / 1000.0 : -1.0, missing, seq,
+           (unsigned)sink.getDropCount(logging::DropReason::QUEUE_FULL),
+           (unsigned)sink.getDropCount(logging::DropReason::TRANSPORT),
+           (unsigned)(missing - std::min<uint32_t>(missing, sink.getTotalDrops())), (long long)send_max_us);
+    printf("                         %zu connects, %zu disconnects, %zu refused attempts, ring high-water %u bytes\n",
+           st.connects, st.disconnects, st.connect_failures, (unsigned)st.max_queued_bytes);
+    sink.shutdown();
+    server.stop();
+
+    int failures = 0;
+    if (server.accepts() < 2 || !first_after_us) {
+        fprintf(stderr, "reconnect: sink did not come back\n");
+        failures++;
+    }
+    if (missing_outside) {
+        fprintf(stderr, "reconnect: %u records missing outside the outage\n", missing_outside);
+        failures++;
+    }
+    return failures;
+}
+
+void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [--records n] [--rate hz] [--coalesce-ms n] [--paced-s n]\n"
+            "          [--reconnect-ms n] [--down-ms n] [--format csv|json] [--verbose]\n",
+            prog);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--records") == 0 && has_value) {
+            options.records = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--rate") == 0 && has_value) {
+            options.rate_hz = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--coalesce-ms") == 0 && has_value) {
+            options.coalesce_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--paced-s") == 0 && has_value) {
+            options.paced_s = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--reconnect-ms") == 0 && has_value) {
+            options.reconnect_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--down-ms") == 0 && has_value) {
+            options.down_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--format") == 0 && has_value) {
+            options.format = argv[++i];
+        } else if (strcmp(arg, "--verbose") == 0) {
+            host_log_level = ESP_LOG_INFO;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.records == 0 || options.rate_hz == 0 || options.rate_hz > 1000 || options.paced_s == 0 ||
+        (options.format != "csv" && options.format != "json")) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (host_log_level < ESP_LOG_INFO) {
+        host_log_level = ESP_LOG_NONE;
+    }
+
+    // One snapshot from the simulator, restamped with a new seq per record
+    host_device_id_set("tcp-0001");
+    sim_bms_config_t config = SIM_BMS_CONFIG_DEFAULT();
+    bms_interface_t* bms = sim_bms_create(&config);
+    host::SimSource source(bms, 1000, 0, "tcp-0001");
+    source.open(std::string());
+    output::BMSSnapshot snapshot;
+    if (!source.poll(snapshot)) {
+        fprintf(stderr, "simulator read failed\n");
+        return 1;
+    }
+
+    int failures = 0;
+    failures += runThroughput("throughput, immediate", options, 0, snapshot);
+    failures += runThroughput("throughput, coalesced", options, options.coalesce_ms, snapshot);
+    failures += runPaced(options, snapshot);
+    failures += runReconnect(options, snapshot);
+
+    sim_bms_destroy(bms);
+    if (failures) {
+        printf("tcp bench FAILED (%d)\n", failures);
+        return 1;
+    }
+    printf("tcp bench PASSED\n");
+    return 0;
+}
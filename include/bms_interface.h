@@ -52,6 +52,11 @@ typedef float (*bms_get_peak_power_func_t)(void* bms_handle);
 typedef bool (*bms_is_charging_enabled_func_t)(void* bms_handle);
 typedef bool (*bms_is_discharging_enabled_func_t)(void* bms_handle);
 typedef float (*bms_get_cell_voltage_delta_func_t)(void* bms_handle);
+// Seed the running peaks, e.g. with the values checkpointed before a restart
+typedef void (*bms_set_peak_values_func_t)(void* bms_handle, float peak_current, float peak_power);
+// Switch the charge / discharge MOSFETs and read the state back; true once the
+// BMS reports the requested state (isChargingEnabled() etc. are refreshed)
+typedef bool (*bms_set_mosfet_func_t)(void* bms_handle, bool charge_on, bool discharge_on);
 
 // BMS Interface structure
 typedef struct {
@@ -77,6 +82,8 @@ typedef struct {
     bms_is_charging_enabled_func_t isChargingEnabled;
     bms_is_discharging_enabled_func_t isDischargingEnabled;
     bms_get_cell_voltage_delta_func_t getCellVoltageDelta;
+    bms_set_peak_values_func_t setPeakValues;
+    bms_set_mosfet_func_t setMosfet;
 } bms_interface_t;
 
 // BMS type enumeration
@@ -2,11 +2,13 @@
 #include <stdint.h>
 #include <string.h>
 #include <cmath>
+#include <deque>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <driver/uart.h>
 #include <esp_log.h>
 #include <esp_timer.h>
+#include <esp_random.h>
 #include "bms_interface.h"
 #include "daly_bms.h"
 #include "jbd_bms.h"
@@ -21,6 +23,27 @@
 #include "wifi_manager.h"
 #include "status_led.h"
 #include "device_id.h"
+#include "config_store.h"
+#include "connectivity.h"
+#include "cell_stats.h"
+#include "ir_estimator.h"
+#include "soh_estimator.h"
+#include "rainflow.h"
+#include "stress_histogram.h"
+#include "runtime_predictor.h"
+#include "history_store.h"
+#include "anomaly_detector.h"
+#include "loop_timing.h"
+#include "snapshot_checkpoint.h"
+#include "fet_control.h"
+#include "nvs_blob.h"
+#include "replay_engine.h"
+#include "web_ui.h"
+#include "log_serializers.h"
+#include <cJSON.h>
+#include <time.h>
+#include <vector>
+#include "command_router.h"
 
 static const char *TAG = "bms_monitor";
 static constexpr uint32_t INTERVAL_IDLE_MS = 10000;
@@ -28,12 +51,22 @@ static constexpr uint32_t INTERVAL_ACTIVE_MS = 1000;
 static constexpr float THRESHOLD_CURRENT_A = 0.5f;
 static constexpr float THRESHOLD_POWER_W = 10.0f;
 static constexpr uint32_t NOTIFY_READ_BMS = 0x01;
+static constexpr uint32_t NOTIFY_FET_COMMAND = 0x02;
+static constexpr uint32_t NOTIFY_COMMAND = 0x04;
+static constexpr uint32_t IDLE_GUARD_US = 20000;   // idle slot ends this long before the next tick
 
 // Global state
 static TaskHandle_t g_main_task_handle = NULL;
 static esp_timer_handle_t g_periodic_timer = NULL;
 static volatile uint32_t g_current_interval_ms = INTERVAL_IDLE_MS;
 
+// esp_timer time (low 32 bits) of the tick that requested the pending read
+static volatile uint32_t g_tick_us = 0;
+
+// Stamped on every snapshot so consumers can tell lost samples from untaken ones
+static uint32_t g_boot_id = 0;
+static uint32_t g_sample_seq = 0;
+
 // BMS instances
 static bms_interface_t* bms_interface = NULL;
 
@@ -50,10 +83,322 @@ static bool auto_detect_bms_type() {
 
 static void periodic_timer_callback(void* arg) {
     if (g_main_task_handle) {
+        g_tick_us = (uint32_t)esp_timer_get_time();
         xTaskNotify(g_main_task_handle, NOTIFY_READ_BMS, eSetBits);
     }
 }
 
+// Link transitions arrive on the event loop task; only forward them to the LED
+static void on_connectivity_change(const connectivity_info_t* info, void* ctx) {
+    ESP_LOGI(TAG, "Link %s (generation %lu, RSSI %d dBm, disconnects %lu)",
+             info->online ? "up" : "down", (unsigned long)info->generation,
+             info->rssi, (unsigned long)info->disconnect_count);
+    status_led_wifi_t led_wifi = {
+        .connected = info->online,
+        .rssi = info->rssi
+    };
+    status_led_notify_wifi(&led_wifi);
+}
+
+// History backfill: {"from":<unix>,"to":<unix>,"res":<s>,"max":<records>}, streamed in chunks.
+// Queued to the poll task, which sends one chunk per pass through its idle slot
+// (history_backfill_step), resuming from the request's cursor.
+struct HistoryBackfill {
+    analytics::HistoryStore::Cursor cursor;
+    uint32_t interval_s = 0;
+    uint32_t max_records = 0;
+    uint32_t sent = 0;
+    uint32_t seq = 0;
+    logging::CommandRouter::ReplyFn reply;
+};
+
+static constexpr size_t MAX_BACKFILLS = 2;
+static std::deque<HistoryBackfill> g_backfills;   // poll task only
+
+static bool handle_history_query(const std::string& args, const logging::CommandRouter::ReplyFn& reply) {
+    static constexpr uint32_t DEFAULT_RANGE_S = 3600;
+    static constexpr uint32_t MAX_RECORDS_DEFAULT = 2000;
+
+    if (g_backfills.size() >= MAX_BACKFILLS) {
+        reply("{\"error\":\"busy\"}");
+        return false;
+    }
+
+    uint32_t to = (uint32_t)time(NULL);
+    uint32_t from = to - DEFAULT_RANGE_S;
+    uint32_t res = 10;
+    uint32_t max_records = MAX_RECORDS_DEFAULT;
+    if (cJSON* json = cJSON_Parse(args.c_str())) {
+        cJSON* item = cJSON_GetObjectItemCaseSensitive(json, "from");
+        if (cJSON_IsNumber(item)) from = (uint32_t)item->valuedouble;
+        item = cJSON_GetObjectItemCaseSensitive(json, "to");
+        if (cJSON_IsNumber(item)) to = (uint32_t)item->valuedouble;
+        item = cJSON_GetObjectItemCaseSensitive(json, "res");
+        if (cJSON_IsNumber(item) && item->valueint > 0) res = (uint32_t)item->valueint;
+        item = cJSON_GetObjectItemCaseSensitive(json, "max");
+        if (cJSON_IsNumber(item) && item->valueint > 0 && (uint32_t)item->valueint < MAX_RECORDS_DEFAULT) {
+            max_records = (uint32_t)item->valueint;
+        }
+        cJSON_Delete(json);
+    }
+
+    analytics::HistoryStore& history = analytics::HistoryStore::getInstance();
+    const int tier = history.selectTier(res, from);
+    analytics::HistoryStore::TierInfo info{};
+    history.getTierInfo(tier, info);
+
+    HistoryBackfill backfill;
+    backfill.cursor = analytics::HistoryStore::openCursor(tier, from, to);
+    backfill.interval_s = info.interval_s;
+    backfill.max_records = max_records;
+    backfill.reply = reply;
+    g_backfills.push_back(std::move(backfill));
+    return true;
+}
+
+// Send the next chunk of the oldest backfill request
+static void history_backfill_step() {
+    static constexpr size_t CHUNK_RECORDS = 48;
+
+    HistoryBackfill& backfill = g_backfills.front();
+    analytics::HistoryRecord records[CHUNK_RECORDS];
+    size_t want = CHUNK_RECORDS;
+    if (backfill.max_records - backfill.sent < want) want = backfill.max_records - backfill.sent;
+    bool done = true;
+    const size_t n = analytics::HistoryStore::getInstance().read(backfill.cursor, records, want, &done);
+    backfill.sent += n;
+    const bool last = done || backfill.sent >= backfill.max_records;
+
+    std::string chunk = "{\"seq\":" + std::to_string(backfill.seq) +
+                        ",\"interval_s\":" + std::to_string(backfill.interval_s) +
+                        ",\"last\":" + (last ? "true" : "false");
+    if (backfill.seq == 0) {
+        chunk += ",\"fields\":";
+        chunk += analytics::HistoryStore::JSON_FIELDS;
+    }
+    chunk += ",\"rows\":[";
+    analytics::HistoryStore::appendJsonRows(chunk, records, n);
+    chunk += "]}";
+    backfill.seq++;
+    // A dropped chunk ends the request; the client sees no "last" and retries
+    if (!backfill.reply(chunk) || last) {
+        g_backfills.pop_front();
+    }
+}
+
+// Replay of a captured log from the SD card, benchmarking the pipeline on-device:
+// {"path":"/sdcard/bms_0001.csv","realtime":false,"speed":1,"loops":1,"max":0,"sinks":false}
+// Analytics are not replayed here since they hold the live pack state. Replayed samples
+// only reach the configured sinks when "sinks" is true; LogManager serializes them with
+// the poll loop's fan-outs, so each stage timing includes waiting for the lock. They go
+// out as device "replay-<recorded id>" with boot_id and seq 0, so collectors keep them
+// apart from the live stream and leave them out of loss accounting.
+// The task runs at the poll task's priority; an unpaced replay sleeps a tick every
+// REPLAY_YIELD_SAMPLES samples so the poll loop and the idle task still get the CPU.
+// The report goes out on diag/replay.
+struct ReplayRequest {
+    std::string path;
+    replay::ReplayEngine::Options options;
+    bool sinks = false;
+};
+
+static volatile bool g_replay_running = false;
+static constexpr uint32_t REPLAY_YIELD_SAMPLES = 32;
+
+static void replay_task(void* arg) {
+    std::unique_ptr<ReplayRequest> req(static_cast<ReplayRequest*>(arg));
+    std::unique_ptr<replay::ReplaySource> source = replay::ReplaySource::create(req->path);
+    std::string result;
+
+    if (!source || !source->open(req->path)) {
+        result = "{\"error\":\"" + (source ? source->getLastError() : std::string("unsupported format")) + "\"}";
+    } else {
+        replay::ReplayEngine engine;
+        std::unique_ptr<logging::BMSSerializer> serializer = logging::BMSSerializer::createSerializer("json");
+        std::string buffer;
+        uint32_t since_yield = 0;
+        engine.addStage("serialize", [&serializer, &buffer](output::BMSSnapshot& s) {
+            serializer->serialize(s, buffer);
+        });
+        if (req->sinks) {
+            engine.addStage("log_send", [](output::BMSSnapshot& s) {
+                char recorded[sizeof(s.device_id)];
+                memcpy(recorded, s.device_id, sizeof(recorded));
+                snprintf(s.device_id, sizeof(s.device_id), "replay-%s", recorded);
+                s.boot_id = 0;
+                s.seq = 0;
+                LOG_SEND(s);
+            });
+        }
+        if (!req->options.realtime) {
+            engine.addStage("yield", [&since_yield](output::BMSSnapshot&) {
+                if (++since_yield >= REPLAY_YIELD_SAMPLES) {
+                    since_yield = 0;
+                    vTaskDelay(1);
+                }
+            });
+        }
+        const replay::ReplayEngine::Report report = engine.run(*source, req->options);
+        source->close();
+        ESP_LOGI(TAG, "%s", replay::ReplayEngine::formatReport(report).c_str());
+        result = replay::ReplayEngine::reportToJson(report);
+    }
+
+    logging::LogManager::getInstance().publishDiagnostic("replay", result);
+    g_replay_running = false;
+    vTaskDelete(NULL);
+}
+
+static bool handle_replay(const std::string& args, const logging::CommandRouter::ReplyFn& reply) {
+    if (g_replay_running) {
+        return reply("{\"error\":\"replay already running\"}");
+    }
+
+    std::unique_ptr<ReplayRequest> req(new ReplayRequest());
+    if (cJSON* json = cJSON_Parse(args.c_str())) {
+        cJSON* item = cJSON_GetObjectItemCaseSensitive(json, "path");
+        if (cJSON_IsString(item)) req->path = item->valuestring;
+        item = cJSON_GetObjectItemCaseSensitive(json, "realtime");
+        if (cJSON_IsBool(item)) req->options.realtime = cJSON_IsTrue(item);
+        item = cJSON_GetObjectItemCaseSensitive(json, "speed");
+        if (cJSON_IsNumber(item) && item->valuedouble > 0) req->options.speed = (float)item->valuedouble;
+        item = cJSON_GetObjectItemCaseSensitive(json, "loops");
+        if (cJSON_IsNumber(item) && item->valueint > 0) req->options.loops = (uint32_t)item->valueint;
+        item = cJSON_GetObjectItemCaseSensitive(json, "max");
+        if (cJSON_IsNumber(item) && item->valuedouble > 0) req->options.max_samples = (uint64_t)item->valuedouble;
+        item = cJSON_GetObjectItemCaseSensitive(json, "sinks");
+        if (cJSON_IsBool(item)) req->sinks = cJSON_IsTrue(item);
+        cJSON_Delete(json);
+    }
+    if (req->path.empty()) {
+        return reply("{\"error\":\"path required\"}");
+    }
+
+    g_replay_running = true;
+    if (xTaskCreate(replay_task, "replay", 6144, req.get(), tskIDLE_PRIORITY + 1, NULL) != pdPASS) {
+        g_replay_running = false;
+        return reply("{\"error\":\"no memory\"}");
+    }
+    req.release();
+    return reply("{\"started\":true}");
+}
+
+// Stored configuration with the secrets masked
+static bool handle_config(const std::string&, const logging::CommandRouter::ReplyFn& reply) {
+    const bms_config_t* cfg = config_store_get();
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "version", CONFIG_STORE_VERSION);
+    cJSON_AddNumberToObject(json, "sections", cfg->sections);
+    if (cfg->sections & CONFIG_SECTION_DEVICE_ID) {
+        cJSON_AddStringToObject(json, "device_id", cfg->device_id);
+    }
+    if (cfg->sections & CONFIG_SECTION_TIMEZONE) {
+        cJSON_AddStringToObject(json, "timezone", cfg->timezone);
+    }
+    if (cfg->sections & CONFIG_SECTION_MQTT) {
+        cJSON* mqtt = cJSON_AddObjectToObject(json, "mqtt");
+        cJSON_AddStringToObject(mqtt, "host", cfg->mqtt.host);
+        cJSON_AddNumberToObject(mqtt, "port", cfg->mqtt.port);
+        cJSON_AddStringToObject(mqtt, "topic", cfg->mqtt.topic);
+        cJSON_AddBoolToObject(mqtt, "use_device_topic", cfg->mqtt.use_device_topic);
+        cJSON_AddStringToObject(mqtt, "username", cfg->mqtt.username);
+        cJSON_AddBoolToObject(mqtt, "password_set", cfg->mqtt.password[0] != '\0');
+        cJSON_AddNumberToObject(mqtt, "qos", cfg->mqtt.qos);
+    }
+    if (cfg->sections & CONFIG_SECTION_OTA) {
+        cJSON* ota = cJSON_AddObjectToObject(json, "ota");
+        cJSON_AddStringToObject(ota, "server_url", cfg->ota.server_url);
+        cJSON_AddBoolToObject(ota, "cert_set", cfg->ota.cert_pem[0] != '\0');
+        cJSON_AddBoolToObject(ota, "skip_cert_verification", cfg->ota.skip_cert_verification);
+        cJSON_AddNumberToObject(ota, "timeout_ms", cfg->ota.timeout_ms);
+        cJSON_AddStringToObject(ota, "current_version", cfg->ota.current_version);
+        cJSON_AddBoolToObject(ota, "auto_rollback_enabled", cfg->ota.auto_rollback_enabled);
+    }
+    if (cfg->sections & CONFIG_SECTION_CONTROL) {
+        cJSON* control = cJSON_AddObjectToObject(json, "control");
+        cJSON_AddBoolToObject(control, "fet_key_set", cfg->control.fet_key[0] != '\0');
+    }
+    char* text = cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    const bool ok = reply(text ? text : "{\"error\":\"no memory\"}");
+    cJSON_free(text);
+    return ok;
+}
+
+// Remote queries served over the MQTT command topic (<topic>/cmd/<name>)
+static void register_commands() {
+    logging::CommandRouter& router = logging::CommandRouter::getInstance();
+    router.registerCommand("rainflow", [](const std::string&, const logging::CommandRouter::ReplyFn& reply) {
+        std::string json;
+        analytics::RainflowCounter::getInstance().toJson(json);
+        return reply(json);
+    });
+    router.registerCommand("stress", [](const std::string&, const logging::CommandRouter::ReplyFn& reply) {
+        std::string json;
+        analytics::StressHistogram::getInstance().toJson(json);
+        return reply(json);
+    });
+    router.registerCommand("replay", handle_replay);
+    router.registerCommand("timing", [](const std::string&, const logging::CommandRouter::ReplyFn& reply) {
+        std::string json;
+        analytics::LoopTiming::getInstance().toJson(esp_timer_get_time(), json);
+        return reply(json);
+    });
+    router.registerCommand("checkpoint", [](const std::string&, const logging::CommandRouter::ReplyFn& reply) {
+        std::string json;
+        analytics::SnapshotCheckpoint::getInstance().toJson(esp_timer_get_time(), json);
+        return reply(json);
+    });
+    // Authenticated MOSFET writes, executed by the poll task and acknowledged from there
+    router.registerCommand("fet", [](const std::string& args, const logging::CommandRouter::ReplyFn& reply) {
+        return control::FetControl::getInstance().submit(args, reply);
+    });
+    router.registerCommand("fet_status", [](const std::string&, const logging::CommandRouter::ReplyFn& reply) {
+        std::string json;
+        control::FetControl::getInstance().toJson(json);
+        return reply(json);
+    });
+    // LogManager holds its lock across sink I/O, including the MQTT publish,
+    // so its queries run on the poll task rather than the MQTT task
+    router.setQueuedNotify([] { xTaskNotify(g_main_task_handle, NOTIFY_COMMAND, eSetBits); });
+    router.registerQueuedCommand("history", handle_history_query);
+    router.registerQueuedCommand("drops", [](const std::string&, const logging::CommandRouter::ReplyFn& reply) {
+        return reply(logging::LogManager::getInstance().getDropStatsJson());
+    });
+    router.registerQueuedCommand("dispatch", [](const std::string&, const logging::CommandRouter::ReplyFn& reply) {
+        return reply(logging::LogManager::getInstance().getDispatchStatsJson());
+    });
+    router.registerQueuedCommand("pipelines", [](const std::string&, const logging::CommandRouter::ReplyFn& reply) {
+        return reply(logging::LogManager::getInstance().getPipelineStatsJson());
+    });
+    router.registerCommand("config", handle_config);
+    router.registerCommand("web", [](const std::string&, const logging::CommandRouter::ReplyFn& reply) {
+        std::string json;
+        web_ui::WebUi::getInstance().toJson(json);
+        return reply(json);
+    });
+    // Re-read the SPIFFS files after reflashing them; components pick it up on reboot
+    router.registerCommand("config_import", [](const std::string&, const logging::CommandRouter::ReplyFn& reply) {
+        const esp_err_t ret = config_store_import_spiffs();
+        if (ret != ESP_OK) {
+            return reply(std::string("{\"error\":\"") + esp_err_to_name(ret) + "\"}");
+        }
+        return reply("{\"imported\":true,\"reboot_required\":true}");
+    });
+}
+
+// Boot counter kept in NVS; a random ID still separates boots if NVS is unusable
+static uint32_t next_boot_id() {
+    uint32_t boot_id = 0;
+    analytics::nvsBlobLoad("sys", "boot_id", 1, &boot_id, sizeof(boot_id));
+    boot_id++;
+    if (analytics::nvsBlobSave("sys", "boot_id", 1, &boot_id, sizeof(boot_id)) != ESP_OK) {
+        boot_id = esp_random() | 0x80000000u;
+        ESP_LOGW(TAG, "Boot counter not saved, using random boot ID %lu", (unsigned long)boot_id);
+    }
+    return boot_id;
+}
+
 static void update_polling_rate(uint32_t new_interval_ms) {
     if (new_interval_ms != g_current_interval_ms) {
         if (g_periodic_timer) {
@@ -76,12 +421,25 @@ extern "C" void app_main(void)
     status_led_set_tick_period_ms(INTERVAL_IDLE_MS);
     status_led_notify_boot_stage(STATUS_BOOT_STAGE_BOOT);
 
+    // Typed configuration from NVS; the SPIFFS files are only parsed on first boot
+    config_store_init();
+    const bms_config_t* config = config_store_get();
+    g_boot_id = next_boot_id();
+    ESP_LOGI(TAG, "Boot ID: %lu", (unsigned long)g_boot_id);
+
     // Initialize WiFi manager
     ESP_LOGI(TAG, "Initializing WiFi manager...");
     esp_err_t wifi_ret = wifi_manager_init();
     if (wifi_ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize WiFi manager: %s", esp_err_to_name(wifi_ret));
     } else {
+        // Observe link transitions before the first connect attempt
+        if (connectivity_init() == ESP_OK) {
+            connectivity_subscribe(on_connectivity_change, NULL);
+        } else {
+            ESP_LOGW(TAG, "Connectivity bus unavailable, network sinks will not be gated");
+        }
+
         // Load WiFi configuration from file
         wifi_ret = wifi_manager_config_from_file("/spiffs/wifi_config.txt");
         if (wifi_ret == ESP_OK) {
@@ -101,23 +459,9 @@ extern "C" void app_main(void)
     // Initialize SNTP for real timestamps
     ESP_LOGI(TAG, "Initializing SNTP for real timestamps...");
 
-    // Determine timezone from /spiffs/timezone.txt if present, else default to Pacific with DST
-    const char* kDefaultTZ = "PST8PDT,M3.2.0/2,M11.1.0/2";
-    std::string tz = kDefaultTZ;
-
-    if (FILE* f = fopen("/spiffs/timezone.txt", "r")) {
-        char buf[128] = {0};
-        size_t n = fread(buf, 1, sizeof(buf) - 1, f);
-        fclose(f);
-        // Trim trailing whitespace
-        while (n > 0 && (buf[n-1] == '\n' || buf[n-1] == '\r' || buf[n-1] == ' ' || buf[n-1] == '\t')) {
-            n--;
-        }
-        tz.assign(buf, n);
-        if (tz.empty()) {
-            tz = kDefaultTZ;
-        }
-    }
+    // Timezone from the config store (timezone.txt), else default to Pacific with DST
+    const std::string tz = (config->sections & CONFIG_SECTION_TIMEZONE) ? config->timezone
+                                                                        : "PST8PDT,M3.2.0/2,M11.1.0/2";
     ESP_LOGI(TAG, "Using timezone: %s", tz.c_str());
 
     if (!sntp_manager.init("pool.ntp.org", tz)) {
@@ -136,7 +480,7 @@ extern "C" void app_main(void)
     // Initialize OTA manager
     ESP_LOGI(TAG, "Initializing OTA manager...");
     ota_config_t ota_config;
-    esp_err_t ota_config_ret = ota_manager_load_config("/spiffs/ota_config.txt", &ota_config);
+    esp_err_t ota_config_ret = ota_manager_config_from_store(&ota_config);
     if (ota_config_ret == ESP_OK) {
         // Initialize OTA status logger first
         ota_status_logger_init();
@@ -195,6 +539,39 @@ extern "C" void app_main(void)
     } else {
         ESP_LOGI(TAG, "Logging system initialized with configuration: %s", logging_config.c_str());
     }
+    analytics::HistoryStore::getInstance().init();
+
+    // Remote MOSFET control is off unless control_config.txt provided a key
+    {
+        char device_id_buf[33] = "";
+        device_id_get(device_id_buf, sizeof(device_id_buf));
+        control::FetControl& fet = control::FetControl::getInstance();
+        fet.setCredentials((config->sections & CONFIG_SECTION_CONTROL) ? config->control.fet_key : "", device_id_buf);
+        fet.setNotify([] { xTaskNotify(g_main_task_handle, NOTIFY_FET_COMMAND, eSetBits); });
+    }
+    register_commands();
+
+    // Local dashboard on port 80; it runs on its own task, off the poll path
+    if (!web_ui::WebUi::getInstance().start()) {
+        ESP_LOGW(TAG, "Dashboard not available");
+    }
+
+    // Move BMSSnapshot to static to reduce stack usage
+    static output::BMSSnapshot s{};
+
+    // Last-known state from before the restart, flagged stale, so the dashboard
+    // and serial show something before the first read; network sinks are
+    // usually still connecting and only see it if the link came up quickly
+    const bool restored = analytics::SnapshotCheckpoint::getInstance().restore(s);
+    if (restored) {
+        if (device_id_get(s.device_id, sizeof(s.device_id)) != ESP_OK) {
+            snprintf(s.device_id, sizeof(s.device_id), "unknown");
+        }
+        s.boot_id = g_boot_id;
+        s.seq = 0;
+        LOG_SEND(s);
+        web_ui::WebUi::getInstance().publish(s);
+    }
 
     // Auto-detect BMS type
     // Assume 16/17 are the RX/TX pins for UART communication
@@ -214,6 +591,11 @@ extern "C" void app_main(void)
 
     ESP_LOGI(TAG, "BMS interface created successfully");
 
+    // Peaks are lifetime values: carry them over from the checkpoint
+    if (restored) {
+        bms_interface->setPeakValues(bms_interface->handle, s.peak_current_a, s.peak_power_w);
+    }
+
     // Initialize the polling timer
     const esp_timer_create_args_t periodic_timer_args = {
         .callback = &periodic_timer_callback,
@@ -224,6 +606,7 @@ extern "C" void app_main(void)
     ESP_LOGI(TAG, "Started polling timer at %lu ms", INTERVAL_IDLE_MS);
 
     // Trigger initial read
+    g_tick_us = (uint32_t)esp_timer_get_time();
     xTaskNotify(g_main_task_handle, NOTIFY_READ_BMS, eSetBits);
 
     // Configure logging format and prepare runtime CSV header sizing (moved outside loop)
@@ -236,9 +619,6 @@ extern "C" void app_main(void)
     #endif
     static bool g_csv_header_configured = false;
 
-    // Move BMSSnapshot to static to reduce stack usage
-    static output::BMSSnapshot s{};
-
     // Variables for time and energy tracking
     uint64_t start_time = esp_timer_get_time();
     uint64_t last_time = start_time;
@@ -246,16 +626,55 @@ extern "C" void app_main(void)
 
     // Main monitoring loop
     uint32_t notified_value;
+    bool idle_slot_spent = false;
     while (1) {
-        // Wait for notification
-        xTaskNotifyWait(0, ULONG_MAX, &notified_value, portMAX_DELAY);
+        // Wait for notification; with sink work deferred past the fan-out
+        // budget, an empty queue is the idle slot that runs it
+        logging::LogManager& log_manager = logging::LogManager::getInstance();
+        const bool idle_work = log_manager.hasDeferred() || !g_backfills.empty();
+        const TickType_t wait = (idle_work && !idle_slot_spent) ? 0 : portMAX_DELAY;
+        if (xTaskNotifyWait(0, ULONG_MAX, &notified_value, wait) != pdTRUE) {
+            const int32_t until_tick_us = (int32_t)(g_tick_us + g_current_interval_ms * 1000 -
+                                                    (uint32_t)esp_timer_get_time());
+            const int32_t budget_us = until_tick_us - (int32_t)IDLE_GUARD_US;
+            // Deferred sink work first, then one history chunk per pass;
+            // nothing left fits before the tick: the rest waits for the next slot
+            size_t progress = log_manager.hasDeferred()
+                ? log_manager.runDeferred(budget_us > 0 ? (uint32_t)budget_us : 0) : 0;
+            if (progress == 0 && budget_us > 0 && !g_backfills.empty()) {
+                history_backfill_step();
+                progress = 1;
+            }
+            idle_slot_spent = progress == 0;
+            continue;
+        }
+        idle_slot_spent = false;
+
+        // Remote FET writes take the UART ahead of the routine read; a command
+        // that arrives during a read wakes the task again right after it
+        if (notified_value & NOTIFY_FET_COMMAND) {
+            control::FetControl::getInstance().execute(bms_interface);
+        }
+        if (notified_value & NOTIFY_COMMAND) {
+            logging::CommandRouter::getInstance().runQueued();
+        }
 
         if (!(notified_value & NOTIFY_READ_BMS)) {
             continue;
         }
 
+        // Cycle timing; 32-bit microsecond differences survive the wrap
+        analytics::LoopTiming::Cycle timing;
+        const uint32_t tick_us = g_tick_us;
+        const uint32_t wake_us = (uint32_t)esp_timer_get_time();
+        timing.interval_us = g_current_interval_ms * 1000;
+        timing.wake_us = wake_us - tick_us;
+
         // Read all BMS measurements
-        if (bms_interface->readMeasurements(bms_interface->handle)) {
+        timing.read_ok = bms_interface->readMeasurements(bms_interface->handle);
+        const uint32_t read_done_us = (uint32_t)esp_timer_get_time();
+        timing.uart_us = read_done_us - wake_us;
+        if (timing.read_ok) {
             // Get basic measurements
             float voltage = bms_interface->getPackVoltage(bms_interface->handle);
             float current = bms_interface->getPackCurrent(bms_interface->handle);
@@ -304,6 +723,8 @@ extern "C" void app_main(void)
             if (device_id_get(s.device_id, sizeof(s.device_id)) != ESP_OK) {
                 snprintf(s.device_id, sizeof(s.device_id), "unknown");
             }
+            s.boot_id = g_boot_id;
+            s.seq = ++g_sample_seq;
 
             s.start_time_us = start_time;
             s.now_time_us = current_time;
@@ -356,6 +777,49 @@ extern "C" void app_main(void)
                 }
             }
 
+            // Rolling per-cell statistics (1 min / 1 h / 24 h)
+            analytics::CellStats& cell_stats = analytics::CellStats::getInstance();
+            cell_stats.update(s);
+            cell_stats.fillSummary(s);
+
+            // Per-cell internal resistance from load steps, trend published hourly
+            analytics::IREstimator& ir = analytics::IREstimator::getInstance();
+            ir.update(s);
+            ir.fillSnapshot(s);
+            {
+                std::string ir_report;
+                if (ir.takeHourlyReport(current_time, ir_report)) {
+                    logging::LogManager::getInstance().publishDiagnostic("ir", ir_report);
+                }
+            }
+
+            // Capacity / SoH learned between SoC anchors
+            analytics::SohEstimator& soh = analytics::SohEstimator::getInstance();
+            soh.update(s);
+            soh.fillSnapshot(s);
+
+            // Time to empty / full from smoothed power (uses the learned capacity)
+            analytics::RuntimePredictor::getInstance().update(s);
+
+            // Cell drift vs pack median; grade changes go out as an alarm event
+            analytics::AnomalyDetector& anomaly = analytics::AnomalyDetector::getInstance();
+            anomaly.update(s);
+            {
+                std::string alarm;
+                if (anomaly.takeEvent(alarm)) {
+                    logging::LogManager::getInstance().publishDiagnostic("alarm", alarm);
+                }
+            }
+
+            // Tiered in-memory history for dashboard backfill
+            analytics::HistoryStore::getInstance().append(s);
+
+            // Cycle depth / mean SoC histogram for degradation tracking
+            analytics::RainflowCounter::getInstance().update(s);
+
+            // Time at temperature x SoC and C-rate x temperature
+            analytics::StressHistogram::getInstance().update(s);
+
             // Configure CSV header counts once (auto-detect or build-time override) before first emission
             if (g_log_cfg.format == output::OutputFormat::CSV && !g_csv_header_configured) {
                 int hc =
@@ -398,7 +862,14 @@ extern "C" void app_main(void)
                 };
                 status_led_notify_bms(&bm);
             }
+            const uint32_t fanout_us = (uint32_t)esp_timer_get_time();
+            timing.build_us = fanout_us - read_done_us;
             LOG_SEND(s);
+            web_ui::WebUi::getInstance().publish(s);
+            timing.fanout_us = (uint32_t)esp_timer_get_time() - fanout_us;
+
+            // Last-known snapshot and peaks to NVS, rate limited
+            analytics::SnapshotCheckpoint::getInstance().update(s);
 
             // Adaptive polling logic
             bool is_active = (std::abs(current) > THRESHOLD_CURRENT_A) || (std::abs(power) > THRESHOLD_POWER_W);
@@ -425,28 +896,14 @@ extern "C" void app_main(void)
             }
         }
 
-        // Check WiFi status periodically (every 10 readings)
-        static int wifi_check_counter = 0;
-        if (++wifi_check_counter >= 10) {
-            wifi_check_counter = 0;
-            wifi_status_t wifi_status;
-            if (wifi_manager_get_status(&wifi_status) == ESP_OK) {
-                ESP_LOGD(TAG, "WiFi Status: %s, IP: %d.%d.%d.%d, RSSI: %d dBm, Disconnects: %lu",
-                         wifi_manager_get_state_string(wifi_status.state),
-                         (int)(wifi_status.ip_address & 0xFF),
-                         (int)((wifi_status.ip_address >> 8) & 0xFF),
-                         (int)((wifi_status.ip_address >> 16) & 0xFF),
-                         (int)((wifi_status.ip_address >> 24) & 0xFF),
-                         wifi_status.rssi,
-                         wifi_status.disconnect_count);
-                status_led_wifi_t led_wifi = {
-                    .connected = (wifi_status.state == WIFI_STATE_CONNECTED),
-                    .rssi = wifi_status.rssi
-                };
-                status_led_notify_wifi(&led_wifi);
-            }
+        const uint64_t cycle_end_us = esp_timer_get_time();
+        timing.cycle_us = (uint32_t)cycle_end_us - tick_us;
+        analytics::LoopTiming& loop_timing = analytics::LoopTiming::getInstance();
+        loop_timing.record(timing);
+        std::string timing_json;
+        if (loop_timing.takeWindow(cycle_end_us, timing_json)) {
+            logging::LogManager::getInstance().publishDiagnostic("timing", timing_json);
         }
-
     }
 
     // Cleanup
@@ -0,0 +1,625 @@
+// Collector benchmark: runs the collector in-process on loopback and drives it
+// with thousands of simulated devices, then reports sustained samples/s, loss
+// and what reached the column files
+//
+//   bms_collector_bench [options]
+//     --devices <n>       simulated devices (default 2000)
+//     --transport <t>     udp (default), tcp, mqtt
+//     --format <f>        csv (default), json
+//     --rate <hz>         samples per second per device (default 1), 0 = as fast as possible
+//     --seconds <s>       send duration (default 10)
+//     --threads <n>       collector workers (default: one per core)
+//     --senders <n>       sending threads (default 2)
+//     --mqtt-conns <n>    collector connections to the stand-in broker (default 1)
+//     --out <dir>         column file root (default: temporary, removed afterwards)
+//     --keep              keep the output directory
+//
+// Payloads are laid out exactly as CSVSerializer and JSONSerializer produce
+// them. In mqtt mode the benchmark plays the broker: the collector subscribes
+// to it and every device's messages arrive over the collector's connection(s).
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <errno.h>
+#include <ftw.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "collector.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int VARIANTS = 8;   // pre-rendered payloads per device, cycled
+
+struct Options {
+    unsigned devices = 2000;
+    std::string transport = "udp";
+    std::string format = "csv";
+    double rate = 1.0;
+    double seconds = 10.0;
+    unsigned threads = 0;
+    unsigned senders = 2;
+    unsigned mqtt_conns = 1;
+    std::string out;
+    bool keep = false;
+};
+
+struct Device {
+    std::string id;
+    int fd = -1;
+    std::vector<std::string> payloads;
+    std::vector<size_t> seq_at;       // offset of the seq digits in each payload
+    uint32_t seq = 0;
+};
+
+// Payloads are rendered once with a fixed-width seq the senders overwrite
+constexpr int SEQ_DIGITS = 10;
+constexpr uint32_t BENCH_BOOT_ID = 1;
+
+void stampSeq(std::string& payload, size_t at, uint32_t seq) {
+    char digits[SEQ_DIGITS + 1];
+    snprintf(digits, sizeof(digits), "%0*u", SEQ_DIGITS, seq);
+    memcpy(&payload[at], digits, SEQ_DIGITS);
+}
+
+void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [--devices n] [--transport udp|tcp|mqtt] [--format csv|json] [--rate hz]\n"
+            "          [--seconds s] [--threads n] [--senders n] [--mqtt-conns n] [--out dir] [--keep]\n",
+            prog);
+}
+
+// ---- Payloads, in the serializers' exact layout -----------------------------
+
+struct Values {
+    int64_t timestamp;
+    uint32_t elapsed;
+    float energy, voltage, current, soc, power;
+    int cells;
+    float cell_v[16];
+    int temps;
+    float temp_c[4];
+    int min_cell, max_cell;
+    float min_v, max_v;
+};
+
+Values makeValues(unsigned device, int variant, int64_t now_s) {
+    Values v;
+    v.timestamp = now_s;
+    v.elapsed = 3600 + (uint32_t)variant;
+    v.cells = 16;
+    v.temps = 4;
+    v.current = (float)(((int)(device % 40) - 20) * 0.75 + variant * 0.1);
+    v.min_v = 9.9f;
+    v.max_v = 0.0f;
+    v.min_cell = v.max_cell = 1;
+    for (int c = 0; c < v.cells; ++c) {
+        v.cell_v[c] = 3.30f + 0.001f * (float)((device * 7 + (unsigned)c * 13 + (unsigned)variant) % 40);
+        if (v.cell_v[c] < v.min_v) { v.min_v = v.cell_v[c]; v.min_cell = c + 1; }
+        if (v.cell_v[c] > v.max_v) { v.max_v = v.cell_v[c]; v.max_cell = c + 1; }
+    }
+    v.voltage = 0.0f;
+    for (int c = 0; c < v.cells; ++c) {
+        v.voltage += v.cell_v[c];
+    }
+    for (int t = 0; t < v.temps; ++t) {
+        v.temp_c[t] = 20.0f + (float)t + 0.1f * (float)variant;
+    }
+    v.power = v.voltage * v.current;
+    v.soc = 40.0f + (float)(device % 50);
+    v.energy = 1000.0f + (float)device;
+    return v;
+}
+
+std::string csvPayload(const std::string& id, const Values& v, size_t* seq_at) {
+    char buf[1024];
+    int len = snprintf(buf, sizeof(buf),
+        "%s,%lld,%u,%02u:%02u:%02u,%.3f,%.2f,%.2f,%.1f,%.2f,%.2f,%.2f,%.2f,%d,%.3f,%d,%.3f,%d,%.3f,%d,%.1f,%.1f,%d,%d",
+        id.c_str(), (long long)v.timestamp, v.elapsed, v.elapsed / 3600, (v.elapsed / 60) % 60, v.elapsed % 60,
+        v.energy, v.voltage, v.current, v.soc, v.power, 100.0, 30.0, 1500.0, v.cells, v.min_v, v.min_cell,
+        v.max_v, v.max_cell, v.max_v - v.min_v, v.temps, v.temp_c[0], v.temp_c[v.temps - 1], 1, 1);
+    for (int c = 0; c < v.cells; ++c) {
+        len += snprintf(buf + len, sizeof(buf) - (size_t)len, ",%.3f", v.cell_v[c]);
+    }
+    for (int t = 0; t < v.temps; ++t) {
+        len += snprintf(buf + len, sizeof(buf) - (size_t)len, ",%.1f", v.temp_c[t]);
+    }
+    len += snprintf(buf + len, sizeof(buf) - (size_t)len, ",%.4f,%.4f,%d,%.2f,%.2f,%.1f,%ld,%ld,%d,%d,%u,",
+                    0.012, 0.003, 0, 0.0, 98.5, 97.0, 36000L, -1L, 0, 0, BENCH_BOOT_ID);
+    *seq_at = (size_t)len;
+    len += snprintf(buf + len, sizeof(buf) - (size_t)len, "%0*u", SEQ_DIGITS, 0u);
+    return std::string(buf, (size_t)len);
+}
+
+std::string jsonPayload(const std::string& id, const Values& v, size_t* seq_at) {
+    char buf[4096];
+    int len = snprintf(buf, sizeof(buf), "{\n  \"device_id\": \"%s\",\n  \"boot_id\": %u,\n  \"seq\": ",
+                       id.c_str(), BENCH_BOOT_ID);
+    *seq_at = (size_t)len;
+    len += snprintf(buf + len, sizeof(buf) - (size_t)len,
+        "%0*u,\n  \"timestamp\": %llu,\n  \"elapsed_seconds\": %u,\n"
+        "  \"elapsed_hms\": \"%u:%u:%u\",\n  \"total_energy_wh\": %.3f,\n"
+        "  \"pack\": {\n    \"voltage_v\": %.3f,\n    \"current_a\": %.3f,\n    \"soc_pct\": %.3f,\n"
+        "    \"power_w\": %.3f,\n    \"full_capacity_ah\": 100.000,\n    \"est_capacity_ah\": 98.500,\n"
+        "    \"soh_pct\": 97.000,\n    \"time_to_empty_s\": 36000,\n    \"time_to_full_s\": -1\n  },\n"
+        "  \"stats\": {\n    \"peak_current_a\": 30.000,\n    \"peak_power_w\": 1500.000\n  },\n"
+        "  \"cells\": {\n    \"count\": %d,\n    \"min_voltage_v\": %.3f,\n    \"max_voltage_v\": %.3f,\n"
+        "    \"min_cell\": %d,\n    \"max_cell\": %d,\n    \"voltage_delta_v\": %.3f,\n    \"values\": [",
+        SEQ_DIGITS, 0u, (unsigned long long)v.elapsed * 1000000ULL, v.elapsed, v.elapsed / 3600,
+        (v.elapsed / 60) % 60, v.elapsed % 60, v.energy, v.voltage, v.current, v.soc, v.power, v.cells,
+        v.min_v, v.max_v, v.min_cell, v.max_cell, v.max_v - v.min_v);
+    for (int c = 0; c < v.cells; ++c) {
+        len += snprintf(buf + len, sizeof(buf) - (size_t)len, "%s%.3f", c ? "," : "", v.cell_v[c]);
+    }
+    len += snprintf(buf + len, sizeof(buf) - (size_t)len,
+        "]\n  },\n  \"temperatures\": {\n    \"count\": %d,\n    \"min_c\": %.3f,\n    \"max_c\": %.3f,\n"
+        "    \"values\": [", v.temps, v.temp_c[0], v.temp_c[v.temps - 1]);
+    for (int t = 0; t < v.temps; ++t) {
+        len += snprintf(buf + len, sizeof(buf) - (size_t)len, "%s%.3f", t ? "," : "", v.temp_c[t]);
+    }
+    len += snprintf(buf + len, sizeof(buf) - (size_t)len,
+        "]\n  },\n  \"cell_stats\": {\n"
+        "    \"1m\": {\"samples\": 60, \"spread_v\": 0.010, \"max_stddev_v\": 0.002, \"drift_cell\": 0, \"drift_mv_per_h\": 0.000},\n"
+        "    \"1h\": {\"samples\": 3600, \"spread_v\": 0.012, \"max_stddev_v\": 0.003, \"drift_cell\": 0, \"drift_mv_per_h\": 0.000},\n"
+        "    \"24h\": {\"samples\": 3600, \"spread_v\": 0.012, \"max_stddev_v\": 0.003, \"drift_cell\": 0, \"drift_mv_per_h\": 0.000}\n"
+        "  },\n  \"internal_resistance\": {\n    \"steps\": 12,\n    \"mohm\": [");
+    for (int c = 0; c < v.cells; ++c) {
+        len += snprintf(buf + len, sizeof(buf) - (size_t)len, "%s%.3f", c ? "," : "", 0.8);
+    }
+    len += snprintf(buf + len, sizeof(buf) - (size_t)len,
+        "]\n  },\n  \"anomaly\": {\n    \"level\": 0,\n    \"cell\": 0,\n    \"z\": 0.000\n  },\n"
+        "  \"status\": {\n    \"charging_enabled\": true,\n    \"discharging_enabled\": true\n  }\n}\n");
+    return std::string(buf, (size_t)len);
+}
+
+// ---- Transport --------------------------------------------------------------
+
+struct sockaddr_in loopback(int port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return addr;
+}
+
+int connectTo(int type, int port) {
+    const int fd = socket(AF_INET, type | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr = loopback(port);
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (type == SOCK_STREAM) {
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+bool sendAll(int fd, const char* p, size_t len) {
+    while (len) {
+        const ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+bool recvAll(int fd, uint8_t* p, size_t len) {
+    while (len) {
+        const ssize_t n = recv(fd, p, len, 0);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// Read one MQTT packet from a blocking socket; returns the type nibble
+int readMqttPacket(int fd, std::vector<uint8_t>& body) {
+    uint8_t head;
+    if (!recvAll(fd, &head, 1)) {
+        return -1;
+    }
+    size_t len = 0;
+    for (int shift = 0; shift < 28; shift += 7) {
+        uint8_t b;
+        if (!recvAll(fd, &b, 1)) {
+            return -1;
+        }
+        len |= (size_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            break;
+        }
+    }
+    body.resize(len);
+    return (len == 0 || recvAll(fd, body.data(), len)) ? head >> 4 : -1;
+}
+
+std::string mqttPublish(const std::string& topic, const std::string& payload) {
+    std::string p;
+    p.push_back((char)0x30);
+    size_t len = 2 + topic.size() + payload.size();
+    do {
+        uint8_t b = (uint8_t)(len & 0x7F);
+        len >>= 7;
+        if (len) b |= 0x80;
+        p.push_back((char)b);
+    } while (len);
+    p.push_back((char)(topic.size() >> 8));
+    p.push_back((char)topic.size());
+    p += topic;
+    p += payload;
+    return p;
+}
+
+// Stand-in broker side of the collector's subscriptions: CONNACK, SUBACK, then publishes
+std::vector<int> acceptSubscribers(int listen_fd, unsigned count) {
+    std::vector<int> fds;
+    while (fds.size() < count) {
+        const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            break;
+        }
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        std::vector<uint8_t> body;
+        if (readMqttPacket(fd, body) != 1) {
+            close(fd);
+            continue;
+        }
+        const uint8_t connack[] = { 0x20, 0x02, 0x00, 0x00 };
+        sendAll(fd, reinterpret_cast<const char*>(connack), sizeof(connack));
+        if (readMqttPacket(fd, body) != 8 || body.size() < 2) {
+            close(fd);
+            continue;
+        }
+        const uint8_t suback[] = { 0x90, 0x03, body[0], body[1], 0x00 };
+        sendAll(fd, reinterpret_cast<const char*>(suback), sizeof(suback));
+        fds.push_back(fd);
+    }
+    return fds;
+}
+
+// ---- Output check -----------------------------------------------------------
+
+uint64_t g_file_rows = 0;
+uint64_t g_file_count = 0;
+bool g_file_ok = true;
+
+int countRows(const char* path, const struct stat* st, int type, struct FTW*) {
+    const size_t len = strlen(path);
+    if (type != FTW_F || len < 5 || strcmp(path + len - 5, ".bcol") != 0) {
+        return 0;
+    }
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        g_file_ok = false;
+        return 0;
+    }
+    g_file_count++;
+    uint8_t header[16];
+    long pos = 0;
+    while (fread(header, 1, sizeof(header), f) == sizeof(header)) {
+        uint32_t rows;
+        uint32_t body;
+        memcpy(&rows, header + 4, 4);
+        memcpy(&body, header + 12, 4);
+        if (memcmp(header, "BCG2", 4) != 0) {
+            g_file_ok = false;
+            break;
+        }
+        g_file_rows += rows;
+        pos += (long)sizeof(header) + (long)body;
+        if (fseek(f, pos, SEEK_SET) != 0) {
+            g_file_ok = false;
+            break;
+        }
+    }
+    if (ftell(f) != st->st_size) {
+        g_file_ok = false;
+    }
+    fclose(f);
+    return 0;
+}
+
+int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+    return remove(path);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--devices") == 0 && has_value) {
+            opt.devices = (unsigned)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--transport") == 0 && has_value) {
+            opt.transport = argv[++i];
+        } else if (strcmp(arg, "--format") == 0 && has_value) {
+            opt.format = argv[++i];
+        } else if (strcmp(arg, "--rate") == 0 && has_value) {
+            opt.rate = strtod(argv[++i], nullptr);
+        } else if (strcmp(arg, "--seconds") == 0 && has_value) {
+            opt.seconds = strtod(argv[++i], nullptr);
+        } else if (strcmp(arg, "--threads") == 0 && has_value) {
+            opt.threads = (unsigned)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--senders") == 0 && has_value) {
+            opt.senders = (unsigned)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--mqtt-conns") == 0 && has_value) {
+            opt.mqtt_conns = (unsigned)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--out") == 0 && has_value) {
+            opt.out = argv[++i];
+        } else if (strcmp(arg, "--keep") == 0) {
+            opt.keep = true;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    const bool udp = opt.transport == "udp";
+    const bool tcp = opt.transport == "tcp";
+    const bool mqtt = opt.transport == "mqtt";
+    if ((!udp && !tcp && !mqtt) || (opt.format != "csv" && opt.format != "json") || opt.devices == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (opt.senders == 0) opt.senders = 1;
+    if (opt.mqtt_conns == 0) opt.mqtt_conns = 1;
+    if (opt.out.empty()) {
+        opt.out = "/tmp/bms_collector_bench." + std::to_string(getpid());
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    // One socket per simulated device
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    // Stand-in broker for mqtt mode
+    int broker_fd = -1;
+    int broker_port = 0;
+    if (mqtt) {
+        broker_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        struct sockaddr_in addr = loopback(0);
+        socklen_t len = sizeof(addr);
+        if (broker_fd < 0 || bind(broker_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(broker_fd, 16) != 0 ||
+            getsockname(broker_fd, reinterpret_cast<struct sockaddr*>(&addr), &len) != 0) {
+            fprintf(stderr, "broker stand-in: %s\n", strerror(errno));
+            return 1;
+        }
+        broker_port = ntohs(addr.sin_port);
+    }
+
+    collector::CollectorConfig config;
+    config.bind_address = "127.0.0.1";
+    config.udp_port = udp ? 0 : -1;
+    config.tcp_port = tcp ? 0 : -1;
+    config.out_dir = opt.out;
+    config.workers = opt.threads;
+    config.flush_ms = 1000;
+    for (unsigned i = 0; mqtt && i < opt.mqtt_conns; ++i) {
+        collector::MqttSubscriber::Config c;
+        c.host = "127.0.0.1";
+        c.port = (uint16_t)broker_port;
+        c.topic = opt.mqtt_conns > 1 ? "$share/bench/bms/telemetry/+" : "bms/telemetry/+";
+        c.client_id = "bench_collector_" + std::to_string(i);
+        config.mqtt.push_back(c);
+    }
+
+    collector::Collector collector(config);
+    std::string error;
+    if (!collector.start(error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::vector<int> broker_conns;
+    std::unique_ptr<std::mutex[]> broker_locks(new std::mutex[opt.mqtt_conns]);
+    if (mqtt) {
+        broker_conns = acceptSubscribers(broker_fd, opt.mqtt_conns);
+        if (broker_conns.size() != opt.mqtt_conns) {
+            fprintf(stderr, "collector did not subscribe\n");
+            return 1;
+        }
+    }
+
+    // Devices: payloads rendered up front so the senders measure the collector, not snprintf
+    const int64_t now_s = (int64_t)time(nullptr);
+    std::vector<Device> devices(opt.devices);
+    size_t payload_bytes = 0;
+    for (unsigned d = 0; d < opt.devices; ++d) {
+        Device& dev = devices[d];
+        char id[24];
+        snprintf(id, sizeof(id), "bench%05u", d);
+        dev.id = id;
+        for (int v = 0; v < VARIANTS; ++v) {
+            const Values values = makeValues(d, v, now_s);
+            size_t seq_at = 0;
+            std::string p = opt.format == "csv" ? csvPayload(dev.id, values, &seq_at)
+                                                : jsonPayload(dev.id, values, &seq_at);
+            if (tcp && opt.format == "csv") {
+                p += "\n";    // stream framing; datagrams and MQTT messages carry one record each
+            }
+            if (mqtt) {
+                const size_t body = p.size();
+                p = mqttPublish("bms/telemetry/" + dev.id, p);
+                seq_at += p.size() - body;
+            }
+            dev.seq_at.push_back(seq_at);
+            payload_bytes += p.size();
+            dev.payloads.push_back(std::move(p));
+        }
+        if (udp || tcp) {
+            dev.fd = connectTo(udp ? SOCK_DGRAM : SOCK_STREAM, udp ? collector.udpPort() : collector.tcpPort());
+            if (dev.fd < 0) {
+                fprintf(stderr, "device %u: connect: %s\n", d, strerror(errno));
+                return 1;
+            }
+        }
+    }
+    fprintf(stderr, "%u devices over %s/%s (%.0f bytes/sample), %u collector worker(s), %u sender(s), %s\n",
+            opt.devices, opt.transport.c_str(), opt.format.c_str(),
+            (double)payload_bytes / (double)(opt.devices * VARIANTS), collector.workerCount(), opt.senders,
+            opt.rate > 0 ? (std::to_string(opt.rate) + " Hz per device").c_str() : "flat out");
+
+    // Senders: each owns a slice of the devices and paces their combined rate
+    std::atomic<bool> sending(true);
+    std::atomic<uint64_t> sent(0);
+    std::atomic<uint64_t> send_errors(0);
+    std::vector<std::thread> senders;
+    const auto started = Clock::now();
+    for (unsigned t = 0; t < opt.senders; ++t) {
+        senders.emplace_back([&, t]() {
+            std::vector<Device*> mine;
+            for (size_t d = t; d < devices.size(); d += opt.senders) {
+                mine.push_back(&devices[d]);
+            }
+            if (mine.empty()) {
+                return;
+            }
+            const double rate = opt.rate * (double)mine.size();
+            uint64_t n = 0;
+            size_t next = 0;
+            while (sending.load(std::memory_order_relaxed)) {
+                if (rate > 0) {
+                    const double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+                    const uint64_t due = (uint64_t)(elapsed * rate);
+                    if (n >= due) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(500));
+                        continue;
+                    }
+                }
+                Device* dev = mine[next];
+                const size_t variant = (n / mine.size()) % VARIANTS;
+                std::string& p = dev->payloads[variant];
+                stampSeq(p, dev->seq_at[variant], ++dev->seq);
+                bool ok;
+                if (mqtt) {
+                    // Senders share the subscriber connections; a publish must not interleave
+                    const size_t c = next % broker_conns.size();
+                    std::lock_guard<std::mutex> lock(broker_locks[c]);
+                    ok = sendAll(broker_conns[c], p.data(), p.size());
+                } else if (udp) {
+                    ok = send(dev->fd, p.data(), p.size(), 0) == (ssize_t)p.size();
+                } else {
+                    ok = sendAll(dev->fd, p.data(), p.size());
+                }
+                if (ok) {
+                    sent.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    send_errors.fetch_add(1, std::memory_order_relaxed);
+                }
+                n++;
+                next = (next + 1) % mine.size();
+            }
+        });
+    }
+
+    // Progress once a second
+    collector::CollectorStats prev;
+    auto last = Clock::now();
+    double peak = 0.0;
+    while (std::chrono::duration<double>(Clock::now() - started).count() < opt.seconds) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        const auto now = Clock::now();
+        const collector::CollectorStats s = collector.stats();
+        const double rate = (double)(s.samples - prev.samples) /
+                            std::chrono::duration<double>(now - last).count();
+        if (rate > peak) peak = rate;
+        fprintf(stderr, "  t=%4.0fs  sent %10llu  received %10llu  %9.0f samples/s  errors %llu\n",
+                std::chrono::duration<double>(now - started).count(), (unsigned long long)sent.load(),
+                (unsigned long long)s.samples, rate, (unsigned long long)s.parse_errors);
+        prev = s;
+        last = now;
+    }
+    sending.store(false);
+    for (auto& t : senders) {
+        t.join();
+    }
+    const double send_s = std::chrono::duration<double>(Clock::now() - started).count();
+
+    // Let the workers drain their sockets before stopping
+    for (auto& dev : devices) {
+        if (dev.fd >= 0) {
+            if (tcp) {
+                shutdown(dev.fd, SHUT_WR);
+            }
+        }
+    }
+    uint64_t settled = 0;
+    for (int i = 0; i < 50; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        const uint64_t now_samples = collector.stats().samples;
+        if (now_samples >= sent.load() || (i > 5 && now_samples == settled)) {
+            break;
+        }
+        settled = now_samples;
+    }
+    const double total_s = std::chrono::duration<double>(Clock::now() - started).count();
+    collector.stop();
+    const collector::CollectorStats s = collector.stats();
+    for (auto& dev : devices) {
+        if (dev.fd >= 0) close(dev.fd);
+    }
+    for (int fd : broker_conns) close(fd);
+    if (broker_fd >= 0) close(broker_fd);
+
+    nftw(opt.out.c_str(), countRows, 64, FTW_PHYS);
+
+    const uint64_t sent_total = sent.load();
+    printf("Sent:       %llu samples in %.1f s (%.0f/s), %llu send errors\n", (unsigned long long)sent_total,
+           send_s, (double)sent_total / send_s, (unsigned long long)send_errors.load());
+    printf("Received:   %llu samples (%.2f%% lost), %llu parse errors, %.1f MB\n",
+           (unsigned long long)s.samples,
+           sent_total ? 100.0 * (double)(sent_total - std::min(sent_total, s.samples)) / (double)sent_total : 0.0,
+           (unsigned long long)s.parse_errors, (double)s.bytes_in / 1e6);
+    printf("Sequence:   %llu missing by seq gaps\n", (unsigned long long)s.seq_missing);
+    printf("Sustained:  %.0f samples/s (%.1f MB/s), peak 1 s %.0f samples/s\n",
+           (double)s.samples / total_s, (double)s.bytes_in / total_s / 1e6, peak);
+    printf("Written:    %llu rows in %llu groups, %.1f MB (%.1f bytes/row), %llu write errors\n",
+           (unsigned long long)s.rows_written, (unsigned long long)s.groups_written,
+           (double)s.bytes_written / 1e6, s.rows_written ? (double)s.bytes_written / (double)s.rows_written : 0.0,
+           (unsigned long long)s.write_errors);
+    printf("Files:      %llu partitions, %llu rows read back%s\n", (unsigned long long)g_file_count,
+           (unsigned long long)g_file_rows, g_file_ok ? "" : " (CORRUPT)");
+
+    if (!opt.keep) {
+        nftw(opt.out.c_str(), removeEntry, 64, FTW_DEPTH | FTW_PHYS);
+    }
+    const bool ok = g_file_ok && g_file_rows == s.samples && s.parse_errors == 0 && s.write_errors == 0;
+    return ok ? 0 : 1;
+}
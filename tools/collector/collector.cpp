@@ -0,0 +1,441 @@
+#include "collector.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include "payload_parser.h"
+
+namespace collector {
+
+namespace {
+
+constexpr int UDP_BATCH = 32;
+constexpr size_t UDP_MAX_DATAGRAM = 9216;
+constexpr int UDP_BATCHES_PER_EVENT = 16;       // then let other sockets in
+constexpr size_t TCP_READ_BYTES = 64 * 1024;
+constexpr size_t TCP_MAX_PENDING = 1024 * 1024; // unterminated record this large: drop the connection
+constexpr int64_t HOUSEKEEPING_MS = 250;
+
+int64_t wallMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Telemetry is <topic>/<device>; diagnostics and commands live below it
+bool isTelemetryTopic(const char* topic, size_t len) {
+    static const char* const SKIP[] = { "/diag/", "/cmd/", "/resp/" };
+    for (const char* skip : SKIP) {
+        const size_t n = strlen(skip);
+        for (size_t i = 0; i + n <= len; ++i) {
+            if (memcmp(topic + i, skip, n) == 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int bindReusePort(int type, const std::string& address, int port, std::string& error) {
+    const int fd = socket(AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = std::string("socket: ") + strerror(errno);
+        return -1;
+    }
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    if (type == SOCK_DGRAM) {
+        // Room for bursts while the worker is busy flushing
+        const int rcvbuf = 8 * 1024 * 1024;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+        error = "bad bind address " + address;
+        close(fd);
+        return -1;
+    }
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        error = "bind " + address + ":" + std::to_string(port) + ": " + strerror(errno);
+        close(fd);
+        return -1;
+    }
+    if (type == SOCK_STREAM && listen(fd, 1024) != 0) {
+        error = std::string("listen: ") + strerror(errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int boundPort(int fd) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len) != 0) {
+        return -1;
+    }
+    return ntohs(addr.sin_port);
+}
+
+} // namespace
+
+class Collector::Worker {
+public:
+    Worker(const CollectorConfig& config, FileWriter& writer, SeqTracker& seq)
+        : config_(config), store_(writer, config.group_rows, config.flush_ms), seq_(seq) {}
+
+    ~Worker() {
+        for (auto& conn : conns_) {
+            close(conn->fd);
+        }
+        mqtt_.clear();
+        if (udp_fd_ >= 0) close(udp_fd_);
+        if (listen_fd_ >= 0) close(listen_fd_);
+        if (stop_fd_ >= 0) close(stop_fd_);
+        if (epoll_fd_ >= 0) close(epoll_fd_);
+    }
+
+    bool open(int& udp_port, int& tcp_port, std::string& error) {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd_ < 0 || stop_fd_ < 0) {
+            error = std::string("epoll/eventfd: ") + strerror(errno);
+            return false;
+        }
+        watch(stop_fd_, &stop_reg_);
+        if (udp_port >= 0) {
+            udp_fd_ = bindReusePort(SOCK_DGRAM, config_.bind_address, udp_port, error);
+            if (udp_fd_ < 0) {
+                return false;
+            }
+            udp_port = boundPort(udp_fd_);
+            watch(udp_fd_, &udp_reg_);
+        }
+        if (tcp_port >= 0) {
+            listen_fd_ = bindReusePort(SOCK_STREAM, config_.bind_address, tcp_port, error);
+            if (listen_fd_ < 0) {
+                return false;
+            }
+            tcp_port = boundPort(listen_fd_);
+            watch(listen_fd_, &listen_reg_);
+        }
+        return true;
+    }
+
+    void addMqtt(const MqttSubscriber::Config& config) {
+        std::unique_ptr<MqttReg> reg(new MqttReg());
+        reg->kind = Kind::MQTT;
+        reg->subscriber.reset(new MqttSubscriber(epoll_fd_, reg.get(), config,
+            [this](const char* topic, size_t topic_len, const char* payload, size_t len) {
+                mqtt_messages_.fetch_add(1, std::memory_order_relaxed);
+                bytes_in_.fetch_add(len, std::memory_order_relaxed);
+                if (isTelemetryTopic(topic, topic_len)) {
+                    ingest(parsePayload(payload, len, true, Source::MQTT, now_ms_, batch_));
+                }
+            }));
+        mqtt_.push_back(std::move(reg));
+    }
+
+    void start() {
+        thread_ = std::thread([this]() { run(); });
+    }
+
+    void stop() {
+        stopping_.store(true);
+        // Wake epoll_wait; without it the worker still sees the flag within HOUSEKEEPING_MS
+        const uint64_t one = 1;
+        const ssize_t ignored = write(stop_fd_, &one, sizeof(one));
+        (void)ignored;
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    void addStats(CollectorStats& s) const {
+        s.datagrams += datagrams_.load(std::memory_order_relaxed);
+        s.tcp_accepted += tcp_accepted_.load(std::memory_order_relaxed);
+        s.tcp_open += tcp_open_.load(std::memory_order_relaxed);
+        s.mqtt_messages += mqtt_messages_.load(std::memory_order_relaxed);
+        s.bytes_in += bytes_in_.load(std::memory_order_relaxed);
+        s.samples += samples_.load(std::memory_order_relaxed);
+        s.parse_errors += parse_errors_.load(std::memory_order_relaxed);
+        s.partitions += store_.openPartitions();
+    }
+
+private:
+    enum class Kind : uint8_t { STOP, UDP, LISTEN, CONN, MQTT };
+
+    struct Reg {
+        Kind kind;
+    };
+    struct Conn : Reg {
+        int fd = -1;
+        std::vector<char> buf;
+        size_t used = 0;
+    };
+    struct MqttReg : Reg {
+        std::unique_ptr<MqttSubscriber> subscriber;
+    };
+
+    void watch(int fd, Reg* reg) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = reg;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    void ingest(const ParseResult& r) {
+        if (r.records) samples_.fetch_add(r.records, std::memory_order_relaxed);
+        if (r.errors) parse_errors_.fetch_add(r.errors, std::memory_order_relaxed);
+    }
+
+    void run() {
+        struct epoll_event events[256];
+        int64_t last_housekeeping = 0;
+        now_ms_ = wallMs();
+        for (auto& m : mqtt_) {
+            m->subscriber->tick(now_ms_);
+        }
+        while (!stopping_.load(std::memory_order_relaxed)) {
+            const int n = epoll_wait(epoll_fd_, events, 256, (int)HOUSEKEEPING_MS);
+            now_ms_ = wallMs();
+            for (int i = 0; i < n; ++i) {
+                Reg* reg = static_cast<Reg*>(events[i].data.ptr);
+                switch (reg->kind) {
+                    case Kind::STOP: break;
+                    case Kind::UDP: drainUdp(); break;
+                    case Kind::LISTEN: acceptAll(); break;
+                    case Kind::CONN: readConn(static_cast<Conn*>(reg)); break;
+                    case Kind::MQTT:
+                        static_cast<MqttReg*>(reg)->subscriber->onEvent(events[i].events, now_ms_);
+                        break;
+                }
+            }
+            for (const Sample& s : batch_) {
+                seq_.add(s);
+                store_.add(s);
+            }
+            batch_.clear();
+            closeDeadConns();
+
+            if (now_ms_ - last_housekeeping >= HOUSEKEEPING_MS) {
+                last_housekeeping = now_ms_;
+                for (auto& m : mqtt_) {
+                    m->subscriber->tick(now_ms_);
+                }
+                store_.flushDue(now_ms_, false);
+            }
+        }
+        store_.flushDue(wallMs(), true);
+    }
+
+    void drainUdp() {
+        if (udp_bufs_.empty()) {
+            udp_bufs_.resize((size_t)UDP_BATCH * UDP_MAX_DATAGRAM);
+        }
+        struct mmsghdr msgs[UDP_BATCH];
+        struct iovec iovs[UDP_BATCH];
+        for (int batch = 0; batch < UDP_BATCHES_PER_EVENT; ++batch) {
+            for (int i = 0; i < UDP_BATCH; ++i) {
+                iovs[i].iov_base = udp_bufs_.data() + (size_t)i * UDP_MAX_DATAGRAM;
+                iovs[i].iov_len = UDP_MAX_DATAGRAM;
+                memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            const int n = recvmmsg(udp_fd_, msgs, UDP_BATCH, MSG_DONTWAIT, nullptr);
+            if (n <= 0) {
+                return;
+            }
+            datagrams_.fetch_add((uint64_t)n, std::memory_order_relaxed);
+            for (int i = 0; i < n; ++i) {
+                bytes_in_.fetch_add(msgs[i].msg_len, std::memory_order_relaxed);
+                ingest(parsePayload(static_cast<const char*>(iovs[i].iov_base), msgs[i].msg_len, true,
+                                    Source::UDP, now_ms_, batch_));
+            }
+            if (n < UDP_BATCH) {
+                return;
+            }
+        }
+    }
+
+    void acceptAll() {
+        while (true) {
+            const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                return;
+            }
+            std::unique_ptr<Conn> conn(new Conn());
+            conn->kind = Kind::CONN;
+            conn->fd = fd;
+            watch(fd, conn.get());
+            conns_.push_back(std::move(conn));
+            tcp_accepted_.fetch_add(1, std::memory_order_relaxed);
+            tcp_open_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void readConn(Conn* c) {
+        while (c->fd >= 0) {
+            if (c->buf.size() - c->used < TCP_READ_BYTES) {
+                c->buf.resize(c->used + TCP_READ_BYTES);
+            }
+            const ssize_t n = recv(c->fd, c->buf.data() + c->used, c->buf.size() - c->used, 0);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                // Peer closed: whatever is left is its last record
+                ingest(parsePayload(c->buf.data(), c->used, true, Source::TCP, now_ms_, batch_));
+                c->used = 0;
+                shutdownConn(c);
+                return;
+            }
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            bytes_in_.fetch_add((uint64_t)n, std::memory_order_relaxed);
+            c->used += (size_t)n;
+            const ParseResult r = parsePayload(c->buf.data(), c->used, false, Source::TCP, now_ms_, batch_);
+            ingest(r);
+            if (r.consumed) {
+                memmove(c->buf.data(), c->buf.data() + r.consumed, c->used - r.consumed);
+                c->used -= r.consumed;
+            }
+            if (c->used > TCP_MAX_PENDING) {
+                parse_errors_.fetch_add(1, std::memory_order_relaxed);
+                shutdownConn(c);
+                return;
+            }
+        }
+    }
+
+    void shutdownConn(Conn* c) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, c->fd, nullptr);
+        close(c->fd);
+        c->fd = -1;
+        dead_conns_ = true;
+        tcp_open_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Deferred so a Conn is never freed while its event is still in the batch
+    void closeDeadConns() {
+        if (!dead_conns_) {
+            return;
+        }
+        for (size_t i = 0; i < conns_.size();) {
+            if (conns_[i]->fd < 0) {
+                conns_[i] = std::move(conns_.back());
+                conns_.pop_back();
+            } else {
+                ++i;
+            }
+        }
+        dead_conns_ = false;
+    }
+
+    const CollectorConfig& config_;
+    ColumnStore store_;
+    SeqTracker& seq_;
+    int epoll_fd_ = -1;
+    int stop_fd_ = -1;
+    int udp_fd_ = -1;
+    int listen_fd_ = -1;
+    Reg stop_reg_{ Kind::STOP };
+    Reg udp_reg_{ Kind::UDP };
+    Reg listen_reg_{ Kind::LISTEN };
+    std::vector<std::unique_ptr<Conn>> conns_;
+    std::vector<std::unique_ptr<MqttReg>> mqtt_;
+    bool dead_conns_ = false;
+    std::vector<char> udp_bufs_;
+    std::vector<Sample> batch_;
+    int64_t now_ms_ = 0;
+    std::thread thread_;
+    std::atomic<bool> stopping_{false};
+
+    std::atomic<uint64_t> datagrams_{0};
+    std::atomic<uint64_t> tcp_accepted_{0};
+    std::atomic<uint64_t> tcp_open_{0};
+    std::atomic<uint64_t> mqtt_messages_{0};
+    std::atomic<uint64_t> bytes_in_{0};
+    std::atomic<uint64_t> samples_{0};
+    std::atomic<uint64_t> parse_errors_{0};
+};
+
+Collector::Collector(const CollectorConfig& config)
+    : config_(config), writer_(config.out_dir, config.writers, config.max_queued_mb << 20) {}
+
+Collector::~Collector() {
+    stop();
+}
+
+bool Collector::start(std::string& error) {
+    unsigned count = config_.workers ? config_.workers : std::thread::hardware_concurrency();
+    if (count == 0) {
+        count = 1;
+    }
+    udp_port_ = config_.udp_port;
+    tcp_port_ = config_.tcp_port;
+    for (unsigned i = 0; i < count; ++i) {
+        std::unique_ptr<Worker> worker(new Worker(config_, writer_, seq_));
+        // The first worker resolves port 0; the rest join the same port
+        if (!worker->open(udp_port_, tcp_port_, error)) {
+            workers_.clear();
+            return false;
+        }
+        workers_.push_back(std::move(worker));
+    }
+    for (size_t i = 0; i < config_.mqtt.size(); ++i) {
+        MqttSubscriber::Config mqtt = config_.mqtt[i];
+        if (config_.mqtt.size() > 1 && mqtt.client_id == MqttSubscriber::Config().client_id) {
+            mqtt.client_id += "_" + std::to_string(i);
+        }
+        workers_[i % workers_.size()]->addMqtt(mqtt);
+    }
+    writer_.start();
+    for (auto& worker : workers_) {
+        worker->start();
+    }
+    running_ = true;
+    return true;
+}
+
+void Collector::stop() {
+    if (!running_) {
+        return;
+    }
+    for (auto& worker : workers_) {
+        worker->stop();
+    }
+    // Workers flushed their last groups on the way out
+    writer_.stop();
+    running_ = false;
+}
+
+CollectorStats Collector::stats() const {
+    CollectorStats s;
+    for (const auto& worker : workers_) {
+        worker->addStats(s);
+    }
+    s.seq_missing = seq_.missing();
+    s.device_restarts = seq_.restarts();
+    s.rows_written = writer_.rowsWritten();
+    s.groups_written = writer_.groupsWritten();
+    s.bytes_written = writer_.bytesWritten();
+    s.write_errors = writer_.writeErrors();
+    return s;
+}
+
+} // namespace collector
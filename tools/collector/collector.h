@@ -0,0 +1,87 @@
+#ifndef COLLECTOR_COLLECTOR_H
+#define COLLECTOR_COLLECTOR_H
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "column_store.h"
+#include "mqtt_subscriber.h"
+#include "seq_tracker.h"
+
+namespace collector {
+
+struct CollectorConfig {
+    std::string bind_address = "0.0.0.0";
+    int udp_port = 3330;          // UDPLogSink default; -1 = off, 0 = any free port
+    int tcp_port = 3331;          // TCPLogSink (client mode) default; -1 = off, 0 = any free port
+    std::vector<MqttSubscriber::Config> mqtt;
+    std::string out_dir = "fleet_data";
+    unsigned workers = 0;         // 0 = one per core
+    uint32_t group_rows = 4096;   // rows per device before a row group is written
+    uint32_t flush_ms = 5000;     // longest a received row waits in memory
+    unsigned writers = 2;         // file writer threads
+    size_t max_queued_mb = 256;   // row groups waiting for the writers before receiving stalls
+};
+
+struct CollectorStats {
+    uint64_t datagrams = 0;
+    uint64_t tcp_accepted = 0;
+    uint64_t tcp_open = 0;
+    uint64_t mqtt_messages = 0;
+    uint64_t bytes_in = 0;
+    uint64_t samples = 0;
+    uint64_t parse_errors = 0;
+    uint64_t seq_missing = 0;     // samples the devices took that never arrived (SeqTracker)
+    uint64_t device_restarts = 0;
+    uint64_t rows_written = 0;
+    uint64_t groups_written = 0;
+    uint64_t bytes_written = 0;
+    uint64_t write_errors = 0;
+    uint64_t partitions = 0;
+};
+
+/**
+ * Ingests what UDPLogSink, TCPLogSink and MQTTLogSink send, in JSON or CSV,
+ * into per-device, per-day column files (see FileWriter)
+ *
+ * Each worker thread runs its own epoll loop with its own UDP and TCP
+ * listening sockets bound with SO_REUSEPORT, so the kernel spreads devices
+ * (by source address/port) over workers and no socket is shared between
+ * threads. MQTT connections are assigned to workers round-robin. Parsing and
+ * column buffering happen on the worker that received the data; finished
+ * row groups go to the writer threads.
+ */
+class Collector {
+public:
+    explicit Collector(const CollectorConfig& config);
+    ~Collector();
+
+    Collector(const Collector&) = delete;
+    Collector& operator=(const Collector&) = delete;
+
+    bool start(std::string& error);
+
+    // Flushes every buffered row and joins the workers
+    void stop();
+
+    CollectorStats stats() const;
+    int udpPort() const { return udp_port_; }
+    int tcpPort() const { return tcp_port_; }
+    unsigned workerCount() const { return (unsigned)workers_.size(); }
+
+private:
+    class Worker;
+
+    CollectorConfig config_;
+    FileWriter writer_;
+    SeqTracker seq_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    int udp_port_ = -1;
+    int tcp_port_ = -1;
+    bool running_ = false;
+};
+
+} // namespace collector
+
+#endif // COLLECTOR_COLLECTOR_H
@@ -0,0 +1,334 @@
+#include "column_store.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <functional>
+#include <utility>
+
+namespace collector {
+
+namespace {
+
+// Idle partitions (device went quiet, day rolled over) are dropped after this
+constexpr int64_t PARTITION_IDLE_MS = 10 * 60 * 1000;
+
+struct GroupHeader {
+    char magic[4];
+    uint32_t rows;
+    uint8_t cells;
+    uint8_t temps;
+    uint16_t reserved;
+    uint32_t body_bytes;
+};
+static_assert(sizeof(GroupHeader) == 16, "row group header is 16 bytes on disk");
+
+// Proleptic Gregorian date of a day count since 1970-01-01
+void civilFromDays(int64_t z, int& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = (unsigned)(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = (int)(yoe + era * 400) + (m <= 2);
+}
+
+template <typename T>
+void appendColumn(std::vector<char>& buf, const std::vector<T>& column) {
+    const char* p = reinterpret_cast<const char*>(column.data());
+    buf.insert(buf.end(), p, p + column.size() * sizeof(T));
+}
+
+} // namespace
+
+// ---- FileWriter ------------------------------------------------------------
+
+FileWriter::FileWriter(const std::string& root, unsigned threads, size_t max_queued_bytes) : root_(root) {
+    if (threads == 0) {
+        threads = 1;
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+        lanes_.emplace_back(new Lane());
+    }
+    struct rlimit rl;
+    size_t budget = 4096;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY) {
+        budget = rl.rlim_cur > 2048 ? (size_t)rl.rlim_cur / 4 : 512;
+    }
+    max_open_per_lane_ = budget / threads ? budget / threads : 1;
+    max_queued_per_lane_ = max_queued_bytes / threads;
+}
+
+FileWriter::~FileWriter() {
+    stop();
+}
+
+void FileWriter::start() {
+    if (running_) {
+        return;
+    }
+    mkdir(root_.c_str(), 0755);
+    for (auto& lane : lanes_) {
+        lane->stopping = false;
+        Lane* l = lane.get();
+        lane->thread = std::thread([this, l] { run(*l); });
+    }
+    running_ = true;
+}
+
+void FileWriter::stop() {
+    if (!running_) {
+        return;
+    }
+    for (auto& lane : lanes_) {
+        {
+            std::lock_guard<std::mutex> lock(lane->mutex);
+            lane->stopping = true;
+        }
+        lane->ready.notify_one();
+    }
+    for (auto& lane : lanes_) {
+        lane->thread.join();
+    }
+    running_ = false;
+}
+
+void FileWriter::submit(const std::string& rel_path, std::vector<char>&& group, uint32_t rows) {
+    Lane& lane = *lanes_[std::hash<std::string>()(rel_path) % lanes_.size()];
+    std::unique_lock<std::mutex> lock(lane.mutex);
+    // Backpressure: a disk that cannot keep up stalls receiving rather than
+    // growing memory without bound. One job is always accepted.
+    lane.space.wait(lock, [&] { return lane.queued_bytes < max_queued_per_lane_ || lane.jobs.empty(); });
+    lane.queued_bytes += group.size();
+    lane.jobs.push_back(Job{ rel_path, std::move(group), rows });
+    lock.unlock();
+    lane.ready.notify_one();
+}
+
+void FileWriter::run(Lane& lane) {
+    std::unique_lock<std::mutex> lock(lane.mutex);
+    while (true) {
+        lane.ready.wait(lock, [&] { return !lane.jobs.empty() || lane.stopping; });
+        if (lane.jobs.empty()) {
+            break;
+        }
+        Job job = std::move(lane.jobs.front());
+        lane.jobs.pop_front();
+        lock.unlock();
+
+        const int fd = openFile(lane, job.path);
+        if (fd >= 0 && writeAll(fd, job.data.data(), job.data.size())) {
+            rows_written_.fetch_add(job.rows, std::memory_order_relaxed);
+            groups_written_.fetch_add(1, std::memory_order_relaxed);
+            bytes_written_.fetch_add(job.data.size(), std::memory_order_relaxed);
+        } else {
+            write_errors_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        lock.lock();
+        lane.queued_bytes -= job.data.size();
+        lane.space.notify_all();
+    }
+    lock.unlock();
+    for (auto& kv : lane.fds) {
+        ::close(kv.second);
+    }
+    lane.fds.clear();
+}
+
+int FileWriter::openFile(Lane& lane, const std::string& rel_path) {
+    auto it = lane.fds.find(rel_path);
+    if (it != lane.fds.end()) {
+        return it->second;
+    }
+    if (lane.fds.size() >= max_open_per_lane_) {
+        // More active partitions than descriptors: give one up
+        ::close(lane.fds.begin()->second);
+        lane.fds.erase(lane.fds.begin());
+    }
+    const std::string path = root_ + "/" + rel_path;
+    const size_t slash = path.rfind('/');
+    mkdir(path.substr(0, slash).c_str(), 0755);
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        lane.fds.emplace(rel_path, fd);
+    }
+    return fd;
+}
+
+bool FileWriter::writeAll(int fd, const char* p, size_t len) {
+    while (len) {
+        const ssize_t n = ::write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// ---- ColumnStore -----------------------------------------------------------
+
+ColumnStore::ColumnStore(FileWriter& writer, uint32_t group_rows, uint32_t flush_ms)
+    : writer_(writer), group_rows_(group_rows ? group_rows : 1), flush_ms_(flush_ms) {
+    key_.reserve(64);
+}
+
+void ColumnStore::add(const Sample& s) {
+    int64_t days = s.time_s / 86400;
+    if (s.time_s < 0 && s.time_s % 86400) {
+        days--;
+    }
+    int year;
+    unsigned month;
+    unsigned day;
+    civilFromDays(days, year, month, day);
+
+    // Key doubles as the relative path; device ids become directory names
+    key_.clear();
+    for (const char* c = s.device_id; *c; ++c) {
+        const bool safe = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') ||
+                          *c == '-' || *c == '_';
+        key_.push_back(safe ? *c : '_');
+    }
+    char date[24];
+    snprintf(date, sizeof(date), "/%04d-%02u-%02u.bcol", year, month, day);
+    key_ += date;
+
+    auto it = partitions_.find(key_);
+    if (it == partitions_.end()) {
+        it = partitions_.emplace(key_, Partition()).first;
+        it->second.path = key_;
+        open_partitions_.store(partitions_.size(), std::memory_order_relaxed);
+    }
+    Partition& p = it->second;
+    if (p.rows == 0) {
+        p.oldest_recv_ms = s.recv_ms;
+    }
+    p.last_add_ms = s.recv_ms;
+
+    p.time_s.push_back(s.time_s);
+    p.recv_ms.push_back(s.recv_ms);
+    p.uptime_s.push_back(s.uptime_s);
+    p.boot_id.push_back(s.boot_id);
+    p.seq.push_back(s.seq);
+    p.source.push_back((uint8_t)s.source);
+    p.flags.push_back(s.flags);
+    p.anomaly_level.push_back(s.anomaly_level);
+    p.scalars[COL_TOTAL_ENERGY_WH].push_back(s.total_energy_wh);
+    p.scalars[COL_PACK_V].push_back(s.pack_voltage_v);
+    p.scalars[COL_PACK_I].push_back(s.pack_current_a);
+    p.scalars[COL_POWER].push_back(s.power_w);
+    p.scalars[COL_SOC].push_back(s.soc_pct);
+    p.scalars[COL_MIN_CELL_V].push_back(s.min_cell_voltage_v);
+    p.scalars[COL_MAX_CELL_V].push_back(s.max_cell_voltage_v);
+    p.scalars[COL_MIN_TEMP].push_back(s.min_temp_c);
+    p.scalars[COL_MAX_TEMP].push_back(s.max_temp_c);
+
+    // A row with more cells than the group so far opens columns backfilled with NaN
+    for (; p.cells < s.cell_count; ++p.cells) {
+        p.cell_v[p.cells].assign(p.rows, NAN);
+    }
+    for (; p.temps < s.temp_count; ++p.temps) {
+        p.temp_c[p.temps].assign(p.rows, NAN);
+    }
+    for (int i = 0; i < p.cells; ++i) {
+        p.cell_v[i].push_back(i < s.cell_count ? s.cell_v[i] : NAN);
+    }
+    for (int i = 0; i < p.temps; ++i) {
+        p.temp_c[i].push_back(i < s.temp_count ? s.temp_c[i] : NAN);
+    }
+    p.rows++;
+
+    if (p.rows >= group_rows_) {
+        flush(p);
+    }
+}
+
+void ColumnStore::flush(Partition& p) {
+    if (p.rows == 0) {
+        return;
+    }
+    // The buffer is handed to a writer thread, so each group gets its own
+    std::vector<char> group;
+    group.reserve(sizeof(GroupHeader) + p.rows * (48 + 4 * (size_t)(13 + p.cells + p.temps)));
+    group.resize(sizeof(GroupHeader));
+    appendColumn(group, p.time_s);
+    appendColumn(group, p.recv_ms);
+    appendColumn(group, p.uptime_s);
+    appendColumn(group, p.boot_id);
+    appendColumn(group, p.seq);
+    appendColumn(group, p.source);
+    appendColumn(group, p.flags);
+    appendColumn(group, p.anomaly_level);
+    for (const auto& column : p.scalars) {
+        appendColumn(group, column);
+    }
+    for (int i = 0; i < p.cells; ++i) {
+        appendColumn(group, p.cell_v[i]);
+    }
+    for (int i = 0; i < p.temps; ++i) {
+        appendColumn(group, p.temp_c[i]);
+    }
+
+    GroupHeader header;
+    memcpy(header.magic, "BCG2", 4);
+    header.rows = (uint32_t)p.rows;
+    header.cells = p.cells;
+    header.temps = p.temps;
+    header.reserved = 0;
+    header.body_bytes = (uint32_t)(group.size() - sizeof(GroupHeader));
+    memcpy(group.data(), &header, sizeof(header));
+
+    writer_.submit(p.path, std::move(group), (uint32_t)p.rows);
+
+    // Keep capacity: the next group of this device is about the same size
+    p.time_s.clear();
+    p.recv_ms.clear();
+    p.uptime_s.clear();
+    p.boot_id.clear();
+    p.seq.clear();
+    p.source.clear();
+    p.flags.clear();
+    p.anomaly_level.clear();
+    for (auto& column : p.scalars) {
+        column.clear();
+    }
+    for (auto& column : p.cell_v) {
+        column.clear();
+    }
+    for (auto& column : p.temp_c) {
+        column.clear();
+    }
+    p.rows = 0;
+    p.cells = 0;
+    p.temps = 0;
+}
+
+void ColumnStore::flushDue(int64_t now_ms, bool force) {
+    for (auto it = partitions_.begin(); it != partitions_.end();) {
+        Partition& p = it->second;
+        if (p.rows && (force || now_ms - p.oldest_recv_ms >= (int64_t)flush_ms_)) {
+            flush(p);
+        }
+        if (p.rows == 0 && (force || now_ms - p.last_add_ms >= PARTITION_IDLE_MS)) {
+            it = partitions_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    open_partitions_.store(partitions_.size(), std::memory_order_relaxed);
+}
+
+} // namespace collector
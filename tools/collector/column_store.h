@@ -0,0 +1,163 @@
+#ifndef COLLECTOR_COLUMN_STORE_H
+#define COLLECTOR_COLUMN_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "sample.h"
+
+namespace collector {
+
+/**
+ * Append-only files, one per device and UTC day:
+ * <root>/<device_id>/<YYYY-MM-DD>.bcol
+ *
+ * A file is a sequence of row groups, in the order they were flushed (not
+ * strictly in time order when a device reached several workers).
+ *
+ * Row group (little-endian):
+ *   char     magic[4]        "BCG2"
+ *   uint32   rows
+ *   uint8    cells, temps    columns of cell_v / temp_c in this group
+ *   uint16   reserved
+ *   uint32   body_bytes      bytes that follow
+ *   then one array of `rows` values per column, in this order:
+ *   int64 time_s, int64 recv_ms, uint32 uptime_s, uint32 boot_id, uint32 seq,
+ *   uint8 source, uint8 flags, int8 anomaly_level, float total_energy_wh,
+ *   pack_voltage_v, pack_current_a, power_w, soc_pct, min_cell_voltage_v,
+ *   max_cell_voltage_v, min_temp_c, max_temp_c, cell_v_1..cells,
+ *   temp_c_1..temps (NaN where a row had fewer)
+ *
+ * Writes happen on writer threads so receiving never waits for the disk
+ * (creating thousands of files at midnight takes seconds). A file always maps
+ * to the same writer, which owns its descriptor; groups of one file are
+ * written in submission order.
+ */
+class FileWriter {
+public:
+    FileWriter(const std::string& root, unsigned threads, size_t max_queued_bytes);
+    ~FileWriter();
+
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    void start();
+
+    // Writes everything queued, then closes the files
+    void stop();
+
+    // Thread-safe; rel_path is "<device>/<date>.bcol". Blocks while the
+    // writer's queue is over its share of max_queued_bytes.
+    void submit(const std::string& rel_path, std::vector<char>&& group, uint32_t rows);
+
+    uint64_t rowsWritten() const { return rows_written_.load(std::memory_order_relaxed); }
+    uint64_t groupsWritten() const { return groups_written_.load(std::memory_order_relaxed); }
+    uint64_t bytesWritten() const { return bytes_written_.load(std::memory_order_relaxed); }
+    uint64_t writeErrors() const { return write_errors_.load(std::memory_order_relaxed); }
+
+
+private:
+    struct Job {
+        std::string path;
+        std::vector<char> data;
+        uint32_t rows;
+    };
+
+    struct Lane {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::condition_variable space;
+        std::deque<Job> jobs;
+        size_t queued_bytes = 0;
+        bool stopping = false;
+        std::unordered_map<std::string, int> fds;    // writer thread only
+        std::thread thread;
+    };
+
+    void run(Lane& lane);
+    int openFile(Lane& lane, const std::string& rel_path);
+    bool writeAll(int fd, const char* p, size_t len);
+
+    std::string root_;
+    size_t max_open_per_lane_;        // from RLIMIT_NOFILE, leaving room for sockets
+    size_t max_queued_per_lane_;
+    std::vector<std::unique_ptr<Lane>> lanes_;
+    bool running_ = false;
+
+    std::atomic<uint64_t> rows_written_{0};
+    std::atomic<uint64_t> groups_written_{0};
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> write_errors_{0};
+};
+
+/**
+ * Per-worker column buffers, one per device and day, flushed as row groups
+ * when full or when the oldest buffered row exceeds flush_ms
+ *
+ * Not thread-safe: each worker owns one. openPartitions() may be read from
+ * any thread.
+ */
+class ColumnStore {
+public:
+    ColumnStore(FileWriter& writer, uint32_t group_rows, uint32_t flush_ms);
+
+    void add(const Sample& s);
+    void flushDue(int64_t now_ms, bool force);
+
+    uint64_t openPartitions() const { return open_partitions_.load(std::memory_order_relaxed); }
+
+private:
+    enum ScalarColumn {
+        COL_TOTAL_ENERGY_WH,
+        COL_PACK_V,
+        COL_PACK_I,
+        COL_POWER,
+        COL_SOC,
+        COL_MIN_CELL_V,
+        COL_MAX_CELL_V,
+        COL_MIN_TEMP,
+        COL_MAX_TEMP,
+        SCALAR_COLUMNS
+    };
+
+    struct Partition {
+        std::string path;
+        int64_t oldest_recv_ms = 0;
+        int64_t last_add_ms = 0;
+        size_t rows = 0;
+        uint8_t cells = 0;
+        uint8_t temps = 0;
+        std::vector<int64_t> time_s;
+        std::vector<int64_t> recv_ms;
+        std::vector<uint32_t> uptime_s;
+        std::vector<uint32_t> boot_id;
+        std::vector<uint32_t> seq;
+        std::vector<uint8_t> source;
+        std::vector<uint8_t> flags;
+        std::vector<int8_t> anomaly_level;
+        std::vector<float> scalars[SCALAR_COLUMNS];
+        std::vector<float> cell_v[MAX_CELLS];
+        std::vector<float> temp_c[MAX_TEMPS];
+    };
+
+    void flush(Partition& p);
+
+    FileWriter& writer_;
+    uint32_t group_rows_;
+    uint32_t flush_ms_;
+    std::unordered_map<std::string, Partition> partitions_;
+    std::string key_;                 // reused for lookups
+    std::atomic<uint64_t> open_partitions_{0};
+};
+
+} // namespace collector
+
+#endif // COLLECTOR_COLUMN_STORE_H
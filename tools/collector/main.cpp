@@ -0,0 +1,164 @@
+// Fleet telemetry collector: receives UDP, TCP and MQTT telemetry from many
+// monitors and writes per-device, per-day column files
+//
+//   bms_collector [options]
+//     --out <dir>         output root (default fleet_data)
+//     --bind <addr>       listen address (default 0.0.0.0)
+//     --udp <port|off>    UDP listen port (default 3330)
+//     --tcp <port|off>    TCP listen port (default 3331)
+//     --mqtt <host[:port]> subscribe to a broker (repeat for more brokers)
+//     --mqtt-conns <n>    connections per broker, load-shared via $share (default 1)
+//     --topic <filter>    MQTT topic filter (default bms/telemetry/+)
+//     --mqtt-user <u>     MQTT username
+//     --mqtt-pass <p>     MQTT password
+//     --threads <n>       worker threads (default: one per core)
+//     --group-rows <n>    rows per device per row group (default 4096)
+//     --flush-ms <ms>     longest a row is buffered (default 5000)
+//     --writers <n>       file writer threads (default 2)
+//     --stats-s <s>       stats interval on stderr, 0 = off (default 10)
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include "collector.h"
+
+namespace {
+
+std::atomic<bool> g_stop(false);
+
+void onSignal(int) {
+    g_stop.store(true);
+}
+
+void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [--out dir] [--bind addr] [--udp port|off] [--tcp port|off]\n"
+            "          [--mqtt host[:port]]... [--mqtt-conns n] [--topic filter]\n"
+            "          [--mqtt-user u] [--mqtt-pass p] [--threads n] [--group-rows n]\n"
+            "          [--flush-ms ms] [--writers n] [--stats-s s]\n", prog);
+}
+
+int parsePort(const char* s) {
+    return strcmp(s, "off") == 0 ? -1 : atoi(s);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    collector::CollectorConfig config;
+    std::vector<std::string> brokers;
+    collector::MqttSubscriber::Config mqtt;
+    unsigned mqtt_conns = 1;
+    unsigned stats_s = 10;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--out") == 0 && has_value) {
+            config.out_dir = argv[++i];
+        } else if (strcmp(arg, "--bind") == 0 && has_value) {
+            config.bind_address = argv[++i];
+        } else if (strcmp(arg, "--udp") == 0 && has_value) {
+            config.udp_port = parsePort(argv[++i]);
+        } else if (strcmp(arg, "--tcp") == 0 && has_value) {
+            config.tcp_port = parsePort(argv[++i]);
+        } else if (strcmp(arg, "--mqtt") == 0 && has_value) {
+            brokers.push_back(argv[++i]);
+        } else if (strcmp(arg, "--mqtt-conns") == 0 && has_value) {
+            mqtt_conns = (unsigned)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--topic") == 0 && has_value) {
+            mqtt.topic = argv[++i];
+        } else if (strcmp(arg, "--mqtt-user") == 0 && has_value) {
+            mqtt.username = argv[++i];
+        } else if (strcmp(arg, "--mqtt-pass") == 0 && has_value) {
+            mqtt.password = argv[++i];
+        } else if (strcmp(arg, "--threads") == 0 && has_value) {
+            config.workers = (unsigned)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--group-rows") == 0 && has_value) {
+            config.group_rows = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--flush-ms") == 0 && has_value) {
+            config.flush_ms = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--writers") == 0 && has_value) {
+            config.writers = (unsigned)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--stats-s") == 0 && has_value) {
+            stats_s = (unsigned)strtoul(argv[++i], nullptr, 10);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // Several connections to one broker only help with a shared subscription
+    if (mqtt_conns > 1 && mqtt.topic.compare(0, 7, "$share/") != 0) {
+        mqtt.topic = "$share/bms_collector/" + mqtt.topic;
+    }
+    mqtt.client_id = "bms_collector_" + std::to_string(getpid());
+    for (const auto& broker : brokers) {
+        collector::MqttSubscriber::Config c = mqtt;
+        const size_t colon = broker.rfind(':');
+        c.host = broker.substr(0, colon);
+        if (colon != std::string::npos) {
+            c.port = (uint16_t)atoi(broker.c_str() + colon + 1);
+        }
+        for (unsigned n = 0; n < (mqtt_conns ? mqtt_conns : 1); ++n) {
+            config.mqtt.push_back(c);
+            config.mqtt.back().client_id += "_" + std::to_string(config.mqtt.size());
+        }
+    }
+
+    // Descriptors: one per TCP device plus the open column files
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    collector::Collector collector(config);
+    std::string error;
+    if (!collector.start(error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    fprintf(stderr, "bms_collector: %u worker(s), udp %d, tcp %d, %zu mqtt connection(s), writing to %s\n",
+            collector.workerCount(), collector.udpPort(), collector.tcpPort(), config.mqtt.size(),
+            config.out_dir.c_str());
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    auto last = std::chrono::steady_clock::now();
+    collector::CollectorStats prev;
+    while (!g_stop.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        const auto now = std::chrono::steady_clock::now();
+        const double dt = std::chrono::duration<double>(now - last).count();
+        if (stats_s == 0 || dt < stats_s) {
+            continue;
+        }
+        const collector::CollectorStats s = collector.stats();
+        fprintf(stderr,
+                "%.0f samples/s (%.1f MB/s in), %llu samples, %llu missing, %llu errors, %llu tcp open, "
+                "%llu mqtt msgs, %llu rows written, %llu partitions\n",
+                (double)(s.samples - prev.samples) / dt, (double)(s.bytes_in - prev.bytes_in) / dt / 1e6,
+                (unsigned long long)s.samples, (unsigned long long)s.seq_missing, (unsigned long long)s.parse_errors,
+                (unsigned long long)s.tcp_open, (unsigned long long)s.mqtt_messages,
+                (unsigned long long)s.rows_written, (unsigned long long)s.partitions);
+        prev = s;
+        last = now;
+    }
+
+    collector.stop();
+    const collector::CollectorStats s = collector.stats();
+    fprintf(stderr, "bms_collector: %llu samples, %llu rows in %llu groups (%.1f MB), %llu write errors\n",
+            (unsigned long long)s.samples, (unsigned long long)s.rows_written,
+            (unsigned long long)s.groups_written, (double)s.bytes_written / 1e6,
+            (unsigned long long)s.write_errors);
+    return 0;
+}
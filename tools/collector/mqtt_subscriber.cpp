@@ -0,0 +1,357 @@
+#include "mqtt_subscriber.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace collector {
+
+namespace {
+
+constexpr uint32_t MAX_BACKOFF_MS = 30000;
+constexpr size_t MAX_PACKET_BYTES = 1u << 20;
+constexpr uint16_t SUBSCRIBE_PACKET_ID = 1;
+
+enum PacketType : uint8_t {
+    CONNECT = 1,
+    CONNACK = 2,
+    PUBLISH = 3,
+    PUBACK = 4,
+    SUBSCRIBE = 8,
+    SUBACK = 9,
+    PINGREQ = 12,
+    PINGRESP = 13,
+    DISCONNECT = 14
+};
+
+void putString(std::vector<uint8_t>& out, const std::string& s) {
+    out.push_back((uint8_t)(s.size() >> 8));
+    out.push_back((uint8_t)s.size());
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+std::vector<uint8_t> packet(uint8_t type_flags, const std::vector<uint8_t>& body) {
+    std::vector<uint8_t> p;
+    p.reserve(body.size() + 5);
+    p.push_back(type_flags);
+    size_t len = body.size();
+    do {
+        uint8_t byte = (uint8_t)(len & 0x7F);
+        len >>= 7;
+        if (len) {
+            byte |= 0x80;
+        }
+        p.push_back(byte);
+    } while (len);
+    p.insert(p.end(), body.begin(), body.end());
+    return p;
+}
+
+} // namespace
+
+MqttSubscriber::MqttSubscriber(int epoll_fd, void* tag, const Config& config, MessageHandler handler)
+    : epoll_fd_(epoll_fd), tag_(tag), config_(config), handler_(std::move(handler)) {}
+
+MqttSubscriber::~MqttSubscriber() {
+    if (fd_ >= 0) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd_, nullptr);
+        ::close(fd_);
+    }
+}
+
+void MqttSubscriber::startConnect(int64_t now_ms) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* res = nullptr;
+    char port[8];
+    snprintf(port, sizeof(port), "%u", config_.port);
+    // Blocking resolve; the broker is normally an address or a local name
+    if (getaddrinfo(config_.host.c_str(), port, &hints, &res) != 0 || !res) {
+        fprintf(stderr, "mqtt: cannot resolve %s\n", config_.host.c_str());
+        disconnect(now_ms, nullptr);
+        return;
+    }
+    fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        freeaddrinfo(res);
+        disconnect(now_ms, "socket");
+        return;
+    }
+    const int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    const int rc = ::connect(fd_, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    if (rc != 0 && errno != EINPROGRESS) {
+        disconnect(now_ms, strerror(errno));
+        return;
+    }
+    state_ = State::CONNECTING;
+    in_.clear();
+    out_.clear();
+    out_pos_ = 0;
+    last_recv_ms_ = now_ms;
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.ptr = tag_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd_, &ev);
+    want_write_ = true;
+}
+
+void MqttSubscriber::disconnect(int64_t now_ms, const char* reason) {
+    if (reason) {
+        fprintf(stderr, "mqtt: %s:%u disconnected (%s), retry in %u ms\n", config_.host.c_str(),
+                config_.port, reason, backoff_ms_);
+    }
+    if (fd_ >= 0) {
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd_, nullptr);
+        ::close(fd_);
+        fd_ = -1;
+    }
+    state_ = State::IDLE;
+    next_attempt_ms_ = now_ms + backoff_ms_;
+    backoff_ms_ = backoff_ms_ * 2 > MAX_BACKOFF_MS ? MAX_BACKOFF_MS : backoff_ms_ * 2;
+}
+
+void MqttSubscriber::queue(const std::vector<uint8_t>& p) {
+    if (out_pos_ == out_.size()) {
+        out_.clear();
+        out_pos_ = 0;
+    }
+    out_.insert(out_.end(), p.begin(), p.end());
+}
+
+bool MqttSubscriber::flushOut() {
+    while (out_pos_ < out_.size()) {
+        const ssize_t n = ::send(fd_, out_.data() + out_pos_, out_.size() - out_pos_, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        out_pos_ += (size_t)n;
+    }
+    updateInterest();
+    return true;
+}
+
+void MqttSubscriber::updateInterest() {
+    const bool want = out_pos_ < out_.size();
+    if (want == want_write_ || fd_ < 0) {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN | (want ? EPOLLOUT : 0u);
+    ev.data.ptr = tag_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd_, &ev);
+    want_write_ = want;
+}
+
+void MqttSubscriber::onEvent(uint32_t events, int64_t now_ms) {
+    if (fd_ < 0) {
+        return;
+    }
+    if (state_ == State::CONNECTING) {
+        if (!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+            return;
+        }
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0) {
+            disconnect(now_ms, strerror(err));
+            return;
+        }
+        std::vector<uint8_t> body;
+        putString(body, "MQTT");
+        body.push_back(4);    // protocol level 3.1.1
+        uint8_t flags = 0x02; // clean session
+        if (!config_.username.empty()) flags |= 0x80;
+        if (!config_.password.empty()) flags |= 0x40;
+        body.push_back(flags);
+        body.push_back((uint8_t)(config_.keepalive_s >> 8));
+        body.push_back((uint8_t)config_.keepalive_s);
+        putString(body, config_.client_id);
+        if (!config_.username.empty()) putString(body, config_.username);
+        if (!config_.password.empty()) putString(body, config_.password);
+        queue(packet(CONNECT << 4, body));
+        state_ = State::WAIT_CONNACK;
+        last_send_ms_ = now_ms;
+    }
+    if ((events & EPOLLOUT) && !flushOut()) {
+        disconnect(now_ms, strerror(errno));
+        return;
+    }
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        if (!readAvailable(now_ms)) {
+            return;
+        }
+    }
+    if (fd_ >= 0 && !flushOut()) {
+        disconnect(now_ms, strerror(errno));
+    }
+}
+
+bool MqttSubscriber::readAvailable(int64_t now_ms) {
+    uint8_t buf[65536];
+    while (true) {
+        const ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+        if (n == 0) {
+            disconnect(now_ms, "closed by broker");
+            return false;
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            disconnect(now_ms, strerror(errno));
+            return false;
+        }
+        in_.insert(in_.end(), buf, buf + n);
+        last_recv_ms_ = now_ms;
+        if ((size_t)n < sizeof(buf)) {
+            break;
+        }
+    }
+
+    size_t pos = 0;
+    while (in_.size() - pos >= 2) {
+        // Fixed header: type/flags, then 1-4 bytes of remaining length
+        size_t len = 0;
+        size_t i = 1;
+        int shift = 0;
+        bool complete = false;
+        while (pos + i < in_.size() && i <= 4) {
+            const uint8_t byte = in_[pos + i++];
+            len |= (size_t)(byte & 0x7F) << shift;
+            shift += 7;
+            if (!(byte & 0x80)) {
+                complete = true;
+                break;
+            }
+        }
+        if (!complete) {
+            if (i > 4) {
+                disconnect(now_ms, "bad packet length");
+                return false;
+            }
+            break;
+        }
+        if (len > MAX_PACKET_BYTES) {
+            disconnect(now_ms, "packet too large");
+            return false;
+        }
+        if (in_.size() - pos - i < len) {
+            break;
+        }
+        if (!handlePacket(in_[pos], in_.data() + pos + i, len, now_ms)) {
+            return false;
+        }
+        pos += i + len;
+    }
+    in_.erase(in_.begin(), in_.begin() + (std::ptrdiff_t)pos);
+    return true;
+}
+
+bool MqttSubscriber::handlePacket(uint8_t type_flags, const uint8_t* body, size_t len, int64_t now_ms) {
+    switch (type_flags >> 4) {
+        case CONNACK: {
+            if (len < 2 || body[1] != 0) {
+                disconnect(now_ms, "connection refused");
+                return false;
+            }
+            std::vector<uint8_t> sub;
+            sub.push_back((uint8_t)(SUBSCRIBE_PACKET_ID >> 8));
+            sub.push_back((uint8_t)SUBSCRIBE_PACKET_ID);
+            putString(sub, config_.topic);
+            sub.push_back(0);     // QoS 0
+            queue(packet((SUBSCRIBE << 4) | 0x02, sub));
+            state_ = State::WAIT_SUBACK;
+            last_send_ms_ = now_ms;
+            return true;
+        }
+        case SUBACK:
+            if (len < 3 || body[2] == 0x80) {
+                disconnect(now_ms, "subscription refused");
+                return false;
+            }
+            state_ = State::SUBSCRIBED;
+            connects_++;
+            backoff_ms_ = 1000;
+            return true;
+        case PUBLISH: {
+            const uint8_t qos = (type_flags >> 1) & 0x03;
+            if (len < 2) {
+                return true;
+            }
+            const size_t topic_len = ((size_t)body[0] << 8) | body[1];
+            size_t off = 2 + topic_len;
+            if (qos) {
+                off += 2;
+            }
+            if (off > len) {
+                disconnect(now_ms, "malformed publish");
+                return false;
+            }
+            if (qos == 1) {
+                queue(packet(PUBACK << 4, { body[off - 2], body[off - 1] }));
+                last_send_ms_ = now_ms;
+            }
+            messages_++;
+            handler_(reinterpret_cast<const char*>(body + 2), topic_len,
+                     reinterpret_cast<const char*>(body + off), len - off);
+            return true;
+        }
+        default:
+            // PINGRESP and anything else a subscriber can ignore
+            return true;
+    }
+}
+
+void MqttSubscriber::tick(int64_t now_ms) {
+    if (state_ == State::IDLE) {
+        if (now_ms >= next_attempt_ms_) {
+            startConnect(now_ms);
+        }
+        return;
+    }
+    const int64_t keepalive_ms = (int64_t)config_.keepalive_s * 1000;
+    if (state_ != State::SUBSCRIBED) {
+        // Connect/handshake timeout
+        if (now_ms - last_send_ms_ > 10000 && now_ms - last_recv_ms_ > 10000) {
+            disconnect(now_ms, "handshake timeout");
+        }
+        return;
+    }
+    if (keepalive_ms > 0) {
+        if (now_ms - last_recv_ms_ > keepalive_ms * 3 / 2) {
+            disconnect(now_ms, "keepalive timeout");
+            return;
+        }
+        if (now_ms - last_send_ms_ >= keepalive_ms / 2) {
+            queue(packet(PINGREQ << 4, {}));
+            last_send_ms_ = now_ms;
+            if (!flushOut()) {
+                disconnect(now_ms, strerror(errno));
+            }
+        }
+    }
+}
+
+} // namespace collector
@@ -0,0 +1,95 @@
+#ifndef COLLECTOR_MQTT_SUBSCRIBER_H
+#define COLLECTOR_MQTT_SUBSCRIBER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace collector {
+
+/**
+ * Minimal MQTT 3.1.1 subscriber on a non-blocking socket, driven by the
+ * owning worker's epoll loop
+ *
+ * Only what the collector needs: CONNECT (clean session, optional
+ * username/password), one SUBSCRIBE at QoS 0, PUBLISH receive (QoS 1 is
+ * acknowledged), keepalive pings and reconnect with backoff. Several
+ * subscribers can share the load through a "$share/<group>/..." filter on
+ * brokers that support shared subscriptions.
+ */
+class MqttSubscriber {
+public:
+    struct Config {
+        std::string host = "127.0.0.1";
+        uint16_t port = 1883;
+        std::string topic = "bms/telemetry/+";
+        std::string client_id = "bms_collector";
+        std::string username;
+        std::string password;
+        uint16_t keepalive_s = 60;
+    };
+
+    using MessageHandler = std::function<void(const char* topic, size_t topic_len,
+                                              const char* payload, size_t payload_len)>;
+
+    /**
+     * @param epoll_fd loop the socket is registered with
+     * @param tag      epoll_event.data.ptr used for this subscriber's socket
+     */
+    MqttSubscriber(int epoll_fd, void* tag, const Config& config, MessageHandler handler);
+    ~MqttSubscriber();
+
+    MqttSubscriber(const MqttSubscriber&) = delete;
+    MqttSubscriber& operator=(const MqttSubscriber&) = delete;
+
+    void onEvent(uint32_t events, int64_t now_ms);
+
+    // Keepalive and reconnect; call at least once a second
+    void tick(int64_t now_ms);
+
+    bool subscribed() const { return state_ == State::SUBSCRIBED; }
+    uint64_t messages() const { return messages_; }
+    uint64_t connects() const { return connects_; }
+
+private:
+    enum class State {
+        IDLE,           // waiting for the reconnect time
+        CONNECTING,     // TCP connect in progress
+        WAIT_CONNACK,
+        WAIT_SUBACK,
+        SUBSCRIBED
+    };
+
+    void startConnect(int64_t now_ms);
+    void disconnect(int64_t now_ms, const char* reason);
+    void queue(const std::vector<uint8_t>& packet);
+    bool flushOut();
+    void updateInterest();
+    bool readAvailable(int64_t now_ms);
+    bool handlePacket(uint8_t type_flags, const uint8_t* body, size_t len, int64_t now_ms);
+
+    int epoll_fd_;
+    void* tag_;
+    Config config_;
+    MessageHandler handler_;
+
+    int fd_ = -1;
+    State state_ = State::IDLE;
+    int64_t next_attempt_ms_ = 0;
+    uint32_t backoff_ms_ = 1000;
+    int64_t last_send_ms_ = 0;
+    int64_t last_recv_ms_ = 0;
+    bool want_write_ = false;
+    std::vector<uint8_t> in_;
+    std::vector<uint8_t> out_;
+    size_t out_pos_ = 0;
+
+    uint64_t messages_ = 0;
+    uint64_t connects_ = 0;
+};
+
+} // namespace collector
+
+#endif // COLLECTOR_MQTT_SUBSCRIBER_H
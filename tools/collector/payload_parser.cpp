@@ -0,0 +1,403 @@
+#include "payload_parser.h"
+#include <string.h>
+#include "delimiter_scan.h"
+
+using analyzer::parseInteger;
+using analyzer::parseNumber;
+using analyzer::scanLine;
+
+namespace collector {
+
+namespace {
+
+// Before this the device clock was not set (SNTP not synced)
+constexpr int64_t MIN_WALL_TIME_S = 1500000000;
+
+// CSVSerializer column positions
+enum CsvColumn {
+    CSV_DEVICE_ID = 0,
+    CSV_TIMESTAMP = 1,
+    CSV_ELAPSED_SEC = 2,
+    CSV_TOTAL_ENERGY_WH = 4,
+    CSV_PACK_V = 5,
+    CSV_PACK_I = 6,
+    CSV_SOC = 7,
+    CSV_POWER = 8,
+    CSV_CELL_COUNT = 12,
+    CSV_MIN_CELL_V = 13,
+    CSV_MAX_CELL_V = 15,
+    CSV_TEMP_COUNT = 18,
+    CSV_MIN_TEMP = 19,
+    CSV_MAX_TEMP = 20,
+    CSV_CHARGING = 21,
+    CSV_DISCHARGING = 22,
+    CSV_CELLS = 23
+};
+
+// Analytics and sequence columns after the packed cells and temperatures,
+// by offset from the first of them; older firmware stops before them
+enum CsvExtColumn {
+    CSV_EXT_ANOMALY_LEVEL = 8,
+    CSV_EXT_BOOT_ID = 10,
+    CSV_EXT_SEQ = 11,
+    CSV_EXT_FIELDS = 12
+};
+
+constexpr size_t CSV_MAX_FIELDS = CSV_CELLS + MAX_CELLS + MAX_TEMPS + CSV_EXT_FIELDS + 1;
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\0';
+}
+
+void copyDeviceId(Sample& s, const char* p, size_t len) {
+    if (len >= sizeof(s.device_id)) {
+        len = sizeof(s.device_id) - 1;
+    }
+    memcpy(s.device_id, p, len);
+    s.device_id[len] = '\0';
+}
+
+// One past the '}' closing the object at p, nullptr if the buffer ends first
+const char* findObjectEnd(const char* p, const char* end) {
+    int depth = 0;
+    bool in_string = false;
+    for (; p < end; ++p) {
+        const char c = *p;
+        if (in_string) {
+            if (c == '\\') {
+                ++p;
+            } else if (c == '"') {
+                in_string = false;
+            }
+        } else if (c == '"') {
+            in_string = true;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (--depth == 0) {
+                return p + 1;
+            }
+        }
+    }
+    return nullptr;
+}
+
+// ---- JSON ----------------------------------------------------------------
+
+enum JsonContext : uint8_t {
+    CTX_ROOT,
+    CTX_PACK,
+    CTX_CELLS,
+    CTX_TEMPS,
+    CTX_ANOMALY,
+    CTX_STATUS,
+    CTX_OTHER
+};
+
+struct Key {
+    const char* p;
+    size_t len;
+
+    bool is(const char* name) const {
+        return strlen(name) == len && memcmp(p, name, len) == 0;
+    }
+};
+
+const char* skipSpace(const char* p, const char* end) {
+    while (p < end && isSpace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+const char* stringEnd(const char* p, const char* end) {
+    // p is just past the opening quote; returns the closing quote
+    while (p < end && *p != '"') {
+        p += (*p == '\\') ? 2 : 1;
+    }
+    return p < end ? p : nullptr;
+}
+
+const char* scalarEnd(const char* p, const char* end) {
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && !isSpace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+JsonContext childContext(JsonContext parent, const Key& key) {
+    if (parent != CTX_ROOT) {
+        return CTX_OTHER;
+    }
+    if (key.is("pack")) return CTX_PACK;
+    if (key.is("cells")) return CTX_CELLS;
+    if (key.is("temperatures")) return CTX_TEMPS;
+    if (key.is("anomaly")) return CTX_ANOMALY;
+    if (key.is("status")) return CTX_STATUS;
+    return CTX_OTHER;
+}
+
+void assignScalar(JsonContext ctx, const Key& key, const char* v, const char* ve, Sample& s) {
+    switch (ctx) {
+        case CTX_ROOT:
+            if (key.is("elapsed_seconds")) s.uptime_s = (uint32_t)parseInteger(v, ve);
+            else if (key.is("seq")) s.seq = (uint32_t)parseInteger(v, ve);
+            else if (key.is("boot_id")) s.boot_id = (uint32_t)parseInteger(v, ve);
+            else if (key.is("total_energy_wh")) s.total_energy_wh = (float)parseNumber(v, ve);
+            break;
+        case CTX_PACK:
+            if (key.is("voltage_v")) s.pack_voltage_v = (float)parseNumber(v, ve);
+            else if (key.is("current_a")) s.pack_current_a = (float)parseNumber(v, ve);
+            else if (key.is("soc_pct")) s.soc_pct = (float)parseNumber(v, ve);
+            else if (key.is("power_w")) s.power_w = (float)parseNumber(v, ve);
+            break;
+        case CTX_CELLS:
+            if (key.is("min_voltage_v")) s.min_cell_voltage_v = (float)parseNumber(v, ve);
+            else if (key.is("max_voltage_v")) s.max_cell_voltage_v = (float)parseNumber(v, ve);
+            break;
+        case CTX_TEMPS:
+            if (key.is("min_c")) s.min_temp_c = (float)parseNumber(v, ve);
+            else if (key.is("max_c")) s.max_temp_c = (float)parseNumber(v, ve);
+            break;
+        case CTX_ANOMALY:
+            if (key.is("level")) s.anomaly_level = (int8_t)parseInteger(v, ve);
+            break;
+        case CTX_STATUS:
+            if (*v == 't') {
+                if (key.is("charging_enabled")) s.flags |= Sample::FLAG_CHARGING;
+                else if (key.is("discharging_enabled")) s.flags |= Sample::FLAG_DISCHARGING;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Numbers of a flat array into dst; returns one past ']' or nullptr
+const char* parseArray(const char* p, const char* end, float* dst, int max, uint8_t* count) {
+    int n = 0;
+    ++p;    // '['
+    while (true) {
+        p = skipSpace(p, end);
+        if (p >= end) {
+            return nullptr;
+        }
+        if (*p == ']') {
+            break;
+        }
+        if (*p == ',') {
+            ++p;
+            continue;
+        }
+        const char* ve = scalarEnd(p, end);
+        if (ve == p) {
+            return nullptr;
+        }
+        if (dst && n < max) {
+            dst[n++] = (float)parseNumber(p, ve);
+        }
+        p = ve;
+    }
+    if (count) {
+        *count = (uint8_t)n;
+    }
+    return p + 1;
+}
+
+} // namespace
+
+bool parseJsonRecord(const char* p, const char* end, Sample& s) {
+    JsonContext stack[8];
+    int depth = 0;
+    p = skipSpace(p, end);
+    if (p >= end || *p != '{') {
+        return false;
+    }
+    stack[depth++] = CTX_ROOT;
+    ++p;
+
+    while (depth > 0) {
+        p = skipSpace(p, end);
+        if (p >= end) {
+            return false;
+        }
+        if (*p == '}') {
+            --depth;
+            ++p;
+            continue;
+        }
+        if (*p == ',') {
+            ++p;
+            continue;
+        }
+        if (*p != '"') {
+            return false;
+        }
+        const char* ke = stringEnd(p + 1, end);
+        if (!ke) {
+            return false;
+        }
+        const Key key = { p + 1, (size_t)(ke - p - 1) };
+        p = skipSpace(ke + 1, end);
+        if (p >= end || *p != ':') {
+            return false;
+        }
+        p = skipSpace(p + 1, end);
+        if (p >= end) {
+            return false;
+        }
+
+        const JsonContext ctx = stack[depth - 1];
+        if (*p == '{') {
+            if (depth == (int)(sizeof(stack) / sizeof(stack[0]))) {
+                return false;
+            }
+            stack[depth++] = childContext(ctx, key);
+            ++p;
+        } else if (*p == '[') {
+            if (ctx == CTX_CELLS && key.is("values")) {
+                p = parseArray(p, end, s.cell_v, MAX_CELLS, &s.cell_count);
+            } else if (ctx == CTX_TEMPS && key.is("values")) {
+                p = parseArray(p, end, s.temp_c, MAX_TEMPS, &s.temp_count);
+            } else {
+                p = findObjectEnd(p, end);
+            }
+            if (!p) {
+                return false;
+            }
+        } else if (*p == '"') {
+            const char* ve = stringEnd(p + 1, end);
+            if (!ve) {
+                return false;
+            }
+            if (ctx == CTX_ROOT && key.is("device_id")) {
+                copyDeviceId(s, p + 1, (size_t)(ve - p - 1));
+            }
+            p = ve + 1;
+        } else {
+            const char* ve = scalarEnd(p, end);
+            assignScalar(ctx, key, p, ve, s);
+            p = ve;
+        }
+    }
+    return s.device_id[0] != '\0';
+}
+
+bool parseCsvRecord(const char* p, const char* end, Sample& s) {
+    const char* fields[CSV_MAX_FIELDS];
+    const char* line_end = nullptr;
+    const size_t n = scanLine(p, end, fields, CSV_MAX_FIELDS, &line_end);
+    if (n < CSV_CELLS) {
+        return false;
+    }
+    auto fieldEnd = [&](size_t i) { return i + 1 < n ? fields[i + 1] - 1 : line_end; };
+    auto number = [&](size_t i) { return (float)parseNumber(fields[i], fieldEnd(i)); };
+    auto integer = [&](size_t i) { return parseInteger(fields[i], fieldEnd(i)); };
+
+    int64_t cells = integer(CSV_CELL_COUNT);
+    int64_t temps = integer(CSV_TEMP_COUNT);
+    if (cells < 0 || temps < 0) {
+        return false;
+    }
+    if (cells > MAX_CELLS) cells = MAX_CELLS;
+    if (temps > MAX_TEMPS) temps = MAX_TEMPS;
+    // Rows carry only the populated cells and temperatures, so the column
+    // count tells whether the analytics and sequence columns follow them
+    const size_t ext_at = CSV_CELLS + (size_t)(cells + temps);
+    const bool has_ext = n == ext_at + CSV_EXT_FIELDS;
+    if (!has_ext && n != ext_at) {
+        return false;
+    }
+
+    copyDeviceId(s, fields[CSV_DEVICE_ID], (size_t)(fieldEnd(CSV_DEVICE_ID) - fields[CSV_DEVICE_ID]));
+    if (s.device_id[0] == '\0') {
+        return false;
+    }
+    s.time_s = integer(CSV_TIMESTAMP);
+    s.uptime_s = (uint32_t)integer(CSV_ELAPSED_SEC);
+    s.total_energy_wh = number(CSV_TOTAL_ENERGY_WH);
+    s.pack_voltage_v = number(CSV_PACK_V);
+    s.pack_current_a = number(CSV_PACK_I);
+    s.soc_pct = number(CSV_SOC);
+    s.power_w = number(CSV_POWER);
+    s.min_cell_voltage_v = number(CSV_MIN_CELL_V);
+    s.max_cell_voltage_v = number(CSV_MAX_CELL_V);
+    s.min_temp_c = number(CSV_MIN_TEMP);
+    s.max_temp_c = number(CSV_MAX_TEMP);
+    if (integer(CSV_CHARGING)) s.flags |= Sample::FLAG_CHARGING;
+    if (integer(CSV_DISCHARGING)) s.flags |= Sample::FLAG_DISCHARGING;
+    if (has_ext) {
+        s.anomaly_level = (int8_t)integer(ext_at + CSV_EXT_ANOMALY_LEVEL);
+        s.boot_id = (uint32_t)integer(ext_at + CSV_EXT_BOOT_ID);
+        s.seq = (uint32_t)integer(ext_at + CSV_EXT_SEQ);
+    }
+    s.cell_count = (uint8_t)cells;
+    s.temp_count = (uint8_t)temps;
+    for (int i = 0; i < cells; ++i) {
+        s.cell_v[i] = number(CSV_CELLS + (size_t)i);
+    }
+    for (int i = 0; i < temps; ++i) {
+        s.temp_c[i] = number(CSV_CELLS + (size_t)cells + (size_t)i);
+    }
+    return true;
+}
+
+ParseResult parsePayload(const char* data, size_t len, bool final, Source source, int64_t recv_ms,
+                         std::vector<Sample>& out) {
+    ParseResult result;
+    const char* p = data;
+    const char* const end = data + len;
+
+    while (true) {
+        p = skipSpace(p, end);
+        if (p >= end) {
+            break;
+        }
+        const bool json = *p == '{';
+        const char* record_end;
+        const char* next;
+        if (json) {
+            record_end = findObjectEnd(p, end);
+            next = record_end;
+        } else {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)(end - p)));
+            record_end = nl ? nl : (final ? end : nullptr);
+            next = nl ? nl + 1 : end;
+        }
+        if (!record_end) {
+            if (final) {
+                result.errors++;
+                p = end;
+            }
+            break;
+        }
+
+        if (!json && (size_t)(record_end - p) >= 10 && memcmp(p, "device_id,", 10) == 0) {
+            p = next;
+            continue;
+        }
+        while (!json && record_end > p && record_end[-1] == '\r') {
+            --record_end;
+        }
+
+        out.emplace_back();
+        Sample& s = out.back();
+        s.source = source;
+        s.recv_ms = recv_ms;
+        if (json ? parseJsonRecord(p, record_end, s) : parseCsvRecord(p, record_end, s)) {
+            // JSON carries only device uptime; CSV has a wall clock once SNTP synced
+            if (s.time_s < MIN_WALL_TIME_S) {
+                s.time_s = recv_ms / 1000;
+            }
+            result.records++;
+        } else {
+            out.pop_back();
+            result.errors++;
+        }
+        p = next;
+    }
+    result.consumed = (size_t)(p - data);
+    return result;
+}
+
+} // namespace collector
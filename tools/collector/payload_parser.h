@@ -0,0 +1,35 @@
+#ifndef COLLECTOR_PAYLOAD_PARSER_H
+#define COLLECTOR_PAYLOAD_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "sample.h"
+
+namespace collector {
+
+struct ParseResult {
+    size_t consumed = 0;      // bytes fully handled; the rest is an incomplete record
+    uint32_t records = 0;
+    uint32_t errors = 0;
+};
+
+/**
+ * Decode the records in one buffer: a UDP datagram, an MQTT payload, or what
+ * a TCP connection has delivered so far
+ *
+ * Records are JSONSerializer objects (pretty-printed or compact) or
+ * CSVSerializer rows, told apart by the first character; any number may be
+ * concatenated. CSV rows end at a newline, or at the end of a datagram/payload
+ * (final = true). With final = false an unterminated record is left
+ * unconsumed for the next read. CSV header lines are skipped.
+ */
+ParseResult parsePayload(const char* data, size_t len, bool final, Source source, int64_t recv_ms,
+                         std::vector<Sample>& out);
+
+bool parseJsonRecord(const char* p, const char* end, Sample& s);
+bool parseCsvRecord(const char* p, const char* end, Sample& s);
+
+} // namespace collector
+
+#endif // COLLECTOR_PAYLOAD_PARSER_H
@@ -0,0 +1,51 @@
+#ifndef COLLECTOR_SAMPLE_H
+#define COLLECTOR_SAMPLE_H
+
+#include <stdint.h>
+
+namespace collector {
+
+// Same limits as output::BMSSnapshot / CSVSerializer
+constexpr int MAX_CELLS = 16;
+constexpr int MAX_TEMPS = 8;
+
+enum class Source : uint8_t {
+    UDP = 0,
+    TCP = 1,
+    MQTT = 2
+};
+
+/**
+ * One telemetry record as received from a monitor, in any serializer format
+ */
+struct Sample {
+    char device_id[33] = { 0 };
+    Source source = Source::UDP;
+    int64_t time_s = 0;           // sample wall time; receive time when the device had no clock
+    int64_t recv_ms = 0;          // collector wall clock at receive
+    uint32_t uptime_s = 0;        // elapsed_sec on the device
+    uint32_t boot_id = 0;         // changes on every device boot; 0 from older firmware
+    uint32_t seq = 0;             // sample sequence within the boot, from 1; 0 from older firmware
+    float total_energy_wh = 0.0f;
+    float pack_voltage_v = 0.0f;
+    float pack_current_a = 0.0f;  // positive = charging
+    float power_w = 0.0f;
+    float soc_pct = 0.0f;
+    float min_cell_voltage_v = 0.0f;
+    float max_cell_voltage_v = 0.0f;
+    float min_temp_c = 0.0f;
+    float max_temp_c = 0.0f;
+    uint8_t flags = 0;            // FLAG_*
+    int8_t anomaly_level = 0;
+    uint8_t cell_count = 0;
+    uint8_t temp_count = 0;
+    float cell_v[MAX_CELLS] = {};
+    float temp_c[MAX_TEMPS] = {};
+
+    static constexpr uint8_t FLAG_CHARGING = 0x01;
+    static constexpr uint8_t FLAG_DISCHARGING = 0x02;
+};
+
+} // namespace collector
+
+#endif // COLLECTOR_SAMPLE_H
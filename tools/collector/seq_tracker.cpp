@@ -0,0 +1,38 @@
+#include "seq_tracker.h"
+#include <string.h>
+#include <functional>
+#include <string_view>
+
+namespace collector {
+
+void SeqTracker::add(const Sample& s) {
+    if (s.seq == 0) {
+        return;
+    }
+    const std::string_view id(s.device_id, strnlen(s.device_id, sizeof(s.device_id)));
+    Shard& shard = shards_[std::hash<std::string_view>()(id) % SHARDS];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.devices.find(std::string(id));
+    if (it == shard.devices.end()) {
+        it = shard.devices.emplace(std::string(id), Run()).first;
+    } else if (it->second.boot_id != s.boot_id) {
+        // What went missing in the previous boot stays counted
+        restarts_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        Run& run = it->second;
+        const int64_t before = (int64_t)(run.last - run.first) + 1 - (int64_t)run.received;
+        run.received++;
+        if (s.seq < run.first) run.first = s.seq;
+        if (s.seq > run.last) run.last = s.seq;
+        const int64_t after = (int64_t)(run.last - run.first) + 1 - (int64_t)run.received;
+        missing_.fetch_add(after - before, std::memory_order_relaxed);
+        return;
+    }
+    it->second.boot_id = s.boot_id;
+    it->second.first = s.seq;
+    it->second.last = s.seq;
+    it->second.received = 1;
+}
+
+} // namespace collector
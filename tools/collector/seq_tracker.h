@@ -0,0 +1,59 @@
+#ifndef COLLECTOR_SEQ_TRACKER_H
+#define COLLECTOR_SEQ_TRACKER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "sample.h"
+
+namespace collector {
+
+/**
+ * Loss accounting from the boot_id / seq every sample carries
+ *
+ * Per device and boot, the samples missing are the span of sequence numbers
+ * seen minus the samples received. That does not depend on arrival order, so
+ * a device whose records reach several workers (MQTT shared subscriptions)
+ * is counted exactly. Samples lost after the last one received before a
+ * reboot cannot be seen. Samples without a seq (older firmware) are ignored.
+ *
+ * Thread-safe: devices are spread over sharded locks.
+ */
+class SeqTracker {
+public:
+    void add(const Sample& s);
+
+    // Samples missing across all devices and boots; late arrivals bring it back down
+    uint64_t missing() const {
+        const int64_t m = missing_.load(std::memory_order_relaxed);
+        return m > 0 ? (uint64_t)m : 0;
+    }
+
+    // Boot ID changes seen (device restarts while the collector ran)
+    uint64_t restarts() const { return restarts_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t SHARDS = 64;
+
+    struct Run {
+        uint32_t boot_id = 0;
+        uint32_t first = 0;
+        uint32_t last = 0;
+        uint64_t received = 0;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, Run> devices;
+    };
+
+    Shard shards_[SHARDS];
+    std::atomic<int64_t> missing_{0};
+    std::atomic<uint64_t> restarts_{0};
+};
+
+} // namespace collector
+
+#endif // COLLECTOR_SEQ_TRACKER_H
@@ -0,0 +1,266 @@
+#include "csv_decoder.h"
+#include <string.h>
+#include "delimiter_scan.h"
+#include "log_stats.h"
+
+namespace analyzer {
+
+namespace {
+
+constexpr char HEADER_PREFIX[] = "device_id,";
+constexpr size_t HEADER_PREFIX_LEN = sizeof(HEADER_PREFIX) - 1;
+
+// CSVSerializer::getHeader() of the current firmware, for files without a header
+constexpr char DEFAULT_HEADER[] =
+    "device_id,timestamp,elapsed_sec,hours:minutes:seconds,total_energy_wh,pack_voltage_v,"
+    "pack_current_a,soc_pct,power_w,full_capacity_ah,peak_current_a,peak_power_w,cell_count,"
+    "min_cell_voltage_v,min_cell_num,max_cell_voltage_v,max_cell_num,cell_voltage_delta_v,"
+    "temp_count,min_temp_c,max_temp_c,charging_enabled,discharging_enabled,"
+    "cell_v_1,cell_v_2,cell_v_3,cell_v_4,cell_v_5,cell_v_6,cell_v_7,cell_v_8,"
+    "cell_v_9,cell_v_10,cell_v_11,cell_v_12,cell_v_13,cell_v_14,cell_v_15,cell_v_16,"
+    "temp_c_1,temp_c_2,temp_c_3,temp_c_4,temp_c_5,temp_c_6,temp_c_7,temp_c_8,"
+    "cell_spread_1h_v,cell_max_stddev_1h_v,cell_drift_1h,cell_drift_1h_mv_per_h,est_capacity_ah,"
+    "soh_pct,time_to_empty_s,time_to_full_s,anomaly_level,anomaly_cell,boot_id,seq";
+
+constexpr size_t MAX_FIELDS = 128;
+
+bool isHeaderAt(const char* p, const char* end) {
+    return (size_t)(end - p) >= HEADER_PREFIX_LEN && memcmp(p, HEADER_PREFIX, HEADER_PREFIX_LEN) == 0;
+}
+
+const char* lineEnd(const char* p, const char* end) {
+    const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)(end - p)));
+    return nl ? nl : end;
+}
+
+// End of field i: the byte before the next field's start, minus a trailing '\r'
+inline const char* fieldEnd(const char* const* fields, size_t n, size_t i, const char* line_end) {
+    const char* e = (i + 1 < n) ? fields[i + 1] - 1 : line_end;
+    if (e > fields[i] && e[-1] == '\r') {
+        --e;
+    }
+    return e;
+}
+
+} // namespace
+
+bool CsvDecoder::looksLikeCsv(const char* data, size_t size) {
+    if (isHeaderAt(data, data + size)) {
+        return true;
+    }
+    // Headerless capture: a text line with many separators
+    const char* end = lineEnd(data, data + (size < 4096 ? size : 4096));
+    size_t commas = 0;
+    for (const char* p = data; p < end; ++p) {
+        const unsigned char c = (unsigned char)*p;
+        if (c == ',') {
+            commas++;
+        } else if (c < 0x20 && c != '\r' && c != '\t') {
+            return false;
+        }
+    }
+    return commas >= 10;
+}
+
+CsvDecoder::Layout CsvDecoder::parseHeader(const char* begin, const char* end) {
+    struct NamedField {
+        const char* name;
+        Field field;
+    };
+    static const NamedField NAMED[] = {
+        { "device_id", F_DEVICE_ID },
+        { "timestamp", F_TIMESTAMP },
+        { "elapsed_sec", F_ELAPSED_SEC },
+        { "pack_voltage_v", F_PACK_V },
+        { "pack_current_a", F_PACK_I },
+        { "soc_pct", F_SOC },
+        { "power_w", F_POWER },
+        { "cell_count", F_CELL_COUNT },
+        { "min_cell_voltage_v", F_MIN_CELL_V },
+        { "min_cell_num", F_MIN_CELL_NUM },
+        { "max_cell_voltage_v", F_MAX_CELL_V },
+        { "max_cell_num", F_MAX_CELL_NUM },
+        { "temp_count", F_TEMP_COUNT },
+    };
+
+    Layout layout;
+    const char* fields[MAX_FIELDS];
+    const char* line_end = nullptr;
+    const size_t n = scanLine(begin, end, fields, MAX_FIELDS, &line_end);
+    bool in_groups = false;
+    for (size_t i = 0; i < n; ++i) {
+        const char* f = fields[i];
+        const size_t len = (size_t)(fieldEnd(fields, n, i, line_end) - f);
+        if (len > 7 && memcmp(f, "cell_v_", 7) == 0) {
+            in_groups = true;
+            layout.header_cells++;
+            continue;
+        }
+        if (len > 7 && memcmp(f, "temp_c_", 7) == 0) {
+            in_groups = true;
+            layout.header_temps++;
+            continue;
+        }
+        if (in_groups) {
+            // Analytics and sequence columns; they follow the packed groups,
+            // so their position varies per row and none is decoded here
+            layout.trailing++;
+            continue;
+        }
+        Field field = F_IGNORE;
+        for (const auto& named : NAMED) {
+            if (strlen(named.name) == len && memcmp(named.name, f, len) == 0) {
+                field = named.field;
+                break;
+            }
+        }
+        layout.fixed.push_back(field);
+    }
+    layout.cells_at = layout.fixed.size();
+    layout.max_fields = layout.cells_at + (size_t)layout.header_cells + (size_t)layout.header_temps +
+                        layout.trailing;
+    if (layout.max_fields > MAX_FIELDS) {
+        layout.max_fields = MAX_FIELDS;
+    }
+    return layout;
+}
+
+std::vector<Chunk> CsvDecoder::split(const MappedFile& file, size_t target_bytes) {
+    const char* data = file.data();
+    const size_t size = file.size();
+    std::vector<Chunk> chunks;
+    layouts_.clear();
+    if (size == 0) {
+        return chunks;
+    }
+
+    // Headers: one at the top of every SD file, more if rotations were concatenated
+    struct HeaderAt {
+        size_t offset;
+        size_t layout;
+    };
+    std::vector<HeaderAt> headers;
+    if (!isHeaderAt(data, data + size)) {
+        layouts_.push_back(parseHeader(DEFAULT_HEADER, DEFAULT_HEADER + sizeof(DEFAULT_HEADER) - 1));
+        headers.push_back({ 0, 0 });
+    }
+    const char* p = data;
+    const char* end = data + size;
+    while (p < end) {
+        if (isHeaderAt(p, end)) {
+            layouts_.push_back(parseHeader(p, lineEnd(p, end)));
+            headers.push_back({ (size_t)(p - data), layouts_.size() - 1 });
+        }
+        const void* next = memmem(p, (size_t)(end - p), "\ndevice_id,", HEADER_PREFIX_LEN + 1);
+        if (!next) {
+            break;
+        }
+        p = static_cast<const char*>(next) + 1;
+    }
+
+    if (target_bytes == 0) {
+        target_bytes = size;
+    }
+    size_t begin = 0;
+    size_t h = 0;
+    while (begin < size) {
+        size_t stop = begin + target_bytes;
+        if (stop >= size) {
+            stop = size;
+        } else {
+            const char* nl = static_cast<const char*>(memchr(data + stop, '\n', size - stop));
+            stop = nl ? (size_t)(nl - data) + 1 : size;
+        }
+        while (h + 1 < headers.size() && headers[h + 1].offset <= begin) {
+            ++h;
+        }
+        chunks.push_back({ begin, stop, headers[h].layout });
+        begin = stop;
+    }
+    return chunks;
+}
+
+void CsvDecoder::decode(const MappedFile& file, const Chunk& chunk, ChunkStats& stats) const {
+    const char* p = file.data() + chunk.begin;
+    const char* const end = file.data() + chunk.end;
+    const Layout* layout = &layouts_[chunk.layout];
+    Layout inline_layout;
+
+    const char* fields[MAX_FIELDS];
+    Record r;
+
+    while (p < end) {
+        if (*p == '\n' || *p == '\r' || *p == '#') {
+            p = lineEnd(p, end) + 1;
+            continue;
+        }
+        if (*p == 'd' && isHeaderAt(p, end)) {
+            const char* le = lineEnd(p, end);
+            inline_layout = parseHeader(p, le);
+            layout = &inline_layout;
+            p = le + 1;
+            continue;
+        }
+
+        const char* line_end = nullptr;
+        const size_t n = scanLine(p, end, fields, layout->max_fields, &line_end);
+        p = line_end + 1;
+        if (n < layout->cells_at) {
+            stats.addError();     // truncated (e.g. power lost mid-write)
+            continue;
+        }
+
+        int64_t timestamp = 0;
+        int64_t elapsed = 0;
+        r.cell_count = 0;
+        r.temp_count = 0;
+        for (size_t i = 0; i < layout->cells_at; ++i) {
+            const Field f = layout->fixed[i];
+            if (f == F_IGNORE) {
+                continue;
+            }
+            const char* v = fields[i];
+            const char* ve = fieldEnd(fields, n, i, line_end);
+            switch (f) {
+                case F_DEVICE_ID: stats.noteDevice(v, (size_t)(ve - v)); break;
+                case F_TIMESTAMP: timestamp = parseInteger(v, ve); break;
+                case F_ELAPSED_SEC: elapsed = parseInteger(v, ve); break;
+                case F_PACK_V: r.pack_voltage_v = (float)parseNumber(v, ve); break;
+                case F_PACK_I: r.pack_current_a = (float)parseNumber(v, ve); break;
+                case F_SOC: r.soc_pct = (float)parseNumber(v, ve); break;
+                case F_POWER: r.power_w = (float)parseNumber(v, ve); break;
+                case F_CELL_COUNT: r.cell_count = (int)parseInteger(v, ve); break;
+                case F_MIN_CELL_V: r.min_cell_voltage_v = (float)parseNumber(v, ve); break;
+                case F_MIN_CELL_NUM: r.min_cell_num = (int)parseInteger(v, ve); break;
+                case F_MAX_CELL_V: r.max_cell_voltage_v = (float)parseNumber(v, ve); break;
+                case F_MAX_CELL_NUM: r.max_cell_num = (int)parseInteger(v, ve); break;
+                case F_TEMP_COUNT: r.temp_count = (int)parseInteger(v, ve); break;
+                default: break;
+            }
+        }
+
+        int cells = r.cell_count < layout->header_cells ? r.cell_count : layout->header_cells;
+        int temps = r.temp_count < layout->header_temps ? r.temp_count : layout->header_temps;
+        if (cells < 0) cells = 0;
+        if (temps < 0) temps = 0;
+        if (cells > MAX_CELLS) cells = MAX_CELLS;
+        if (temps > MAX_TEMPS) temps = MAX_TEMPS;
+        if (n < layout->cells_at + (size_t)cells + (size_t)temps) {
+            stats.addError();
+            continue;
+        }
+        size_t col = layout->cells_at;
+        for (int i = 0; i < cells; ++i, ++col) {
+            r.cell_v[i] = (float)parseNumber(fields[col], fieldEnd(fields, n, col, line_end));
+        }
+        for (int i = 0; i < temps; ++i, ++col) {
+            r.temp_c[i] = (float)parseNumber(fields[col], fieldEnd(fields, n, col, line_end));
+        }
+        r.cell_count = cells;
+        r.temp_count = temps;
+        r.time_s = timestamp > 0 ? timestamp : elapsed;
+        stats.add(r);
+    }
+}
+
+} // namespace analyzer
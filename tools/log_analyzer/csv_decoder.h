@@ -0,0 +1,65 @@
+#ifndef ANALYZER_CSV_DECODER_H
+#define ANALYZER_CSV_DECODER_H
+
+#include <stdint.h>
+#include <vector>
+#include "record_decoder.h"
+
+namespace analyzer {
+
+/**
+ * CSV as written by CSVSerializer (SD card sink, serial sink in CSV mode)
+ *
+ * Columns are mapped by header name, so older firmware with fewer columns
+ * decodes too. The header lists cell_v_1..N and temp_c_1..M for the
+ * configured maximum, but rows only carry cell_count cells followed by
+ * temp_count temperatures, so those two groups are read positionally.
+ * Columns named after the groups (analytics, boot_id, seq) come after the
+ * packed temperatures and are not decoded.
+ * Header lines repeated mid-file (concatenated rotations) start a new layout.
+ */
+class CsvDecoder : public RecordDecoder {
+public:
+    const char* name() const override { return "csv"; }
+    std::vector<Chunk> split(const MappedFile& file, size_t target_bytes) override;
+    void decode(const MappedFile& file, const Chunk& chunk, ChunkStats& stats) const override;
+
+    static bool looksLikeCsv(const char* data, size_t size);
+
+private:
+    enum Field : uint8_t {
+        F_IGNORE = 0,
+        F_DEVICE_ID,
+        F_TIMESTAMP,
+        F_ELAPSED_SEC,
+        F_PACK_V,
+        F_PACK_I,
+        F_SOC,
+        F_POWER,
+        F_CELL_COUNT,
+        F_MIN_CELL_V,
+        F_MIN_CELL_NUM,
+        F_MAX_CELL_V,
+        F_MAX_CELL_NUM,
+        F_TEMP_COUNT,
+        F_CELL_V,
+        F_TEMP_C
+    };
+
+    struct Layout {
+        std::vector<Field> fixed;     // columns before the first cell_v_ column
+        size_t cells_at = 0;          // index of cell_v_1 (== fixed.size())
+        int header_cells = 0;
+        int header_temps = 0;
+        size_t trailing = 0;          // columns after the temp_c_ group
+        size_t max_fields = 0;
+    };
+
+    static Layout parseHeader(const char* begin, const char* end);
+
+    std::vector<Layout> layouts_;
+};
+
+} // namespace analyzer
+
+#endif // ANALYZER_CSV_DECODER_H
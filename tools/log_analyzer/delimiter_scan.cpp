@@ -0,0 +1,24 @@
+#include "delimiter_scan.h"
+#include <stdlib.h>
+
+namespace analyzer {
+
+double parseNumberSlow(const char* p, const char* end) {
+    // Fields point into a mapped file or receive buffer, not NUL-terminated
+    char buf[64];
+    size_t len = (size_t)(end - p);
+    while (len && (p[len - 1] == '\r' || p[len - 1] == ' ')) {
+        --len;
+    }
+    if (len == 0) {
+        return 0.0;
+    }
+    if (len >= sizeof(buf)) {
+        len = sizeof(buf) - 1;
+    }
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+    return strtod(buf, nullptr);
+}
+
+} // namespace analyzer
@@ -0,0 +1,171 @@
+#ifndef ANALYZER_DELIMITER_SCAN_H
+#define ANALYZER_DELIMITER_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace analyzer {
+
+/**
+ * Split one CSV line in a single pass: finds the field separators and the end
+ * of line together, 32 (AVX2) or 16 (SSE2/NEON) bytes per step
+ *
+ * fields[i] receives the start of field i (at most max_fields); the return
+ * value is the field count and *line_end points at the '\n' (or end).
+ * Fields beyond max_fields are not split but the line end is still found.
+ */
+inline size_t scanLine(const char* p, const char* end, const char** fields, size_t max_fields,
+                       const char** line_end) {
+    size_t n = 0;
+    fields[n++] = p;
+
+#if defined(__AVX2__)
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    while (p + 32 <= end) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        uint32_t commas = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, comma));
+        const uint32_t newlines = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+        if (newlines) {
+            const uint32_t nl = (uint32_t)__builtin_ctz(newlines);
+            commas &= (1u << nl) - 1u;
+            while (commas && n < max_fields) {
+                fields[n++] = p + __builtin_ctz(commas) + 1;
+                commas &= commas - 1;
+            }
+            *line_end = p + nl;
+            return n;
+        }
+        while (commas && n < max_fields) {
+            fields[n++] = p + __builtin_ctz(commas) + 1;
+            commas &= commas - 1;
+        }
+        p += 32;
+    }
+#elif defined(__SSE2__)
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (p + 16 <= end) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        uint32_t commas = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, comma));
+        const uint32_t newlines = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+        if (newlines) {
+            const uint32_t nl = (uint32_t)__builtin_ctz(newlines);
+            commas &= (1u << nl) - 1u;
+            while (commas && n < max_fields) {
+                fields[n++] = p + __builtin_ctz(commas) + 1;
+                commas &= commas - 1;
+            }
+            *line_end = p + nl;
+            return n;
+        }
+        while (commas && n < max_fields) {
+            fields[n++] = p + __builtin_ctz(commas) + 1;
+            commas &= commas - 1;
+        }
+        p += 16;
+    }
+#elif defined(__ARM_NEON)
+    // No movemask on NEON: narrow the compare result to 4 bits per byte
+    const uint8x16_t comma = vdupq_n_u8(',');
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    while (p + 16 <= end) {
+        const uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+        uint64_t commas = vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(vceqq_u8(v, comma)), 4)), 0) & 0x8888888888888888ULL;
+        const uint64_t newlines = vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(vceqq_u8(v, newline)), 4)), 0) & 0x8888888888888888ULL;
+        if (newlines) {
+            const uint32_t nl = (uint32_t)__builtin_ctzll(newlines) >> 2;
+            commas &= (nl ? (~0ULL >> (64 - 4 * nl)) : 0ULL);
+            while (commas && n < max_fields) {
+                fields[n++] = p + (__builtin_ctzll(commas) >> 2) + 1;
+                commas &= commas - 1;
+            }
+            *line_end = p + nl;
+            return n;
+        }
+        while (commas && n < max_fields) {
+            fields[n++] = p + (__builtin_ctzll(commas) >> 2) + 1;
+            commas &= commas - 1;
+        }
+        p += 16;
+    }
+#endif
+
+    // Scalar tail (and the whole line without SIMD)
+    while (p < end && *p != '\n') {
+        if (*p == ',' && n < max_fields) {
+            fields[n++] = p + 1;
+        }
+        ++p;
+    }
+    *line_end = p;
+    return n;
+}
+
+/**
+ * Decimal as printed by the serializers ("-12.345"); falls back to strtod for
+ * anything else (exponents, inf/nan)
+ */
+double parseNumberSlow(const char* p, const char* end);
+
+inline double parseNumber(const char* p, const char* end) {
+    const char* s = p;
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = *s == '-';
+        ++s;
+    }
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int frac = 0;
+    while (s < end && (unsigned)(*s - '0') < 10u) {
+        mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+        ++s;
+        ++digits;
+    }
+    if (s < end && *s == '.') {
+        ++s;
+        while (s < end && (unsigned)(*s - '0') < 10u) {
+            mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+            ++s;
+            ++digits;
+            ++frac;
+        }
+    }
+    if (s != end || digits == 0 || digits > 18) {
+        return parseNumberSlow(p, end);
+    }
+    static const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+    const double value = (double)mantissa / POW10[frac];
+    return negative ? -value : value;
+}
+
+inline int64_t parseInteger(const char* p, const char* end) {
+    bool negative = false;
+    if (p < end && *p == '-') {
+        negative = true;
+        ++p;
+    }
+    int64_t value = 0;
+    while (p < end && (unsigned)(*p - '0') < 10u) {
+        value = value * 10 + (*p - '0');
+        ++p;
+    }
+    return negative ? -value : value;
+}
+
+} // namespace analyzer
+
+#endif // ANALYZER_DELIMITER_SCAN_H
@@ -0,0 +1,208 @@
+#include "log_stats.h"
+#include <math.h>
+#include <string.h>
+
+namespace analyzer {
+
+void RunningStat::merge(const RunningStat& o) {
+    n += o.n;
+    sum += o.sum;
+    sum_sq += o.sum_sq;
+    if (o.min < min) min = o.min;
+    if (o.max > max) max = o.max;
+}
+
+double RunningStat::stddev() const {
+    if (n < 2) {
+        return 0.0;
+    }
+    const double m = mean();
+    const double var = sum_sq / (double)n - m * m;
+    return var > 0.0 ? sqrt(var) : 0.0;
+}
+
+void Energy::merge(const Energy& o) {
+    charge_wh += o.charge_wh;
+    discharge_wh += o.discharge_wh;
+    charge_ah += o.charge_ah;
+    discharge_ah += o.discharge_ah;
+    covered_s += o.covered_s;
+    gaps += o.gaps;
+}
+
+void Bucket::add(const Record& r) {
+    n++;
+    pack_voltage_v += r.pack_voltage_v;
+    pack_current_a += r.pack_current_a;
+    power_w += r.power_w;
+    soc_pct += r.soc_pct;
+    if (r.min_cell_voltage_v < min_cell_voltage_v) min_cell_voltage_v = r.min_cell_voltage_v;
+    if (r.max_cell_voltage_v > max_cell_voltage_v) max_cell_voltage_v = r.max_cell_voltage_v;
+    if (r.cell_count > cells) cells = r.cell_count;
+    if (r.temp_count > temps) temps = r.temp_count;
+    for (int i = 0; i < r.cell_count; ++i) {
+        cell_v[i] += r.cell_v[i];
+    }
+    for (int i = 0; i < r.temp_count; ++i) {
+        temp_c[i] += r.temp_c[i];
+    }
+}
+
+void Bucket::merge(const Bucket& o) {
+    n += o.n;
+    pack_voltage_v += o.pack_voltage_v;
+    pack_current_a += o.pack_current_a;
+    power_w += o.power_w;
+    soc_pct += o.soc_pct;
+    if (o.min_cell_voltage_v < min_cell_voltage_v) min_cell_voltage_v = o.min_cell_voltage_v;
+    if (o.max_cell_voltage_v > max_cell_voltage_v) max_cell_voltage_v = o.max_cell_voltage_v;
+    if (o.cells > cells) cells = o.cells;
+    if (o.temps > temps) temps = o.temps;
+    for (int i = 0; i < MAX_CELLS; ++i) {
+        cell_v[i] += o.cell_v[i];
+    }
+    for (int i = 0; i < MAX_TEMPS; ++i) {
+        temp_c[i] += o.temp_c[i];
+    }
+    charge_wh += o.charge_wh;
+    discharge_wh += o.discharge_wh;
+}
+
+Bucket& ChunkStats::bucketFor(int64_t time_s) {
+    const int64_t width = (int64_t)config_->resample_s;
+    int64_t key = time_s - time_s % width;
+    if (time_s < 0 && time_s % width) {
+        key -= width;
+    }
+    if (!bucket_ || key != bucket_key_) {
+        bucket_ = &buckets[key];
+        bucket_key_ = key;
+    }
+    return *bucket_;
+}
+
+void ChunkStats::integrate(const Edge& a, const Edge& b) {
+    const int64_t dt = b.time_s - a.time_s;
+    if (dt <= 0 || dt > (int64_t)config_->max_gap_s) {
+        // Same second (sub-second polling) adds nothing; backwards or long gaps are not bridged
+        if (dt != 0) {
+            energy.gaps++;
+        }
+        return;
+    }
+    // Trapezoid over the interval; positive power and current are charging
+    const double hours = (double)dt / 3600.0;
+    const double wh = 0.5 * ((double)a.power_w + b.power_w) * hours;
+    const double ah = 0.5 * ((double)a.current_a + b.current_a) * hours;
+    if (wh >= 0.0) {
+        energy.charge_wh += wh;
+    } else {
+        energy.discharge_wh -= wh;
+    }
+    if (ah >= 0.0) {
+        energy.charge_ah += ah;
+    } else {
+        energy.discharge_ah -= ah;
+    }
+    energy.covered_s += (double)dt;
+
+    if (config_->resample_s) {
+        Bucket& bucket = bucketFor(b.time_s);
+        if (wh >= 0.0) {
+            bucket.charge_wh += wh;
+        } else {
+            bucket.discharge_wh -= wh;
+        }
+    }
+}
+
+void ChunkStats::add(const Record& r) {
+    const Edge edge = { r.time_s, r.power_w, r.pack_current_a };
+    if (!have_edge_) {
+        first_ = edge;
+        first_time_s = r.time_s;
+        have_edge_ = true;
+    } else {
+        integrate(last_, edge);
+    }
+    last_ = edge;
+    last_time_s = r.time_s;
+    rows++;
+
+    pack_voltage_v.add(r.pack_voltage_v);
+    pack_current_a.add(r.pack_current_a);
+    power_w.add(r.power_w);
+    soc_pct.add(r.soc_pct);
+    cell_delta_v.add(r.max_cell_voltage_v - r.min_cell_voltage_v);
+
+    for (int i = 0; i < r.cell_count; ++i) {
+        cells[i].add(r.cell_v[i]);
+    }
+    for (int i = 0; i < r.temp_count; ++i) {
+        temps[i].add(r.temp_c[i]);
+    }
+    if (r.cell_count > max_cells) max_cells = r.cell_count;
+    if (r.temp_count > max_temps) max_temps = r.temp_count;
+    if (r.min_cell_num >= 1 && r.min_cell_num <= MAX_CELLS) lowest_count[r.min_cell_num - 1]++;
+    if (r.max_cell_num >= 1 && r.max_cell_num <= MAX_CELLS) highest_count[r.max_cell_num - 1]++;
+
+    if (config_->resample_s) {
+        bucketFor(r.time_s).add(r);
+    }
+}
+
+void ChunkStats::noteDevice(const char* id, size_t len) {
+    // Logs are per device, so this almost always matches the last entry
+    if (!devices.empty() && devices.back().size() == len && memcmp(devices.back().data(), id, len) == 0) {
+        return;
+    }
+    for (const auto& d : devices) {
+        if (d.size() == len && memcmp(d.data(), id, len) == 0) {
+            return;
+        }
+    }
+    devices.emplace_back(id, len);
+}
+
+void ChunkStats::merge(const ChunkStats& later) {
+    if (later.rows == 0) {
+        errors += later.errors;
+        return;
+    }
+    if (have_edge_) {
+        integrate(last_, later.first_);
+    } else {
+        first_ = later.first_;
+        first_time_s = later.first_time_s;
+        have_edge_ = true;
+    }
+    last_ = later.last_;
+    last_time_s = later.last_time_s;
+
+    rows += later.rows;
+    errors += later.errors;
+    pack_voltage_v.merge(later.pack_voltage_v);
+    pack_current_a.merge(later.pack_current_a);
+    power_w.merge(later.power_w);
+    soc_pct.merge(later.soc_pct);
+    cell_delta_v.merge(later.cell_delta_v);
+    for (int i = 0; i < MAX_CELLS; ++i) {
+        cells[i].merge(later.cells[i]);
+        lowest_count[i] += later.lowest_count[i];
+        highest_count[i] += later.highest_count[i];
+    }
+    for (int i = 0; i < MAX_TEMPS; ++i) {
+        temps[i].merge(later.temps[i]);
+    }
+    if (later.max_cells > max_cells) max_cells = later.max_cells;
+    if (later.max_temps > max_temps) max_temps = later.max_temps;
+    energy.merge(later.energy);
+    for (const auto& d : later.devices) {
+        noteDevice(d.data(), d.size());
+    }
+    for (const auto& kv : later.buckets) {
+        buckets[kv.first].merge(kv.second);
+    }
+}
+
+} // namespace analyzer
@@ -0,0 +1,129 @@
+#ifndef ANALYZER_LOG_STATS_H
+#define ANALYZER_LOG_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+#include "record_decoder.h"
+
+namespace analyzer {
+
+struct StatsConfig {
+    uint32_t max_gap_s = 300;      // longer gaps between samples are not integrated
+    uint32_t resample_s = 0;       // bucket width for the export, 0 = no export
+};
+
+/**
+ * Min/max/mean/stddev from plain sums, so chunks merge by addition
+ */
+struct RunningStat {
+    uint64_t n = 0;
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    float min = std::numeric_limits<float>::infinity();
+    float max = -std::numeric_limits<float>::infinity();
+
+    void add(float x) {
+        n++;
+        sum += x;
+        sum_sq += (double)x * x;
+        if (x < min) min = x;
+        if (x > max) max = x;
+    }
+    void merge(const RunningStat& o);
+    double mean() const { return n ? sum / (double)n : 0.0; }
+    double stddev() const;
+};
+
+struct Energy {
+    double charge_wh = 0.0;
+    double discharge_wh = 0.0;
+    double charge_ah = 0.0;
+    double discharge_ah = 0.0;
+    double covered_s = 0.0;        // time span that was integrated
+    uint64_t gaps = 0;             // sample gaps longer than max_gap_s (or going backwards)
+
+    void merge(const Energy& o);
+};
+
+/**
+ * Averages for one resample bucket
+ */
+struct Bucket {
+    uint32_t n = 0;
+    int cells = 0;
+    int temps = 0;
+    double pack_voltage_v = 0.0;
+    double pack_current_a = 0.0;
+    double power_w = 0.0;
+    double soc_pct = 0.0;
+    float min_cell_voltage_v = std::numeric_limits<float>::infinity();
+    float max_cell_voltage_v = -std::numeric_limits<float>::infinity();
+    double cell_v[MAX_CELLS] = {};
+    double temp_c[MAX_TEMPS] = {};
+    double charge_wh = 0.0;
+    double discharge_wh = 0.0;
+
+    void add(const Record& r);
+    void merge(const Bucket& o);
+};
+
+/**
+ * Aggregates of one chunk; chunks are merged in file order
+ */
+class ChunkStats {
+public:
+    explicit ChunkStats(const StatsConfig& config) : config_(&config) {}
+
+    void add(const Record& r);
+    void addError() { errors++; }
+    void noteDevice(const char* id, size_t len);
+
+    // Append a later chunk, integrating across the boundary
+    void merge(const ChunkStats& later);
+
+    uint64_t rows = 0;
+    uint64_t errors = 0;
+    int64_t first_time_s = 0;
+    int64_t last_time_s = 0;
+
+    RunningStat pack_voltage_v;
+    RunningStat pack_current_a;
+    RunningStat power_w;
+    RunningStat soc_pct;
+    RunningStat cell_delta_v;
+    RunningStat cells[MAX_CELLS];
+    RunningStat temps[MAX_TEMPS];
+    uint64_t lowest_count[MAX_CELLS] = {};    // samples in which this cell was the lowest
+    uint64_t highest_count[MAX_CELLS] = {};
+    int max_cells = 0;
+    int max_temps = 0;
+
+    Energy energy;
+    std::vector<std::string> devices;
+    std::map<int64_t, Bucket> buckets;
+
+private:
+    struct Edge {
+        int64_t time_s;
+        float power_w;
+        float current_a;
+    };
+
+    void integrate(const Edge& a, const Edge& b);
+    Bucket& bucketFor(int64_t time_s);
+
+    const StatsConfig* config_;
+    int64_t bucket_key_ = 0;
+    Bucket* bucket_ = nullptr;        // last bucket used; records arrive in time order
+    bool have_edge_ = false;
+    Edge first_{};
+    Edge last_{};
+};
+
+} // namespace analyzer
+
+#endif // ANALYZER_LOG_STATS_H
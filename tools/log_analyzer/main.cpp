@@ -0,0 +1,363 @@
+// Offline analyzer for SD card logs: per-cell statistics, energy totals and
+// resampled exports over any number of files, parsed in parallel
+//
+//   bms_log_analyzer [options] <file|dir>...
+//     --threads <n>       parser threads (default: all cores)
+//     --chunk-mb <n>      work unit size (default 8)
+//     --max-gap-s <s>     longest sample gap integrated for energy (default 300)
+//     --resample <s>      bucket width for --export (default 60)
+//     --export <path>     write a resampled CSV
+//     --json              print the summary as JSON
+//     --quiet             no throughput line on stderr
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "log_stats.h"
+#include "mapped_file.h"
+#include "record_decoder.h"
+
+using namespace analyzer;
+
+namespace {
+
+struct Options {
+    unsigned threads = 0;
+    size_t chunk_bytes = 8u << 20;
+    std::string export_path;
+    bool json = false;
+    bool quiet = false;
+};
+
+struct FileJob {
+    MappedFile file;
+    std::unique_ptr<RecordDecoder> decoder;
+    std::vector<Chunk> chunks;
+};
+
+struct Task {
+    const FileJob* job;
+    const Chunk* chunk;
+};
+
+void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [--threads n] [--chunk-mb n] [--max-gap-s s] [--resample s]\n"
+            "          [--export out.csv] [--json] [--quiet] <file|dir>...\n", prog);
+}
+
+bool hasCsvExtension(const char* name) {
+    const size_t len = strlen(name);
+    return len > 4 && strcasecmp(name + len - 4, ".csv") == 0;
+}
+
+// Directories expand to their *.csv files; daily file names sort chronologically
+bool collectPaths(const std::string& arg, std::vector<std::string>& out) {
+    struct stat st;
+    if (stat(arg.c_str(), &st) != 0) {
+        fprintf(stderr, "%s: %s\n", arg.c_str(), strerror(errno));
+        return false;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        out.push_back(arg);
+        return true;
+    }
+    DIR* dir = opendir(arg.c_str());
+    if (!dir) {
+        fprintf(stderr, "%s: %s\n", arg.c_str(), strerror(errno));
+        return false;
+    }
+    std::vector<std::string> found;
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.' && hasCsvExtension(entry->d_name)) {
+            found.push_back(arg + "/" + entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(found.begin(), found.end());
+    out.insert(out.end(), found.begin(), found.end());
+    return true;
+}
+
+std::string formatTime(int64_t t) {
+    // Logs written before SNTP sync carry elapsed seconds
+    if (t < 1000000000) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "+%llds", (long long)t);
+        return buf;
+    }
+    const time_t tt = (time_t)t;
+    struct tm tm_utc;
+    gmtime_r(&tt, &tm_utc);
+    char buf[32];
+    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S UTC", &tm_utc);
+    return buf;
+}
+
+double percent(uint64_t part, uint64_t whole) {
+    return whole ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+void printText(const ChunkStats& s, size_t files) {
+    printf("Files:    %zu\n", files);
+    printf("Rows:     %llu (%llu malformed)\n", (unsigned long long)s.rows, (unsigned long long)s.errors);
+    if (s.rows == 0) {
+        return;
+    }
+    printf("Span:     %s .. %s\n", formatTime(s.first_time_s).c_str(), formatTime(s.last_time_s).c_str());
+    printf("Devices: ");
+    for (const auto& d : s.devices) {
+        printf(" %s", d.c_str());
+    }
+    printf("\n\n");
+
+    printf("Energy    in %.1f Wh / %.2f Ah, out %.1f Wh / %.2f Ah, net %+.1f Wh\n",
+           s.energy.charge_wh, s.energy.charge_ah, s.energy.discharge_wh, s.energy.discharge_ah,
+           s.energy.charge_wh - s.energy.discharge_wh);
+    printf("          integrated over %.1f h, %llu gap(s) skipped\n\n",
+           s.energy.covered_s / 3600.0, (unsigned long long)s.energy.gaps);
+
+    printf("%-12s %10s %10s %10s %10s\n", "", "min", "avg", "max", "stddev");
+    const struct {
+        const char* label;
+        const RunningStat& stat;
+    } pack[] = {
+        { "voltage V", s.pack_voltage_v },
+        { "current A", s.pack_current_a },
+        { "power W", s.power_w },
+        { "SOC %", s.soc_pct },
+        { "cell delta V", s.cell_delta_v },
+    };
+    for (const auto& row : pack) {
+        printf("%-12s %10.3f %10.3f %10.3f %10.4f\n", row.label, row.stat.min, row.stat.mean(),
+               row.stat.max, row.stat.stddev());
+    }
+
+    printf("\n%-6s %8s %8s %8s %9s %8s %8s\n", "cell", "min V", "avg V", "max V", "stddev", "lowest", "highest");
+    for (int i = 0; i < s.max_cells; ++i) {
+        const RunningStat& c = s.cells[i];
+        printf("%-6d %8.3f %8.4f %8.3f %9.5f %7.1f%% %7.1f%%\n", i + 1, c.min, c.mean(), c.max, c.stddev(),
+               percent(s.lowest_count[i], s.rows), percent(s.highest_count[i], s.rows));
+    }
+    if (s.max_temps) {
+        printf("\n%-6s %8s %8s %8s\n", "temp", "min C", "avg C", "max C");
+        for (int i = 0; i < s.max_temps; ++i) {
+            const RunningStat& t = s.temps[i];
+            printf("%-6d %8.1f %8.2f %8.1f\n", i + 1, t.min, t.mean(), t.max);
+        }
+    }
+}
+
+void printStatJson(const char* name, const RunningStat& s, bool comma) {
+    printf("\"%s\":{\"min\":%.4f,\"avg\":%.5f,\"max\":%.4f,\"stddev\":%.5f}%s", name, s.n ? s.min : 0.0f,
+           s.mean(), s.n ? s.max : 0.0f, s.stddev(), comma ? "," : "");
+}
+
+void printJson(const ChunkStats& s, size_t files) {
+    printf("{\"files\":%zu,\"rows\":%llu,\"errors\":%llu,\"first_time\":%lld,\"last_time\":%lld,\"devices\":[",
+           files, (unsigned long long)s.rows, (unsigned long long)s.errors, (long long)s.first_time_s,
+           (long long)s.last_time_s);
+    for (size_t i = 0; i < s.devices.size(); ++i) {
+        printf("%s\"%s\"", i ? "," : "", s.devices[i].c_str());
+    }
+    printf("],\"energy\":{\"charge_wh\":%.3f,\"discharge_wh\":%.3f,\"charge_ah\":%.4f,\"discharge_ah\":%.4f,"
+           "\"covered_s\":%.0f,\"gaps\":%llu},",
+           s.energy.charge_wh, s.energy.discharge_wh, s.energy.charge_ah, s.energy.discharge_ah,
+           s.energy.covered_s, (unsigned long long)s.energy.gaps);
+    printf("\"pack\":{");
+    printStatJson("voltage_v", s.pack_voltage_v, true);
+    printStatJson("current_a", s.pack_current_a, true);
+    printStatJson("power_w", s.power_w, true);
+    printStatJson("soc_pct", s.soc_pct, true);
+    printStatJson("cell_delta_v", s.cell_delta_v, false);
+    printf("},\"cells\":[");
+    for (int i = 0; i < s.max_cells; ++i) {
+        const RunningStat& c = s.cells[i];
+        printf("%s{\"min\":%.4f,\"avg\":%.5f,\"max\":%.4f,\"stddev\":%.5f,\"lowest_pct\":%.2f,\"highest_pct\":%.2f}",
+               i ? "," : "", c.min, c.mean(), c.max, c.stddev(), percent(s.lowest_count[i], s.rows),
+               percent(s.highest_count[i], s.rows));
+    }
+    printf("],\"temps\":[");
+    for (int i = 0; i < s.max_temps; ++i) {
+        const RunningStat& t = s.temps[i];
+        printf("%s{\"min\":%.2f,\"avg\":%.3f,\"max\":%.2f}", i ? "," : "", t.min, t.mean(), t.max);
+    }
+    printf("]}\n");
+}
+
+bool writeExport(const ChunkStats& s, const std::string& path) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+    fprintf(f, "timestamp,samples,pack_voltage_v,pack_current_a,power_w,soc_pct,min_cell_voltage_v,"
+               "max_cell_voltage_v");
+    for (int i = 0; i < s.max_cells; ++i) {
+        fprintf(f, ",cell_v_%d", i + 1);
+    }
+    for (int i = 0; i < s.max_temps; ++i) {
+        fprintf(f, ",temp_c_%d", i + 1);
+    }
+    fprintf(f, ",charge_wh,discharge_wh\n");
+
+    for (const auto& kv : s.buckets) {
+        const Bucket& b = kv.second;
+        if (b.n == 0) {
+            // Only energy landed here (interval ending in an otherwise empty bucket)
+            continue;
+        }
+        const double n = (double)b.n;
+        fprintf(f, "%lld,%u,%.3f,%.3f,%.2f,%.2f,%.3f,%.3f", (long long)kv.first, b.n, b.pack_voltage_v / n,
+                b.pack_current_a / n, b.power_w / n, b.soc_pct / n, b.min_cell_voltage_v, b.max_cell_voltage_v);
+        // Averages are over every sample in the bucket; cell/temp counts do not change mid-log
+        for (int i = 0; i < s.max_cells; ++i) {
+            fprintf(f, ",%.4f", i < b.cells ? b.cell_v[i] / n : 0.0);
+        }
+        for (int i = 0; i < s.max_temps; ++i) {
+            fprintf(f, ",%.2f", i < b.temps ? b.temp_c[i] / n : 0.0);
+        }
+        fprintf(f, ",%.4f,%.4f\n", b.charge_wh, b.discharge_wh);
+    }
+    const bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    StatsConfig config;
+    std::vector<std::string> paths;
+    bool resample_set = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--threads") == 0 && has_value) {
+            options.threads = (unsigned)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--chunk-mb") == 0 && has_value) {
+            options.chunk_bytes = (size_t)(strtod(argv[++i], nullptr) * (1 << 20));
+        } else if (strcmp(arg, "--max-gap-s") == 0 && has_value) {
+            config.max_gap_s = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--resample") == 0 && has_value) {
+            config.resample_s = (uint32_t)strtoul(argv[++i], nullptr, 10);
+            resample_set = true;
+        } else if (strcmp(arg, "--export") == 0 && has_value) {
+            options.export_path = argv[++i];
+        } else if (strcmp(arg, "--json") == 0) {
+            options.json = true;
+        } else if (strcmp(arg, "--quiet") == 0) {
+            options.quiet = true;
+        } else if (arg[0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else if (!collectPaths(arg, paths)) {
+            return 1;
+        }
+    }
+    if (paths.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!options.export_path.empty() && !resample_set) {
+        config.resample_s = 60;
+    }
+    if (options.export_path.empty()) {
+        config.resample_s = 0;
+    }
+    if (options.chunk_bytes < 4096) {
+        options.chunk_bytes = 4096;
+    }
+    if (options.threads == 0) {
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+
+    // Map and split every file up front; chunks of all files share one work queue
+    std::vector<std::unique_ptr<FileJob>> jobs;
+    std::vector<Task> tasks;
+    size_t total_bytes = 0;
+    for (const auto& path : paths) {
+        std::unique_ptr<FileJob> job(new FileJob());
+        if (!job->file.open(path)) {
+            fprintf(stderr, "%s\n", job->file.lastError().c_str());
+            return 1;
+        }
+        job->decoder = RecordDecoder::forData(job->file.data(), job->file.size());
+        if (!job->decoder) {
+            if (job->file.size()) {
+                fprintf(stderr, "%s: unrecognised log format, skipped\n", path.c_str());
+            }
+            continue;
+        }
+        job->chunks = job->decoder->split(job->file, options.chunk_bytes);
+        total_bytes += job->file.size();
+        jobs.push_back(std::move(job));
+    }
+    for (const auto& job : jobs) {
+        for (const auto& chunk : job->chunks) {
+            tasks.push_back({ job.get(), &chunk });
+        }
+    }
+
+    // One ChunkStats per task, built in place and merged in file order afterwards
+    std::vector<std::unique_ptr<ChunkStats>> results;
+    results.reserve(tasks.size());
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        results.emplace_back(new ChunkStats(config));
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < tasks.size(); i = next.fetch_add(1)) {
+            tasks[i].job->decoder->decode(tasks[i].job->file, *tasks[i].chunk, *results[i]);
+        }
+    };
+    const unsigned thread_count = (unsigned)std::min<size_t>(options.threads, std::max<size_t>(1, tasks.size()));
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < thread_count; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ChunkStats total(config);
+    for (const auto& r : results) {
+        total.merge(*r);
+    }
+    results.clear();
+
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    if (options.json) {
+        printJson(total, jobs.size());
+    } else {
+        printText(total, jobs.size());
+    }
+    if (!options.export_path.empty() && !writeExport(total, options.export_path)) {
+        return 1;
+    }
+    if (!options.quiet) {
+        fprintf(stderr, "Parsed %.1f MB in %.3f s with %u thread(s): %.0f MB/s, %.2f M rows/s\n",
+                (double)total_bytes / 1e6, seconds, thread_count,
+                seconds > 0 ? (double)total_bytes / 1e6 / seconds : 0.0,
+                seconds > 0 ? (double)total.rows / 1e6 / seconds : 0.0);
+    }
+    return total.rows > 0 ? 0 : 1;
+}
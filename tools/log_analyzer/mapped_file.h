@@ -0,0 +1,42 @@
+#ifndef ANALYZER_MAPPED_FILE_H
+#define ANALYZER_MAPPED_FILE_H
+
+#include <stddef.h>
+#include <string>
+
+namespace analyzer {
+
+/**
+ * Read-only memory map of a whole log file
+ *
+ * Pages are faulted in by the parser threads as they touch them; the kernel is
+ * told the access is sequential so read-ahead stays ahead of the scan.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    const std::string& path() const { return path_; }
+    const std::string& lastError() const { return last_error_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::string path_;
+    std::string last_error_;
+};
+
+} // namespace analyzer
+
+#endif // ANALYZER_MAPPED_FILE_H
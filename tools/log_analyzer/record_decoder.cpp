@@ -0,0 +1,16 @@
+#include "record_decoder.h"
+#include "csv_decoder.h"
+
+namespace analyzer {
+
+std::unique_ptr<RecordDecoder> RecordDecoder::forData(const char* data, size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+    if (CsvDecoder::looksLikeCsv(data, size)) {
+        return std::unique_ptr<RecordDecoder>(new CsvDecoder());
+    }
+    return nullptr;
+}
+
+} // namespace analyzer
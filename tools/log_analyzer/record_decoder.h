@@ -0,0 +1,76 @@
+#ifndef ANALYZER_RECORD_DECODER_H
+#define ANALYZER_RECORD_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include "mapped_file.h"
+
+namespace analyzer {
+
+constexpr int MAX_CELLS = 32;
+constexpr int MAX_TEMPS = 16;
+
+/**
+ * One decoded sample, the subset of BMSSnapshot the analyzer aggregates
+ */
+struct Record {
+    int64_t time_s = 0;           // real timestamp, elapsed seconds when the clock was not set
+    float pack_voltage_v = 0.0f;
+    float pack_current_a = 0.0f;  // positive = charging
+    float power_w = 0.0f;
+    float soc_pct = 0.0f;
+    float min_cell_voltage_v = 0.0f;
+    float max_cell_voltage_v = 0.0f;
+    int min_cell_num = 0;         // 1-based, 0 if unknown
+    int max_cell_num = 0;
+    int cell_count = 0;
+    int temp_count = 0;
+    float cell_v[MAX_CELLS] = {};
+    float temp_c[MAX_TEMPS] = {};
+};
+
+class ChunkStats;
+
+/**
+ * A byte range of one file that decodes independently of its neighbours
+ */
+struct Chunk {
+    size_t begin = 0;
+    size_t end = 0;
+    size_t layout = 0;    // decoder-specific (e.g. which CSV header governs the range)
+};
+
+/**
+ * Turns a mapped log file into records
+ *
+ * CSV from the SD card sink is the only format today. A binary format adds a
+ * decoder here and a signature check in forData(); splitting and aggregation
+ * stay the same.
+ */
+class RecordDecoder {
+public:
+    virtual ~RecordDecoder() = default;
+
+    virtual const char* name() const = 0;
+
+    /**
+     * Cut the file into chunks of roughly target_bytes on record boundaries
+     */
+    virtual std::vector<Chunk> split(const MappedFile& file, size_t target_bytes) = 0;
+
+    /**
+     * Decode one chunk into stats; safe to call concurrently for different chunks
+     */
+    virtual void decode(const MappedFile& file, const Chunk& chunk, ChunkStats& stats) const = 0;
+
+    /**
+     * Pick a decoder by content; nullptr if the format is not recognised
+     */
+    static std::unique_ptr<RecordDecoder> forData(const char* data, size_t size);
+};
+
+} // namespace analyzer
+
+#endif // ANALYZER_RECORD_DECODER_H
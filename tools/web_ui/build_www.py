@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+Pack the dashboard into an image for the "www" flash partition
+
+Every file is gzipped once here, so the device sends bytes straight from
+flash. Files other than index.html get a content hash in their name
+(app.js -> app.3f9c2a1b.js), references in index.html are rewritten, and the
+device serves them as immutable; index.html itself is revalidated by ETag.
+
+Image layout (little-endian), read by components/web_ui/web_ui.cpp:
+  header  16 bytes   "BWW1", entry count, data size, reserved
+  entries 128 bytes  path[64], content_type[32], offset, size, flags, etag[20]
+  data               gzip bodies, 4-byte aligned, offsets from image start
+Entries are sorted by path for binary search.
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import struct
+import sys
+
+MAGIC = b"BWW1"
+HEADER = struct.Struct("<4sIII")
+ENTRY = struct.Struct("<64s32sIII20s")
+FLAG_GZIP = 1 << 0
+FLAG_IMMUTABLE = 1 << 1
+
+CONTENT_TYPES = {
+    ".html": "text/html; charset=utf-8",
+    ".js": "application/javascript",
+    ".css": "text/css",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+    ".json": "application/json",
+}
+
+# Already compressed; gzip only costs decode time on the client
+NO_GZIP = {".png"}
+
+
+def digest(data):
+    return hashlib.sha256(data).hexdigest()
+
+
+def build(src_dir):
+    names = sorted(n for n in os.listdir(src_dir) if os.path.isfile(os.path.join(src_dir, n)))
+    if "index.html" not in names:
+        sys.exit(f"error: {src_dir}/index.html missing")
+
+    assets = []
+    renames = {}
+    for name in names:
+        if name == "index.html":
+            continue
+        with open(os.path.join(src_dir, name), "rb") as f:
+            data = f.read()
+        stem, ext = os.path.splitext(name)
+        hashed = f"{stem}.{digest(data)[:8]}{ext}"
+        renames[name] = hashed
+        assets.append((hashed, ext, data, FLAG_IMMUTABLE))
+
+    with open(os.path.join(src_dir, "index.html"), "rb") as f:
+        index = f.read()
+    for name, hashed in renames.items():
+        index = index.replace(f'"{name}"'.encode(), f'"{hashed}"'.encode())
+    assets.append(("index.html", ".html", index, 0))
+
+    entries = []
+    for name, ext, data, flags in assets:
+        if ext not in CONTENT_TYPES:
+            sys.exit(f"error: no content type for {name}")
+        if ext not in NO_GZIP:
+            # mtime=0 keeps the image reproducible
+            data = gzip.compress(data, compresslevel=9, mtime=0)
+            flags |= FLAG_GZIP
+        etag = f'"{digest(data)[:16]}"'
+        entries.append(("/" + name, CONTENT_TYPES[ext], data, flags, etag))
+    entries.sort(key=lambda e: e[0].encode())
+    return entries
+
+
+def pack(entries):
+    offset = HEADER.size + ENTRY.size * len(entries)
+    table = b""
+    body = b""
+    for path, ctype, data, flags, etag in entries:
+        if len(path) >= 64:
+            sys.exit(f"error: path too long: {path}")
+        pad = (-(offset + len(body))) % 4
+        body += b"\0" * pad
+        table += ENTRY.pack(path.encode(), ctype.encode(), offset + len(body), len(data), flags, etag.encode())
+        body += data
+    return HEADER.pack(MAGIC, len(entries), len(body), 0) + table + body
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build the www partition image for the dashboard")
+    parser.add_argument("src", help="asset directory (tools/web_ui/www)")
+    parser.add_argument("out", help="output image (e.g. build/www.bin)")
+    parser.add_argument("--size", type=lambda s: int(s, 0), default=0,
+                        help="partition size; fail if the image does not fit")
+    args = parser.parse_args()
+
+    entries = build(args.src)
+    image = pack(entries)
+    if args.size and len(image) > args.size:
+        sys.exit(f"error: image is {len(image)} bytes, partition holds {args.size}")
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.out)), exist_ok=True)
+    with open(args.out, "wb") as f:
+        f.write(image)
+    for path, _, data, flags, _ in entries:
+        cache = "immutable" if flags & FLAG_IMMUTABLE else "revalidate"
+        print(f"  {path:<32} {len(data):>7} bytes  {cache}")
+    print(f"{args.out}: {len(entries)} files, {len(image)} bytes")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,117 @@
+// Live dashboard fed by the device's /events stream (one JSON snapshot per poll)
+(function () {
+  'use strict';
+  const $ = (id) => document.getElementById(id);
+  const HISTORY_MS = 5 * 60 * 1000;
+  const trend = [];
+
+  function fmtDuration(s) {
+    if (s < 0) return '-';
+    const h = Math.floor(s / 3600);
+    const m = Math.floor((s % 3600) / 60);
+    return h > 0 ? h + 'h ' + m + 'm' : m + 'm';
+  }
+
+  function badge(el, on, text, cls) {
+    el.textContent = text;
+    el.className = 'badge ' + (cls || (on ? 'on' : 'off'));
+  }
+
+  function renderCells(d) {
+    const box = $('cells');
+    const cells = d.cells || [];
+    if (box.children.length !== cells.length) {
+      box.innerHTML = '';
+      cells.forEach(() => {
+        const bar = document.createElement('div');
+        bar.className = 'bar';
+        bar.appendChild(document.createElement('span'));
+        box.appendChild(bar);
+      });
+    }
+    const lo = Math.min.apply(null, cells) - 0.02;
+    const hi = Math.max.apply(null, cells) + 0.02;
+    cells.forEach((v, n) => {
+      const bar = box.children[n];
+      bar.style.height = (10 + 90 * (v - lo) / (hi - lo || 1)) + '%';
+      bar.className = 'bar' + (n + 1 === d.cmin ? ' min' : n + 1 === d.cmax ? ' max' : '');
+      bar.firstChild.textContent = v.toFixed(3);
+    });
+    $('delta').textContent = 'delta ' + (d.dv * 1000).toFixed(0) + ' mV';
+  }
+
+  function renderTrend() {
+    const canvas = $('trend');
+    const w = canvas.width = canvas.clientWidth * devicePixelRatio;
+    const h = canvas.height = 120 * devicePixelRatio;
+    const ctx = canvas.getContext('2d');
+    ctx.clearRect(0, 0, w, h);
+    if (trend.length < 2) return;
+    const now = trend[trend.length - 1][0];
+    let lo = 0;
+    let hi = 0;
+    trend.forEach((s) => { lo = Math.min(lo, s[1]); hi = Math.max(hi, s[1]); });
+    const span = hi - lo || 1;
+    const y = (p) => h - 4 - (h - 8) * (p - lo) / span;
+    ctx.strokeStyle = '#2a313b';
+    ctx.beginPath();
+    ctx.moveTo(0, y(0));
+    ctx.lineTo(w, y(0));
+    ctx.stroke();
+    ctx.strokeStyle = '#4c9aff';
+    ctx.lineWidth = 2 * devicePixelRatio;
+    ctx.beginPath();
+    trend.forEach((s, n) => {
+      const x = w * (1 - (now - s[0]) / HISTORY_MS);
+      if (n === 0) ctx.moveTo(x, y(s[1])); else ctx.lineTo(x, y(s[1]));
+    });
+    ctx.stroke();
+  }
+
+  function render(d) {
+    $('dev').textContent = d.dev;
+    $('v').textContent = d.v.toFixed(2);
+    $('i').textContent = d.i.toFixed(2);
+    $('p').textContent = d.p.toFixed(0);
+    $('soc').textContent = d.soc.toFixed(0);
+    $('soh').textContent = d.soh > 0 ? d.soh.toFixed(0) : '-';
+    const charging = d.i > 0;
+    $('rt').textContent = fmtDuration(charging ? d.ttf : d.tte);
+    $('rtl').textContent = charging ? 'to full' : 'to empty';
+    renderCells(d);
+
+    const temps = $('temps');
+    temps.innerHTML = '';
+    (d.temps || []).forEach((t) => {
+      const chip = document.createElement('span');
+      chip.className = 'chip';
+      chip.textContent = t.toFixed(1) + ' °C';
+      temps.appendChild(chip);
+    });
+
+    badge($('chg'), d.chg, d.chg ? 'charge on' : 'charge off');
+    badge($('dsg'), d.dsg, d.dsg ? 'discharge on' : 'discharge off');
+    const levels = ['cells ok', 'cell ' + d.anc + ' watch', 'cell ' + d.anc + ' warning', 'cell ' + d.anc + ' alarm'];
+    badge($('an'), d.an === 0, levels[Math.min(d.an, 3)], d.an === 1 ? 'warn' : null);
+
+    $('ts').textContent = d.t > 1500000000 ? new Date(d.t * 1000).toLocaleString() : 'uptime ' + fmtDuration(d.up);
+
+    // Checkpoint restored at boot: show it, but keep it out of the live trend
+    if (d.stale) {
+      badge($('link'), false, 'last known', 'warn');
+      return;
+    }
+    badge($('link'), true, 'live');
+
+    const now = Date.now();
+    trend.push([now, d.p]);
+    while (trend.length && now - trend[0][0] > HISTORY_MS) trend.shift();
+    renderTrend();
+  }
+
+  const events = new EventSource('/events');
+  events.onopen = () => badge($('link'), true, 'live');
+  events.onerror = () => badge($('link'), false, 'reconnecting');
+  events.onmessage = (e) => render(JSON.parse(e.data));
+  window.addEventListener('resize', renderTrend);
+})();